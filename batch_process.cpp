@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <config/Config.h>
+#include <server/BatchProcessor.h>
+#include <server/RequestHandler.h>
+
+int main(int argc, char *argv[])
+{
+	// Load configuration
+	Config::loadFromFile("config.yaml");
+	Config::loadFromArgs(argc, argv);
+
+	const std::string input = Config::getString("batch.input", "");
+	const std::string output = Config::getString("batch.output", "");
+	if (input.empty())
+	{
+		std::cerr << "Usage: batch_process --batch.input=FILE.jsonl [--batch.output=RESULTS.jsonl]"
+				  << " [--batch.threads=N] [--batch.chunk_mb=M]" << std::endl;
+		return 1;
+	}
+
+	BatchProcessor::Options options;
+	options.threads = static_cast<size_t>(std::max(Config::getInt("batch.threads", 0), 0));
+	options.chunk_bytes = static_cast<size_t>(std::max(Config::getInt("batch.chunk_mb", 16), 1)) << 20;
+
+	RequestHandler handler;
+	BatchProcessor processor(handler, options);
+	processor.onProgress([](uint64_t done, uint64_t total, uint64_t lines)
+						 {
+		std::fprintf(stderr, "\r%6.1f%%  %llu / %llu MiB  %llu lines", total > 0 ? 100.0 * done / total : 100.0,
+					 static_cast<unsigned long long>(done >> 20), static_cast<unsigned long long>(total >> 20),
+					 static_cast<unsigned long long>(lines)); });
+
+	if (!processor.processFile(input))
+	{
+		return 1;
+	}
+	std::cerr << std::endl;
+
+	const auto &summary = processor.summary();
+	const double seconds = summary.seconds > 0 ? summary.seconds : 1e-9;
+	std::cout << "Processed " << summary.lines << " lines (" << summary.applied << " applied, " << summary.rejected
+			  << " rejected) for " << summary.clients << " clients in " << summary.seconds << " s" << std::endl;
+	std::cout << "Throughput: " << static_cast<double>(summary.bytes) / seconds / (1 << 20) << " MiB/s, "
+			  << static_cast<double>(summary.lines) / seconds << " lines/s" << std::endl;
+	std::cout << "Total numbers sum: " << summary.total_sum << std::endl;
+
+	if (!output.empty())
+	{
+		if (!processor.writeResults(output))
+		{
+			return 1;
+		}
+		std::cout << "Wrote per-client results to " << output << std::endl;
+	}
+	return 0;
+}
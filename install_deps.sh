@@ -22,7 +22,8 @@ apt-get install -y \
     libyaml-cpp-dev \
     libspdlog-dev \
     libgtest-dev \
-    libgmock-dev
+    libgmock-dev \
+    zlib1g-dev
 
 # Install additional tools for development and monitoring
 apt-get install -y \
@@ -0,0 +1,100 @@
+// Example handler plugin, see src/server/PluginApi.h. Built as
+// libexample_plugin.so; copy it into plugins.directory to serve:
+//   GET  /plugin/echo?...   method, path and query of the request (event loop)
+//   GET  /plugin/repeat?n=N N bytes of 'x', to exercise buffer growth (worker)
+//   POST /plugin/count/*    body size and the number of calls so far (worker)
+
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include <server/PluginApi.h>
+
+namespace
+{
+	struct State
+	{
+		std::atomic<uint64_t> calls{0};
+	};
+
+	std::string_view view(service_str s)
+	{
+		return std::string_view(s.data, s.size);
+	}
+
+	// snprintf into the response, or the size needed
+	template <typename... Args>
+	int format(service_response *response, const char *pattern, Args... args)
+	{
+		const int length = std::snprintf(response->data, response->capacity, pattern, args...);
+		if (length < 0)
+			return SERVICE_PLUGIN_ERROR;
+		response->size = static_cast<size_t>(length);
+		return response->size < response->capacity ? SERVICE_PLUGIN_OK : SERVICE_PLUGIN_NEED_SPACE;
+	}
+
+	int echo(void *, const service_request *request, service_response *response)
+	{
+		return format(response, R"({"method": "%.*s", "path": "%.*s", "query": "%.*s", "success": true})",
+					  static_cast<int>(request->method.size), request->method.data,
+					  static_cast<int>(request->path.size), request->path.data,
+					  static_cast<int>(request->query.size), request->query.data);
+	}
+
+	int repeat(void *, const service_request *request, service_response *response)
+	{
+		std::string_view query = view(request->query);
+		size_t count = 0;
+		if (!query.starts_with("n=") ||
+			std::from_chars(query.data() + 2, query.data() + query.size(), count).ec != std::errc{})
+		{
+			response->status = 400;
+			return format(response, R"({"error": "Expected ?n=<bytes>", "success": false})");
+		}
+		response->size = count;
+		if (count > response->capacity)
+			return SERVICE_PLUGIN_NEED_SPACE;
+		std::memset(response->data, 'x', count);
+		response->content_type = "text/plain";
+		return SERVICE_PLUGIN_OK;
+	}
+
+	int count(void *state, const service_request *request, service_response *response)
+	{
+		const uint64_t calls = ++static_cast<State *>(state)->calls;
+		return format(response, R"({"bytes": %zu, "calls": %llu, "success": true})", request->body.size,
+					  static_cast<unsigned long long>(calls));
+	}
+
+	void *create()
+	{
+		return new State();
+	}
+
+	void destroy(void *state)
+	{
+		delete static_cast<State *>(state);
+	}
+
+	const service_route routes[] = {
+		{"GET", "/plugin/echo", SERVICE_EXEC_REACTOR, echo},
+		{"GET", "/plugin/repeat", SERVICE_EXEC_WORKER, repeat},
+		{"POST", "/plugin/count/*", SERVICE_EXEC_WORKER, count},
+	};
+
+	const service_plugin plugin = {
+		SERVICE_PLUGIN_ABI_VERSION,
+		"example",
+		create,
+		destroy,
+		routes,
+		sizeof(routes) / sizeof(routes[0]),
+	};
+}
+
+extern "C" const service_plugin *service_plugin_entry()
+{
+	return &plugin;
+}
@@ -3,6 +3,7 @@
 #include <memory>
 
 #include <config/Config.h>
+#include <server/Allocator.h>
 #include <server/ServerFactory.h>
 
 int main(int argc, char *argv[])
@@ -10,6 +11,7 @@ int main(int argc, char *argv[])
     // Load configuration
     Config::loadFromFile("config.yaml");
     Config::loadFromArgs(argc, argv);
+    Allocator::initialize();
 
     // Get server configuration with defaults
     std::string host = Config::getString("server.host", "0.0.0.0");
@@ -12,13 +12,20 @@ Client::Client(const std::string &host, int port)
 }
 
 std::string Client::sendRequest(const std::string &endpoint, const std::string &method,
-								const std::string &body, const std::string &content_type)
+								const std::string &body, const std::string &content_type,
+								const std::string &accept)
 {
 	try
 	{
+		httplib::Headers headers;
+		if (!accept.empty())
+		{
+			headers.emplace("Accept", accept);
+		}
+
 		if (method == "GET")
 		{
-			auto response = client.Get(endpoint);
+			auto response = client.Get(endpoint, headers);
 			if (response && response->status == 200)
 			{
 				return response->body;
@@ -31,7 +38,7 @@ std::string Client::sendRequest(const std::string &endpoint, const std::string &
 		}
 		else if (method == "POST")
 		{
-			auto response = client.Post(endpoint, body, content_type);
+			auto response = client.Post(endpoint, headers, body, content_type);
 			if (response && response->status == 200)
 			{
 				return response->body;
@@ -10,9 +10,10 @@ class Client
 public:
 	Client(const std::string &host = "localhost", int port = 8080);
 
-	// Core request method used by tests
+	// Core request method used by tests; a non-empty accept is sent as the Accept header
 	std::string sendRequest(const std::string &endpoint, const std::string &method,
-							const std::string &body = "", const std::string &content_type = "application/json");
+							const std::string &body = "", const std::string &content_type = "application/json",
+							const std::string &accept = "");
 
 	// Test connection to server
 	bool testConnection(int timeout_seconds = 5);
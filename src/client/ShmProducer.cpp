@@ -0,0 +1,154 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <client/ShmProducer.h>
+
+ShmProducer::~ShmProducer()
+{
+	close();
+}
+
+bool ShmProducer::connect(const std::string &socket_path, uint32_t capacity, ShmRing::Mode mode)
+{
+	close();
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (socket_ < 0)
+	{
+		return false;
+	}
+	if (::connect(socket_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+	{
+		close();
+		return false;
+	}
+
+	ShmRing::Hello hello;
+	hello.capacity = capacity;
+	hello.mode = mode;
+	if (send(socket_, &hello, sizeof(hello), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(hello)))
+	{
+		close();
+		return false;
+	}
+
+	// The reply carries the ring's memfd and the server's wake eventfd
+	ShmRing::Hello reply;
+	iovec iov{&reply, sizeof(reply)};
+	alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))];
+	msghdr message{};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	ssize_t got = recvmsg(socket_, &message, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+
+	int fds[2] = {-1, -1};
+	cmsghdr *rights = CMSG_FIRSTHDR(&message);
+	if (rights != nullptr && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS &&
+		rights->cmsg_len == CMSG_LEN(sizeof(fds)))
+	{
+		std::memcpy(fds, CMSG_DATA(rights), sizeof(fds));
+	}
+	if (got != static_cast<ssize_t>(sizeof(reply)) || reply.magic != ShmRing::MAGIC || fds[0] < 0 || fds[1] < 0)
+	{
+		for (int fd : fds)
+		{
+			if (fd >= 0)
+				::close(fd);
+		}
+		close();
+		errno = EPROTO;
+		return false;
+	}
+
+	wake_fd_ = fds[1];
+	size_ = ShmRing::bytesFor(reply.capacity);
+	memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+	::close(fds[0]);
+	if (memory_ == MAP_FAILED)
+	{
+		memory_ = nullptr;
+		close();
+		return false;
+	}
+
+	ring_ = ShmRing::attach(memory_, size_);
+	if (!ring_.valid())
+	{
+		close();
+		errno = EPROTO;
+		return false;
+	}
+	return true;
+}
+
+void ShmProducer::close()
+{
+	ring_ = ShmRing();
+	if (memory_ != nullptr)
+	{
+		munmap(memory_, size_);
+		memory_ = nullptr;
+	}
+	if (wake_fd_ >= 0)
+	{
+		::close(wake_fd_);
+		wake_fd_ = -1;
+	}
+	if (socket_ >= 0)
+	{
+		::close(socket_);
+		socket_ = -1;
+	}
+}
+
+bool ShmProducer::push(int32_t id, int32_t number)
+{
+	if (!ring_.valid() || !ring_.push({id, number}))
+	{
+		return false;
+	}
+	if (ring_.producerShouldWake())
+	{
+		wakeConsumer();
+	}
+	return true;
+}
+
+size_t ShmProducer::push(std::span<const ShmRing::Record> records)
+{
+	size_t pushed = 0;
+	while (ring_.valid() && pushed < records.size() && ring_.push(records[pushed]))
+	{
+		++pushed;
+	}
+	if (pushed > 0 && ring_.producerShouldWake())
+	{
+		wakeConsumer();
+	}
+	return pushed;
+}
+
+void ShmProducer::wakeConsumer()
+{
+	const uint64_t one = 1;
+	if (write(wake_fd_, &one, sizeof(one)) == static_cast<ssize_t>(sizeof(one)))
+	{
+		wakeups_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include <common/ShmRing.h>
+
+// Producer end of shared-memory ingestion for processes on the server's
+// host. connect() asks the server's Unix socket (server.shm_socket) for a
+// ring and receives its memfd and the server's wake eventfd; after that a
+// push is a few memory operations on the mapped ring, and the only syscall
+// is an eventfd write when the server has gone to sleep on an idle ring.
+// The connection stays open while the ring is in use; closing it tells the
+// server to drain and drop the ring. With Mode::MultiProducer any number of
+// threads may push, with SingleProducer only one at a time.
+class ShmProducer
+{
+public:
+	ShmProducer() = default;
+	~ShmProducer();
+
+	ShmProducer(const ShmProducer &) = delete;
+	ShmProducer &operator=(const ShmProducer &) = delete;
+
+	// capacity is a hint in records; the server rounds it to a power of two.
+	// false with errno set if the server cannot be reached or refuses
+	bool connect(const std::string &socket_path, uint32_t capacity = 1u << 16,
+				 ShmRing::Mode mode = ShmRing::Mode::SingleProducer);
+	void close();
+	bool connected() const { return ring_.valid(); }
+
+	// false when the ring is full; the caller decides whether to retry
+	bool push(int32_t id, int32_t number);
+	// Pushes records in order until the ring is full; returns how many went in
+	size_t push(std::span<const ShmRing::Record> records);
+
+	uint32_t capacity() const { return ring_.valid() ? ring_.capacity() : 0; }
+	// Records the server has not taken yet
+	uint64_t pending() const { return ring_.valid() ? ring_.size() : 0; }
+	// eventfd writes so far, the producer's only syscalls after connect()
+	uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+private:
+	void wakeConsumer();
+
+	int socket_ = -1;
+	int wake_fd_ = -1;
+	void *memory_ = nullptr;
+	size_t size_ = 0;
+	ShmRing ring_;
+	std::atomic<uint64_t> wakeups_{0};
+};
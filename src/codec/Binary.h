@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <codec/Describe.h>
+
+// Decoding shared by the binary formats. A format supplies a reader over the
+// request bytes with peek(), readBool(), readInteger(), readFloat(),
+// readString(), readArrayHeader(), readMapHeader(), skip(), offset() and
+// atEnd(); strings are returned as views into the request, so nothing is
+// copied until a value lands in its field.
+namespace codec
+{
+	enum class ItemType
+	{
+		Nil,
+		Bool,
+		Integer,
+		Float,
+		String,
+		Bytes,
+		Array,
+		Map,
+		Other,	 // extensions, tags, simple values
+		Invalid, // truncated input or a reserved byte
+	};
+
+	// Integer item: raw, or -1 - raw when negative (covers the full CBOR range)
+	struct Integer
+	{
+		bool negative = false;
+		uint64_t raw = 0;
+
+		static Integer fromSigned(int64_t value)
+		{
+			return value < 0 ? Integer{true, ~static_cast<uint64_t>(value)} : Integer{false, static_cast<uint64_t>(value)};
+		}
+	};
+
+	template <typename U>
+	inline U loadBigEndian(const char *p)
+	{
+		U value = 0;
+		for (size_t i = 0; i < sizeof(U); ++i)
+		{
+			value = static_cast<U>((value << 8) | static_cast<unsigned char>(p[i]));
+		}
+		return value;
+	}
+
+	inline void appendBigEndian(std::string &out, uint64_t value, size_t bytes)
+	{
+		for (size_t i = bytes; i-- > 0;)
+		{
+			out += static_cast<char>((value >> (8 * i)) & 0xFF);
+		}
+	}
+
+	enum class ReadResult
+	{
+		Stored,
+		Mismatch,  // well-formed item of another type, consumed
+		Malformed, // the document is broken
+	};
+
+	template <typename Target>
+	bool assignInteger(Integer n, Target &target)
+	{
+		if constexpr (std::is_floating_point_v<Target>)
+		{
+			target = n.negative ? -1.0 - static_cast<Target>(n.raw) : static_cast<Target>(n.raw);
+			return true;
+		}
+		else if constexpr (std::is_signed_v<Target>)
+		{
+			if (n.negative)
+			{
+				if (n.raw > static_cast<uint64_t>(std::numeric_limits<Target>::max()))
+					return false;
+				target = static_cast<Target>(-1 - static_cast<Target>(n.raw));
+				return true;
+			}
+			if (!std::in_range<Target>(n.raw))
+				return false;
+			target = static_cast<Target>(n.raw);
+			return true;
+		}
+		else
+		{
+			if (n.negative || !std::in_range<Target>(n.raw))
+				return false;
+			target = static_cast<Target>(n.raw);
+			return true;
+		}
+	}
+
+	// Reads the next item into target when its type fits, otherwise skips it
+	template <typename Reader, typename Target>
+	ReadResult readField(Reader &reader, Target &target)
+	{
+		ItemType type = reader.peek();
+		if (type == ItemType::Invalid)
+			return ReadResult::Malformed;
+
+		if constexpr (std::is_same_v<Target, bool>)
+		{
+			if (type == ItemType::Bool)
+				return reader.readBool(target) ? ReadResult::Stored : ReadResult::Malformed;
+		}
+		else if constexpr (std::is_arithmetic_v<Target>)
+		{
+			if (type == ItemType::Integer)
+			{
+				Integer n;
+				if (!reader.readInteger(n))
+					return ReadResult::Malformed;
+				return assignInteger(n, target) ? ReadResult::Stored : ReadResult::Mismatch;
+			}
+			if constexpr (std::is_floating_point_v<Target>)
+			{
+				if (type == ItemType::Float)
+				{
+					double d;
+					if (!reader.readFloat(d))
+						return ReadResult::Malformed;
+					target = static_cast<Target>(d);
+					return ReadResult::Stored;
+				}
+			}
+		}
+		else if constexpr (std::is_same_v<Target, std::string>)
+		{
+			if (type == ItemType::String)
+			{
+				std::string_view s;
+				if (!reader.readString(s))
+					return ReadResult::Malformed;
+				target.assign(s.data(), s.size());
+				return ReadResult::Stored;
+			}
+		}
+
+		return reader.skip() ? ReadResult::Mismatch : ReadResult::Malformed;
+	}
+
+	// Same rules as the JSON decoder: the root must be a map, unknown and
+	// non-string keys are skipped, the first occurrence of a key wins and the
+	// whole item is read before field errors are reported.
+	template <Described T, typename Reader>
+	std::expected<T, DecodeError> decodeObject(Reader &reader)
+	{
+		ItemType type = reader.peek();
+		if (type != ItemType::Map)
+		{
+			if (type == ItemType::Invalid || !reader.skip())
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			return std::unexpected(DecodeError{DecodeError::NotAnObject});
+		}
+
+		size_t count;
+		if (!reader.readMapHeader(count))
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+
+		T value{};
+		FieldStates<T> states{};
+		for (size_t i = 0; i < count; ++i)
+		{
+			int index = -1;
+			if (reader.peek() == ItemType::String)
+			{
+				std::string_view key;
+				if (!reader.readString(key))
+					return std::unexpected(DecodeError{DecodeError::Syntax});
+				index = findField<T>(key);
+			}
+			else if (!reader.skip())
+			{
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			}
+
+			if (index < 0 || states[index] != FieldState::Missing)
+			{
+				if (!reader.skip())
+					return std::unexpected(DecodeError{DecodeError::Syntax});
+				continue;
+			}
+
+			ReadResult result = ReadResult::Malformed;
+			visitField<T>(index, [&](const auto &field)
+						  {
+				result = readField(reader, field.get(value));
+				return true; });
+			if (result == ReadResult::Malformed)
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			states[index] = result == ReadResult::Stored ? FieldState::Set : FieldState::WrongType;
+		}
+
+		if (auto fields = checkFields(states); !fields)
+			return std::unexpected(fields.error());
+		return value;
+	}
+
+	// Decodes a whole document; bytes after the root item are a syntax error
+	template <Described T, typename Reader>
+	std::expected<T, DecodeError> decodeDocument(std::string_view data)
+	{
+		Reader reader(data);
+		auto value = decodeObject<T>(reader);
+		if ((value || value.error().kind != DecodeError::Syntax) && !reader.atEnd())
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		return value;
+	}
+
+	// Splits a root array into the encoded bytes of each element, without decoding them
+	template <typename Reader>
+	std::expected<std::vector<std::string_view>, DecodeError> splitDocumentArray(std::string_view data)
+	{
+		Reader reader(data);
+		ItemType type = reader.peek();
+		if (type != ItemType::Array)
+		{
+			if (type == ItemType::Invalid || !reader.skip() || !reader.atEnd())
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			return std::unexpected(DecodeError{DecodeError::NotAnObject});
+		}
+
+		size_t count;
+		if (!reader.readArrayHeader(count))
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+
+		std::vector<std::string_view> items;
+		items.reserve(std::min(count, data.size()));
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t start = reader.offset();
+			if (!reader.skip())
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			items.push_back(data.substr(start, reader.offset() - start));
+		}
+
+		if (!reader.atEnd())
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		return items;
+	}
+
+	// Decodes a root array of strings with the same errors as decodeJsonStrings
+	template <typename Reader>
+	std::expected<std::vector<std::string>, DecodeError> decodeStringArray(std::string_view data)
+	{
+		Reader reader(data);
+		ItemType type = reader.peek();
+		if (type != ItemType::Array)
+		{
+			if (type == ItemType::Invalid || !reader.skip() || !reader.atEnd())
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			return std::unexpected(DecodeError{DecodeError::NotAnObject});
+		}
+
+		size_t count;
+		if (!reader.readArrayHeader(count))
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+
+		std::vector<std::string> items;
+		items.reserve(std::min(count, data.size()));
+		int wrong_index = -1;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (reader.peek() == ItemType::String)
+			{
+				std::string_view s;
+				if (!reader.readString(s))
+					return std::unexpected(DecodeError{DecodeError::Syntax});
+				items.emplace_back(s);
+				continue;
+			}
+
+			if (!reader.skip())
+				return std::unexpected(DecodeError{DecodeError::Syntax});
+			if (wrong_index < 0)
+				wrong_index = static_cast<int>(i);
+		}
+
+		if (!reader.atEnd())
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		if (wrong_index >= 0)
+			return std::unexpected(DecodeError{DecodeError::WrongType, static_cast<size_t>(wrong_index)});
+		return items;
+	}
+}
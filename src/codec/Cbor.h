@@ -0,0 +1,343 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <codec/Binary.h>
+#include <codec/Describe.h>
+
+// CBOR (RFC 8949). Indefinite-length items are rejected: every producer we
+// talk to encodes definite lengths, and it keeps strings zero-copy.
+namespace codec
+{
+	class CborReader
+	{
+	public:
+		explicit CborReader(std::string_view data) : data_(data) {}
+
+		size_t offset() const { return pos_; }
+		bool atEnd() const { return pos_ == data_.size(); }
+
+		ItemType peek() const
+		{
+			if (pos_ >= data_.size())
+				return ItemType::Invalid;
+
+			uint8_t b = byte(pos_);
+			uint8_t major = b >> 5;
+			uint8_t info = b & 0x1F;
+			if (info >= 28)
+				return ItemType::Invalid; // reserved, or indefinite length
+
+			switch (major)
+			{
+			case 0:
+			case 1:
+				return ItemType::Integer;
+			case 2:
+				return ItemType::Bytes;
+			case 3:
+				return ItemType::String;
+			case 4:
+				return ItemType::Array;
+			case 5:
+				return ItemType::Map;
+			case 6:
+				return ItemType::Other; // tag
+			default:
+				if (info == 20 || info == 21)
+					return ItemType::Bool;
+				if (info == 22 || info == 23)
+					return ItemType::Nil;
+				if (info >= 25)
+					return ItemType::Float;
+				return ItemType::Other; // simple value
+			}
+		}
+
+		bool readBool(bool &value)
+		{
+			if (pos_ >= data_.size())
+				return false;
+			value = byte(pos_++) == 0xF5;
+			return true;
+		}
+
+		bool readInteger(Integer &value)
+		{
+			uint8_t major;
+			uint64_t argument;
+			if (!readHead(major, argument) || major > 1)
+				return false;
+			value = Integer{major == 1, argument};
+			return true;
+		}
+
+		bool readFloat(double &value)
+		{
+			if (pos_ >= data_.size())
+				return false;
+
+			uint8_t info = byte(pos_++) & 0x1F;
+			const char *p;
+			if (info == 25 && take(2, p))
+			{
+				value = halfToDouble(loadBigEndian<uint16_t>(p));
+				return true;
+			}
+			if (info == 26 && take(4, p))
+			{
+				value = std::bit_cast<float>(loadBigEndian<uint32_t>(p));
+				return true;
+			}
+			if (info == 27 && take(8, p))
+			{
+				value = std::bit_cast<double>(loadBigEndian<uint64_t>(p));
+				return true;
+			}
+			return false;
+		}
+
+		bool readString(std::string_view &value)
+		{
+			uint8_t major;
+			uint64_t length;
+			const char *p;
+			if (!readHead(major, length) || major != 3 || length > remaining() || !take(length, p))
+				return false;
+			value = std::string_view(p, length);
+			return true;
+		}
+
+		bool readArrayHeader(size_t &count) { return readCount(4, count); }
+		bool readMapHeader(size_t &count) { return readCount(5, count); }
+
+		// Skips one complete item without recursion
+		bool skip()
+		{
+			size_t pending = 1;
+			while (pending > 0)
+			{
+				--pending;
+				if (peek() == ItemType::Invalid)
+					return false;
+
+				uint8_t major;
+				uint64_t argument;
+				const char *p;
+				if (!readHead(major, argument))
+					return false;
+
+				switch (major)
+				{
+				case 2:
+				case 3:
+					if (argument > remaining() || !take(argument, p))
+						return false;
+					break;
+				case 4:
+				case 5:
+					if (argument > remaining())
+						return false;
+					pending += major == 5 ? 2 * argument : argument;
+					break;
+				case 6:
+					++pending; // the tagged item
+					break;
+				default:
+					break; // integers, simple values and floats are fully read by readHead
+				}
+			}
+			return true;
+		}
+
+	private:
+		uint8_t byte(size_t pos) const { return static_cast<uint8_t>(data_[pos]); }
+		size_t remaining() const { return data_.size() - pos_; }
+
+		bool take(size_t n, const char *&p)
+		{
+			if (n > remaining())
+				return false;
+			p = data_.data() + pos_;
+			pos_ += n;
+			return true;
+		}
+
+		// Initial byte plus its argument: a value, length or count (or the raw
+		// bits of a float for major type 7)
+		bool readHead(uint8_t &major, uint64_t &argument)
+		{
+			if (pos_ >= data_.size())
+				return false;
+
+			uint8_t b = byte(pos_++);
+			major = b >> 5;
+			uint8_t info = b & 0x1F;
+			const char *p;
+			switch (info)
+			{
+			case 24:
+				if (!take(1, p))
+					return false;
+				argument = loadBigEndian<uint8_t>(p);
+				return true;
+			case 25:
+				if (!take(2, p))
+					return false;
+				argument = loadBigEndian<uint16_t>(p);
+				return true;
+			case 26:
+				if (!take(4, p))
+					return false;
+				argument = loadBigEndian<uint32_t>(p);
+				return true;
+			case 27:
+				if (!take(8, p))
+					return false;
+				argument = loadBigEndian<uint64_t>(p);
+				return true;
+			default:
+				argument = info;
+				return info < 24;
+			}
+		}
+
+		bool readCount(uint8_t expected_major, size_t &count)
+		{
+			uint8_t major;
+			uint64_t argument;
+			if (!readHead(major, argument) || major != expected_major || argument > remaining())
+				return false;
+			count = static_cast<size_t>(argument);
+			return true;
+		}
+
+		static double halfToDouble(uint16_t half)
+		{
+			int exponent = (half >> 10) & 0x1F;
+			int mantissa = half & 0x3FF;
+			double value;
+			if (exponent == 0)
+				value = std::ldexp(mantissa, -24);
+			else if (exponent != 31)
+				value = std::ldexp(mantissa + 1024, exponent - 25);
+			else
+				value = mantissa == 0 ? INFINITY : NAN;
+			return half & 0x8000 ? -value : value;
+		}
+
+		std::string_view data_;
+		size_t pos_ = 0;
+	};
+
+	class CborWriter
+	{
+	public:
+		explicit CborWriter(std::string &out) : out_(out) {}
+
+		void startObject(size_t members) { writeHead(5, members); }
+		void endObject() {}
+		void startArray(size_t elements) { writeHead(4, elements); }
+		void endArray() {}
+		void key(std::string_view name) { value(name); }
+		void raw(std::string_view encoded) { out_ += encoded; }
+
+		void value(bool b) { out_ += static_cast<char>(b ? 0xF5 : 0xF4); }
+
+		template <typename N>
+			requires(std::is_integral_v<N> && !std::is_same_v<N, bool>)
+		void value(N n)
+		{
+			if constexpr (std::is_signed_v<N>)
+			{
+				if (n < 0)
+				{
+					writeHead(1, ~static_cast<uint64_t>(static_cast<int64_t>(n)));
+					return;
+				}
+			}
+			writeHead(0, static_cast<uint64_t>(n));
+		}
+
+		template <typename F>
+			requires std::is_floating_point_v<F>
+		void value(F d)
+		{
+			out_ += static_cast<char>(0xFB);
+			appendBigEndian(out_, std::bit_cast<uint64_t>(static_cast<double>(d)), 8);
+		}
+
+		void value(std::string_view s)
+		{
+			writeHead(3, s.size());
+			out_ += s;
+		}
+
+		void value(const char *s) { value(std::string_view(s)); }
+
+		template <Described T>
+		void members(const T &object)
+		{
+			forEachField<T>([&](const auto &field)
+							{
+				key(field.name);
+				value(field.get(object));
+				return true; });
+		}
+
+	private:
+		void writeHead(uint8_t major, uint64_t argument)
+		{
+			const char type = static_cast<char>(major << 5);
+			if (argument < 24)
+			{
+				out_ += static_cast<char>(type | argument);
+			}
+			else if (argument <= 0xFF)
+			{
+				out_ += static_cast<char>(type | 24);
+				appendBigEndian(out_, argument, 1);
+			}
+			else if (argument <= 0xFFFF)
+			{
+				out_ += static_cast<char>(type | 25);
+				appendBigEndian(out_, argument, 2);
+			}
+			else if (argument <= 0xFFFFFFFF)
+			{
+				out_ += static_cast<char>(type | 26);
+				appendBigEndian(out_, argument, 4);
+			}
+			else
+			{
+				out_ += static_cast<char>(type | 27);
+				appendBigEndian(out_, argument, 8);
+			}
+		}
+
+		std::string &out_;
+	};
+
+	template <Described T>
+	std::expected<T, DecodeError> decodeCbor(std::string_view data)
+	{
+		return decodeDocument<T, CborReader>(data);
+	}
+
+	template <Described T>
+	std::string encodeCbor(const T &object)
+	{
+		std::string out;
+		CborWriter writer(out);
+		writer.startObject(fieldCount<T>);
+		writer.members(object);
+		writer.endObject();
+		return out;
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <codec/Cbor.h>
+#include <codec/Describe.h>
+#include <codec/Json.h>
+#include <codec/MsgPack.h>
+
+namespace codec
+{
+	enum class Format
+	{
+		Json,
+		MsgPack,
+		Cbor,
+	};
+
+	constexpr const char *contentType(Format format)
+	{
+		switch (format)
+		{
+		case Format::MsgPack:
+			return "application/msgpack";
+		case Format::Cbor:
+			return "application/cbor";
+		default:
+			return "application/json";
+		}
+	}
+
+	namespace detail
+	{
+		inline std::string_view trim(std::string_view s)
+		{
+			while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+				s.remove_prefix(1);
+			while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+				s.remove_suffix(1);
+			return s;
+		}
+
+		inline bool equalsIgnoreCase(std::string_view a, std::string_view b)
+		{
+			if (a.size() != b.size())
+				return false;
+			for (size_t i = 0; i < a.size(); ++i)
+			{
+				if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+					return false;
+			}
+			return true;
+		}
+
+		// Media type without parameters, e.g. "application/msgpack" from "application/msgpack; q=0.9"
+		inline std::string_view mediaType(std::string_view value)
+		{
+			return trim(value.substr(0, value.find(';')));
+		}
+
+		inline bool parseMediaType(std::string_view media, Format &format)
+		{
+			if (equalsIgnoreCase(media, "application/json"))
+				format = Format::Json;
+			else if (equalsIgnoreCase(media, "application/msgpack") || equalsIgnoreCase(media, "application/x-msgpack") ||
+					 equalsIgnoreCase(media, "application/vnd.msgpack"))
+				format = Format::MsgPack;
+			else if (equalsIgnoreCase(media, "application/cbor"))
+				format = Format::Cbor;
+			else
+				return false;
+			return true;
+		}
+	}
+
+	// Request body format; anything unrecognised (including no header) is JSON
+	inline Format formatFromContentType(std::string_view content_type)
+	{
+		Format format = Format::Json;
+		detail::parseMediaType(detail::mediaType(content_type), format);
+		return format;
+	}
+
+	// Response format from an Accept header: the supported type with the
+	// highest q wins, earlier entries win ties, and wildcards or an empty
+	// header select the fallback
+	inline Format formatFromAccept(std::string_view accept, Format fallback)
+	{
+		Format best = fallback;
+		double best_q = -1.0;
+
+		while (!accept.empty())
+		{
+			size_t comma = accept.find(',');
+			std::string_view entry = accept.substr(0, comma);
+			accept = comma == std::string_view::npos ? std::string_view() : accept.substr(comma + 1);
+
+			double q = 1.0;
+			size_t q_pos = entry.find("q=");
+			if (q_pos != std::string_view::npos)
+			{
+				q = std::strtod(std::string(entry.substr(q_pos + 2)).c_str(), nullptr);
+			}
+
+			std::string_view media = detail::mediaType(entry);
+			Format format = fallback;
+			if (!detail::parseMediaType(media, format) && media != "*/*" && !detail::equalsIgnoreCase(media, "application/*"))
+				continue;
+
+			if (q > best_q && q > 0.0)
+			{
+				best = format;
+				best_q = q;
+			}
+		}
+		return best;
+	}
+
+	template <Described T>
+	std::expected<T, DecodeError> decode(Format format, std::string_view data)
+	{
+		switch (format)
+		{
+		case Format::MsgPack:
+			return decodeMsgPack<T>(data);
+		case Format::Cbor:
+			return decodeCbor<T>(data);
+		default:
+			return decodeJson<T>(data);
+		}
+	}
+
+	// Splits a root array into encoded elements that decode() accepts
+	inline std::expected<std::vector<std::string_view>, DecodeError> splitArray(Format format, std::string_view data)
+	{
+		switch (format)
+		{
+		case Format::MsgPack:
+			return splitDocumentArray<MsgPackReader>(data);
+		case Format::Cbor:
+			return splitDocumentArray<CborReader>(data);
+		default:
+			return splitJsonArray(data);
+		}
+	}
+
+	// Decodes a root array of strings
+	inline std::expected<std::vector<std::string>, DecodeError> decodeStrings(Format format, std::string_view data)
+	{
+		switch (format)
+		{
+		case Format::MsgPack:
+			return decodeStringArray<MsgPackReader>(data);
+		case Format::Cbor:
+			return decodeStringArray<CborReader>(data);
+		default:
+			return decodeJsonStrings(data);
+		}
+	}
+
+	// Runs write(writer) with the writer for format and returns the encoded bytes
+	template <typename Write>
+	std::string encode(Format format, Write &&write)
+	{
+		std::string out;
+		switch (format)
+		{
+		case Format::MsgPack:
+		{
+			MsgPackWriter writer(out);
+			write(writer);
+			break;
+		}
+		case Format::Cbor:
+		{
+			CborWriter writer(out);
+			write(writer);
+			break;
+		}
+		default:
+		{
+			JsonWriter writer(out);
+			write(writer);
+			break;
+		}
+		}
+		return out;
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <codec/PerfectHash.h>
+
+// Compile-time description of a payload type. Specialize Describe<T> once:
+//
+//   template <>
+//   struct codec::Describe<UserData>
+//   {
+//       static constexpr auto fields = std::make_tuple(
+//           CODEC_FIELD(UserData, id, codec::NonNegative),
+//           CODEC_FIELD(UserData, name, codec::NotEmpty));
+//   };
+//
+// and the JSON decoder, encoder and validators are generated from it.
+namespace codec
+{
+	template <typename T>
+	struct Describe;
+
+	template <typename T>
+	struct MemberTraits;
+
+	template <typename C, typename M>
+	struct MemberTraits<M C::*>
+	{
+		using Class = C;
+		using Type = M;
+	};
+
+	template <auto Member, typename... Validators>
+	struct Field
+	{
+		using Class = typename MemberTraits<decltype(Member)>::Class;
+		using Type = typename MemberTraits<decltype(Member)>::Type;
+
+		std::string_view name;
+
+		static constexpr Type &get(Class &object) { return object.*Member; }
+		static constexpr const Type &get(const Class &object) { return object.*Member; }
+		static constexpr bool validate(const Type &value) { return (Validators::check(value) && ...); }
+	};
+
+	template <auto Member, typename... Validators>
+	constexpr Field<Member, Validators...> field(std::string_view name)
+	{
+		return {name};
+	}
+
+	template <typename T>
+	concept Described = requires { Describe<T>::fields; };
+
+	template <Described T>
+	constexpr size_t fieldCount = std::tuple_size_v<std::remove_cvref_t<decltype(Describe<T>::fields)>>;
+
+	// Calls f(field) for every field in declaration order until f returns false
+	template <Described T, typename F>
+	constexpr bool forEachField(F &&f)
+	{
+		return [&]<size_t... I>(std::index_sequence<I...>)
+		{
+			return (f(std::get<I>(Describe<T>::fields)) && ...);
+		}(std::make_index_sequence<fieldCount<T>>{});
+	}
+
+	// Calls f(field) for the field at a runtime index
+	template <Described T, typename F>
+	constexpr bool visitField(size_t index, F &&f)
+	{
+		return [&]<size_t... I>(std::index_sequence<I...>)
+		{
+			bool result = false;
+			((index == I ? (result = f(std::get<I>(Describe<T>::fields)), true) : false) || ...);
+			return result;
+		}(std::make_index_sequence<fieldCount<T>>{});
+	}
+
+	struct DecodeError
+	{
+		enum Kind
+		{
+			Syntax,
+			NotAnObject,
+			MissingField,
+			WrongType,
+			Invalid,
+		};
+
+		Kind kind;
+		size_t field = 0; // index into Describe<T>::fields for field errors
+	};
+
+	template <Described T>
+	constexpr auto fieldNames = []<size_t... I>(std::index_sequence<I...>)
+	{
+		return std::array<std::string_view, sizeof...(I)>{std::get<I>(Describe<T>::fields).name...};
+	}(std::make_index_sequence<fieldCount<T>>{});
+
+	template <Described T>
+	constexpr auto fieldIndex = makePerfectHash(fieldNames<T>);
+
+	// Index of a described key, or -1
+	template <Described T>
+	constexpr int findField(std::string_view key)
+	{
+		int index = fieldIndex<T>.find(key);
+		return index >= 0 && fieldNames<T>[index] == key ? index : -1;
+	}
+
+	// Per-field progress of a decoder; the first Missing or WrongType field in
+	// declaration order is the one reported
+	enum class FieldState : uint8_t
+	{
+		Missing,
+		Set,
+		WrongType,
+	};
+
+	template <Described T>
+	using FieldStates = std::array<FieldState, fieldCount<T>>;
+
+	template <size_t N>
+	std::expected<void, DecodeError> checkFields(const std::array<FieldState, N> &states)
+	{
+		for (size_t i = 0; i < N; ++i)
+		{
+			if (states[i] == FieldState::Missing)
+				return std::unexpected(DecodeError{DecodeError::MissingField, i});
+			if (states[i] == FieldState::WrongType)
+				return std::unexpected(DecodeError{DecodeError::WrongType, i});
+		}
+		return {};
+	}
+
+	// Field validators
+	struct NonNegative
+	{
+		template <typename V>
+		static constexpr bool check(const V &value) { return value >= 0; }
+	};
+
+	struct NotEmpty
+	{
+		template <typename V>
+		static constexpr bool check(const V &value) { return !value.empty(); }
+	};
+
+	template <auto Min, auto Max>
+	struct InRange
+	{
+		template <typename V>
+		static constexpr bool check(const V &value) { return value >= Min && value <= Max; }
+	};
+
+	template <size_t N>
+	struct MaxLength
+	{
+		template <typename V>
+		static constexpr bool check(const V &value) { return value.size() <= N; }
+	};
+}
+
+#define CODEC_FIELD(Type, member, ...) ::codec::field<&Type::member __VA_OPT__(, ) __VA_ARGS__>(#member)
@@ -0,0 +1,536 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <codec/Describe.h>
+#include <common/rapidjson/encodedstream.h>
+#include <common/rapidjson/memorystream.h>
+#include <common/rapidjson/reader.h>
+
+namespace codec
+{
+	// SAX handler filling the described fields of the root object. Members of
+	// nested values are skipped; for duplicate keys the first one wins.
+	template <Described T>
+	class JsonDecoder
+	{
+	public:
+		explicit JsonDecoder(T &value) : value_(value) {}
+
+		bool Null() { return scalar([](auto &) { return false; }); }
+		bool Bool(bool b)
+		{
+			return scalar([b](auto &target)
+						  {
+				if constexpr (std::is_same_v<std::remove_cvref_t<decltype(target)>, bool>)
+				{
+					target = b;
+					return true;
+				}
+				return false; });
+		}
+		bool Int(int i) { return number(static_cast<int64_t>(i)); }
+		bool Uint(unsigned u) { return number(static_cast<uint64_t>(u)); }
+		bool Int64(int64_t i) { return number(i); }
+		bool Uint64(uint64_t u) { return number(u); }
+		bool Double(double d)
+		{
+			return scalar([d](auto &target)
+						  {
+				if constexpr (std::is_floating_point_v<std::remove_cvref_t<decltype(target)>>)
+				{
+					target = d;
+					return true;
+				}
+				return false; });
+		}
+		bool RawNumber(const char *, rapidjson::SizeType, bool) { return scalar([](auto &) { return false; }); }
+		bool String(const char *str, rapidjson::SizeType length, bool)
+		{
+			return scalar([str, length](auto &target)
+						  {
+				if constexpr (std::is_same_v<std::remove_cvref_t<decltype(target)>, std::string>)
+				{
+					target.assign(str, length);
+					return true;
+				}
+				return false; });
+		}
+
+		bool StartObject()
+		{
+			if (depth_ == 0)
+				root_is_object_ = true;
+			return startContainer();
+		}
+		bool Key(const char *str, rapidjson::SizeType length, bool)
+		{
+			pending_ = -1;
+			if (depth_ == 1)
+			{
+				int index = findField<T>(std::string_view(str, length));
+				if (index >= 0 && state_[index] == FieldState::Missing)
+				{
+					pending_ = index;
+				}
+			}
+			return true;
+		}
+		bool EndObject(rapidjson::SizeType)
+		{
+			--depth_;
+			return true;
+		}
+		bool StartArray() { return startContainer(); }
+		bool EndArray(rapidjson::SizeType)
+		{
+			--depth_;
+			return true;
+		}
+
+		std::expected<void, DecodeError> finish() const
+		{
+			if (!root_is_object_)
+			{
+				return std::unexpected(DecodeError{DecodeError::NotAnObject});
+			}
+			return checkFields(state_);
+		}
+
+	private:
+		// Only values directly under the root object are stored; parsing always
+		// continues so that syntax errors later in the document are still reported
+		template <typename Assign>
+		bool scalar(Assign &&assign)
+		{
+			if (depth_ == 1 && pending_ >= 0)
+			{
+				bool stored = visitField<T>(pending_, [&](const auto &field)
+											{ return assign(field.get(value_)); });
+				state_[pending_] = stored ? FieldState::Set : FieldState::WrongType;
+				pending_ = -1;
+			}
+			return true;
+		}
+
+		template <typename N>
+		bool number(N n)
+		{
+			return scalar([n](auto &target)
+						  {
+				using Target = std::remove_cvref_t<decltype(target)>;
+				if constexpr (std::is_integral_v<Target> && !std::is_same_v<Target, bool>)
+				{
+					if (std::in_range<Target>(n))
+					{
+						target = static_cast<Target>(n);
+						return true;
+					}
+				}
+				else if constexpr (std::is_floating_point_v<Target>)
+				{
+					target = static_cast<Target>(n);
+					return true;
+				}
+				return false; });
+		}
+
+		bool startContainer()
+		{
+			if (depth_ == 1 && pending_ >= 0)
+			{
+				state_[pending_] = FieldState::WrongType;
+				pending_ = -1;
+			}
+			++depth_;
+			return true;
+		}
+
+		T &value_;
+		FieldStates<T> state_{};
+		int pending_ = -1;
+		unsigned depth_ = 0;
+		bool root_is_object_ = false;
+	};
+
+	// Parses with the same rules as rapidjson::Document::Parse but without a DOM;
+	// the reader's string stack starts in a stack buffer.
+	template <Described T>
+	std::expected<T, DecodeError> decodeJson(std::string_view json)
+	{
+		using Pool = rapidjson::MemoryPoolAllocator<>;
+		alignas(std::max_align_t) char buffer[1024];
+		Pool pool(buffer, sizeof(buffer));
+		rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, Pool> reader(&pool, 256);
+
+		T value{};
+		JsonDecoder<T> decoder(value);
+		rapidjson::MemoryStream memory(json.data(), json.size());
+		rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> stream(memory);
+
+		if (reader.Parse(stream, decoder).IsError())
+		{
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		}
+		if (auto fields = decoder.finish(); !fields)
+		{
+			return std::unexpected(fields.error());
+		}
+		return value;
+	}
+
+	template <Described T>
+	std::expected<void, DecodeError> validate(const T &value)
+	{
+		size_t index = 0;
+		bool valid = forEachField<T>([&](const auto &field)
+									 { return field.validate(field.get(value)) && (++index, true); });
+		if (!valid)
+		{
+			return std::unexpected(DecodeError{DecodeError::Invalid, index});
+		}
+		return {};
+	}
+
+	// Streaming writer appending compact JSON to a string; escaping matches
+	// rapidjson::Writer so responses are byte-for-byte unchanged.
+	class JsonWriter
+	{
+	public:
+		explicit JsonWriter(std::string &out) : out_(out) {}
+
+		// Member and element counts are only needed by the binary writers
+		void startObject(size_t = 0)
+		{
+			separate();
+			out_ += '{';
+			need_comma_ = false;
+		}
+
+		void endObject()
+		{
+			out_ += '}';
+			need_comma_ = true;
+		}
+
+		void startArray(size_t = 0)
+		{
+			separate();
+			out_ += '[';
+			need_comma_ = false;
+		}
+
+		void endArray()
+		{
+			out_ += ']';
+			need_comma_ = true;
+		}
+
+		// Appends an already encoded JSON value
+		void raw(std::string_view encoded)
+		{
+			separate();
+			out_ += encoded;
+			need_comma_ = true;
+		}
+
+		void key(std::string_view name)
+		{
+			separate();
+			writeString(name);
+			out_ += ':';
+			need_comma_ = false;
+		}
+
+		void value(bool b)
+		{
+			separate();
+			out_ += b ? "true" : "false";
+			need_comma_ = true;
+		}
+
+		template <typename N>
+			requires(std::is_arithmetic_v<N> && !std::is_same_v<N, bool>)
+		void value(N n)
+		{
+			separate();
+			char digits[32];
+			auto result = std::to_chars(digits, digits + sizeof(digits), n);
+			out_.append(digits, result.ptr);
+			need_comma_ = true;
+		}
+
+		void value(std::string_view s)
+		{
+			separate();
+			writeString(s);
+			need_comma_ = true;
+		}
+
+		void value(const char *s) { value(std::string_view(s)); }
+
+		template <Described T>
+		void members(const T &object)
+		{
+			forEachField<T>([&](const auto &field)
+							{
+				key(field.name);
+				value(field.get(object));
+				return true; });
+		}
+
+	private:
+		void separate()
+		{
+			if (need_comma_)
+				out_ += ',';
+		}
+
+		void writeString(std::string_view s)
+		{
+			// 0 = copy, 'u' = \u00XX, otherwise the character after the backslash
+			static constexpr auto escapes = []
+			{
+				std::array<char, 256> table{};
+				for (int c = 0; c < 0x20; ++c)
+					table[c] = 'u';
+				table['\b'] = 'b';
+				table['\t'] = 't';
+				table['\n'] = 'n';
+				table['\f'] = 'f';
+				table['\r'] = 'r';
+				table['"'] = '"';
+				table['\\'] = '\\';
+				return table;
+			}();
+			static constexpr char hex[] = "0123456789ABCDEF";
+
+			out_ += '"';
+			size_t run = 0;
+			for (size_t i = 0; i < s.size(); ++i)
+			{
+				unsigned char c = static_cast<unsigned char>(s[i]);
+				char escape = escapes[c];
+				if (!escape)
+					continue;
+
+				out_.append(s.data() + run, i - run);
+				run = i + 1;
+				out_ += '\\';
+				out_ += escape;
+				if (escape == 'u')
+				{
+					out_ += "00";
+					out_ += hex[c >> 4];
+					out_ += hex[c & 0xF];
+				}
+			}
+			out_.append(s.data() + run, s.size() - run);
+			out_ += '"';
+		}
+
+		std::string &out_;
+		bool need_comma_ = false;
+	};
+
+	template <Described T>
+	std::string encodeJson(const T &object)
+	{
+		std::string out;
+		JsonWriter writer(out);
+		writer.startObject(fieldCount<T>);
+		writer.members(object);
+		writer.endObject();
+		return out;
+	}
+
+	// Records the text of each element of a root array. Objects keep their own
+	// span; any other element is replaced by "null", which decodes to the same
+	// NotAnObject error the original element would.
+	class JsonArraySplitter : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JsonArraySplitter>
+	{
+	public:
+		using Stream = rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream>;
+
+		JsonArraySplitter(const Stream &stream, const char *begin, std::vector<std::string_view> &items)
+			: stream_(stream), begin_(begin), items_(items)
+		{
+		}
+
+		bool Default()
+		{
+			if (depth_ == 1)
+				items_.emplace_back("null");
+			return true;
+		}
+
+		bool StartObject()
+		{
+			if (depth_ == 1)
+				start_ = stream_.Tell() - 1;
+			++depth_;
+			return true;
+		}
+
+		bool EndObject(rapidjson::SizeType)
+		{
+			if (--depth_ == 1)
+				items_.emplace_back(begin_ + start_, stream_.Tell() - start_);
+			return true;
+		}
+
+		bool StartArray()
+		{
+			if (depth_ == 0)
+				root_is_array_ = true;
+			else if (depth_ == 1)
+				items_.emplace_back("null");
+			++depth_;
+			return true;
+		}
+
+		bool EndArray(rapidjson::SizeType)
+		{
+			--depth_;
+			return true;
+		}
+
+		bool Key(const char *, rapidjson::SizeType, bool) { return true; }
+		bool rootIsArray() const { return root_is_array_; }
+
+	private:
+		const Stream &stream_;
+		const char *begin_;
+		std::vector<std::string_view> &items_;
+		size_t start_ = 0;
+		unsigned depth_ = 0;
+		bool root_is_array_ = false;
+	};
+
+	// Splits a root JSON array into element texts without decoding them; a
+	// non-array root is reported as NotAnObject
+	inline std::expected<std::vector<std::string_view>, DecodeError> splitJsonArray(std::string_view json)
+	{
+		using Pool = rapidjson::MemoryPoolAllocator<>;
+		alignas(std::max_align_t) char buffer[1024];
+		Pool pool(buffer, sizeof(buffer));
+		rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, Pool> reader(&pool, 256);
+
+		std::vector<std::string_view> items;
+		rapidjson::MemoryStream memory(json.data(), json.size());
+		JsonArraySplitter::Stream stream(memory);
+		JsonArraySplitter splitter(stream, json.data(), items);
+
+		if (reader.Parse(stream, splitter).IsError())
+		{
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		}
+		if (!splitter.rootIsArray())
+		{
+			return std::unexpected(DecodeError{DecodeError::NotAnObject});
+		}
+		return items;
+	}
+
+	// Collects the strings of a root array of strings
+	class JsonStringArrayReader : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JsonStringArrayReader>
+	{
+	public:
+		explicit JsonStringArrayReader(std::vector<std::string> &items) : items_(items) {}
+
+		bool Default()
+		{
+			if (depth_ == 1)
+				wrongElement();
+			return true;
+		}
+
+		bool String(const char *str, rapidjson::SizeType length, bool)
+		{
+			if (depth_ == 1)
+				items_.emplace_back(str, length);
+			return true;
+		}
+
+		bool StartObject()
+		{
+			if (depth_ == 1)
+				wrongElement();
+			++depth_;
+			return true;
+		}
+
+		bool EndObject(rapidjson::SizeType)
+		{
+			--depth_;
+			return true;
+		}
+
+		bool StartArray()
+		{
+			if (depth_ == 0)
+				root_is_array_ = true;
+			else if (depth_ == 1)
+				wrongElement();
+			++depth_;
+			return true;
+		}
+
+		bool EndArray(rapidjson::SizeType)
+		{
+			--depth_;
+			return true;
+		}
+
+		bool Key(const char *, rapidjson::SizeType, bool) { return true; }
+
+		bool rootIsArray() const { return root_is_array_; }
+		// Index of the first element that is not a string, or -1
+		int wrongIndex() const { return wrong_index_; }
+
+	private:
+		void wrongElement()
+		{
+			if (wrong_index_ < 0)
+				wrong_index_ = static_cast<int>(items_.size() + skipped_);
+			++skipped_;
+		}
+
+		std::vector<std::string> &items_;
+		unsigned depth_ = 0;
+		size_t skipped_ = 0;
+		int wrong_index_ = -1;
+		bool root_is_array_ = false;
+	};
+
+	// Decodes a root JSON array of strings. A non-array root is NotAnObject;
+	// a non-string element is WrongType with field set to its index
+	inline std::expected<std::vector<std::string>, DecodeError> decodeJsonStrings(std::string_view json)
+	{
+		using Pool = rapidjson::MemoryPoolAllocator<>;
+		alignas(std::max_align_t) char buffer[1024];
+		Pool pool(buffer, sizeof(buffer));
+		rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, Pool> reader(&pool, 256);
+
+		std::vector<std::string> items;
+		rapidjson::MemoryStream memory(json.data(), json.size());
+		rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> stream(memory);
+		JsonStringArrayReader handler(items);
+
+		if (reader.Parse(stream, handler).IsError())
+			return std::unexpected(DecodeError{DecodeError::Syntax});
+		if (!handler.rootIsArray())
+			return std::unexpected(DecodeError{DecodeError::NotAnObject});
+		if (handler.wrongIndex() >= 0)
+			return std::unexpected(DecodeError{DecodeError::WrongType, static_cast<size_t>(handler.wrongIndex())});
+		return items;
+	}
+}
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <codec/Binary.h>
+#include <codec/Describe.h>
+
+// MessagePack (https://github.com/msgpack/msgpack/blob/master/spec.md)
+namespace codec
+{
+	class MsgPackReader
+	{
+	public:
+		explicit MsgPackReader(std::string_view data) : data_(data) {}
+
+		size_t offset() const { return pos_; }
+		bool atEnd() const { return pos_ == data_.size(); }
+
+		ItemType peek() const
+		{
+			if (pos_ >= data_.size())
+				return ItemType::Invalid;
+
+			uint8_t b = byte(pos_);
+			if (b <= 0x7F || b >= 0xE0)
+				return ItemType::Integer;
+			if (b <= 0x8F)
+				return ItemType::Map;
+			if (b <= 0x9F)
+				return ItemType::Array;
+			if (b <= 0xBF)
+				return ItemType::String;
+
+			switch (b)
+			{
+			case 0xC0:
+				return ItemType::Nil;
+			case 0xC2:
+			case 0xC3:
+				return ItemType::Bool;
+			case 0xC4:
+			case 0xC5:
+			case 0xC6:
+				return ItemType::Bytes;
+			case 0xCA:
+			case 0xCB:
+				return ItemType::Float;
+			case 0xD9:
+			case 0xDA:
+			case 0xDB:
+				return ItemType::String;
+			case 0xDC:
+			case 0xDD:
+				return ItemType::Array;
+			case 0xDE:
+			case 0xDF:
+				return ItemType::Map;
+			case 0xC1:
+				return ItemType::Invalid;
+			default:
+				return b >= 0xCC && b <= 0xD3 ? ItemType::Integer : ItemType::Other;
+			}
+		}
+
+		bool readBool(bool &value)
+		{
+			if (pos_ >= data_.size())
+				return false;
+			value = byte(pos_++) == 0xC3;
+			return true;
+		}
+
+		bool readInteger(Integer &value)
+		{
+			if (pos_ >= data_.size())
+				return false;
+
+			uint8_t b = byte(pos_++);
+			if (b <= 0x7F)
+			{
+				value = Integer{false, b};
+				return true;
+			}
+			if (b >= 0xE0)
+			{
+				value = Integer::fromSigned(static_cast<int8_t>(b));
+				return true;
+			}
+
+			switch (b)
+			{
+			case 0xCC:
+				return readUnsigned<uint8_t>(value);
+			case 0xCD:
+				return readUnsigned<uint16_t>(value);
+			case 0xCE:
+				return readUnsigned<uint32_t>(value);
+			case 0xCF:
+				return readUnsigned<uint64_t>(value);
+			case 0xD0:
+				return readSigned<uint8_t>(value);
+			case 0xD1:
+				return readSigned<uint16_t>(value);
+			case 0xD2:
+				return readSigned<uint32_t>(value);
+			case 0xD3:
+				return readSigned<uint64_t>(value);
+			default:
+				return false;
+			}
+		}
+
+		bool readFloat(double &value)
+		{
+			if (pos_ >= data_.size())
+				return false;
+
+			uint8_t b = byte(pos_++);
+			const char *p;
+			if (b == 0xCA && take(4, p))
+			{
+				value = std::bit_cast<float>(loadBigEndian<uint32_t>(p));
+				return true;
+			}
+			if (b == 0xCB && take(8, p))
+			{
+				value = std::bit_cast<double>(loadBigEndian<uint64_t>(p));
+				return true;
+			}
+			return false;
+		}
+
+		bool readString(std::string_view &value)
+		{
+			size_t length;
+			const char *p;
+			if (!readLength(0xA0, 0x1F, 0xD9, 0xDA, 0xDB, length) || !take(length, p))
+				return false;
+			value = std::string_view(p, length);
+			return true;
+		}
+
+		bool readArrayHeader(size_t &count) { return readLength(0x90, 0x0F, NO_CODE, 0xDC, 0xDD, count); }
+		bool readMapHeader(size_t &count) { return readLength(0x80, 0x0F, NO_CODE, 0xDE, 0xDF, count); }
+
+		// Skips one complete item without recursion
+		bool skip()
+		{
+			size_t pending = 1;
+			while (pending > 0)
+			{
+				--pending;
+				if (pos_ >= data_.size())
+					return false;
+
+				uint8_t b = byte(pos_);
+				size_t count;
+				const char *p;
+				switch (peek())
+				{
+				case ItemType::Array:
+					if (!readArrayHeader(count) || count > remaining())
+						return false;
+					pending += count;
+					break;
+				case ItemType::Map:
+					if (!readMapHeader(count) || count > remaining())
+						return false;
+					pending += 2 * count;
+					break;
+				case ItemType::String:
+				{
+					std::string_view s;
+					if (!readString(s))
+						return false;
+					break;
+				}
+				case ItemType::Bytes:
+					++pos_;
+					if (!readSize(size_t{1} << (b - 0xC4), count) || !take(count, p))
+						return false;
+					break;
+				case ItemType::Other:
+					++pos_;
+					if (b >= 0xD4) // fixext 1..16
+					{
+						if (!take(1 + (size_t{1} << (b - 0xD4)), p))
+							return false;
+					}
+					else if (!readSize(size_t{1} << (b - 0xC7), count) || !take(1 + count, p))
+					{
+						return false;
+					}
+					break;
+				case ItemType::Integer:
+				{
+					Integer n;
+					if (!readInteger(n))
+						return false;
+					break;
+				}
+				case ItemType::Float:
+				{
+					double d;
+					if (!readFloat(d))
+						return false;
+					break;
+				}
+				case ItemType::Nil:
+				case ItemType::Bool:
+					++pos_;
+					break;
+				case ItemType::Invalid:
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		static constexpr int NO_CODE = -1;
+
+		uint8_t byte(size_t pos) const { return static_cast<uint8_t>(data_[pos]); }
+		size_t remaining() const { return data_.size() - pos_; }
+
+		bool take(size_t n, const char *&p)
+		{
+			if (n > remaining())
+				return false;
+			p = data_.data() + pos_;
+			pos_ += n;
+			return true;
+		}
+
+		bool readSize(size_t bytes, size_t &value)
+		{
+			const char *p;
+			if (!take(bytes, p))
+				return false;
+			switch (bytes)
+			{
+			case 1:
+				value = loadBigEndian<uint8_t>(p);
+				return true;
+			case 2:
+				value = loadBigEndian<uint16_t>(p);
+				return true;
+			default:
+				value = loadBigEndian<uint32_t>(p);
+				return true;
+			}
+		}
+
+		// fix* forms carry the length in the low bits of the type byte;
+		// arrays and maps have no 8-bit length form
+		bool readLength(uint8_t fix_base, uint8_t fix_mask, int code8, uint8_t code16, uint8_t code32, size_t &length)
+		{
+			if (pos_ >= data_.size())
+				return false;
+
+			uint8_t b = byte(pos_++);
+			if ((b & ~fix_mask) == fix_base)
+			{
+				length = b & fix_mask;
+				return true;
+			}
+			if (b == code8)
+				return readSize(1, length);
+			if (b == code16)
+				return readSize(2, length);
+			if (b == code32)
+				return readSize(4, length);
+			return false;
+		}
+
+		template <typename U>
+		bool readUnsigned(Integer &value)
+		{
+			const char *p;
+			if (!take(sizeof(U), p))
+				return false;
+			value = Integer{false, loadBigEndian<U>(p)};
+			return true;
+		}
+
+		template <typename U>
+		bool readSigned(Integer &value)
+		{
+			const char *p;
+			if (!take(sizeof(U), p))
+				return false;
+			value = Integer::fromSigned(static_cast<std::make_signed_t<U>>(loadBigEndian<U>(p)));
+			return true;
+		}
+
+		std::string_view data_;
+		size_t pos_ = 0;
+	};
+
+	class MsgPackWriter
+	{
+	public:
+		explicit MsgPackWriter(std::string &out) : out_(out) {}
+
+		void startObject(size_t members) { writeLength(0x80, 0x0F, NO_CODE, 0xDE, 0xDF, members); }
+		void endObject() {}
+		void startArray(size_t elements) { writeLength(0x90, 0x0F, NO_CODE, 0xDC, 0xDD, elements); }
+		void endArray() {}
+		void key(std::string_view name) { value(name); }
+		void raw(std::string_view encoded) { out_ += encoded; }
+
+		void value(bool b) { out_ += static_cast<char>(b ? 0xC3 : 0xC2); }
+
+		template <typename N>
+			requires(std::is_integral_v<N> && !std::is_same_v<N, bool>)
+		void value(N n)
+		{
+			if constexpr (std::is_signed_v<N>)
+			{
+				if (n < 0)
+				{
+					writeNegative(n);
+					return;
+				}
+			}
+			writeUnsigned(static_cast<uint64_t>(n));
+		}
+
+		template <typename F>
+			requires std::is_floating_point_v<F>
+		void value(F d)
+		{
+			out_ += static_cast<char>(0xCB);
+			appendBigEndian(out_, std::bit_cast<uint64_t>(static_cast<double>(d)), 8);
+		}
+
+		void value(std::string_view s)
+		{
+			writeLength(0xA0, 0x1F, 0xD9, 0xDA, 0xDB, s.size());
+			out_ += s;
+		}
+
+		void value(const char *s) { value(std::string_view(s)); }
+
+		template <Described T>
+		void members(const T &object)
+		{
+			forEachField<T>([&](const auto &field)
+							{
+				key(field.name);
+				value(field.get(object));
+				return true; });
+		}
+
+	private:
+		static constexpr int NO_CODE = -1;
+
+		void writeUnsigned(uint64_t n)
+		{
+			if (n <= 0x7F)
+			{
+				out_ += static_cast<char>(n);
+			}
+			else if (n <= 0xFF)
+			{
+				out_ += static_cast<char>(0xCC);
+				appendBigEndian(out_, n, 1);
+			}
+			else if (n <= 0xFFFF)
+			{
+				out_ += static_cast<char>(0xCD);
+				appendBigEndian(out_, n, 2);
+			}
+			else if (n <= 0xFFFFFFFF)
+			{
+				out_ += static_cast<char>(0xCE);
+				appendBigEndian(out_, n, 4);
+			}
+			else
+			{
+				out_ += static_cast<char>(0xCF);
+				appendBigEndian(out_, n, 8);
+			}
+		}
+
+		void writeNegative(int64_t n)
+		{
+			const uint64_t bits = static_cast<uint64_t>(n);
+			if (n >= -32)
+			{
+				out_ += static_cast<char>(bits & 0xFF);
+			}
+			else if (n >= INT8_MIN)
+			{
+				out_ += static_cast<char>(0xD0);
+				appendBigEndian(out_, bits, 1);
+			}
+			else if (n >= INT16_MIN)
+			{
+				out_ += static_cast<char>(0xD1);
+				appendBigEndian(out_, bits, 2);
+			}
+			else if (n >= INT32_MIN)
+			{
+				out_ += static_cast<char>(0xD2);
+				appendBigEndian(out_, bits, 4);
+			}
+			else
+			{
+				out_ += static_cast<char>(0xD3);
+				appendBigEndian(out_, bits, 8);
+			}
+		}
+
+		void writeLength(uint8_t fix_base, size_t fix_max, int code8, uint8_t code16, uint8_t code32, size_t length)
+		{
+			if (length <= fix_max)
+			{
+				out_ += static_cast<char>(fix_base | length);
+			}
+			else if (code8 != NO_CODE && length <= 0xFF)
+			{
+				out_ += static_cast<char>(code8);
+				appendBigEndian(out_, length, 1);
+			}
+			else if (length <= 0xFFFF)
+			{
+				out_ += static_cast<char>(code16);
+				appendBigEndian(out_, length, 2);
+			}
+			else
+			{
+				out_ += static_cast<char>(code32);
+				appendBigEndian(out_, length, 4);
+			}
+		}
+
+		std::string &out_;
+	};
+
+	template <Described T>
+	std::expected<T, DecodeError> decodeMsgPack(std::string_view data)
+	{
+		return decodeDocument<T, MsgPackReader>(data);
+	}
+
+	template <Described T>
+	std::string encodeMsgPack(const T &object)
+	{
+		std::string out;
+		MsgPackWriter writer(out);
+		writer.startObject(fieldCount<T>);
+		writer.members(object);
+		writer.endObject();
+		return out;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace codec
+{
+	constexpr uint32_t hashKey(std::string_view key, uint32_t seed)
+	{
+		uint32_t hash = 2166136261u ^ seed;
+		for (char c : key)
+		{
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+		}
+		return hash ^ (hash >> 15);
+	}
+
+	// Collision-free table for a fixed key set, built at compile time. find()
+	// returns the only candidate index; callers confirm it by comparing keys.
+	template <size_t N>
+	struct PerfectHash
+	{
+		static constexpr size_t SIZE = std::bit_ceil(N * 2 > 0 ? N * 2 : 1);
+
+		uint32_t seed = 0;
+		std::array<int16_t, SIZE> slots{};
+
+		constexpr int find(std::string_view key) const
+		{
+			return slots[hashKey(key, seed) & (SIZE - 1)];
+		}
+	};
+
+	template <size_t N>
+	constexpr PerfectHash<N> makePerfectHash(const std::array<std::string_view, N> &keys)
+	{
+		PerfectHash<N> table;
+		for (uint32_t seed = 1; seed < 100000; ++seed)
+		{
+			table.seed = seed;
+			table.slots.fill(-1);
+
+			bool collision = false;
+			for (size_t i = 0; i < N && !collision; ++i)
+			{
+				auto &slot = table.slots[hashKey(keys[i], seed) & (PerfectHash<N>::SIZE - 1)];
+				collision = slot != -1;
+				slot = static_cast<int16_t>(i);
+			}
+			if (!collision)
+			{
+				return table;
+			}
+		}
+
+		// Not a constant expression: duplicate field names fail to compile here
+		throw "no collision-free seed for field names";
+	}
+}
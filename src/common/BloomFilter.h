@@ -0,0 +1,78 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Split-block Bloom filter over precomputed 64-bit hashes: each key sets one
+// bit in each of the eight 32-bit words of a single 32-byte block, so a
+// lookup reads one cache line. Sized for about 1% false positives at
+// capacity; insert() past capacity still works but the rate climbs, so the
+// owner rebuilds with reset() once saturated() says so. Not thread-safe.
+class BloomFilter
+{
+public:
+	explicit BloomFilter(size_t capacity = 1024) { reset(capacity); }
+
+	// Drops every key and resizes for capacity keys
+	void reset(size_t capacity)
+	{
+		capacity_ = capacity < 64 ? 64 : capacity;
+		// ~10 bits per key, rounded up to a power of two number of blocks
+		block_count_ = std::bit_ceil((capacity_ * 10 + BLOCK_BITS - 1) / BLOCK_BITS);
+		blocks_ = std::make_unique<Block[]>(block_count_);
+		size_ = 0;
+	}
+
+	void insert(uint64_t hash)
+	{
+		Block &block = blocks_[blockIndex(hash)];
+		const uint32_t key = static_cast<uint32_t>(hash);
+		for (int i = 0; i < WORDS; ++i)
+		{
+			block.words[i] |= bit(key, i);
+		}
+		++size_;
+	}
+
+	bool mightContain(uint64_t hash) const
+	{
+		const Block &block = blocks_[blockIndex(hash)];
+		const uint32_t key = static_cast<uint32_t>(hash);
+		for (int i = 0; i < WORDS; ++i)
+		{
+			if ((block.words[i] & bit(key, i)) == 0)
+				return false;
+		}
+		return true;
+	}
+
+	size_t size() const { return size_; }
+	size_t capacity() const { return capacity_; }
+	bool saturated() const { return size_ > capacity_; }
+
+private:
+	static constexpr int WORDS = 8;
+	static constexpr size_t BLOCK_BITS = WORDS * 32;
+
+	struct alignas(32) Block
+	{
+		uint32_t words[WORDS] = {};
+	};
+
+	// Odd multipliers from the Parquet split-block filter
+	static uint32_t bit(uint32_t key, int word)
+	{
+		static constexpr uint32_t SALT[WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+												 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+		return 1U << ((key * SALT[word]) >> 27);
+	}
+
+	size_t blockIndex(uint64_t hash) const { return (hash >> 32) & (block_count_ - 1); }
+
+	std::unique_ptr<Block[]> blocks_;
+	size_t block_count_ = 0;
+	size_t capacity_ = 0;
+	size_t size_ = 0;
+};
@@ -0,0 +1,167 @@
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/ClientStatsTable.h>
+
+ClientStatsTable::Stats ClientStatsTable::statsOf(const Row &row)
+{
+	Stats stats;
+	stats.count = row.count;
+	if (stats.count == 0)
+	{
+		return stats;
+	}
+
+	stats.sum = row.sum;
+	stats.min = row.min;
+	stats.max = row.max;
+	stats.mean = row.mean;
+	stats.variance = row.m2 / static_cast<double>(stats.count);
+	stats.last_seen_ms = row.last_seen_ms;
+	return stats;
+}
+
+void ClientStatsTable::record(Row &row, int32_t value, int64_t now_ms)
+{
+	const uint64_t count = ++row.count;
+	row.sum += value;
+	row.min = std::min(row.min, value);
+	row.max = std::max(row.max, value);
+	const double delta = value - row.mean;
+	row.mean += delta / static_cast<double>(count);
+	row.m2 += delta * (value - row.mean);
+	row.last_seen_ms = std::max(row.last_seen_ms, now_ms);
+}
+
+void ClientStatsTable::mergeRow(uint32_t slot, const Row &row)
+{
+	const double na = static_cast<double>(count_[slot]);
+	const double nb = static_cast<double>(row.count);
+	const double w = nb / std::max(na + nb, 1.0);
+	const double delta = row.mean - mean_[slot];
+	mean_[slot] += delta * w;
+	m2_[slot] += row.m2 + delta * delta * na * w;
+	count_[slot] += row.count;
+	sum_[slot] += row.sum;
+	min_[slot] = std::min(min_[slot], row.min);
+	max_[slot] = std::max(max_[slot], row.max);
+	last_seen_[slot] = std::max(last_seen_[slot], row.last_seen_ms);
+}
+
+void ClientStatsTable::reserve(size_t n)
+{
+	count_.reserve(n);
+	sum_.reserve(n);
+	min_.reserve(n);
+	max_.reserve(n);
+	mean_.reserve(n);
+	m2_.reserve(n);
+	last_seen_.reserve(n);
+}
+
+void ClientStatsTable::clear()
+{
+	count_.clear();
+	sum_.clear();
+	min_.clear();
+	max_.clear();
+	mean_.clear();
+	m2_.clear();
+	last_seen_.clear();
+}
+
+void ClientStatsTable::merge(const ClientStatsTable &other)
+{
+	const size_t n = other.size();
+	reserve(n);
+	while (size() < n)
+	{
+		add();
+	}
+
+	// An empty row has mean 0, m2 0 and a count of 0, so with the combined
+	// count clamped to 1 the formulas below return the other row unchanged
+	auto merge_moments = [&](size_t i)
+	{
+		const double na = static_cast<double>(count_[i]);
+		const double nb = static_cast<double>(other.count_[i]);
+		const double w = nb / std::max(na + nb, 1.0);
+		const double delta = other.mean_[i] - mean_[i];
+		mean_[i] += delta * w;
+		m2_[i] += other.m2_[i] + delta * delta * na * w;
+	};
+
+	size_t i = 0;
+#if defined(__SSE2__)
+	// Moments two rows at a time; they read the counts, so they go first
+	const __m128d one = _mm_set1_pd(1.0);
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128d na = _mm_set_pd(static_cast<double>(count_[i + 1]), static_cast<double>(count_[i]));
+		__m128d nb = _mm_set_pd(static_cast<double>(other.count_[i + 1]), static_cast<double>(other.count_[i]));
+		__m128d w = _mm_div_pd(nb, _mm_max_pd(_mm_add_pd(na, nb), one));
+		__m128d mean_a = _mm_loadu_pd(&mean_[i]);
+		__m128d delta = _mm_sub_pd(_mm_loadu_pd(&other.mean_[i]), mean_a);
+		__m128d m2 = _mm_add_pd(_mm_loadu_pd(&m2_[i]), _mm_loadu_pd(&other.m2_[i]));
+		m2 = _mm_add_pd(m2, _mm_mul_pd(_mm_mul_pd(delta, delta), _mm_mul_pd(na, w)));
+		_mm_storeu_pd(&mean_[i], _mm_add_pd(mean_a, _mm_mul_pd(delta, w)));
+		_mm_storeu_pd(&m2_[i], m2);
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		merge_moments(i);
+	}
+
+	i = 0;
+#if defined(__SSE2__)
+	for (; i + 2 <= n; i += 2)
+	{
+		auto add64 = [&](auto &dst, const auto &src)
+		{
+			auto *d = reinterpret_cast<__m128i *>(&dst[i]);
+			const auto *s = reinterpret_cast<const __m128i *>(&src[i]);
+			_mm_storeu_si128(d, _mm_add_epi64(_mm_loadu_si128(d), _mm_loadu_si128(s)));
+		};
+		add64(count_, other.count_);
+		add64(sum_, other.sum_);
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		count_[i] += other.count_[i];
+		sum_[i] += other.sum_[i];
+	}
+
+	i = 0;
+#if defined(__SSE2__)
+	// SSE2 has no 32-bit min/max; select through a compare mask
+	for (; i + 4 <= n; i += 4)
+	{
+		auto *min_a = reinterpret_cast<__m128i *>(&min_[i]);
+		auto *max_a = reinterpret_cast<__m128i *>(&max_[i]);
+		__m128i a = _mm_loadu_si128(min_a);
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&other.min_[i]));
+		__m128i greater = _mm_cmpgt_epi32(a, b);
+		_mm_storeu_si128(min_a, _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a)));
+
+		a = _mm_loadu_si128(max_a);
+		b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&other.max_[i]));
+		greater = _mm_cmpgt_epi32(a, b);
+		_mm_storeu_si128(max_a, _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b)));
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		min_[i] = std::min(min_[i], other.min_[i]);
+		max_[i] = std::max(max_[i], other.max_[i]);
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		last_seen_[i] = std::max(last_seen_[i], other.last_seen_[i]);
+	}
+}
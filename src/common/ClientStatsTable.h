@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Per-client statistics of a stream of int32 values, one column per
+// statistic (struct of arrays) indexed by a dense slot number the owner
+// assigns, e.g. as the value of its key map. record() is a handful of
+// scalar operations on one row; merge() combines two tables column by
+// column with SSE2, using Chan's formula for the mean and variance. Empty
+// rows merge as identities, so tables of different sizes combine without
+// branching. Not thread-safe.
+class ClientStatsTable
+{
+public:
+	struct Stats
+	{
+		uint64_t count = 0;
+		int64_t sum = 0;
+		int32_t min = 0; // 0 when count is 0
+		int32_t max = 0;
+		double mean = 0;
+		double variance = 0; // population variance
+		int64_t last_seen_ms = 0;
+	};
+
+	// Raw state of one row, for moving a client out of the table and back
+	struct Row
+	{
+		uint64_t count = 0;
+		int64_t sum = 0;
+		int32_t min = std::numeric_limits<int32_t>::max();
+		int32_t max = std::numeric_limits<int32_t>::min();
+		double mean = 0;
+		double m2 = 0;
+		int64_t last_seen_ms = 0;
+	};
+
+	// Bytes of column storage per client
+	static constexpr size_t BYTES_PER_CLIENT = sizeof(uint64_t) + sizeof(int64_t) + 2 * sizeof(int32_t) +
+											   2 * sizeof(double) + sizeof(int64_t);
+	static_assert(BYTES_PER_CLIENT < 64);
+
+	// Appends an empty row and returns its slot
+	uint32_t add()
+	{
+		count_.emplace_back();
+		sum_.emplace_back();
+		min_.emplace_back();
+		max_.emplace_back();
+		mean_.emplace_back();
+		m2_.emplace_back();
+		last_seen_.emplace_back();
+		const auto slot = static_cast<uint32_t>(count_.size() - 1);
+		setRow(slot, Row{});
+		return slot;
+	}
+
+	// Welford's update
+	void record(uint32_t slot, int32_t value, int64_t now_ms)
+	{
+		const uint64_t count = ++count_[slot];
+		sum_[slot] += value;
+		min_[slot] = value < min_[slot] ? value : min_[slot];
+		max_[slot] = value > max_[slot] ? value : max_[slot];
+		const double delta = value - mean_[slot];
+		mean_[slot] += delta / static_cast<double>(count);
+		m2_[slot] += delta * (value - mean_[slot]);
+		last_seen_[slot] = now_ms > last_seen_[slot] ? now_ms : last_seen_[slot];
+	}
+
+	// The same update on a detached row, e.g. to pre-aggregate a batch
+	static void record(Row &row, int32_t value, int64_t now_ms);
+
+	// Folds row into the row at slot with Chan's formula; recording values
+	// into an empty Row and merging it equals recording them here
+	void mergeRow(uint32_t slot, const Row &row);
+
+	// Pulls every column of a row towards the cache ahead of an update
+	void prefetch(uint32_t slot) const
+	{
+		__builtin_prefetch(&count_[slot], 1);
+		__builtin_prefetch(&sum_[slot], 1);
+		__builtin_prefetch(&min_[slot], 1);
+		__builtin_prefetch(&max_[slot], 1);
+		__builtin_prefetch(&mean_[slot], 1);
+		__builtin_prefetch(&m2_[slot], 1);
+		__builtin_prefetch(&last_seen_[slot], 1);
+	}
+
+	Stats get(uint32_t slot) const { return statsOf(row(slot)); }
+	static Stats statsOf(const Row &row);
+	int64_t sum(uint32_t slot) const { return sum_[slot]; }
+	uint64_t count(uint32_t slot) const { return count_[slot]; }
+	int64_t lastSeen(uint32_t slot) const { return last_seen_[slot]; }
+
+	Row row(uint32_t slot) const
+	{
+		return {count_[slot], sum_[slot], min_[slot], max_[slot], mean_[slot], m2_[slot], last_seen_[slot]};
+	}
+
+	void setRow(uint32_t slot, const Row &row)
+	{
+		count_[slot] = row.count;
+		sum_[slot] = row.sum;
+		min_[slot] = row.min;
+		max_[slot] = row.max;
+		mean_[slot] = row.mean;
+		m2_[slot] = row.m2;
+		last_seen_[slot] = row.last_seen_ms;
+	}
+
+	// Empties a row so its slot can be reused
+	void reset(uint32_t slot) { setRow(slot, Row{}); }
+
+	// Folds other's row i into row i for every slot of other, growing this
+	// table with empty rows first if it is smaller
+	void merge(const ClientStatsTable &other);
+
+	size_t size() const { return count_.size(); }
+	void reserve(size_t n);
+	void clear();
+
+private:
+	std::vector<uint64_t> count_;
+	std::vector<int64_t> sum_;
+	std::vector<int32_t> min_;
+	std::vector<int32_t> max_;
+	std::vector<double> mean_;
+	std::vector<double> m2_; // sum of squared deviations from the mean
+	std::vector<int64_t> last_seen_;
+};
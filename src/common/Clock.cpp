@@ -0,0 +1,119 @@
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <common/Clock.h>
+
+namespace
+{
+	constexpr auto CALIBRATION_WINDOW = std::chrono::milliseconds(10);
+
+	uint64_t steadyNow()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+										 std::chrono::steady_clock::now().time_since_epoch())
+										 .count());
+	}
+
+	// A steady_clock reading paired with the tick count at the same moment
+	struct Sample
+	{
+		uint64_t ticks;
+		uint64_t nanos;
+	};
+
+	Sample sample()
+	{
+		// The tightest of a few brackets, so a preemption between the reads
+		// does not skew the pairing
+		Sample best{};
+		uint64_t best_width = UINT64_MAX;
+		for (int i = 0; i < 5; ++i)
+		{
+			const uint64_t before = Clock::ticks();
+			const uint64_t nanos = steadyNow();
+			const uint64_t after = Clock::ticks();
+			if (after - before < best_width)
+			{
+				best_width = after - before;
+				best = {before + (after - before) / 2, nanos};
+			}
+		}
+		return best;
+	}
+
+	struct Calibration
+	{
+		Sample origin;
+		double ticks_per_ns;
+	};
+
+	const Calibration &calibration()
+	{
+		static const Calibration result = []
+		{
+			if (!Clock::usesTsc())
+				return Calibration{{0, 0}, 1.0};
+
+			const Sample start = sample();
+			std::this_thread::sleep_for(CALIBRATION_WINDOW);
+			const Sample end = sample();
+			return Calibration{start, static_cast<double>(end.ticks - start.ticks) /
+										  static_cast<double>(end.nanos - start.nanos)};
+		}();
+		return result;
+	}
+}
+
+uint64_t Clock::steadyNanos()
+{
+	return steadyNow();
+}
+
+int64_t Clock::wallMillis()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			   std::chrono::system_clock::now().time_since_epoch())
+		.count();
+}
+
+bool Clock::detectInvariantTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	// CPUID 0x80000007 EDX bit 8: the TSC runs at a constant rate in all
+	// power states, so it can stand in for a clock
+	unsigned eax, ebx, ecx, edx;
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+		return (edx & (1u << 8)) != 0;
+#endif
+	return false;
+}
+
+void Clock::tick()
+{
+	const int64_t wall_ms = wallMillis();
+	coarse_seconds_.store(static_cast<time_t>(wall_ms / 1000), std::memory_order_relaxed);
+	coarse_wall_millis_.store(wall_ms, std::memory_order_relaxed);
+	coarse_millis_.store(steadyNow() / 1'000'000, std::memory_order_relaxed);
+}
+
+void Clock::calibrate()
+{
+	calibration();
+}
+
+double Clock::ticksPerSecond()
+{
+	return calibration().ticks_per_ns * 1e9;
+}
+
+uint64_t Clock::nanos(Ticks reading)
+{
+	const Calibration &calib = calibration();
+	// Readings taken before the calibration are negative offsets
+	const auto offset = static_cast<double>(static_cast<int64_t>(reading - calib.origin.ticks));
+	return calib.origin.nanos + static_cast<uint64_t>(static_cast<int64_t>(offset / calib.ticks_per_ns));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timestamps for the server's hot paths, in two flavours.
+//
+// Coarse time is for timeouts and activity bookkeeping: the reactor (or the
+// blocking server's ticker thread) calls tick() once per loop iteration and
+// everyone else reads the cached wall seconds and milliseconds (same epoch
+// as time(nullptr)) or monotonic milliseconds with one relaxed load.
+// Readings are as old as the ticking thread's current iteration.
+//
+// Fine time is for latencies: ticks() is a raw rdtsc when the CPU has an
+// invariant TSC, calibrated against steady_clock on first use (or by an
+// early calibrate()), and steady_clock nanoseconds otherwise. Tick
+// differences convert with the helpers below; nanos() maps a reading onto
+// steady_clock's timeline.
+class Clock
+{
+public:
+	using Ticks = uint64_t;
+
+	// Coarse
+	static void tick();
+	static time_t coarseSeconds() { return coarse_seconds_.load(std::memory_order_relaxed); }
+	static uint64_t coarseMillis() { return coarse_millis_.load(std::memory_order_relaxed); }
+	static int64_t coarseWallMillis() { return coarse_wall_millis_.load(std::memory_order_relaxed); }
+
+	// Fine
+	static Ticks ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		if (use_tsc_)
+			return __rdtsc();
+#endif
+		return steadyNanos();
+	}
+
+	// Measures the TSC rate now instead of on the first conversion
+	static void calibrate();
+	static bool usesTsc() { return use_tsc_; }
+	static double ticksPerSecond();
+
+	static double toSeconds(Ticks elapsed) { return static_cast<double>(elapsed) / ticksPerSecond(); }
+	static double toNanos(Ticks elapsed) { return toSeconds(elapsed) * 1e9; }
+	static double toMillis(Ticks elapsed) { return toSeconds(elapsed) * 1e3; }
+	static double toMicros(Ticks elapsed) { return toSeconds(elapsed) * 1e6; }
+	static Ticks fromSeconds(double seconds) { return static_cast<Ticks>(seconds * ticksPerSecond()); }
+	static double secondsSince(Ticks start) { return toSeconds(ticks() - start); }
+	static double millisSince(Ticks start) { return toMillis(ticks() - start); }
+
+	// steady_clock nanoseconds of a ticks() reading
+	static uint64_t nanos(Ticks reading);
+	static uint64_t nanos() { return nanos(ticks()); }
+
+private:
+	static uint64_t steadyNanos();
+	static int64_t wallMillis();
+	static bool detectInvariantTsc();
+
+	inline static std::atomic<time_t> coarse_seconds_{time(nullptr)};
+	inline static std::atomic<uint64_t> coarse_millis_{steadyNanos() / 1'000'000};
+	inline static std::atomic<int64_t> coarse_wall_millis_{wallMillis()};
+	inline static const bool use_tsc_ = detectInvariantTsc();
+};
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Mixes std::hash output so both halves of the word carry entropy: the table
+// takes its group index from the high bits and a 7-bit tag from the low ones,
+// and std::hash<int> is the identity. String hashes accept any string-like key.
+template <typename Key>
+struct FlatHash
+{
+	static size_t mix(uint64_t h)
+	{
+		h *= 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	size_t operator()(const Key &key) const { return mix(std::hash<Key>{}(key)); }
+};
+
+template <>
+struct FlatHash<std::string>
+{
+	using is_transparent = void;
+
+	size_t operator()(std::string_view key) const { return FlatHash<int>::mix(std::hash<std::string_view>{}(key)); }
+};
+
+// Open-addressing hash map in the Swiss-table layout: one control byte per
+// slot (empty, deleted, or the low 7 hash bits of a full slot), scanned 16 at
+// a time with SSE2 so a lookup touches one control group and usually one slot.
+// Elements live inline in a flat array, so inserts only allocate on growth.
+//
+// Differences from std::unordered_map: iterators and references are
+// invalidated by any insert that grows the table (erase invalidates only the
+// erased element), iteration order is unspecified, and keys must not be
+// modified through an iterator. Lookups are heterogeneous when Hash defines
+// is_transparent, e.g. find(std::string_view) on a std::string key.
+template <typename Key, typename Value, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<>>
+class FlatHashMap
+{
+	static constexpr size_t GROUP_SIZE = 16;
+	static constexpr int8_t EMPTY = -128;  // 0b10000000
+	static constexpr int8_t DELETED = -2;  // 0b11111110; full slots are 0..127
+
+	// Bit i set when control byte i of the group matches
+	class Group
+	{
+	public:
+		explicit Group(const int8_t *ctrl)
+		{
+#if defined(__SSE2__)
+			ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+			std::memcpy(ctrl_, ctrl, GROUP_SIZE);
+#endif
+		}
+
+		uint32_t match(int8_t tag) const
+		{
+#if defined(__SSE2__)
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl_)));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < GROUP_SIZE; ++i)
+				mask |= static_cast<uint32_t>(ctrl_[i] == tag) << i;
+			return mask;
+#endif
+		}
+
+		uint32_t matchEmpty() const { return match(EMPTY); }
+
+		// Empty and deleted bytes are the only ones with the sign bit set
+		uint32_t matchFree() const
+		{
+#if defined(__SSE2__)
+			return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < GROUP_SIZE; ++i)
+				mask |= static_cast<uint32_t>(ctrl_[i] < 0) << i;
+			return mask;
+#endif
+		}
+
+	private:
+#if defined(__SSE2__)
+		__m128i ctrl_;
+#else
+		int8_t ctrl_[GROUP_SIZE];
+#endif
+	};
+
+public:
+	using key_type = Key;
+	using mapped_type = Value;
+	using value_type = std::pair<Key, Value>;
+	using size_type = size_t;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+
+	template <bool Const>
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = FlatHashMap::value_type;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::conditional_t<Const, const value_type &, value_type &>;
+		using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+
+		Iterator() = default;
+		// iterator -> const_iterator
+		template <bool C = Const, typename = std::enable_if_t<C>>
+		Iterator(const Iterator<false> &other) : ctrl_(other.ctrl_), slot_(other.slot_), end_(other.end_) {}
+
+		reference operator*() const { return *slot_; }
+		pointer operator->() const { return slot_; }
+
+		Iterator &operator++()
+		{
+			++ctrl_;
+			++slot_;
+			skipFree();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator copy = *this;
+			++*this;
+			return copy;
+		}
+
+		bool operator==(const Iterator &other) const { return ctrl_ == other.ctrl_; }
+
+	private:
+		friend class FlatHashMap;
+		template <bool>
+		friend class Iterator;
+
+		Iterator(const int8_t *ctrl, value_type *slot, const int8_t *end) : ctrl_(ctrl), slot_(slot), end_(end) {}
+
+		void skipFree()
+		{
+			while (ctrl_ != end_ && *ctrl_ < 0)
+			{
+				++ctrl_;
+				++slot_;
+			}
+		}
+
+		const int8_t *ctrl_ = nullptr;
+		value_type *slot_ = nullptr;
+		const int8_t *end_ = nullptr;
+	};
+
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	FlatHashMap() = default;
+
+	explicit FlatHashMap(size_t expected_size) { reserve(expected_size); }
+
+	FlatHashMap(std::initializer_list<value_type> values)
+	{
+		reserve(values.size());
+		for (const auto &value : values)
+			try_emplace(value.first, value.second);
+	}
+
+	FlatHashMap(const FlatHashMap &other)
+	{
+		reserve(other.size_);
+		for (const auto &[key, value] : other)
+			emplaceUnique(hash_(key), key, value);
+	}
+
+	FlatHashMap(FlatHashMap &&other) noexcept { swap(other); }
+
+	FlatHashMap &operator=(FlatHashMap other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~FlatHashMap() { release(); }
+
+	void swap(FlatHashMap &other) noexcept
+	{
+		std::swap(ctrl_, other.ctrl_);
+		std::swap(slots_, other.slots_);
+		std::swap(capacity_, other.capacity_);
+		std::swap(size_, other.size_);
+		std::swap(growth_left_, other.growth_left_);
+	}
+
+	iterator begin()
+	{
+		iterator it(ctrl_, slots_, ctrl_ + capacity_);
+		it.skipFree();
+		return it;
+	}
+	iterator end() { return iterator(ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_); }
+	const_iterator begin() const { return const_cast<FlatHashMap *>(this)->begin(); }
+	const_iterator end() const { return const_cast<FlatHashMap *>(this)->end(); }
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	size_t capacity() const { return capacity_; }
+	double loadFactor() const { return capacity_ ? static_cast<double>(size_) / capacity_ : 0.0; }
+
+	template <typename K>
+	iterator find(const K &key)
+	{
+		return find(key, hash_(key));
+	}
+
+	// Lookup with hash(key) computed earlier, e.g. outside a lock
+	template <typename K>
+	iterator find(const K &key, size_t hash)
+	{
+		if (size_ == 0)
+			return end();
+		size_t index = findIndex(hash, key);
+		return index == NOT_FOUND ? end() : iteratorAt(index);
+	}
+
+	template <typename K>
+	size_t hash(const K &key) const { return hash_(key); }
+
+	// Starts loading the control group and first slot a lookup of hash reads
+	// first, so batched lookups can overlap their cache misses
+	void prefetch(size_t hash) const
+	{
+		if (capacity_ == 0)
+			return;
+		const size_t base = firstGroup(hash) * GROUP_SIZE;
+		__builtin_prefetch(ctrl_ + base);
+		__builtin_prefetch(slots_ + base);
+	}
+
+	template <typename K>
+	const_iterator find(const K &key) const
+	{
+		return const_cast<FlatHashMap *>(this)->find(key);
+	}
+
+	template <typename K>
+	Value &at(const K &key)
+	{
+		auto it = find(key);
+		if (it == end())
+			throw std::out_of_range("FlatHashMap::at");
+		return it->second;
+	}
+
+	template <typename K>
+	const Value &at(const K &key) const
+	{
+		return const_cast<FlatHashMap *>(this)->at(key);
+	}
+
+	template <typename K>
+	bool contains(const K &key) const { return find(key) != end(); }
+
+	template <typename K>
+	size_t count(const K &key) const { return contains(key) ? 1 : 0; }
+
+	// Constructs Key from key only when the element is inserted
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> try_emplace(K &&key, Args &&...args)
+	{
+		const size_t hash = hash_(key);
+		if (size_ != 0)
+		{
+			size_t index = findIndex(hash, key);
+			if (index != NOT_FOUND)
+				return {iteratorAt(index), false};
+		}
+		return {emplaceUnique(hash, std::forward<K>(key), std::forward<Args>(args)...), true};
+	}
+
+	template <typename K, typename V>
+	std::pair<iterator, bool> insert_or_assign(K &&key, V &&value)
+	{
+		auto result = try_emplace(std::forward<K>(key), std::forward<V>(value));
+		if (!result.second)
+			result.first->second = std::forward<V>(value);
+		return result;
+	}
+
+	std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+
+	template <typename K>
+	Value &operator[](K &&key)
+	{
+		return try_emplace(std::forward<K>(key)).first->second;
+	}
+
+	template <typename K>
+	size_t erase(const K &key)
+	{
+		auto it = find(key);
+		if (it == end())
+			return 0;
+		erase(it);
+		return 1;
+	}
+
+	// Returns the element after it; nothing moves, so other iterators stay valid
+	iterator erase(iterator it)
+	{
+		eraseAt(static_cast<size_t>(it.ctrl_ - ctrl_));
+		++it;
+		return it;
+	}
+
+	void clear()
+	{
+		for (size_t i = 0; i < capacity_; ++i)
+		{
+			if (ctrl_[i] >= 0)
+				std::destroy_at(slots_ + i);
+		}
+		if (capacity_)
+			std::memset(ctrl_, EMPTY, capacity_);
+		size_ = 0;
+		growth_left_ = maxLoad(capacity_);
+	}
+
+	// Sizes the table so expected_size elements fit without growing
+	void reserve(size_t expected_size)
+	{
+		if (expected_size <= maxLoad(capacity_))
+			return;
+		size_t capacity = std::max(capacity_, GROUP_SIZE);
+		while (maxLoad(capacity) < expected_size)
+			capacity *= 2;
+		rehash(capacity);
+	}
+
+	// Copy of the contents taken in one pass, for callers that iterate
+	// outside the lock that guards the map
+	std::vector<value_type> snapshot() const
+	{
+		std::vector<value_type> copy;
+		copy.reserve(size_);
+		for (const auto &value : *this)
+			copy.push_back(value);
+		return copy;
+	}
+
+private:
+	static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+	static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+	static int8_t tagOf(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+	size_t groupMask() const { return capacity_ / GROUP_SIZE - 1; }
+	size_t firstGroup(size_t hash) const { return (hash >> 7) & groupMask(); }
+
+	iterator iteratorAt(size_t index) { return iterator(ctrl_ + index, slots_ + index, ctrl_ + capacity_); }
+
+	// Groups are probed triangularly (g, g+1, g+3, g+6, ...), which visits
+	// every group of a power-of-two table; a group with an empty byte ends it
+	template <typename K>
+	size_t findIndex(size_t hash, const K &key) const
+	{
+		const int8_t tag = tagOf(hash);
+		size_t group = firstGroup(hash);
+		for (size_t step = 1;; ++step)
+		{
+			const size_t base = group * GROUP_SIZE;
+			Group g(ctrl_ + base);
+			for (uint32_t mask = g.match(tag); mask != 0; mask &= mask - 1)
+			{
+				size_t index = base + std::countr_zero(mask);
+				if (equal_(slots_[index].first, key))
+					return index;
+			}
+			if (g.matchEmpty() != 0 || step > groupMask())
+				return NOT_FOUND;
+			group = (group + step) & groupMask();
+		}
+	}
+
+	size_t findFree(size_t hash) const
+	{
+		size_t group = firstGroup(hash);
+		for (size_t step = 1;; ++step)
+		{
+			const size_t base = group * GROUP_SIZE;
+			if (uint32_t mask = Group(ctrl_ + base).matchFree(); mask != 0)
+				return base + std::countr_zero(mask);
+			group = (group + step) & groupMask();
+		}
+	}
+
+	template <typename K, typename... Args>
+	iterator emplaceUnique(size_t hash, K &&key, Args &&...args)
+	{
+		size_t index = capacity_ ? findFree(hash) : NOT_FOUND;
+		if (index == NOT_FOUND || (growth_left_ == 0 && ctrl_[index] == EMPTY))
+		{
+			// Rebuild in place when tombstones, not elements, used up the room
+			rehash(capacity_ && size_ < maxLoad(capacity_) / 2 ? capacity_ : std::max(capacity_ * 2, GROUP_SIZE));
+			index = findFree(hash);
+		}
+
+		std::construct_at(slots_ + index, std::piecewise_construct,
+						  std::forward_as_tuple(std::forward<K>(key)),
+						  std::forward_as_tuple(std::forward<Args>(args)...));
+		if (ctrl_[index] == EMPTY)
+			--growth_left_;
+		ctrl_[index] = tagOf(hash);
+		++size_;
+		return iteratorAt(index);
+	}
+
+	void eraseAt(size_t index)
+	{
+		std::destroy_at(slots_ + index);
+		--size_;
+
+		// A probe that reaches this group stops here if it already has an
+		// empty byte, so the slot can go back to empty instead of a tombstone
+		const size_t base = index - index % GROUP_SIZE;
+		if (Group(ctrl_ + base).matchEmpty() != 0)
+		{
+			ctrl_[index] = EMPTY;
+			++growth_left_;
+		}
+		else
+		{
+			ctrl_[index] = DELETED;
+		}
+	}
+
+	void rehash(size_t capacity)
+	{
+		int8_t *old_ctrl = ctrl_;
+		value_type *old_slots = slots_;
+		const size_t old_capacity = capacity_;
+
+		ctrl_ = static_cast<int8_t *>(::operator new(capacity));
+		std::memset(ctrl_, EMPTY, capacity);
+		slots_ = std::allocator<value_type>().allocate(capacity);
+		capacity_ = capacity;
+		growth_left_ = maxLoad(capacity) - size_;
+
+		for (size_t i = 0; i < old_capacity; ++i)
+		{
+			if (old_ctrl[i] < 0)
+				continue;
+			const size_t hash = hash_(old_slots[i].first);
+			const size_t index = findFree(hash);
+			std::construct_at(slots_ + index, std::move(old_slots[i]));
+			std::destroy_at(old_slots + i);
+			ctrl_[index] = tagOf(hash);
+		}
+
+		if (old_capacity)
+		{
+			::operator delete(old_ctrl);
+			std::allocator<value_type>().deallocate(old_slots, old_capacity);
+		}
+	}
+
+	void release()
+	{
+		if (!capacity_)
+			return;
+		for (size_t i = 0; i < capacity_; ++i)
+		{
+			if (ctrl_[i] >= 0)
+				std::destroy_at(slots_ + i);
+		}
+		::operator delete(ctrl_);
+		std::allocator<value_type>().deallocate(slots_, capacity_);
+		ctrl_ = nullptr;
+		slots_ = nullptr;
+		capacity_ = size_ = growth_left_ = 0;
+	}
+
+	int8_t *ctrl_ = nullptr;
+	value_type *slots_ = nullptr;
+	size_t capacity_ = 0;
+	size_t size_ = 0;
+	size_t growth_left_ = 0;
+	[[no_unique_address]] Hash hash_;
+	[[no_unique_address]] KeyEqual equal_;
+};
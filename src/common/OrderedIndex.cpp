@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/OrderedIndex.h>
+
+OrderedIndex::OrderedIndex() : root_(new Leaf())
+{
+}
+
+OrderedIndex::~OrderedIndex()
+{
+	destroy(root_);
+}
+
+void OrderedIndex::clear()
+{
+	destroy(root_);
+	root_ = new Leaf();
+	size_ = 0;
+	height_ = 1;
+}
+
+void OrderedIndex::destroy(Node *node)
+{
+	if (node->leaf)
+	{
+		delete static_cast<Leaf *>(node);
+		return;
+	}
+
+	auto *inner = static_cast<Inner *>(node);
+	for (int i = 0; i <= inner->count; ++i)
+	{
+		destroy(inner->children[i]);
+	}
+	delete inner;
+}
+
+// Keys are sorted, so the scan stops at the first block that is not all less
+int OrderedIndex::countLess(const int32_t *keys, int n, int32_t key)
+{
+#if defined(__SSE2__)
+	const __m128i needle = _mm_set1_epi32(key);
+	int less = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i block = _mm_load_si128(reinterpret_cast<const __m128i *>(keys + i));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, needle)));
+		less += std::popcount(static_cast<unsigned>(mask));
+		if (mask != 0xF)
+			return less;
+	}
+	for (; i < n && keys[i] < key; ++i)
+	{
+		++less;
+	}
+	return less;
+#else
+	return static_cast<int>(std::lower_bound(keys, keys + n, key) - keys);
+#endif
+}
+
+// Number of separators <= key
+int OrderedIndex::childIndex(const Inner *node, int32_t key)
+{
+	return key == INT32_MAX ? node->count : countLess(node->keys, node->count, key + 1);
+}
+
+OrderedIndex::RangeTotal OrderedIndex::subtreeTotal(const Node *node)
+{
+	RangeTotal total;
+	if (node->leaf)
+	{
+		const auto *leaf = static_cast<const Leaf *>(node);
+		total.count = leaf->count;
+		for (int i = 0; i < leaf->count; ++i)
+		{
+			total.sum += leaf->values[i];
+		}
+		return total;
+	}
+
+	const auto *inner = static_cast<const Inner *>(node);
+	for (int i = 0; i <= inner->count; ++i)
+	{
+		total.count += inner->counts[i];
+		total.sum += inner->sums[i];
+	}
+	return total;
+}
+
+void OrderedIndex::add(int32_t key, int64_t delta)
+{
+	bool inserted = false;
+	auto split = insert(root_, key, delta, inserted);
+	if (inserted)
+	{
+		++size_;
+	}
+
+	if (split)
+	{
+		auto *root = new Inner();
+		root->count = 1;
+		root->keys[0] = split->separator;
+		root->children[0] = root_;
+		root->children[1] = split->right;
+		for (int i = 0; i < 2; ++i)
+		{
+			RangeTotal total = subtreeTotal(root->children[i]);
+			root->counts[i] = total.count;
+			root->sums[i] = total.sum;
+		}
+		root_ = root;
+		++height_;
+	}
+}
+
+std::optional<OrderedIndex::Split> OrderedIndex::insert(Node *node, int32_t key, int64_t delta, bool &inserted)
+{
+	if (node->leaf)
+	{
+		auto *leaf = static_cast<Leaf *>(node);
+		int pos = countLess(leaf->keys, leaf->count, key);
+		if (pos < leaf->count && leaf->keys[pos] == key)
+		{
+			leaf->values[pos] += delta;
+			return std::nullopt;
+		}
+		inserted = true;
+
+		std::optional<Split> split;
+		Leaf *target = leaf;
+		if (leaf->count == NODE_KEYS)
+		{
+			// Move the upper half to a new right sibling and insert into whichever half owns pos
+			constexpr int half = NODE_KEYS / 2;
+			auto *right = new Leaf();
+			right->count = NODE_KEYS - half;
+			std::copy(leaf->keys + half, leaf->keys + NODE_KEYS, right->keys);
+			std::copy(leaf->values + half, leaf->values + NODE_KEYS, right->values);
+			right->next = leaf->next;
+			leaf->next = right;
+			leaf->count = half;
+			split = Split{0, right};
+
+			if (pos >= half)
+			{
+				target = right;
+				pos -= half;
+			}
+		}
+
+		std::copy_backward(target->keys + pos, target->keys + target->count, target->keys + target->count + 1);
+		std::copy_backward(target->values + pos, target->values + target->count, target->values + target->count + 1);
+		target->keys[pos] = key;
+		target->values[pos] = delta;
+		++target->count;
+
+		if (split)
+		{
+			split->separator = split->right->keys[0];
+		}
+		return split;
+	}
+
+	auto *inner = static_cast<Inner *>(node);
+	int idx = childIndex(inner, key);
+	auto child_split = insert(inner->children[idx], key, delta, inserted);
+	inner->sums[idx] += delta;
+	inner->counts[idx] += inserted ? 1 : 0;
+	if (!child_split)
+	{
+		return std::nullopt;
+	}
+
+	// The new right child takes its share of the totals from children[idx]
+	RangeTotal right_total = subtreeTotal(child_split->right);
+	inner->counts[idx] -= right_total.count;
+	inner->sums[idx] -= right_total.sum;
+
+	// Lay out the node with the new child in scratch arrays one entry
+	// larger than a node, then copy back, splitting around the middle key
+	// if it overflowed
+	int32_t keys[NODE_KEYS + 1];
+	Node *children[NODE_KEYS + 2];
+	uint64_t counts[NODE_KEYS + 2];
+	int64_t sums[NODE_KEYS + 2];
+	const int n = inner->count;
+
+	std::copy(inner->keys, inner->keys + idx, keys);
+	keys[idx] = child_split->separator;
+	std::copy(inner->keys + idx, inner->keys + n, keys + idx + 1);
+
+	std::copy(inner->children, inner->children + idx + 1, children);
+	children[idx + 1] = child_split->right;
+	std::copy(inner->children + idx + 1, inner->children + n + 1, children + idx + 2);
+
+	std::copy(inner->counts, inner->counts + idx + 1, counts);
+	counts[idx + 1] = right_total.count;
+	std::copy(inner->counts + idx + 1, inner->counts + n + 1, counts + idx + 2);
+
+	std::copy(inner->sums, inner->sums + idx + 1, sums);
+	sums[idx + 1] = right_total.sum;
+	std::copy(inner->sums + idx + 1, inner->sums + n + 1, sums + idx + 2);
+
+	auto fill = [&](Inner *target, int first_key, int key_count)
+	{
+		target->count = key_count;
+		std::copy(keys + first_key, keys + first_key + key_count, target->keys);
+		std::copy(children + first_key, children + first_key + key_count + 1, target->children);
+		std::copy(counts + first_key, counts + first_key + key_count + 1, target->counts);
+		std::copy(sums + first_key, sums + first_key + key_count + 1, target->sums);
+	};
+
+	if (n < NODE_KEYS)
+	{
+		fill(inner, 0, n + 1);
+		return std::nullopt;
+	}
+
+	// NODE_KEYS + 1 keys: the left half stays, the middle one moves up
+	constexpr int half = (NODE_KEYS + 1) / 2;
+	auto *right = new Inner();
+	fill(right, half + 1, NODE_KEYS - half);
+	fill(inner, 0, half);
+	return Split{keys[half], right};
+}
+
+std::optional<int64_t> OrderedIndex::erase(int32_t key)
+{
+	auto value = erase(root_, key);
+	if (value)
+	{
+		--size_;
+	}
+	return value;
+}
+
+std::optional<int64_t> OrderedIndex::erase(Node *node, int32_t key)
+{
+	if (node->leaf)
+	{
+		auto *leaf = static_cast<Leaf *>(node);
+		int pos = countLess(leaf->keys, leaf->count, key);
+		if (pos == leaf->count || leaf->keys[pos] != key)
+		{
+			return std::nullopt;
+		}
+
+		int64_t value = leaf->values[pos];
+		std::copy(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+		std::copy(leaf->values + pos + 1, leaf->values + leaf->count, leaf->values + pos);
+		--leaf->count;
+		return value;
+	}
+
+	auto *inner = static_cast<Inner *>(node);
+	int idx = childIndex(inner, key);
+	auto value = erase(inner->children[idx], key);
+	if (value)
+	{
+		--inner->counts[idx];
+		inner->sums[idx] -= *value;
+	}
+	return value;
+}
+
+std::optional<int64_t> OrderedIndex::find(int32_t key) const
+{
+	int pos;
+	const Leaf *leaf = lowerBound(key, pos);
+	if (pos < leaf->count && leaf->keys[pos] == key)
+	{
+		return leaf->values[pos];
+	}
+	return std::nullopt;
+}
+
+const OrderedIndex::Leaf *OrderedIndex::lowerBound(int32_t key, int &pos) const
+{
+	const Node *node = root_;
+	while (!node->leaf)
+	{
+		const auto *inner = static_cast<const Inner *>(node);
+		node = inner->children[childIndex(inner, key)];
+	}
+
+	const auto *leaf = static_cast<const Leaf *>(node);
+	pos = countLess(leaf->keys, leaf->count, key);
+	return leaf;
+}
+
+OrderedIndex::RangeTotal OrderedIndex::prefix(int32_t key) const
+{
+	RangeTotal total;
+	const Node *node = root_;
+	while (!node->leaf)
+	{
+		// Whole subtrees left of the path come from the per-child totals
+		const auto *inner = static_cast<const Inner *>(node);
+		int idx = childIndex(inner, key);
+		for (int i = 0; i < idx; ++i)
+		{
+			total.count += inner->counts[i];
+			total.sum += inner->sums[i];
+		}
+		node = inner->children[idx];
+	}
+
+	const auto *leaf = static_cast<const Leaf *>(node);
+	int n = key == INT32_MAX ? leaf->count : countLess(leaf->keys, leaf->count, key + 1);
+	total.count += n;
+	for (int i = 0; i < n; ++i)
+	{
+		total.sum += leaf->values[i];
+	}
+	return total;
+}
+
+OrderedIndex::RangeTotal OrderedIndex::total(int32_t from, int32_t to) const
+{
+	if (from > to)
+	{
+		return {};
+	}
+
+	RangeTotal upper = prefix(to);
+	if (from == INT32_MIN)
+	{
+		return upper;
+	}
+
+	RangeTotal lower = prefix(from - 1);
+	return {upper.count - lower.count, upper.sum - lower.sum};
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// B+-tree from int32 keys to int64 values, for ordered queries over client
+// ids. Nodes hold up to 64 keys in one sorted array that is searched with
+// SSE2 compares; inner nodes also keep the entry count and value sum of each
+// child's subtree, so range totals cost one root-to-leaf walk per bound.
+// Leaves are linked for in-order scans. erase() leaves nodes underfull
+// instead of rebalancing; separators stay valid, so only space is lost until
+// later inserts refill the nodes. Not thread-safe.
+class OrderedIndex
+{
+public:
+	struct RangeTotal
+	{
+		uint64_t count = 0;
+		int64_t sum = 0;
+	};
+
+	OrderedIndex();
+	~OrderedIndex();
+
+	OrderedIndex(const OrderedIndex &) = delete;
+	OrderedIndex &operator=(const OrderedIndex &) = delete;
+
+	// Adds delta to the value at key, inserting key with value delta if absent
+	void add(int32_t key, int64_t delta);
+	std::optional<int64_t> find(int32_t key) const;
+	// Removes key; returns its value, or nullopt if it was absent
+	std::optional<int64_t> erase(int32_t key);
+
+	// Count and sum of the entries with from <= key <= to
+	RangeTotal total(int32_t from, int32_t to) const;
+
+	// Calls f(key, value) for entries with from <= key <= to in key order,
+	// stopping after limit calls; returns the number of calls
+	template <typename F>
+	size_t scan(int32_t from, int32_t to, size_t limit, F &&f) const
+	{
+		size_t visited = 0;
+		int pos;
+		for (const Leaf *leaf = lowerBound(from, pos); leaf != nullptr && visited < limit; leaf = leaf->next, pos = 0)
+		{
+			for (; pos < leaf->count && visited < limit; ++pos, ++visited)
+			{
+				if (leaf->keys[pos] > to)
+					return visited;
+				f(leaf->keys[pos], leaf->values[pos]);
+			}
+		}
+		return visited;
+	}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	int height() const { return height_; }
+	void clear();
+
+private:
+	static constexpr int NODE_KEYS = 64;
+
+	struct Node
+	{
+		explicit Node(bool is_leaf) : leaf(is_leaf) {}
+
+		bool leaf;
+		int count = 0;
+		alignas(16) int32_t keys[NODE_KEYS];
+	};
+
+	struct Leaf : Node
+	{
+		Leaf() : Node(true) {}
+
+		int64_t values[NODE_KEYS];
+		Leaf *next = nullptr;
+	};
+
+	// children[i] holds keys below keys[i]; children[i + 1] holds keys from keys[i] up
+	struct Inner : Node
+	{
+		Inner() : Node(false) {}
+
+		Node *children[NODE_KEYS + 1];
+		uint64_t counts[NODE_KEYS + 1];
+		int64_t sums[NODE_KEYS + 1];
+	};
+
+	struct Split
+	{
+		int32_t separator;
+		Node *right;
+	};
+
+	static int countLess(const int32_t *keys, int n, int32_t key);
+	static int childIndex(const Inner *node, int32_t key);
+	static RangeTotal subtreeTotal(const Node *node);
+	static void destroy(Node *node);
+
+	std::optional<Split> insert(Node *node, int32_t key, int64_t delta, bool &inserted);
+	static std::optional<int64_t> erase(Node *node, int32_t key);
+	const Leaf *lowerBound(int32_t key, int &pos) const;
+	RangeTotal prefix(int32_t key) const; // entries with key <= key
+
+	Node *root_;
+	size_t size_ = 0;
+	int height_ = 1;
+};
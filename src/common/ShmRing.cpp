@@ -0,0 +1,55 @@
+#include <bit>
+#include <new>
+
+#include <common/ShmRing.h>
+
+uint32_t ShmRing::roundCapacity(uint32_t capacity)
+{
+	if (capacity <= MIN_CAPACITY)
+		return MIN_CAPACITY;
+	if (capacity >= MAX_CAPACITY)
+		return MAX_CAPACITY;
+	return std::bit_ceil(capacity);
+}
+
+size_t ShmRing::bytesFor(uint32_t capacity)
+{
+	return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Slot);
+}
+
+ShmRing ShmRing::create(void *memory, uint32_t capacity, Mode mode)
+{
+	auto *header = new (memory) Header{};
+	header->magic = MAGIC;
+	header->version = VERSION;
+	header->capacity = capacity;
+	header->mode = mode;
+
+	auto *slots = reinterpret_cast<Slot *>(static_cast<char *>(memory) + sizeof(Header));
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		new (&slots[i]) Slot{};
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	return ShmRing(header, slots);
+}
+
+ShmRing ShmRing::attach(void *memory, size_t size)
+{
+	if (memory == nullptr || size < sizeof(Header))
+	{
+		return {};
+	}
+
+	auto *header = static_cast<Header *>(memory);
+	if (header->magic != MAGIC || header->version != VERSION || !std::has_single_bit(header->capacity) ||
+		size < bytesFor(header->capacity))
+	{
+		return {};
+	}
+
+	ShmRing ring(header, reinterpret_cast<Slot *>(static_cast<char *>(memory) + sizeof(Header)));
+	ring.tail_ = header->tail.load(std::memory_order_relaxed);
+	return ring;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Bounded queue of (id, number) records in memory shared between processes,
+// for producers on the same host. Each slot carries a sequence number, so
+// producers and the single consumer only meet on the slot they touch: a
+// producer may write slot p once its sequence is p and publishes it by
+// setting p + 1; the consumer reads it when the sequence is p + 1 and frees
+// it for the next lap with p + capacity. With SingleProducer the producer
+// claims positions with a plain store, with MultiProducer a compare-exchange
+// lets threads or processes share one ring.
+//
+// The ring holds no file descriptors. To block while idle, the consumer
+// raises a sleeping flag, checks the ring once more and waits on an event
+// the producers signal when they see the flag (consumerSleep(),
+// producerShouldWake()); both sides fence, so a record pushed around the
+// time the consumer goes to sleep is either seen by the consumer or wakes
+// it. While the consumer is awake, pushing and popping are plain memory
+// operations.
+class ShmRing
+{
+public:
+	struct Record
+	{
+		int32_t id;
+		int32_t number;
+	};
+
+	enum class Mode : uint32_t
+	{
+		SingleProducer,
+		MultiProducer,
+	};
+
+	// Sent by a producer when it connects, and echoed back with the
+	// capacity the consumer chose
+	struct Hello
+	{
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint32_t capacity = 0;
+		Mode mode = Mode::SingleProducer;
+	};
+
+	static constexpr uint32_t MAGIC = 0x53524e47; // "SRNG"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t MIN_CAPACITY = 1u << 10;
+	static constexpr uint32_t MAX_CAPACITY = 1u << 22;
+
+	// Power of two within [MIN_CAPACITY, MAX_CAPACITY] at or above capacity
+	static uint32_t roundCapacity(uint32_t capacity);
+	// Bytes of shared memory for a ring of capacity records
+	static size_t bytesFor(uint32_t capacity);
+
+	ShmRing() = default;
+	// Lays out an empty ring in zeroed memory of bytesFor(capacity) bytes
+	static ShmRing create(void *memory, uint32_t capacity, Mode mode);
+	// A ring made by create() in memory of size bytes; invalid if the header
+	// does not match
+	static ShmRing attach(void *memory, size_t size);
+
+	bool valid() const { return header_ != nullptr; }
+	uint32_t capacity() const { return header_->capacity; }
+	Mode mode() const { return header_->mode; }
+
+	// Producer side; false when the ring is full
+	bool push(Record record)
+	{
+		uint64_t pos = header_->head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot &slot = slots_[pos & mask_];
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<int64_t>(sequence - pos);
+			if (diff < 0)
+			{
+				return false;
+			}
+			if (diff > 0)
+			{
+				// Another producer took pos
+				pos = header_->head.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (header_->mode == Mode::SingleProducer)
+			{
+				header_->head.store(pos + 1, std::memory_order_relaxed);
+			}
+			else if (!header_->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				continue;
+			}
+			slot.record = record;
+			slot.sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+	}
+
+	// After pushing: true if the consumer went to sleep and this producer
+	// is the one to signal it
+	bool producerShouldWake()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return header_->consumer_sleeping.load(std::memory_order_relaxed) != 0 &&
+			   header_->consumer_sleeping.exchange(0, std::memory_order_acq_rel) != 0;
+	}
+
+	// Consumer side, one thread: moves up to out.size() records into out
+	size_t pop(std::span<Record> out)
+	{
+		size_t count = 0;
+		while (count < out.size())
+		{
+			Slot &slot = slots_[tail_ & mask_];
+			if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1)
+				break;
+			out[count++] = slot.record;
+			slot.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+			++tail_;
+		}
+		if (count > 0)
+		{
+			header_->tail.store(tail_, std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+	// Whether the next slot holds a record; consumer side
+	bool readable() const
+	{
+		return slots_[tail_ & mask_].sequence.load(std::memory_order_acquire) == tail_ + 1;
+	}
+
+	// Raises the sleeping flag; false, with the flag lowered again, if a
+	// record arrived meanwhile and the consumer must not block
+	bool consumerSleep()
+	{
+		header_->consumer_sleeping.store(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (readable())
+		{
+			consumerWake();
+			return false;
+		}
+		return true;
+	}
+	void consumerWake() { header_->consumer_sleeping.store(0, std::memory_order_relaxed); }
+
+	// Records pushed and not yet popped, as seen by either side
+	uint64_t size() const
+	{
+		return header_->head.load(std::memory_order_relaxed) - header_->tail.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t capacity;
+		Mode mode;
+		alignas(64) std::atomic<uint64_t> head; // next position a producer claims
+		alignas(64) std::atomic<uint64_t> tail; // consumer position, for size()
+		alignas(64) std::atomic<uint32_t> consumer_sleeping;
+	};
+
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence;
+		Record record;
+	};
+
+	// Shared by separate processes, so the atomics must not use locks
+	static_assert(std::atomic<uint64_t>::is_always_lock_free);
+	static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+	ShmRing(Header *header, Slot *slots) : header_(header), slots_(slots), mask_(header->capacity - 1) {}
+
+	Header *header_ = nullptr;
+	Slot *slots_ = nullptr;
+	uint64_t mask_ = 0;
+	uint64_t tail_ = 0; // consumer's own copy of header_->tail
+};
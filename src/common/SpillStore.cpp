@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(SERVICE_SPILL_ZLIB)
+#include <zlib.h>
+#endif
+
+#include <common/SpillStore.h>
+
+namespace
+{
+	constexpr size_t HEADER_BYTES = 2 * sizeof(uint32_t); // stored length, raw length
+
+	bool writeAll(int fd, const char *data, size_t size, uint64_t offset)
+	{
+		while (size > 0)
+		{
+			ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+			if (written <= 0)
+				return false;
+			data += written;
+			size -= static_cast<size_t>(written);
+			offset += static_cast<uint64_t>(written);
+		}
+		return true;
+	}
+
+	bool readAll(int fd, char *data, size_t size, uint64_t offset)
+	{
+		while (size > 0)
+		{
+			ssize_t got = ::pread(fd, data, size, static_cast<off_t>(offset));
+			if (got <= 0)
+				return false;
+			data += got;
+			size -= static_cast<size_t>(got);
+			offset += static_cast<uint64_t>(got);
+		}
+		return true;
+	}
+}
+
+SpillStore::~SpillStore()
+{
+	close();
+}
+
+bool SpillStore::open(const std::string &path)
+{
+	close();
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	path_ = path;
+	return true;
+}
+
+void SpillStore::close()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+		::unlink(path_.c_str());
+		fd_ = -1;
+	}
+	index_.clear();
+	blocks_.clear();
+	pending_.clear();
+	cached_.clear();
+	cached_block_ = UINT32_MAX;
+	file_size_ = 0;
+	live_bytes_ = 0;
+	dead_bytes_ = 0;
+}
+
+void SpillStore::clear()
+{
+	index_.clear();
+	blocks_.clear();
+	pending_.clear();
+	cached_block_ = UINT32_MAX;
+	live_bytes_ = 0;
+	dead_bytes_ = 0;
+	if (fd_ >= 0 && ::ftruncate(fd_, 0) == 0)
+	{
+		file_size_ = 0;
+	}
+}
+
+bool SpillStore::put(int32_t key, std::string_view record)
+{
+	if (auto it = index_.find(key); it != index_.end())
+	{
+		dead_bytes_ += it->second.length;
+		live_bytes_ -= it->second.length;
+		index_.erase(it);
+	}
+
+	bool written = true;
+	if (!pending_.empty() && pending_.size() + record.size() > BLOCK_BYTES)
+	{
+		written = flushBlock();
+	}
+
+	index_.insert_or_assign(key, Location{static_cast<uint32_t>(blocks_.size()),
+										  static_cast<uint32_t>(pending_.size()), static_cast<uint32_t>(record.size())});
+	pending_.append(record);
+	live_bytes_ += record.size();
+
+	if (dead_bytes_ > live_bytes_ && dead_bytes_ > BLOCK_BYTES)
+	{
+		compact();
+	}
+	return written;
+}
+
+std::optional<std::string> SpillStore::get(int32_t key)
+{
+	auto it = index_.find(key);
+	if (it == index_.end())
+	{
+		return std::nullopt;
+	}
+
+	const Location &location = it->second;
+	const std::string *block = location.block == blocks_.size() ? &pending_ : loadBlock(location.block);
+	if (block == nullptr)
+	{
+		return std::nullopt;
+	}
+	return block->substr(location.offset, location.length);
+}
+
+bool SpillStore::erase(int32_t key)
+{
+	auto it = index_.find(key);
+	if (it == index_.end())
+	{
+		return false;
+	}
+
+	dead_bytes_ += it->second.length;
+	live_bytes_ -= it->second.length;
+	index_.erase(it);
+	if (dead_bytes_ > live_bytes_ && dead_bytes_ > BLOCK_BYTES)
+	{
+		compact();
+	}
+	return true;
+}
+
+std::optional<SpillStore::Block> SpillStore::appendBlock(int fd, uint64_t &file_size, std::string_view raw)
+{
+	std::string stored(HEADER_BYTES, '\0');
+	uint32_t stored_length = static_cast<uint32_t>(raw.size());
+#if defined(SERVICE_SPILL_ZLIB)
+	uLongf compressed_length = compressBound(raw.size());
+	stored.resize(HEADER_BYTES + compressed_length);
+	if (compress2(reinterpret_cast<Bytef *>(stored.data() + HEADER_BYTES), &compressed_length,
+				  reinterpret_cast<const Bytef *>(raw.data()), raw.size(), Z_BEST_SPEED) == Z_OK &&
+		compressed_length < raw.size())
+	{
+		stored_length = static_cast<uint32_t>(compressed_length);
+	}
+#endif
+	// Equal lengths mean the block is stored as is
+	if (stored_length == raw.size())
+	{
+		stored.resize(HEADER_BYTES);
+		stored.append(raw);
+	}
+	stored.resize(HEADER_BYTES + stored_length);
+
+	// The header makes the file readable on its own; reads use the in-memory copy
+	const Block block{file_size, stored_length, static_cast<uint32_t>(raw.size())};
+	std::memcpy(stored.data(), &block.stored_length, sizeof(block.stored_length));
+	std::memcpy(stored.data() + sizeof(block.stored_length), &block.raw_length, sizeof(block.raw_length));
+	if (!writeAll(fd, stored.data(), stored.size(), file_size))
+	{
+		return std::nullopt;
+	}
+	file_size += stored.size();
+	return block;
+}
+
+bool SpillStore::flushBlock()
+{
+	if (pending_.empty())
+	{
+		return true;
+	}
+
+	auto block = fd_ >= 0 ? appendBlock(fd_, file_size_, pending_) : std::nullopt;
+	if (!block)
+	{
+		// Forget the records of the block that could not be written
+		const auto lost = static_cast<uint32_t>(blocks_.size());
+		for (auto it = index_.begin(); it != index_.end();)
+		{
+			if (it->second.block == lost)
+			{
+				live_bytes_ -= it->second.length;
+				it = index_.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		pending_.clear();
+		return false;
+	}
+
+	blocks_.push_back(*block);
+	pending_.clear();
+	return true;
+}
+
+const std::string *SpillStore::loadBlock(uint32_t block)
+{
+	if (block == cached_block_)
+	{
+		return &cached_;
+	}
+
+	const Block &location = blocks_[block];
+	std::string stored(location.stored_length, '\0');
+	if (!readAll(fd_, stored.data(), stored.size(), location.offset + HEADER_BYTES))
+	{
+		return nullptr;
+	}
+
+	if (location.stored_length == location.raw_length)
+	{
+		cached_ = std::move(stored);
+	}
+	else
+	{
+#if defined(SERVICE_SPILL_ZLIB)
+		cached_.resize(location.raw_length);
+		uLongf raw_length = location.raw_length;
+		if (uncompress(reinterpret_cast<Bytef *>(cached_.data()), &raw_length,
+					   reinterpret_cast<const Bytef *>(stored.data()), stored.size()) != Z_OK ||
+			raw_length != location.raw_length)
+		{
+			cached_block_ = UINT32_MAX;
+			return nullptr;
+		}
+#else
+		return nullptr;
+#endif
+	}
+	cached_block_ = block;
+	return &cached_;
+}
+
+void SpillStore::compact()
+{
+	if (!flushBlock())
+	{
+		return;
+	}
+
+	// Copy live records in file order, so each old block is read once
+	std::vector<std::pair<int32_t, Location>> entries;
+	entries.reserve(index_.size());
+	for (const auto &[key, location] : index_)
+	{
+		entries.emplace_back(key, location);
+	}
+	std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b)
+			  { return a.second.block != b.second.block ? a.second.block < b.second.block
+														: a.second.offset < b.second.offset; });
+
+	const std::string temp_path = path_ + ".compact";
+	int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	auto abandon = [&]
+	{
+		::close(fd);
+		::unlink(temp_path.c_str());
+	};
+
+	FlatHashMap<int32_t, Location> index;
+	index.reserve(entries.size());
+	std::vector<Block> blocks;
+	uint64_t file_size = 0;
+	std::string block;
+	for (const auto &[key, location] : entries)
+	{
+		const std::string *source = loadBlock(location.block);
+		if (source == nullptr)
+		{
+			abandon();
+			return;
+		}
+		if (!block.empty() && block.size() + location.length > BLOCK_BYTES)
+		{
+			auto written = appendBlock(fd, file_size, block);
+			if (!written)
+			{
+				abandon();
+				return;
+			}
+			blocks.push_back(*written);
+			block.clear();
+		}
+		index.try_emplace(key, Location{static_cast<uint32_t>(blocks.size()), static_cast<uint32_t>(block.size()),
+										location.length});
+		block.append(*source, location.offset, location.length);
+	}
+
+	if (::rename(temp_path.c_str(), path_.c_str()) != 0)
+	{
+		abandon();
+		return;
+	}
+
+	// The last partial block becomes the pending one
+	::close(fd_);
+	fd_ = fd;
+	index_.swap(index);
+	blocks_ = std::move(blocks);
+	pending_ = std::move(block);
+	cached_block_ = UINT32_MAX;
+	file_size_ = file_size;
+	dead_bytes_ = 0;
+}
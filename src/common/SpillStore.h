@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <common/FlatHashMap.h>
+
+// Append-only file of small records keyed by int32, used as a cold tier for
+// data evicted from memory. Records are packed into blocks of about 4 KiB
+// that are compressed with zlib when the build has it (SERVICE_SPILL_ZLIB)
+// before being appended; an in-memory index maps each key to its block and
+// offset. Reads decompress a whole block and keep the last one cached.
+// Erased and replaced records stay in the file as dead bytes until they
+// outweigh the live ones, then the live records are rewritten to a fresh
+// file. The file is scratch space: open() truncates it. Not thread-safe.
+class SpillStore
+{
+public:
+	SpillStore() = default;
+	~SpillStore();
+
+	SpillStore(const SpillStore &) = delete;
+	SpillStore &operator=(const SpillStore &) = delete;
+
+	// Creates or truncates path; false with errno set if it cannot be opened
+	bool open(const std::string &path);
+	bool isOpen() const { return fd_ >= 0; }
+	// Closes and removes the file
+	void close();
+
+	// Stores record under key, replacing any previous one; false if a full
+	// block could not be written, in which case that block's records are lost
+	bool put(int32_t key, std::string_view record);
+	std::optional<std::string> get(int32_t key);
+	bool erase(int32_t key);
+	bool contains(int32_t key) const { return index_.contains(key); }
+	// Drops every record and truncates the file
+	void clear();
+
+	template <typename F>
+	void forEachKey(F &&f) const
+	{
+		for (const auto &[key, location] : index_)
+		{
+			f(key);
+		}
+	}
+
+	size_t size() const { return index_.size(); }
+	uint64_t fileBytes() const { return file_size_; }
+
+	static constexpr size_t BLOCK_BYTES = 4 * 1024;
+
+private:
+	struct Location
+	{
+		uint32_t block; // index into blocks_; blocks_.size() is the pending block
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	// Kept in memory so a read is a single pread
+	struct Block
+	{
+		uint64_t offset;
+		uint32_t stored_length;
+		uint32_t raw_length;
+	};
+
+	bool flushBlock();
+	static std::optional<Block> appendBlock(int fd, uint64_t &file_size, std::string_view raw);
+	const std::string *loadBlock(uint32_t block);
+	void compact();
+
+	int fd_ = -1;
+	std::string path_;
+	FlatHashMap<int32_t, Location> index_;
+	std::vector<Block> blocks_;
+	std::string pending_; // uncompressed records of the block being filled
+	std::string cached_;  // last block read back from the file
+	uint32_t cached_block_ = UINT32_MAX;
+	uint64_t file_size_ = 0;
+	uint64_t live_bytes_ = 0;
+	uint64_t dead_bytes_ = 0;
+};
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <codec/Codec.h>
+#include <common/Tracer.h>
+
+namespace
+{
+	static_assert((Tracer::BUFFER_EVENTS & (Tracer::BUFFER_EVENTS - 1)) == 0, "BUFFER_EVENTS must be a power of two");
+
+	// Fields are atomics so a capture may read a slot the owner is rewriting;
+	// such slots are detected through head and dropped
+	struct Slot
+	{
+		std::atomic<const char *> name{nullptr};
+		std::atomic<Clock::Ticks> begin{0};
+		std::atomic<Clock::Ticks> end{0};
+	};
+
+	struct ThreadBuffer
+	{
+		int tid = static_cast<int>(syscall(SYS_gettid));
+		std::string name; // guarded by registry_mutex
+		std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(Tracer::BUFFER_EVENTS);
+		std::atomic<uint64_t> head{0}; // events ever written
+	};
+
+	std::mutex registry_mutex;
+	// Buffers outlive their threads so a capture still sees what they did
+	std::vector<std::shared_ptr<ThreadBuffer>> registry;
+	std::mutex capture_mutex;
+
+	ThreadBuffer &threadBuffer()
+	{
+		thread_local std::shared_ptr<ThreadBuffer> buffer = []
+		{
+			auto created = std::make_shared<ThreadBuffer>();
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			registry.push_back(created);
+			return created;
+		}();
+		return *buffer;
+	}
+
+	struct Event
+	{
+		const char *name;
+		Clock::Ticks begin;
+		Clock::Ticks end;
+		int tid;
+	};
+}
+
+void Tracer::record(const char *name, Clock::Ticks begin, Clock::Ticks end)
+{
+	ThreadBuffer &buffer = threadBuffer();
+	const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	Slot &slot = buffer.slots[head & (BUFFER_EVENTS - 1)];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.begin.store(begin, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(std::string_view name)
+{
+	ThreadBuffer &buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer.name = name;
+}
+
+std::string Tracer::capture(int ms)
+{
+	std::lock_guard<std::mutex> capture_lock(capture_mutex);
+	ms = std::clamp(ms, 0, MAX_CAPTURE_MS);
+
+	const Clock::Ticks start = Clock::ticks();
+	recording_.store(true, std::memory_order_relaxed);
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+	recording_.store(false, std::memory_order_relaxed);
+	const Clock::Ticks stop = Clock::ticks();
+
+	std::vector<Event> events;
+	std::vector<std::pair<int, std::string>> names;
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		std::vector<std::pair<uint64_t, Event>> copied;
+		for (const auto &buffer : registry)
+		{
+			if (!buffer->name.empty())
+				names.emplace_back(buffer->tid, buffer->name);
+
+			const uint64_t head = buffer->head.load(std::memory_order_acquire);
+			const uint64_t first = head > BUFFER_EVENTS ? head - BUFFER_EVENTS : 0;
+			copied.clear();
+			for (uint64_t i = first; i < head; ++i)
+			{
+				const Slot &slot = buffer->slots[i & (BUFFER_EVENTS - 1)];
+				copied.emplace_back(i, Event{slot.name.load(std::memory_order_relaxed),
+											 slot.begin.load(std::memory_order_relaxed),
+											 slot.end.load(std::memory_order_relaxed), buffer->tid});
+			}
+			// The owner kept writing meanwhile, so the oldest copies may hold
+			// newer or half-written events. The slot at its position may be
+			// mid-write before head moves, hence the extra one.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t after = buffer->head.load(std::memory_order_relaxed) + 1;
+			const uint64_t valid_from = after > BUFFER_EVENTS ? after - BUFFER_EVENTS : 0;
+			for (const auto &[index, event] : copied)
+			{
+				if (index >= valid_from && event.end >= start && event.begin <= stop)
+					events.push_back(event);
+			}
+		}
+	}
+	std::sort(events.begin(), events.end(), [](const Event &a, const Event &b)
+			  { return a.begin < b.begin; });
+
+	const int pid = static_cast<int>(getpid());
+	const uint64_t start_ns = Clock::nanos(start);
+	return codec::encode(codec::Format::Json, [&](auto &writer)
+						 {
+		writer.startObject(3);
+		writer.key("traceEvents");
+		writer.startArray(names.size() + events.size());
+		for (const auto &[tid, name] : names)
+		{
+			writer.startObject(5);
+			writer.key("name");
+			writer.value("thread_name");
+			writer.key("ph");
+			writer.value("M");
+			writer.key("pid");
+			writer.value(pid);
+			writer.key("tid");
+			writer.value(tid);
+			writer.key("args");
+			writer.startObject(1);
+			writer.key("name");
+			writer.value(name);
+			writer.endObject();
+			writer.endObject();
+		}
+		for (const auto &event : events)
+		{
+			writer.startObject(6);
+			writer.key("name");
+			writer.value(event.name);
+			writer.key("ph");
+			writer.value("X");
+			// Relative to the start of the capture
+			writer.key("ts");
+			writer.value(static_cast<double>(static_cast<int64_t>(Clock::nanos(event.begin) - start_ns)) / 1e3);
+			writer.key("dur");
+			writer.value(Clock::toMicros(event.end - event.begin));
+			writer.key("pid");
+			writer.value(pid);
+			writer.key("tid");
+			writer.value(event.tid);
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.key("displayTimeUnit");
+		writer.value("ms");
+		writer.key("otherData");
+		writer.startObject(2);
+		writer.key("tracing_compiled_in");
+		writer.value(ENABLED);
+		writer.key("window_ms");
+		writer.value(ms);
+		writer.endObject();
+		writer.endObject(); });
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <common/Clock.h>
+
+// Timeline of what the server's threads do, for chrome://tracing or
+// ui.perfetto.dev. TRACE_ZONE("name") records the enclosing scope as one
+// complete event into a ring buffer owned by the calling thread, so
+// threads never contend; capture() turns recording on for a window and
+// returns the events of every thread as Chrome trace-event JSON (GET
+// /debug/trace?ms=N). Outside a capture a zone costs one relaxed load. The
+// macros compile to nothing unless the build sets SERVICE_TRACING
+// (cmake -DSERVICE_TRACING=ON).
+class Tracer
+{
+public:
+#ifdef SERVICE_TRACING
+	static constexpr bool ENABLED = true;
+#else
+	static constexpr bool ENABLED = false;
+#endif
+
+	static constexpr size_t BUFFER_EVENTS = 1 << 15; // per thread; older events are overwritten
+	static constexpr int MAX_CAPTURE_MS = 10000;
+
+	class Zone
+	{
+	public:
+		// name must outlive the capture, e.g. a string literal
+		explicit Zone(const char *name) : name_(recording() ? name : nullptr), begin_(name_ ? Clock::ticks() : 0) {}
+		~Zone()
+		{
+			if (name_)
+				record(name_, begin_, Clock::ticks());
+		}
+
+		Zone(const Zone &) = delete;
+		Zone &operator=(const Zone &) = delete;
+
+	private:
+		const char *name_;
+		Clock::Ticks begin_;
+	};
+
+	static bool recording() { return recording_.load(std::memory_order_relaxed); }
+	// Adds an event to the calling thread's buffer; begin and end are
+	// Clock::ticks() readings, converted only when captured
+	static void record(const char *name, Clock::Ticks begin, Clock::Ticks end);
+	// Label of the calling thread in captures
+	static void setThreadName(std::string_view name);
+
+	// Records for ms milliseconds, then returns the events that overlap the
+	// window; concurrent captures wait for each other
+	static std::string capture(int ms);
+
+private:
+	inline static std::atomic<bool> recording_{false};
+};
+
+#ifdef SERVICE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) Tracer::Zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Tracer::setThreadName(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -24,7 +24,7 @@ bool Config::loadFromArgs(int argc, char *argv[])
 	return true;
 }
 
-std::string Config::getString(const std::string &key, const std::string &defaultValue)
+std::string Config::getString(std::string_view key, const std::string &defaultValue)
 {
 	if (!instance_)
 		return defaultValue;
@@ -36,7 +36,7 @@ std::string Config::getString(const std::string &key, const std::string &default
 	return defaultValue;
 }
 
-int Config::getInt(const std::string &key, int defaultValue)
+int Config::getInt(std::string_view key, int defaultValue)
 {
 	if (!instance_)
 	{
@@ -59,7 +59,7 @@ int Config::getInt(const std::string &key, int defaultValue)
 	return defaultValue;
 }
 
-bool Config::getBool(const std::string &key, bool defaultValue)
+bool Config::getBool(std::string_view key, bool defaultValue)
 {
 	if (!instance_)
 	{
@@ -194,7 +194,7 @@ void Config::parseArgs(int argc, char *argv[])
 	}
 }
 
-void Config::flattenMap(const std::string &prefix, const std::unordered_map<std::string, std::string> &map)
+void Config::flattenMap(const std::string &prefix, const FlatHashMap<std::string, std::string> &map)
 {
 	for (const auto &[key, value] : map)
 	{
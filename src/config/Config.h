@@ -1,17 +1,19 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <memory>
 
+#include <common/FlatHashMap.h>
+
 class Config
 {
 public:
 	static bool loadFromFile(const std::string &filename = "config.yaml");
 	static bool loadFromArgs(int argc, char *argv[]);
-	static std::string getString(const std::string &key, const std::string &defaultValue = "");
-	static int getInt(const std::string &key, int defaultValue = 0);
-	static bool getBool(const std::string &key, bool defaultValue = false);
+	static std::string getString(std::string_view key, const std::string &defaultValue = "");
+	static int getInt(std::string_view key, int defaultValue = 0);
+	static bool getBool(std::string_view key, bool defaultValue = false);
 	static bool isLoaded() { return instance_ != nullptr; }
 	static std::string toString();
 
@@ -19,8 +21,8 @@ private:
 	Config() = default;
 	bool parseYAML(const std::string &filename);
 	void parseArgs(int argc, char *argv[]);
-	void flattenMap(const std::string &prefix, const std::unordered_map<std::string, std::string> &map);
+	void flattenMap(const std::string &prefix, const FlatHashMap<std::string, std::string> &map);
 
 	static std::unique_ptr<Config> instance_;
-	std::unordered_map<std::string, std::string> config_;
+	FlatHashMap<std::string, std::string> config_;
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <common/Clock.h>
+
+// Caps how many messages a call site emits per second. Messages over the cap
+// are counted and the count is handed to the next caller that is allowed to log.
+// Windows follow the coarse clock, so they are only as current as its last tick.
+class LogRateLimiter
+{
+public:
+	explicit LogRateLimiter(uint32_t max_per_second) : max_per_second_(max_per_second) {}
+
+	bool allow(uint64_t &suppressed)
+	{
+		const int64_t now = static_cast<int64_t>(Clock::coarseMillis() / 1000);
+
+		int64_t window = window_.load(std::memory_order_relaxed);
+		if (window != now && window_.compare_exchange_strong(window, now, std::memory_order_relaxed))
+		{
+			count_.store(0, std::memory_order_relaxed);
+		}
+
+		if (count_.fetch_add(1, std::memory_order_relaxed) < max_per_second_)
+		{
+			suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		suppressed_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+private:
+	const uint32_t max_per_second_;
+	std::atomic<int64_t> window_{0};
+	std::atomic<uint32_t> count_{0};
+	std::atomic<uint64_t> suppressed_{0};
+};
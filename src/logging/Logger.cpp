@@ -6,9 +6,54 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <common/Tracer.h>
 #include <config/Config.h>
 #include <logging/Logger.h>
 
+#ifdef SERVICE_TRACING
+namespace
+{
+	// Puts a zone around each message the async thread formats and writes
+	class TracedSinks : public spdlog::sinks::sink
+	{
+	public:
+		explicit TracedSinks(std::vector<spdlog::sink_ptr> sinks) : sinks_(std::move(sinks)) {}
+
+		void log(const spdlog::details::log_msg &msg) override
+		{
+			TRACE_ZONE("log");
+			for (auto &sink : sinks_)
+			{
+				if (sink->should_log(msg.level))
+					sink->log(msg);
+			}
+		}
+
+		void flush() override
+		{
+			TRACE_ZONE("log_flush");
+			for (auto &sink : sinks_)
+				sink->flush();
+		}
+
+		void set_pattern(const std::string &pattern) override
+		{
+			for (auto &sink : sinks_)
+				sink->set_pattern(pattern);
+		}
+
+		void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override
+		{
+			for (auto &sink : sinks_)
+				sink->set_formatter(formatter->clone());
+		}
+
+	private:
+		std::vector<spdlog::sink_ptr> sinks_;
+	};
+}
+#endif
+
 // Helper function to convert string to spdlog level
 spdlog::level::level_enum string_to_level(const std::string &level_str)
 {
@@ -36,7 +81,8 @@ std::shared_ptr<spdlog::logger> Logger::create_logger()
 	std::string flush_level = Config::getString("logging.flush_on", "warn");
 
 	// Create async logger with thread pool
-	spdlog::init_thread_pool(8192, 1);
+	spdlog::init_thread_pool(8192, 1, []
+							 { TRACE_THREAD_NAME("logger"); });
 
 	// Create sinks (console and file)
 	auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
@@ -48,6 +94,9 @@ std::shared_ptr<spdlog::logger> Logger::create_logger()
 
 	// Combine sinks
 	std::vector<spdlog::sink_ptr> sinks{console_sink, file_sink};
+#ifdef SERVICE_TRACING
+	sinks = {std::make_shared<TracedSinks>(std::move(sinks))};
+#endif
 
 	// Create async logger
 	auto logger = std::make_shared<spdlog::async_logger>(
@@ -0,0 +1,131 @@
+#include <sstream>
+#include <cstdint>
+
+#include <logging/Logger.h>
+#include <server/Allocator.h>
+
+#if defined(SERVICE_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(SERVICE_ALLOCATOR_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifndef SERVICE_ALLOCATOR_DECAY_MS
+#define SERVICE_ALLOCATOR_DECAY_MS 1000
+#endif
+
+#define SERVICE_STRINGIFY_IMPL(x) #x
+#define SERVICE_STRINGIFY(x) SERVICE_STRINGIFY_IMPL(x)
+
+#if defined(SERVICE_ALLOCATOR_JEMALLOC)
+// Read by jemalloc before the first allocation: keep thread caches on, purge
+// dirty pages on a background thread and return unused pages after the decay.
+const char *malloc_conf = "background_thread:true,tcache:true,"
+						  "dirty_decay_ms:" SERVICE_STRINGIFY(SERVICE_ALLOCATOR_DECAY_MS) ","
+						  "muzzy_decay_ms:" SERVICE_STRINGIFY(SERVICE_ALLOCATOR_DECAY_MS);
+#endif
+
+void Allocator::initialize()
+{
+#if defined(SERVICE_ALLOCATOR_MIMALLOC)
+	// mimalloc keeps per-thread heaps by default; only tune how long freed pages linger
+#if MI_MALLOC_VERSION >= 210 || (MI_MALLOC_VERSION >= 180 && MI_MALLOC_VERSION < 200)
+	mi_option_set(mi_option_purge_delay, SERVICE_ALLOCATOR_DECAY_MS);
+#else
+	mi_option_set(mi_option_reset_delay, SERVICE_ALLOCATOR_DECAY_MS);
+#endif
+#endif
+	Logger::info("Allocator backend: {}", backend());
+}
+
+const char *Allocator::backend() noexcept
+{
+#if defined(SERVICE_ALLOCATOR_MIMALLOC)
+	return "mimalloc";
+#elif defined(SERVICE_ALLOCATOR_JEMALLOC)
+	return "jemalloc";
+#else
+	return "system";
+#endif
+}
+
+AllocatorStats Allocator::getStats()
+{
+	AllocatorStats stats;
+
+#if defined(SERVICE_ALLOCATOR_MIMALLOC)
+	// mimalloc does not track live bytes cheaply; committed memory is the closest figure
+	size_t elapsed, user, system, current_rss, peak_rss, current_commit, peak_commit, page_faults;
+	mi_process_info(&elapsed, &user, &system, &current_rss, &peak_rss,
+					&current_commit, &peak_commit, &page_faults);
+	stats.allocated = current_commit;
+	stats.resident = current_rss;
+	stats.retained = current_commit > current_rss ? current_commit - current_rss : 0;
+#elif defined(SERVICE_ALLOCATOR_JEMALLOC)
+	// Statistics are cached by jemalloc until the epoch is advanced
+	uint64_t epoch = 1;
+	size_t len = sizeof(epoch);
+	mallctl("epoch", &epoch, &len, &epoch, len);
+
+	len = sizeof(size_t);
+	mallctl("stats.allocated", &stats.allocated, &len, nullptr, 0);
+	mallctl("stats.resident", &stats.resident, &len, nullptr, 0);
+	mallctl("stats.retained", &stats.retained, &len, nullptr, 0);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 info = mallinfo2();
+	stats.allocated = info.uordblks + info.hblkhd;
+	stats.resident = info.arena + info.hblkhd;
+	stats.retained = info.fordblks;
+#endif
+
+	if (stats.resident > 0 && stats.allocated <= stats.resident)
+	{
+		stats.fragmentation = 1.0 - static_cast<double>(stats.allocated) / static_cast<double>(stats.resident);
+	}
+
+	return stats;
+}
+
+std::string Allocator::toJson()
+{
+	auto stats = getStats();
+
+	std::stringstream ss;
+	ss << R"({"backend": ")" << backend() << R"(", )"
+	   << R"("allocated_bytes": )" << stats.allocated << ", "
+	   << R"("resident_bytes": )" << stats.resident << ", "
+	   << R"("retained_bytes": )" << stats.retained << ", "
+	   << R"("fragmentation": )" << stats.fragmentation << ", "
+	   << R"("success": true})";
+	return ss.str();
+}
+
+std::string Allocator::toPrometheus()
+{
+	auto stats = getStats();
+
+	std::stringstream ss;
+	ss << "# HELP cpp_service_allocator_info Allocator linked into the service\n";
+	ss << "# TYPE cpp_service_allocator_info gauge\n";
+	ss << "cpp_service_allocator_info{backend=\"" << backend() << "\"} 1\n\n";
+
+	ss << "# HELP cpp_service_allocator_allocated_bytes Bytes allocated by the application\n";
+	ss << "# TYPE cpp_service_allocator_allocated_bytes gauge\n";
+	ss << "cpp_service_allocator_allocated_bytes " << stats.allocated << "\n\n";
+
+	ss << "# HELP cpp_service_allocator_resident_bytes Bytes mapped and resident in the allocator\n";
+	ss << "# TYPE cpp_service_allocator_resident_bytes gauge\n";
+	ss << "cpp_service_allocator_resident_bytes " << stats.resident << "\n\n";
+
+	ss << "# HELP cpp_service_allocator_retained_bytes Bytes retained by the allocator but not returned to the OS\n";
+	ss << "# TYPE cpp_service_allocator_retained_bytes gauge\n";
+	ss << "cpp_service_allocator_retained_bytes " << stats.retained << "\n\n";
+
+	ss << "# HELP cpp_service_allocator_fragmentation_ratio Share of resident memory not in use\n";
+	ss << "# TYPE cpp_service_allocator_fragmentation_ratio gauge\n";
+	ss << "cpp_service_allocator_fragmentation_ratio " << stats.fragmentation << "\n\n";
+
+	return ss.str();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Snapshot of the general-purpose allocator's heap, in bytes
+struct AllocatorStats
+{
+	size_t allocated = 0; // Bytes handed out to the application
+	size_t resident = 0;  // Bytes the allocator keeps mapped and backed by memory
+	size_t retained = 0;  // Bytes the allocator holds but has not returned to the OS
+	double fragmentation = 0.0; // 1 - allocated / resident
+};
+
+// Thin facade over the allocator selected at build time (SERVICE_ALLOCATOR)
+class Allocator
+{
+public:
+	// Applies runtime tuning; call once at startup before spawning threads
+	static void initialize();
+
+	static const char *backend() noexcept;
+	static AllocatorStats getStats();
+
+	// JSON document served on /debug/allocator
+	static std::string toJson();
+	// Prometheus gauges appended to /metrics
+	static std::string toPrometheus();
+};
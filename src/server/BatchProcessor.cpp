@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include <codec/Codec.h>
+#include <logging/Logger.h>
+#include <server/BatchProcessor.h>
+#include <server/ClientAggregates.h>
+#include <server/RequestHandler.h>
+
+namespace
+{
+	bool writeAll(int fd, std::string_view data)
+	{
+		while (!data.empty())
+		{
+			ssize_t written = write(fd, data.data(), data.size());
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			data.remove_prefix(static_cast<size_t>(written));
+		}
+		return true;
+	}
+}
+
+BatchProcessor::BatchProcessor(RequestHandler &handler) : BatchProcessor(handler, Options{})
+{
+}
+
+BatchProcessor::BatchProcessor(RequestHandler &handler, Options options)
+	: handler_(handler), options_(options)
+{
+	if (options_.threads == 0)
+	{
+		options_.threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	options_.chunk_bytes = std::max<size_t>(options_.chunk_bytes, 1);
+}
+
+bool BatchProcessor::processFile(const std::string &path)
+{
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) < 0)
+	{
+		Logger::error("Cannot open {}: {}", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	const auto size = static_cast<size_t>(info.st_size);
+	if (size == 0)
+	{
+		close(fd);
+		return true;
+	}
+
+	void *memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		Logger::error("Cannot map {}: {}", path, strerror(errno));
+		return false;
+	}
+	// Chunks are claimed in order, so read-ahead on the whole file pays off
+	madvise(memory, size, MADV_SEQUENTIAL);
+
+	drop_pages_ = true;
+	process(std::string_view(static_cast<const char *>(memory), size));
+	drop_pages_ = false;
+	munmap(memory, size);
+	return true;
+}
+
+std::string_view BatchProcessor::chunk(std::string_view input, size_t index) const
+{
+	// A chunk owns every line that starts inside its nominal range
+	auto line_start = [&](size_t offset) -> size_t
+	{
+		if (offset == 0)
+			return 0;
+		if (offset >= input.size())
+			return input.size();
+		const void *newline = std::memchr(input.data() + offset - 1, '\n', input.size() - offset + 1);
+		return newline == nullptr ? input.size() : static_cast<const char *>(newline) - input.data() + 1;
+	};
+
+	const size_t begin = line_start(std::min(index * options_.chunk_bytes, input.size()));
+	const size_t end = line_start(std::min((index + 1) * options_.chunk_bytes, input.size()));
+	return input.substr(begin, end - begin);
+}
+
+void BatchProcessor::process(std::string_view input)
+{
+	const auto started = std::chrono::steady_clock::now();
+	const int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+							   std::chrono::system_clock::now().time_since_epoch())
+							   .count();
+	const size_t chunks = (input.size() + options_.chunk_bytes - 1) / options_.chunk_bytes;
+	const size_t threads = std::min(options_.threads, std::max<size_t>(chunks, 1));
+
+	bytes_done_ = 0;
+	lines_done_ = 0;
+	std::atomic<size_t> next_chunk{0};
+	std::vector<Partial> partials(threads);
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t running = threads;
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t]
+							 {
+			for (size_t index = next_chunk++; index < chunks; index = next_chunk++)
+			{
+				const std::string_view part = chunk(input, index);
+				processChunk(part, partials[t], now_ms);
+				bytes_done_ += part.size();
+
+				// The pages are in the page cache; only this mapping lets go of them
+				if (drop_pages_)
+				{
+					const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+					const auto from = (reinterpret_cast<uintptr_t>(part.data()) + page - 1) & ~(page - 1);
+					const auto to = (reinterpret_cast<uintptr_t>(part.data() + part.size())) & ~(page - 1);
+					if (to > from)
+						madvise(reinterpret_cast<void *>(from), to - from, MADV_DONTNEED);
+				}
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0)
+				finished.notify_one(); });
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!finished.wait_for(lock, std::chrono::seconds(1), [&]
+								  { return running == 0; }))
+		{
+			if (progress_)
+				progress_(bytes_done_, input.size(), lines_done_);
+		}
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	for (const Partial &partial : partials)
+	{
+		merge(partial);
+	}
+
+	summary_.bytes += input.size();
+	summary_.lines = result_.lines;
+	summary_.applied = result_.applied;
+	summary_.rejected = result_.rejected;
+	summary_.total_sum = result_.sum;
+	summary_.clients = result_.slots.size();
+	summary_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	if (progress_)
+		progress_(input.size(), input.size(), lines_done_);
+}
+
+void BatchProcessor::processChunk(std::string_view chunk, Partial &partial, int64_t now_ms)
+{
+	uint64_t lines = 0;
+	while (!chunk.empty())
+	{
+		const size_t newline = chunk.find('\n');
+		std::string_view line = chunk.substr(0, newline);
+		chunk.remove_prefix(newline == std::string_view::npos ? chunk.size() : newline + 1);
+
+		const size_t last = line.find_last_not_of(" \t\r");
+		if (last == std::string_view::npos)
+			continue;
+		line = line.substr(0, last + 1);
+		lines++;
+
+		auto update = handler_.decodeUpdate(line, codec::Format::Json);
+		if (!update)
+		{
+			partial.rejected++;
+			continue;
+		}
+
+		auto [it, inserted] = partial.slots.try_emplace(update->id, 0u);
+		if (inserted)
+		{
+			it->second = partial.table.add();
+		}
+		partial.table.record(it->second, update->number, now_ms);
+		partial.sum += update->number;
+		partial.applied++;
+	}
+	partial.lines += lines;
+	lines_done_ += lines;
+}
+
+void BatchProcessor::merge(const Partial &partial)
+{
+	for (const auto &[id, slot] : partial.slots)
+	{
+		auto [it, inserted] = result_.slots.try_emplace(id, 0u);
+		if (inserted)
+		{
+			it->second = result_.table.add();
+		}
+		result_.table.mergeRow(it->second, partial.table.row(slot));
+	}
+	result_.lines += partial.lines;
+	result_.applied += partial.applied;
+	result_.rejected += partial.rejected;
+	result_.sum += partial.sum;
+}
+
+ClientStatsTable::Stats BatchProcessor::stats(int32_t id) const
+{
+	auto it = result_.slots.find(id);
+	return it != result_.slots.end() ? result_.table.get(it->second) : ClientStatsTable::Stats{};
+}
+
+bool BatchProcessor::writeResults(const std::string &path) const
+{
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		Logger::error("Cannot open {} for writing: {}", path, strerror(errno));
+		return false;
+	}
+
+	std::vector<std::pair<int32_t, uint32_t>> clients(result_.slots.begin(), result_.slots.end());
+	std::sort(clients.begin(), clients.end());
+
+	std::string buffer;
+	buffer.reserve(WRITE_BUFFER_BYTES + 256);
+	bool ok = true;
+	for (const auto &[id, slot] : clients)
+	{
+		const auto stats = result_.table.get(slot);
+		buffer += codec::encode(codec::Format::Json, [&](auto &writer)
+								{
+			writer.startObject(7);
+			writer.key("client_id");
+			writer.value(ClientAggregates::clientKey(id));
+			writer.key("count");
+			writer.value(stats.count);
+			writer.key("sum");
+			writer.value(stats.sum);
+			writer.key("min");
+			writer.value(stats.min);
+			writer.key("max");
+			writer.value(stats.max);
+			writer.key("mean");
+			writer.value(stats.mean);
+			writer.key("variance");
+			writer.value(stats.variance);
+			writer.endObject(); });
+		buffer += '\n';
+
+		if (buffer.size() >= WRITE_BUFFER_BYTES)
+		{
+			ok = ok && writeAll(fd, buffer);
+			buffer.clear();
+		}
+	}
+	ok = ok && writeAll(fd, buffer);
+
+	if (close(fd) < 0 || !ok)
+	{
+		Logger::error("Failed to write {}: {}", path, strerror(errno));
+		return false;
+	}
+	return true;
+}
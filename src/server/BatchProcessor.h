@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <common/ClientStatsTable.h>
+#include <common/FlatHashMap.h>
+
+class RequestHandler;
+
+// Offline replay of /process payloads, one JSON document per line (JSONL),
+// for backfills. The input is split into chunks of about chunk_bytes that
+// start and end on line boundaries; each chunk's boundaries follow from its
+// index alone, so worker threads claim chunks from a shared counter without
+// a splitting pass. Lines are decoded and validated with
+// RequestHandler::decodeUpdate(), as /process does, and folded into the
+// worker's own statistics table. The tables are merged once the input is
+// done; nothing touches the handler's aggregates or the network. Files are
+// mmapped and read front to back, and pages of finished chunks are dropped
+// from the mapping so memory stays flat for inputs larger than RAM.
+class BatchProcessor
+{
+public:
+	static constexpr size_t DEFAULT_CHUNK_BYTES = 16u << 20;
+	static constexpr size_t WRITE_BUFFER_BYTES = 1u << 20;
+
+	struct Options
+	{
+		size_t threads = 0; // 0 is one per hardware thread
+		size_t chunk_bytes = DEFAULT_CHUNK_BYTES;
+	};
+
+	struct Summary
+	{
+		uint64_t bytes = 0;
+		uint64_t lines = 0; // non-blank
+		uint64_t applied = 0;
+		uint64_t rejected = 0;
+		long long total_sum = 0;
+		size_t clients = 0;
+		double seconds = 0;
+	};
+
+	// Called about once a second from the thread that runs process()
+	using Progress = std::function<void(uint64_t bytes_done, uint64_t bytes_total, uint64_t lines)>;
+
+	explicit BatchProcessor(RequestHandler &handler);
+	BatchProcessor(RequestHandler &handler, Options options);
+
+	void onProgress(Progress progress) { progress_ = std::move(progress); }
+
+	// false if the file cannot be mapped; the summary covers every call so far
+	bool processFile(const std::string &path);
+	void process(std::string_view input);
+
+	// One {"client_id", "count", "sum", "min", "max", "mean", "variance"}
+	// object per line in id order, written WRITE_BUFFER_BYTES at a time
+	bool writeResults(const std::string &path) const;
+
+	const Summary &summary() const { return summary_; }
+	// Zeroed Stats for an unknown client
+	ClientStatsTable::Stats stats(int32_t id) const;
+
+private:
+	// A worker's statistics; the merged result has the same shape
+	struct Partial
+	{
+		FlatHashMap<int32_t, uint32_t> slots;
+		ClientStatsTable table;
+		uint64_t lines = 0;
+		uint64_t applied = 0;
+		uint64_t rejected = 0;
+		long long sum = 0;
+	};
+
+	// [begin, end) of chunk index in input, empty past the last chunk
+	std::string_view chunk(std::string_view input, size_t index) const;
+	void processChunk(std::string_view chunk, Partial &partial, int64_t now_ms);
+	void merge(const Partial &partial);
+
+	RequestHandler &handler_;
+	Options options_;
+	Progress progress_;
+	Partial result_;
+	Summary summary_;
+	std::atomic<uint64_t> bytes_done_{0};
+	std::atomic<uint64_t> lines_done_{0};
+	bool drop_pages_ = false; // input is a file mapping owned by processFile()
+};
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+#include <logging/Logger.h>
+#include <server/ClientAggregates.h>
+#include <server/Metrics.h>
+
+namespace
+{
+	// Spilled rows are stored as their raw bytes; the spill file's block
+	// compression takes out the zero and repeated bytes
+	static_assert(std::is_trivially_copyable_v<ClientStatsTable::Row>);
+
+	std::string_view rowBytes(const ClientStatsTable::Row &row)
+	{
+		return {reinterpret_cast<const char *>(&row), sizeof(row)};
+	}
+}
+
+ClientAggregates::ClientAggregates() : ClientAggregates(Limits{})
+{
+}
+
+ClientAggregates::ClientAggregates(Limits limits) : limits_(std::move(limits))
+{
+	if (!limits_.spill_path.empty() && !spill_.open(limits_.spill_path))
+	{
+		Logger::error("Cannot open client spill file {}: {}; evicted clients will be dropped",
+					  limits_.spill_path, std::strerror(errno));
+	}
+}
+
+std::optional<int32_t> ClientAggregates::parseClientId(std::string_view client_id)
+{
+	constexpr std::string_view prefix = "user_";
+	if (!client_id.starts_with(prefix))
+	{
+		return std::nullopt;
+	}
+
+	int32_t id;
+	const char *first = client_id.data() + prefix.size();
+	const char *last = client_id.data() + client_id.size();
+	auto [end, ec] = std::from_chars(first, last, id);
+	if (ec != std::errc() || end != last || first == last)
+	{
+		return std::nullopt;
+	}
+	return id;
+}
+
+std::string ClientAggregates::clientKey(int32_t id)
+{
+	char key[32] = "user_";
+	char *end = std::to_chars(key + 5, std::end(key), id).ptr;
+	return std::string(key, end);
+}
+
+void ClientAggregates::record(int32_t id, int32_t number, int64_t now_ms)
+{
+	auto it = slots_.find(id);
+	const uint32_t slot = it != slots_.end() ? it->second : admit(id);
+
+	stats_.record(slot, number, now_ms);
+	states_[slot] = HOT;
+	index_.add(id, number);
+
+	if (limits_.ttl_ms > 0)
+	{
+		expireIdle(now_ms);
+	}
+}
+
+void ClientAggregates::recordBatch(std::span<const Update> updates, int64_t now_ms)
+{
+	// Sorting groups the duplicates and hands the ordered index ascending keys
+	batch_.assign(updates.begin(), updates.end());
+	std::sort(batch_.begin(), batch_.end(), [](const Update &a, const Update &b)
+			  { return a.id < b.id; });
+
+	pending_.clear();
+	for (const Update &update : batch_)
+	{
+		if (pending_.empty() || pending_.back().id != update.id)
+		{
+			pending_.push_back({update.id, NO_SLOT, 0, slots_.hash(update.id), {}});
+		}
+		ClientStatsTable::record(pending_.back().row, update.number, now_ms);
+	}
+
+	const size_t count = pending_.size();
+	auto evictions = [this]
+	{ return counters_.evicted + counters_.expired; };
+	auto lookup = [&](PendingRow &pending)
+	{
+		auto it = slots_.find(pending.id, pending.hash);
+		if (it != slots_.end())
+		{
+			pending.slot = it->second;
+			pending.evictions = evictions();
+			stats_.prefetch(pending.slot);
+		}
+	};
+
+	for (size_t i = 0; i < std::min(count, 2 * PREFETCH_DISTANCE); ++i)
+	{
+		slots_.prefetch(pending_[i].hash);
+	}
+	for (size_t i = 0; i < std::min(count, PREFETCH_DISTANCE); ++i)
+	{
+		lookup(pending_[i]);
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i + 2 * PREFETCH_DISTANCE < count)
+		{
+			slots_.prefetch(pending_[i + 2 * PREFETCH_DISTANCE].hash);
+		}
+		if (i + PREFETCH_DISTANCE < count)
+		{
+			lookup(pending_[i + PREFETCH_DISTANCE]);
+		}
+
+		PendingRow &pending = pending_[i];
+		// A client admitted since the lookup may have evicted this one
+		if (pending.slot != NO_SLOT && pending.evictions != evictions())
+		{
+			pending.slot = NO_SLOT;
+			lookup(pending);
+		}
+		const uint32_t slot = pending.slot != NO_SLOT ? pending.slot : admit(pending.id);
+
+		stats_.mergeRow(slot, pending.row);
+		states_[slot] = HOT;
+		index_.add(pending.id, pending.row.sum);
+	}
+
+	if (limits_.ttl_ms > 0)
+	{
+		expireIdle(now_ms, TTL_STEPS * updates.size());
+	}
+}
+
+uint32_t ClientAggregates::admit(int32_t id)
+{
+	const uint32_t slot = allocateSlot();
+	slot_ids_[slot] = id;
+	slots_.try_emplace(id, slot);
+
+	if (auto row = spilledRow(id))
+	{
+		// Back from the spill file: it is already in the Bloom filter
+		stats_.setRow(slot, *row);
+		index_.add(id, row->sum);
+		spill_.erase(id);
+	}
+	else
+	{
+		trackNewClient(id);
+	}
+
+	publishSizes();
+	return slot;
+}
+
+uint32_t ClientAggregates::allocateSlot()
+{
+	if (!free_slots_.empty())
+	{
+		uint32_t slot = free_slots_.back();
+		free_slots_.pop_back();
+		return slot;
+	}
+
+	if (limits_.capacity == 0 || stats_.size() < limits_.capacity)
+	{
+		states_.push_back(FREE);
+		slot_ids_.push_back(0);
+		return stats_.add();
+	}
+
+	// No free slot, so every slot is in use: within one turn of the hand
+	// some slot is COLD
+	for (;;)
+	{
+		const auto slot = static_cast<uint32_t>(clock_hand_);
+		clock_hand_ = clock_hand_ + 1 == states_.size() ? 0 : clock_hand_ + 1;
+		if (states_[slot] == HOT)
+		{
+			states_[slot] = COLD;
+		}
+		else if (states_[slot] == COLD)
+		{
+			evict(slot, false);
+			return slot;
+		}
+	}
+}
+
+void ClientAggregates::evict(uint32_t slot, bool expired)
+{
+	auto &metrics = Metrics::getInstance();
+	const int32_t id = slot_ids_[slot];
+	slots_.erase(id);
+	index_.erase(id);
+
+	if (spill_.isOpen())
+	{
+		if (spill_.put(id, rowBytes(stats_.row(slot))))
+		{
+			counters_.spilled++;
+			metrics.incrementClientSpills();
+		}
+		else
+		{
+			counters_.spill_errors++;
+			metrics.incrementClientSpillErrors();
+		}
+	}
+
+	stats_.reset(slot);
+	states_[slot] = FREE;
+	(expired ? counters_.expired : counters_.evicted)++;
+	metrics.incrementClientEvictions(expired);
+}
+
+void ClientAggregates::expireIdle(int64_t now_ms, size_t steps)
+{
+	// More steps than slots would only check the same clients again
+	const size_t slots = states_.size();
+	steps = std::min(steps, slots);
+	for (size_t step = 0; step < steps; ++step)
+	{
+		const auto slot = static_cast<uint32_t>(ttl_hand_);
+		ttl_hand_ = ttl_hand_ + 1 >= slots ? 0 : ttl_hand_ + 1;
+		if (states_[slot] != FREE && stats_.lastSeen(slot) < now_ms - limits_.ttl_ms)
+		{
+			evict(slot, true);
+			free_slots_.push_back(slot);
+			publishSizes();
+		}
+	}
+}
+
+std::optional<ClientStatsTable::Row> ClientAggregates::spilledRow(int32_t id)
+{
+	if (!spill_.isOpen() || !spill_.contains(id))
+	{
+		return std::nullopt;
+	}
+
+	auto bytes = spill_.get(id);
+	if (!bytes || bytes->size() != sizeof(ClientStatsTable::Row))
+	{
+		return std::nullopt;
+	}
+
+	ClientStatsTable::Row row;
+	std::memcpy(&row, bytes->data(), sizeof(row));
+	counters_.tier_hits++;
+	Metrics::getInstance().incrementClientTierHits();
+	return row;
+}
+
+void ClientAggregates::trackNewClient(int32_t id)
+{
+	if (!filter_.saturated())
+	{
+		filter_.insert(slots_.hash(id));
+		return;
+	}
+
+	// Rebuild at twice the size rather than let the false positive rate
+	// climb; this also drops ids that were evicted without spilling
+	filter_.reset((slots_.size() + spill_.size()) * 2);
+	for (const auto &[key, slot] : slots_)
+	{
+		filter_.insert(slots_.hash(key));
+	}
+	spill_.forEachKey([&](int32_t key)
+					  { filter_.insert(slots_.hash(key)); });
+}
+
+int64_t ClientAggregates::sum(int32_t id)
+{
+	if (auto it = slots_.find(id); it != slots_.end())
+	{
+		return stats_.sum(it->second);
+	}
+	auto row = spilledRow(id);
+	return row ? row->sum : 0;
+}
+
+ClientStatsTable::Stats ClientAggregates::stats(int32_t id)
+{
+	if (auto it = slots_.find(id); it != slots_.end())
+	{
+		return stats_.get(it->second);
+	}
+	auto row = spilledRow(id);
+	return row ? ClientStatsTable::statsOf(*row) : ClientStatsTable::Stats{};
+}
+
+void ClientAggregates::sums(const std::vector<std::optional<int32_t>> &ids, std::vector<long long> &out)
+{
+	const size_t count = ids.size();
+	out.assign(count, 0);
+
+	std::vector<size_t> hashes(count);
+	std::vector<char> known(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (ids[i])
+		{
+			hashes[i] = slots_.hash(*ids[i]);
+			known[i] = filter_.mightContain(hashes[i]);
+		}
+	}
+
+	for (size_t i = 0; i < std::min(count, PREFETCH_DISTANCE); ++i)
+	{
+		if (known[i])
+			slots_.prefetch(hashes[i]);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i + PREFETCH_DISTANCE < count && known[i + PREFETCH_DISTANCE])
+		{
+			slots_.prefetch(hashes[i + PREFETCH_DISTANCE]);
+		}
+		if (!known[i])
+			continue;
+
+		if (auto it = slots_.find(*ids[i], hashes[i]); it != slots_.end())
+		{
+			out[i] = stats_.sum(it->second);
+		}
+		else if (auto row = spilledRow(*ids[i]))
+		{
+			out[i] = row->sum;
+		}
+	}
+}
+
+void ClientAggregates::clear()
+{
+	slots_.clear();
+	stats_.clear();
+	states_.clear();
+	slot_ids_.clear();
+	free_slots_.clear();
+	clock_hand_ = 0;
+	ttl_hand_ = 0;
+	index_.clear();
+	filter_.reset(BloomFilter().capacity());
+	spill_.clear();
+	publishSizes();
+}
+
+void ClientAggregates::publishSizes() const
+{
+	Metrics::getInstance().setClientCounts(slots_.size(), spill_.size());
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <common/BloomFilter.h>
+#include <common/ClientStatsTable.h>
+#include <common/FlatHashMap.h>
+#include <common/OrderedIndex.h>
+#include <common/SpillStore.h>
+
+// Per-client aggregates keyed by user id: statistics rows, the id-ordered
+// range index and a Bloom filter of every id seen, so lookups of unknown ids
+// skip the table.
+//
+// The resident set can be bounded. When a new client arrives and capacity
+// clients are resident, a CLOCK hand evicts the first client whose reference
+// bit is clear, clearing the bits it passes; record() sets the bit. With a
+// TTL, each record() also checks the next two slots of a second hand and
+// evicts clients idle longer than the TTL. Both cost O(1) amortized on the
+// request path. Evicted clients are dropped, or written to a SpillStore when
+// a spill path is set; per-client reads and the next record() for a spilled
+// client find it there, and record() moves it back into memory. Listings
+// (forEach(), index()) cover resident clients only. Not thread-safe.
+class ClientAggregates
+{
+public:
+	struct Limits
+	{
+		size_t capacity = 0;	// resident clients; 0 is unbounded
+		int64_t ttl_ms = 0;		// idle time before eviction; 0 never expires
+		std::string spill_path; // file for evicted clients; empty drops them
+	};
+
+	struct Update
+	{
+		int32_t id;
+		int32_t number;
+	};
+
+	struct Counters
+	{
+		uint64_t evicted = 0; // to make room, by the CLOCK hand
+		uint64_t expired = 0; // idle past the TTL
+		uint64_t spilled = 0;
+		uint64_t spill_errors = 0;
+		uint64_t tier_hits = 0; // reads or records served from the spill file
+	};
+
+	ClientAggregates();
+	explicit ClientAggregates(Limits limits);
+
+	// "user_<id>" <-> id
+	static std::optional<int32_t> parseClientId(std::string_view client_id);
+	static std::string clientKey(int32_t id);
+
+	void record(int32_t id, int32_t number, int64_t now_ms);
+	// Same result as record() for each update in turn, up to floating point
+	// rounding of the mean and variance. Duplicates are folded into one
+	// partial row per id first; then every id is hashed and the loop runs
+	// three stages a fixed distance apart: prefetch the map group, look the
+	// id up and prefetch its row, apply the partial row. Cache misses of
+	// different ids overlap instead of being paid one after another.
+	void recordBatch(std::span<const Update> updates, int64_t now_ms);
+
+	int64_t sum(int32_t id);
+	// Zeroed Stats for an unknown client
+	ClientStatsTable::Stats stats(int32_t id);
+	// out[i] is the sum of ids[i], 0 for unknown or unparsed ids. Ids the
+	// Bloom filter rejects never touch the table; the rest are prefetched a
+	// few lookups ahead so their cache misses overlap.
+	void sums(const std::vector<std::optional<int32_t>> &ids, std::vector<long long> &out);
+
+	// f(id, sum) for every resident client
+	template <typename F>
+	void forEach(F &&f) const
+	{
+		for (const auto &[id, slot] : slots_)
+		{
+			f(id, stats_.sum(slot));
+		}
+	}
+
+	const OrderedIndex &index() const { return index_; }
+	size_t size() const { return slots_.size(); }
+	size_t spilledSize() const { return spill_.size(); }
+	bool spillEnabled() const { return spill_.isOpen(); }
+	const Counters &counters() const { return counters_; }
+	void clear();
+
+private:
+	enum SlotState : uint8_t
+	{
+		FREE,
+		COLD,
+		HOT, // referenced since the CLOCK hand last passed
+	};
+
+	static constexpr int TTL_STEPS = 2;
+	static constexpr size_t PREFETCH_DISTANCE = 8;
+
+	// One id of a batch on its way through recordBatch()
+	struct PendingRow
+	{
+		int32_t id;
+		uint32_t slot;		// NO_SLOT until looked up, or for new clients
+		uint64_t evictions; // evictions when slot was looked up
+		size_t hash;
+		ClientStatsTable::Row row;
+	};
+
+	static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+	uint32_t admit(int32_t id);
+	uint32_t allocateSlot();
+	void evict(uint32_t slot, bool expired);
+	void expireIdle(int64_t now_ms, size_t steps = TTL_STEPS);
+	std::optional<ClientStatsTable::Row> spilledRow(int32_t id);
+	void trackNewClient(int32_t id);
+	void publishSizes() const;
+
+	Limits limits_;
+	FlatHashMap<int32_t, uint32_t> slots_; // id to row in stats_
+	ClientStatsTable stats_;
+	std::vector<uint8_t> states_;  // SlotState per row
+	std::vector<int32_t> slot_ids_; // id per row, for eviction
+	std::vector<uint32_t> free_slots_;
+	size_t clock_hand_ = 0;
+	size_t ttl_hand_ = 0;
+	OrderedIndex index_;
+	BloomFilter filter_;
+	SpillStore spill_;
+	Counters counters_;
+	std::vector<Update> batch_; // scratch space of recordBatch()
+	std::vector<PendingRow> pending_;
+};
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <common/Clock.h>
+#include <logging/Logger.h>
+#include <server/FileTailer.h>
+#include <server/Metrics.h>
+#include <server/RequestHandler.h>
+
+namespace
+{
+	constexpr uint32_t WATCH_EVENTS = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+	bool tailed(std::string_view name)
+	{
+		return name.size() > FileTailer::SUFFIX.size() && name.ends_with(FileTailer::SUFFIX);
+	}
+
+	int64_t mtimeNs(const struct stat &info)
+	{
+		return static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+	}
+}
+
+FileTailer::FileTailer()
+	: buffer_(READ_BYTES), events_(64 * (sizeof(inotify_event) + NAME_MAX + 1))
+{
+}
+
+FileTailer::~FileTailer()
+{
+	close();
+}
+
+bool FileTailer::open(const std::string &directory, const std::string &checkpoint_path)
+{
+	close();
+
+	inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd_ < 0)
+	{
+		Logger::error("Failed to create inotify instance: {}", strerror(errno));
+		return false;
+	}
+	if (inotify_add_watch(inotify_fd_, directory.c_str(), WATCH_EVENTS | IN_ONLYDIR) < 0)
+	{
+		Logger::error("Failed to watch {}: {}", directory, strerror(errno));
+		close();
+		return false;
+	}
+
+	directory_ = directory;
+	checkpoint_path_ = checkpoint_path.empty() ? directory + "/.tail-offsets" : checkpoint_path;
+	// The watch exists before the scan, so a file created in between is not missed
+	loadCheckpoint();
+	scanDirectory();
+	return true;
+}
+
+void FileTailer::close()
+{
+	if (inotify_fd_ < 0)
+	{
+		return;
+	}
+	saveCheckpoint();
+	::close(inotify_fd_);
+	inotify_fd_ = -1;
+	files_.clear();
+	pending_ = false;
+}
+
+uint64_t FileTailer::offset(const std::string &name) const
+{
+	auto it = files_.find(name);
+	return it != files_.end() ? it->second.offset : 0;
+}
+
+void FileTailer::loadCheckpoint()
+{
+	FILE *checkpoint = std::fopen(checkpoint_path_.c_str(), "r");
+	if (checkpoint == nullptr)
+	{
+		return;
+	}
+
+	// "<inode> <offset> <name>" per line; files are matched when they are found
+	unsigned long long inode;
+	unsigned long long offset;
+	char name[NAME_MAX + 1];
+	while (std::fscanf(checkpoint, "%llu %llu %255[^\n]\n", &inode, &offset, name) == 3)
+	{
+		File file;
+		file.inode = static_cast<ino_t>(inode);
+		file.offset = offset;
+		files_.try_emplace(std::string(name), file);
+	}
+	std::fclose(checkpoint);
+}
+
+bool FileTailer::saveCheckpoint()
+{
+	const std::string temporary = checkpoint_path_ + ".tmp";
+	FILE *checkpoint = std::fopen(temporary.c_str(), "w");
+	if (checkpoint == nullptr)
+	{
+		Logger::warn("Cannot write tail checkpoint {}: {}", temporary, strerror(errno));
+		return false;
+	}
+	for (const auto &[name, file] : files_)
+	{
+		std::fprintf(checkpoint, "%llu %llu %s\n", static_cast<unsigned long long>(file.inode),
+					 static_cast<unsigned long long>(file.offset), name.c_str());
+	}
+	const bool written = std::fclose(checkpoint) == 0;
+	if (!written || std::rename(temporary.c_str(), checkpoint_path_.c_str()) < 0)
+	{
+		Logger::warn("Cannot save tail checkpoint {}: {}", checkpoint_path_, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+void FileTailer::scanDirectory()
+{
+	DIR *dir = opendir(directory_.c_str());
+	if (dir == nullptr)
+	{
+		Logger::warn("Cannot list {}: {}", directory_, strerror(errno));
+		return;
+	}
+
+	// Checkpoint entries for files that are gone are dropped here
+	FlatHashMap<std::string, File> previous;
+	previous.swap(files_);
+	while (dirent *entry = readdir(dir))
+	{
+		if (tailed(entry->d_name))
+		{
+			std::string name(entry->d_name);
+			if (auto it = previous.find(name); it != previous.end())
+			{
+				files_.try_emplace(name, it->second);
+			}
+			track(name);
+		}
+	}
+	closedir(dir);
+	Metrics::getInstance().setTailFiles(files_.size());
+}
+
+void FileTailer::track(const std::string &name)
+{
+	struct stat info;
+	if (stat((directory_ + "/" + name).c_str(), &info) < 0 || !S_ISREG(info.st_mode))
+	{
+		files_.erase(name);
+		return;
+	}
+
+	auto [it, inserted] = files_.try_emplace(name, File{});
+	File &file = it->second;
+	if (file.inode != info.st_ino || static_cast<uint64_t>(info.st_size) < file.offset)
+	{
+		// A new file under a known name, or one cut short: start over
+		file = File{};
+		file.inode = info.st_ino;
+	}
+	file.size = static_cast<uint64_t>(info.st_size);
+	file.mtime_ns = mtimeNs(info);
+	file.dirty = true;
+	pending_ = true;
+}
+
+void FileTailer::handleEvents()
+{
+	bool rescan = false;
+	for (;;)
+	{
+		ssize_t length = read(inotify_fd_, events_.data(), events_.size());
+		if (length <= 0)
+		{
+			break;
+		}
+
+		for (char *cursor = events_.data(); cursor < events_.data() + length;)
+		{
+			const auto *event = reinterpret_cast<const inotify_event *>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				rescan = true;
+				continue;
+			}
+			if (event->len == 0 || !tailed(event->name))
+			{
+				continue;
+			}
+
+			const std::string name(event->name);
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				files_.erase(name);
+			}
+			else
+			{
+				track(name);
+			}
+		}
+	}
+
+	// Events were lost; the directory itself is the truth
+	if (rescan)
+	{
+		scanDirectory();
+	}
+	Metrics::getInstance().setTailFiles(files_.size());
+	updateLag();
+}
+
+size_t FileTailer::drain(RequestHandler &handler, size_t max_bytes)
+{
+	handler_ = &handler;
+	const Counters before = counters_;
+	size_t total = 0;
+	std::vector<std::string> vanished;
+	pending_ = false;
+
+	for (auto &[name, file] : files_)
+	{
+		if (!file.dirty)
+		{
+			continue;
+		}
+		if (total >= max_bytes)
+		{
+			pending_ = true;
+			break;
+		}
+
+		int fd = ::open((directory_ + "/" + name).c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			vanished.push_back(name);
+			continue;
+		}
+		total += readFile(fd, file, max_bytes - total);
+		::close(fd);
+		pending_ = pending_ || file.dirty;
+	}
+	for (const auto &name : vanished)
+	{
+		files_.erase(name);
+	}
+
+	if (!updates_.empty())
+	{
+		handler.recordUpdates(updates_);
+		updates_.clear();
+	}
+	handler_ = nullptr;
+
+	if (total > 0)
+	{
+		saveCheckpoint();
+	}
+	updateLag();
+
+	Metrics::getInstance().addTailRecords(counters_.lines - before.lines, counters_.bytes - before.bytes,
+										  counters_.applied - before.applied,
+										  counters_.parse_errors - before.parse_errors);
+	return total;
+}
+
+size_t FileTailer::readFile(int fd, File &file, size_t max_bytes)
+{
+	struct stat info;
+	if (fstat(fd, &info) < 0)
+	{
+		file.dirty = false;
+		return 0;
+	}
+	if (file.inode != info.st_ino || static_cast<uint64_t>(info.st_size) < file.offset)
+	{
+		file = File{};
+		file.inode = info.st_ino;
+	}
+	file.size = static_cast<uint64_t>(info.st_size);
+	file.mtime_ns = mtimeNs(info);
+
+	size_t consumed = 0;
+	bool uncapped = false; // the budget cut a read short of any newline
+	while (file.offset < file.size && (consumed < max_bytes || uncapped))
+	{
+		const size_t full = static_cast<size_t>(std::min<uint64_t>(READ_BYTES, file.size - file.offset));
+		const size_t want = uncapped ? full : std::min(full, max_bytes - consumed);
+		const ssize_t got = pread(fd, buffer_.data(), want, static_cast<off_t>(file.offset));
+		if (got <= 0)
+		{
+			break;
+		}
+		std::string_view data(buffer_.data(), static_cast<size_t>(got));
+
+		size_t start = 0;
+		if (file.skipping)
+		{
+			const size_t newline = data.find('\n');
+			if (newline == std::string_view::npos)
+			{
+				file.offset += data.size();
+				consumed += data.size();
+				continue;
+			}
+			start = newline + 1;
+			file.skipping = false;
+		}
+
+		const size_t last_newline = data.rfind('\n');
+		if (last_newline == std::string_view::npos || last_newline < start)
+		{
+			if (want < full)
+			{
+				// Finish the line even if that overshoots the budget, past
+				// the end of a dropped one
+				file.offset += start;
+				consumed += start;
+				uncapped = true;
+				continue;
+			}
+			if (start == 0 && data.size() == READ_BYTES)
+			{
+				// No line fits the buffer; drop it up to its newline
+				counters_.parse_errors++;
+				file.skipping = true;
+				file.offset += data.size();
+				consumed += data.size();
+				continue;
+			}
+			// The rest is a line still being written
+			file.offset += start;
+			consumed += start;
+			break;
+		}
+
+		consumeLines(data.substr(start, last_newline + 1 - start));
+		file.offset += last_newline + 1;
+		consumed += last_newline + 1;
+		uncapped = false;
+		if (static_cast<size_t>(got) < want)
+		{
+			break;
+		}
+	}
+
+	counters_.bytes += consumed;
+	// Stopped by the budget with whole lines left; otherwise wait for the next write
+	file.dirty = consumed >= max_bytes && file.offset < file.size;
+	return consumed;
+}
+
+void FileTailer::consumeLines(std::string_view data)
+{
+	while (!data.empty())
+	{
+		const size_t newline = data.find('\n');
+		std::string_view line = data.substr(0, newline);
+		data.remove_prefix(newline == std::string_view::npos ? data.size() : newline + 1);
+
+		const size_t last = line.find_last_not_of(" \t\r");
+		if (last == std::string_view::npos)
+		{
+			continue;
+		}
+		line = line.substr(0, last + 1);
+		counters_.lines++;
+
+		auto update = handler_->decodeUpdate(line, codec::Format::Json);
+		if (update)
+		{
+			updates_.push_back(*update);
+			counters_.applied++;
+		}
+		else
+		{
+			counters_.parse_errors++;
+		}
+	}
+}
+
+void FileTailer::defer()
+{
+	counters_.deferred++;
+	Metrics::getInstance().incrementTailDeferred();
+}
+
+void FileTailer::updateLag()
+{
+	// Runs on the reactor, which keeps the coarse clock current
+	const int64_t now_ns = Clock::coarseWallMillis() * 1'000'000;
+	uint64_t lag_bytes = 0;
+	int64_t oldest_ns = now_ns;
+	for (const auto &[name, file] : files_)
+	{
+		if (file.offset < file.size)
+		{
+			lag_bytes += file.size - file.offset;
+			oldest_ns = std::min(oldest_ns, file.mtime_ns);
+		}
+	}
+	counters_.lag_bytes = lag_bytes;
+	// A write since the last tick can be newer than now_ns
+	counters_.lag_seconds = static_cast<double>(std::max<int64_t>(now_ns - oldest_ns, 0)) * 1e-9;
+	Metrics::getInstance().setTailLag(counters_.lag_bytes, counters_.lag_seconds);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+#include <common/FlatHashMap.h>
+#include <server/ClientAggregates.h>
+
+class RequestHandler;
+
+// Ingestion from JSONL files that upstream systems drop into a directory.
+// An inotify watch reports new, growing, moved and deleted files; the
+// reactor reads the watch (handleEvents()) and, while workers have room,
+// calls drain(), which reads complete lines past each file's offset,
+// decodes them like /process and applies them in one
+// RequestHandler::recordUpdates() call. A line still being written stays
+// in the file until its newline arrives. Offsets are saved to a checkpoint
+// file (written to a temporary name and renamed) after every drain that
+// advanced one, so a restarted server resumes where it stopped. A file
+// whose inode changed or that shrank is read again from the start. Not
+// thread-safe.
+class FileTailer
+{
+public:
+	struct Counters
+	{
+		uint64_t lines = 0; // non-blank
+		uint64_t bytes = 0;
+		uint64_t applied = 0;
+		uint64_t parse_errors = 0;
+		uint64_t deferred = 0; // drains skipped for backpressure
+		uint64_t lag_bytes = 0;	  // unread bytes over all files
+		double lag_seconds = 0;	  // age of the oldest unread write
+	};
+
+	static constexpr size_t READ_BYTES = 1u << 20; // per file and read
+	static constexpr std::string_view SUFFIX = ".jsonl";
+
+	FileTailer();
+	~FileTailer();
+
+	FileTailer(const FileTailer &) = delete;
+	FileTailer &operator=(const FileTailer &) = delete;
+
+	// Watches directory and loads offsets from checkpoint_path, which
+	// defaults to ".tail-offsets" inside the directory
+	bool open(const std::string &directory, const std::string &checkpoint_path = "");
+	// Saves the offsets one last time
+	void close();
+	int fd() const { return inotify_fd_; }
+
+	// Reads the inotify events queued so far
+	void handleEvents();
+	// Whether some file may have unread lines
+	bool pending() const { return pending_; }
+	// Reads at most max_bytes over all files; returns the bytes consumed
+	size_t drain(RequestHandler &handler, size_t max_bytes = 4 * READ_BYTES);
+	// The caller skipped a drain because its workers are busy
+	void defer();
+
+	const Counters &counters() const { return counters_; }
+	// Offset the next drain starts from, for tests and the checkpoint
+	uint64_t offset(const std::string &name) const;
+
+private:
+	struct File
+	{
+		ino_t inode = 0;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		int64_t mtime_ns = 0;
+		bool dirty = true;
+		bool skipping = false; // inside a line longer than READ_BYTES
+	};
+
+	void scanDirectory();
+	void track(const std::string &name);
+	size_t readFile(int fd, File &file, size_t max_bytes);
+	void consumeLines(std::string_view data);
+	void loadCheckpoint();
+	bool saveCheckpoint();
+	void updateLag();
+
+	int inotify_fd_ = -1;
+	std::string directory_;
+	std::string checkpoint_path_;
+	FlatHashMap<std::string, File> files_;
+	bool pending_ = false;
+	std::vector<char> buffer_;
+	std::vector<char> events_;
+	std::vector<ClientAggregates::Update> updates_;
+	RequestHandler *handler_ = nullptr; // during drain()
+	Counters counters_;
+};
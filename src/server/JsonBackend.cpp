@@ -0,0 +1,110 @@
+#include <iterator>
+
+#include <codec/Json.h>
+#include <common/rapidjson/document.h>
+#include <logging/Logger.h>
+#include <server/JsonBackend.h>
+
+std::unique_ptr<JsonBackend> JsonBackend::create(const std::string &name)
+{
+	if (name == "structural")
+	{
+		return std::make_unique<StructuralJsonBackend>();
+	}
+	if (name == "rapidjson")
+	{
+		return std::make_unique<RapidJsonBackend>();
+	}
+	if (name != "codec")
+	{
+		Logger::warn("Unknown JSON backend '{}', using codec", name);
+	}
+	return std::make_unique<CodecJsonBackend>();
+}
+
+RequestError toRequestError(const codec::DecodeError &error) noexcept
+{
+	static constexpr RequestError field_errors[] = {
+		RequestError::InvalidId,
+		RequestError::InvalidName,
+		RequestError::InvalidPhone,
+		RequestError::InvalidNumber,
+	};
+	static_assert(std::size(field_errors) == codec::fieldCount<UserData>);
+
+	switch (error.kind)
+	{
+	case codec::DecodeError::Syntax:
+		return RequestError::InvalidJson;
+	case codec::DecodeError::NotAnObject:
+		return RequestError::NotAnObject;
+	case codec::DecodeError::MissingField:
+	case codec::DecodeError::WrongType:
+		return field_errors[error.field];
+	case codec::DecodeError::Invalid:
+		break;
+	}
+	return RequestError::InvalidUserData;
+}
+
+std::expected<UserData, RequestError> CodecJsonBackend::parseUserData(std::string_view json_input) const
+{
+	auto data = codec::decodeJson<UserData>(json_input);
+	if (!data)
+	{
+		return std::unexpected(toRequestError(data.error()));
+	}
+	return std::move(*data);
+}
+
+std::expected<UserData, RequestError> RapidJsonBackend::parseUserData(std::string_view json_input) const
+{
+	rapidjson::Document doc;
+	doc.Parse(json_input.data(), json_input.size());
+
+	if (doc.HasParseError())
+	{
+		return std::unexpected(RequestError::InvalidJson);
+	}
+
+	if (!doc.IsObject())
+	{
+		return std::unexpected(RequestError::NotAnObject);
+	}
+
+	UserData data;
+
+	// Parse id
+	auto id = doc.FindMember("id");
+	if (id == doc.MemberEnd() || !id->value.IsInt())
+	{
+		return std::unexpected(RequestError::InvalidId);
+	}
+	data.id = id->value.GetInt();
+
+	// Parse name
+	auto name = doc.FindMember("name");
+	if (name == doc.MemberEnd() || !name->value.IsString())
+	{
+		return std::unexpected(RequestError::InvalidName);
+	}
+	data.name.assign(name->value.GetString(), name->value.GetStringLength());
+
+	// Parse phone
+	auto phone = doc.FindMember("phone");
+	if (phone == doc.MemberEnd() || !phone->value.IsString())
+	{
+		return std::unexpected(RequestError::InvalidPhone);
+	}
+	data.phone.assign(phone->value.GetString(), phone->value.GetStringLength());
+
+	// Parse number
+	auto number = doc.FindMember("number");
+	if (number == doc.MemberEnd() || !number->value.IsInt())
+	{
+		return std::unexpected(RequestError::InvalidNumber);
+	}
+	data.number = number->value.GetInt();
+
+	return data;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <server/UserData.h>
+
+// Decodes /process payloads into UserData. Implementations must agree on every
+// input: same fields for valid documents and the same RequestError otherwise.
+class JsonBackend
+{
+public:
+	virtual ~JsonBackend() = default;
+
+	virtual const char *name() const noexcept = 0;
+	virtual std::expected<UserData, RequestError> parseUserData(std::string_view json_input) const = 0;
+
+	// "codec" (default), "rapidjson" or "structural"; unknown names fall back to codec
+	static std::unique_ptr<JsonBackend> create(const std::string &name);
+};
+
+// DOM parse through rapidjson::Document
+class RapidJsonBackend final : public JsonBackend
+{
+public:
+	const char *name() const noexcept override { return "rapidjson"; }
+	std::expected<UserData, RequestError> parseUserData(std::string_view json_input) const override;
+};
+
+// SAX decoder generated from codec::Describe<UserData>, no DOM allocations
+class CodecJsonBackend final : public JsonBackend
+{
+public:
+	const char *name() const noexcept override { return "codec"; }
+	std::expected<UserData, RequestError> parseUserData(std::string_view json_input) const override;
+};
+
+// Two-stage parser: a SIMD pass indexes structural characters, then only the
+// index is walked to validate the document and pick out the UserData fields
+class StructuralJsonBackend final : public JsonBackend
+{
+public:
+	const char *name() const noexcept override { return "structural"; }
+	std::expected<UserData, RequestError> parseUserData(std::string_view json_input) const override;
+};
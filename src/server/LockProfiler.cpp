@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include <codec/Codec.h>
+#include <server/LockProfiler.h>
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex mutex;
+		std::deque<LockProfiler::Site> sites; // stable addresses
+	};
+
+	// Never destroyed: mutexes in other static objects may outlive it
+	Registry &registry()
+	{
+		static auto *instance = new Registry();
+		return *instance;
+	}
+
+	void clear(LockProfiler::Histogram &histogram)
+	{
+		for (auto &count : histogram.counts)
+			count.store(0, std::memory_order_relaxed);
+		histogram.sum_ns.store(0, std::memory_order_relaxed);
+		histogram.max_ns.store(0, std::memory_order_relaxed);
+	}
+}
+
+LockProfiler::Site &LockProfiler::site(std::string_view name)
+{
+	auto &sites = registry();
+	std::lock_guard<std::mutex> lock(sites.mutex);
+	for (auto &site : sites.sites)
+	{
+		if (site.name == name)
+		{
+			return site;
+		}
+	}
+	return sites.sites.emplace_back(name);
+}
+
+std::string LockProfiler::toJson()
+{
+	auto &sites = registry();
+	std::vector<const Site *> ordered;
+	{
+		std::lock_guard<std::mutex> lock(sites.mutex);
+		for (const auto &site : sites.sites)
+			ordered.push_back(&site);
+	}
+	std::stable_sort(ordered.begin(), ordered.end(), [](const Site *a, const Site *b)
+					 { return a->wait.sum_ns.load(std::memory_order_relaxed) > b->wait.sum_ns.load(std::memory_order_relaxed); });
+
+	return codec::encode(codec::Format::Json, [&](auto &writer)
+						 {
+		auto histogram = [&](const Histogram &times)
+		{
+			writer.startObject(3);
+			writer.key("sum_ms");
+			writer.value(static_cast<double>(times.sum_ns.load(std::memory_order_relaxed)) / 1e6);
+			writer.key("max_us");
+			writer.value(static_cast<double>(times.max_ns.load(std::memory_order_relaxed)) / 1e3);
+			// Cumulative, like a Prometheus histogram; the last bucket is +Inf
+			writer.key("buckets");
+			writer.startArray(times.counts.size());
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < times.counts.size(); ++i)
+			{
+				cumulative += times.counts[i].load(std::memory_order_relaxed);
+				writer.startObject(2);
+				writer.key("le_us");
+				if (i < BUCKETS_NS.size())
+					writer.value(static_cast<double>(BUCKETS_NS[i]) / 1e3);
+				else
+					writer.value("+Inf");
+				writer.key("count");
+				writer.value(cumulative);
+				writer.endObject();
+			}
+			writer.endArray();
+			writer.endObject();
+		};
+
+		writer.startObject(2);
+		writer.key("enabled");
+		writer.value(ENABLED);
+		writer.key("locks");
+		writer.startArray(ordered.size());
+		for (const Site *site : ordered)
+		{
+			const uint64_t acquisitions = site->acquisitions.load(std::memory_order_relaxed);
+			const uint64_t contended = site->contended.load(std::memory_order_relaxed);
+			writer.startObject(6);
+			writer.key("name");
+			writer.value(site->name);
+			writer.key("acquisitions");
+			writer.value(acquisitions);
+			writer.key("contended");
+			writer.value(contended);
+			writer.key("contention_ratio");
+			writer.value(acquisitions > 0 ? static_cast<double>(contended) / static_cast<double>(acquisitions) : 0.0);
+			writer.key("wait");
+			histogram(site->wait);
+			writer.key("hold");
+			histogram(site->hold);
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.endObject(); });
+}
+
+void LockProfiler::reset()
+{
+	auto &sites = registry();
+	std::lock_guard<std::mutex> lock(sites.mutex);
+	for (auto &site : sites.sites)
+	{
+		site.acquisitions.store(0, std::memory_order_relaxed);
+		site.contended.store(0, std::memory_order_relaxed);
+		clear(site.wait);
+		clear(site.hold);
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <common/Clock.h>
+
+// Contention profile of the server's hot mutexes, for deciding which locks
+// to remove. Each mutex is declared as a ProfiledMutex with a name; in
+// builds with SERVICE_LOCK_PROFILING (cmake -DSERVICE_LOCK_PROFILING=ON)
+// that is an InstrumentedMutex, which counts acquisitions and the ones that
+// had to wait, and keeps histograms of wait and hold times per name. All
+// mutexes with the same name, e.g. every connection's write mutex, share
+// one site. Otherwise it is a plain std::mutex and costs nothing. The sites
+// are served as JSON on GET /debug/locks, most waited-on first.
+class LockProfiler
+{
+public:
+#ifdef SERVICE_LOCK_PROFILING
+	static constexpr bool ENABLED = true;
+#else
+	static constexpr bool ENABLED = false;
+#endif
+
+	// Upper bounds of the histogram buckets; the last bucket is +Inf
+	static constexpr std::array<uint64_t, 8> BUCKETS_NS = {250, 1'000, 4'000, 16'000,
+														   64'000, 256'000, 1'000'000, 4'000'000};
+
+	struct Histogram
+	{
+		std::array<std::atomic<uint64_t>, BUCKETS_NS.size() + 1> counts{};
+		std::atomic<uint64_t> sum_ns{0};
+		std::atomic<uint64_t> max_ns{0};
+
+		void record(uint64_t ns)
+		{
+			size_t bucket = 0;
+			while (bucket < BUCKETS_NS.size() && ns > BUCKETS_NS[bucket])
+				++bucket;
+			counts[bucket].fetch_add(1, std::memory_order_relaxed);
+			sum_ns.fetch_add(ns, std::memory_order_relaxed);
+			uint64_t max = max_ns.load(std::memory_order_relaxed);
+			while (ns > max && !max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			{
+			}
+		}
+	};
+
+	struct Site
+	{
+		explicit Site(std::string_view site_name) : name(site_name) {}
+
+		const std::string name;
+		std::atomic<uint64_t> acquisitions{0};
+		std::atomic<uint64_t> contended{0};
+		Histogram wait; // contended acquisitions only
+		Histogram hold;
+	};
+
+	// The site for name, created on first use and never freed
+	static Site &site(std::string_view name);
+	static std::string toJson();
+	// Zeroes every site, for tests
+	static void reset();
+};
+
+// std::mutex that records into a LockProfiler site. Lockable, so it works
+// with lock_guard, unique_lock and condition_variable_any.
+class InstrumentedMutex
+{
+public:
+	explicit InstrumentedMutex(std::string_view name) : site_(&LockProfiler::site(name)) {}
+
+	InstrumentedMutex(const InstrumentedMutex &) = delete;
+	InstrumentedMutex &operator=(const InstrumentedMutex &) = delete;
+
+	void lock()
+	{
+		if (mutex_.try_lock())
+		{
+			acquired_ = Clock::ticks();
+		}
+		else
+		{
+			const Clock::Ticks start = Clock::ticks();
+			mutex_.lock();
+			acquired_ = Clock::ticks();
+			site_->contended.fetch_add(1, std::memory_order_relaxed);
+			site_->wait.record(static_cast<uint64_t>(Clock::toNanos(acquired_ - start)));
+		}
+		site_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool try_lock()
+	{
+		if (!mutex_.try_lock())
+		{
+			return false;
+		}
+		acquired_ = Clock::ticks();
+		site_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void unlock()
+	{
+		const Clock::Ticks held = Clock::ticks() - acquired_;
+		mutex_.unlock();
+		site_->hold.record(static_cast<uint64_t>(Clock::toNanos(held)));
+	}
+
+private:
+	std::mutex mutex_;
+	LockProfiler::Site *site_;
+	Clock::Ticks acquired_ = 0; // written and read by the holder only
+};
+
+// A std::mutex that accepts, and ignores, a profiling name
+class NamedMutex : public std::mutex
+{
+public:
+	explicit NamedMutex(std::string_view) {}
+};
+
+using ProfiledMutex = std::conditional_t<LockProfiler::ENABLED, InstrumentedMutex, NamedMutex>;
+// For waiting on a ProfiledMutex: condition_variable only takes
+// unique_lock<std::mutex>, which a NamedMutex binds to
+using ProfiledLock = std::unique_lock<std::conditional_t<LockProfiler::ENABLED, InstrumentedMutex, std::mutex>>;
+using ProfiledConditionVariable =
+	std::conditional_t<LockProfiler::ENABLED, std::condition_variable_any, std::condition_variable>;
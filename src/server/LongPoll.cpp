@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <server/LongPoll.h>
+#include <server/Metrics.h>
+
+LongPollQueue::LongPollQueue()
+	: wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+LongPollQueue::~LongPollQueue()
+{
+	if (wake_fd_ >= 0)
+	{
+		::close(wake_fd_);
+	}
+}
+
+void LongPollQueue::acknowledge()
+{
+	uint64_t count;
+	while (read(wake_fd_, &count, sizeof(count)) == sizeof(count))
+	{
+	}
+}
+
+void LongPollQueue::park(uint64_t version, std::chrono::milliseconds wait, Resume resume)
+{
+	const uint64_t deadline_ms = Clock::coarseMillis() + static_cast<uint64_t>(std::min(wait, MAX_WAIT).count());
+	{
+		std::lock_guard<ProfiledMutex> lock(mutex_);
+		if (waiters_.empty() || version < polled_version_)
+		{
+			polled_version_ = version;
+		}
+		next_deadline_ms_ = std::min(next_deadline_ms_, deadline_ms);
+		waiters_.push_back({version, deadline_ms, std::move(resume)});
+		parked_.store(waiters_.size(), std::memory_order_relaxed);
+		Metrics::getInstance().setLongPollsParked(waiters_.size());
+	}
+
+	const uint64_t one = 1;
+	[[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+size_t LongPollQueue::poll(uint64_t version, uint64_t now_ms)
+{
+	// A request parked after this load wakes the reactor through fd()
+	if (parked_.load(std::memory_order_relaxed) == 0)
+	{
+		return 0;
+	}
+
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	if (waiters_.empty() || (version == polled_version_ && now_ms < next_deadline_ms_))
+	{
+		return 0;
+	}
+
+	size_t answered = 0;
+	polled_version_ = version;
+	next_deadline_ms_ = UINT64_MAX;
+	std::erase_if(waiters_, [&](Waiter &waiter)
+				  {
+		const bool expired = now_ms >= waiter.deadline_ms;
+		if (expired || waiter.version != version)
+		{
+			if (waiter.resume(expired))
+			{
+				++answered;
+				return true;
+			}
+			waiter.version = version;
+		}
+		next_deadline_ms_ = std::min(next_deadline_ms_, waiter.deadline_ms);
+		return false; });
+
+	parked_.store(waiters_.size(), std::memory_order_relaxed);
+	Metrics::getInstance().setLongPollsParked(waiters_.size());
+	return answered;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <common/Clock.h>
+#include <server/LockProfiler.h>
+
+// Requests parked until the data they read changes (GET ...?wait=ms with
+// If-None-Match). A parked request holds no thread: a worker parks it with
+// the data version it saw and returns, and the reactor calls poll() with
+// the current version. Waiters are only looked at when that version moved
+// or a deadline passed, so an idle queue costs one comparison per poll and
+// an empty one a single load. Deadlines are Clock::coarseMillis() values.
+// The reactor is woken through fd() when a request is parked.
+class LongPollQueue
+{
+public:
+	// Called on the reactor; returns true once the request was answered.
+	// With expired false the version moved, but maybe not for the data this
+	// request reads, in which case it returns false and keeps waiting.
+	using Resume = std::function<bool(bool expired)>;
+
+	// Longest wait honoured, below the server's 30 s idle-connection reaping
+	static constexpr std::chrono::milliseconds MAX_WAIT{20000};
+
+	LongPollQueue();
+	~LongPollQueue();
+
+	LongPollQueue(const LongPollQueue &) = delete;
+	LongPollQueue &operator=(const LongPollQueue &) = delete;
+
+	bool valid() const { return wake_fd_ >= 0; }
+	// eventfd readable after park(); clear it with acknowledge()
+	int fd() const { return wake_fd_; }
+	void acknowledge();
+
+	// Thread-safe; wait is capped at MAX_WAIT
+	void park(uint64_t version, std::chrono::milliseconds wait, Resume resume);
+	// Resumes waiters whose version is older than version or whose deadline
+	// passed; returns how many were answered. now_ms defaults to the time
+	// the reactor ticked last.
+	size_t poll(uint64_t version, uint64_t now_ms = Clock::coarseMillis());
+
+	size_t size() const { return parked_.load(std::memory_order_relaxed); }
+
+private:
+	struct Waiter
+	{
+		uint64_t version;
+		uint64_t deadline_ms;
+		Resume resume;
+	};
+
+	int wake_fd_ = -1;
+	mutable ProfiledMutex mutex_{"LongPollQueue::mutex_"};
+	std::vector<Waiter> waiters_;
+	std::atomic<size_t> parked_{0}; // waiters_.size(), read without the lock
+	uint64_t polled_version_ = 0;	// lowest version among waiters_
+	uint64_t next_deadline_ms_ = UINT64_MAX;
+};
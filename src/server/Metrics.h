@@ -1,13 +1,19 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <mutex>
-#include <chrono>
 #include <vector>
 #include <algorithm>
 
+#include <common/Clock.h>
+#include <server/Allocator.h>
+#include <server/LockProfiler.h>
+
 class Metrics
 {
 public:
@@ -42,13 +48,13 @@ public:
 	// Timing metrics
 	void updateRequestDuration(double duration_seconds)
 	{
-		std::lock_guard<std::mutex> lock(duration_mutex_);
+		std::lock_guard<ProfiledMutex> lock(duration_mutex_);
 		request_duration_seconds_ = duration_seconds;
 	}
 
 	void updateRequestDurationHistogram(double duration_seconds)
 	{
-		std::lock_guard<std::mutex> lock(histogram_mutex_);
+		std::lock_guard<ProfiledMutex> lock(histogram_mutex_);
 		if (duration_seconds < 0.001)
 			request_duration_bucket_1ms_++;
 		else if (duration_seconds < 0.01)
@@ -64,10 +70,15 @@ public:
 		request_duration_count_++;
 	}
 
+	// From the kernel's receive timestamp (server.rx_timestamps): how long
+	// bytes sat in the socket receive queue, and arrival to response
+	void recordKernelQueueDelay(double seconds) { kernel_queue_seconds_.record(seconds); }
+	void recordEndToEndLatency(double seconds) { end_to_end_seconds_.record(seconds); }
+
 	// Connection timing metrics - NEW
 	void updateConnectionDuration(double duration_seconds)
 	{
-		std::lock_guard<std::mutex> lock(connection_mutex_);
+		std::lock_guard<ProfiledMutex> lock(connection_mutex_);
 		connection_duration_sum_ += duration_seconds;
 		connection_duration_count_++;
 	}
@@ -90,9 +101,10 @@ public:
 	// RPS calculation
 	double getRequestsPerSecond()
 	{
-		std::lock_guard<std::mutex> lock(rps_mutex_);
-		auto now = std::chrono::steady_clock::now();
-		auto cutoff = now - std::chrono::seconds(1);
+		std::lock_guard<ProfiledMutex> lock(rps_mutex_);
+		const Clock::Ticks now = Clock::ticks();
+		const Clock::Ticks window = Clock::fromSeconds(1);
+		const Clock::Ticks cutoff = now > window ? now - window : 0;
 
 		// Count requests in the last second
 		auto count = std::count_if(request_timestamps_.begin(), request_timestamps_.end(),
@@ -118,6 +130,85 @@ public:
 		total_numbers_sum_ = 0;
 	}
 
+	// Client aggregate table
+	void incrementClientEvictions(bool expired) { (expired ? clients_expired_ : clients_evicted_)++; }
+	void incrementClientSpills() { clients_spilled_++; }
+	void incrementClientSpillErrors() { client_spill_errors_++; }
+	void incrementClientTierHits() { client_tier_hits_++; }
+	void setClientCounts(size_t resident, size_t spilled)
+	{
+		clients_resident_ = resident;
+		clients_spilled_resident_ = spilled;
+	}
+
+	// UDP ingestion
+	void addUdpDatagrams(uint64_t datagrams, uint64_t bytes, uint64_t applied, uint64_t parse_errors)
+	{
+		udp_datagrams_ += datagrams;
+		udp_bytes_ += bytes;
+		udp_applied_ += applied;
+		udp_parse_errors_ += parse_errors;
+	}
+	void addUdpDrops(uint64_t dropped, uint64_t truncated)
+	{
+		udp_dropped_ += dropped;
+		udp_truncated_ += truncated;
+	}
+	void addUdpLag(double seconds_sum, uint64_t samples, double seconds_max)
+	{
+		udp_lag_seconds_sum_.fetch_add(seconds_sum, std::memory_order_relaxed);
+		udp_lag_samples_ += samples;
+		udp_lag_seconds_max_ = seconds_max;
+	}
+
+	void addShmRecords(uint64_t applied, uint64_t rejected)
+	{
+		shm_records_ += applied;
+		shm_rejected_ += rejected;
+	}
+	void incrementShmSleeps() { shm_sleeps_++; }
+	void setShmProducers(uint64_t producers) { shm_producers_ = producers; }
+
+	void addTailRecords(uint64_t lines, uint64_t bytes, uint64_t applied, uint64_t parse_errors)
+	{
+		tail_lines_ += lines;
+		tail_bytes_ += bytes;
+		tail_applied_ += applied;
+		tail_parse_errors_ += parse_errors;
+	}
+	void incrementTailDeferred() { tail_deferred_++; }
+	void setTailLag(uint64_t bytes, double seconds)
+	{
+		tail_lag_bytes_ = bytes;
+		tail_lag_seconds_ = seconds;
+	}
+	void setTailFiles(uint64_t files) { tail_files_ = files; }
+
+	void addPushEvents(uint64_t events, uint64_t deliveries, uint64_t dropped)
+	{
+		push_events_ += events;
+		push_deliveries_ += deliveries;
+		push_dropped_ += dropped;
+	}
+	void setPushSubscribers(uint64_t subscribers) { push_subscribers_ = subscribers; }
+
+	void incrementNotModified() { not_modified_++; }
+	void setLongPollsParked(uint64_t parked) { long_polls_parked_ = parked; }
+
+	void addMirrorRequests(uint64_t sent, uint64_t dropped, uint64_t errors)
+	{
+		mirror_sent_ += sent;
+		mirror_dropped_ += dropped;
+		mirror_errors_ += errors;
+	}
+	void incrementMirrorMismatches() { mirror_mismatches_++; }
+
+	void incrementPluginCalls() { plugin_calls_++; }
+	void incrementPluginErrors() { plugin_errors_++; }
+	void incrementPluginReloads() { plugin_reloads_++; }
+	void incrementPluginLoadErrors() { plugin_load_errors_++; }
+	void setPluginsLoaded(uint64_t loaded) { plugins_loaded_ = loaded; }
+
 	// Reset metrics (useful for testing)
 	void reset()
 	{
@@ -129,17 +220,60 @@ public:
 		bytes_received_ = 0;
 		bytes_sent_ = 0;
 		total_numbers_sum_ = 0;
+		clients_evicted_ = 0;
+		clients_expired_ = 0;
+		clients_spilled_ = 0;
+		client_spill_errors_ = 0;
+		client_tier_hits_ = 0;
+		udp_datagrams_ = 0;
+		udp_bytes_ = 0;
+		udp_applied_ = 0;
+		udp_parse_errors_ = 0;
+		udp_dropped_ = 0;
+		udp_truncated_ = 0;
+		udp_lag_seconds_sum_ = 0.0;
+		udp_lag_samples_ = 0;
+		udp_lag_seconds_max_ = 0.0;
+		shm_records_ = 0;
+		shm_rejected_ = 0;
+		shm_sleeps_ = 0;
+		shm_producers_ = 0;
+		tail_lines_ = 0;
+		tail_bytes_ = 0;
+		tail_applied_ = 0;
+		tail_parse_errors_ = 0;
+		tail_deferred_ = 0;
+		tail_lag_bytes_ = 0;
+		tail_lag_seconds_ = 0.0;
+		tail_files_ = 0;
+		push_events_ = 0;
+		push_deliveries_ = 0;
+		push_dropped_ = 0;
+		push_subscribers_ = 0;
+		not_modified_ = 0;
+		long_polls_parked_ = 0;
+		mirror_sent_ = 0;
+		mirror_dropped_ = 0;
+		mirror_errors_ = 0;
+		mirror_mismatches_ = 0;
+		plugin_calls_ = 0;
+		plugin_errors_ = 0;
+		plugin_reloads_ = 0;
+		plugin_load_errors_ = 0;
+		plugins_loaded_ = 0;
 
 		// New metrics
 		max_read_buffer_size_ = 0;
 		max_write_buffer_size_ = 0;
 		connection_duration_sum_ = 0.0;
 		connection_duration_count_ = 0;
+		kernel_queue_seconds_.reset();
+		end_to_end_seconds_.reset();
 
-		std::lock_guard<std::mutex> lock1(duration_mutex_);
-		std::lock_guard<std::mutex> lock2(histogram_mutex_);
-		std::lock_guard<std::mutex> lock3(rps_mutex_);
-		std::lock_guard<std::mutex> lock4(connection_mutex_);
+		std::lock_guard<ProfiledMutex> lock1(duration_mutex_);
+		std::lock_guard<ProfiledMutex> lock2(histogram_mutex_);
+		std::lock_guard<ProfiledMutex> lock3(rps_mutex_);
+		std::lock_guard<ProfiledMutex> lock4(connection_mutex_);
 		request_duration_seconds_ = 0.0;
 		request_duration_bucket_1ms_ = 0;
 		request_duration_bucket_10ms_ = 0;
@@ -197,6 +331,11 @@ public:
 		ss << "cpp_service_request_duration_seconds_histogram_sum " << request_duration_sum_ << "\n";
 		ss << "cpp_service_request_duration_seconds_histogram_count " << request_duration_count_ << "\n\n";
 
+		kernel_queue_seconds_.write(ss, "cpp_service_kernel_queue_seconds",
+									"Lower bound of the time received bytes waited in the socket receive queue, from the last segment of each read");
+		end_to_end_seconds_.write(ss, "cpp_service_end_to_end_seconds",
+								  "Lower bound of the time from the kernel receiving a request to its response being sent, from the last segment of its first read");
+
 		// New connection duration metrics
 		ss << "# HELP cpp_service_connection_duration_seconds_sum Total connection duration in seconds\n";
 		ss << "# TYPE cpp_service_connection_duration_seconds_sum counter\n";
@@ -233,10 +372,221 @@ public:
 		ss << "# TYPE cpp_service_total_numbers_sum counter\n";
 		ss << "cpp_service_total_numbers_sum " << total_numbers_sum_ << "\n\n";
 
+		ss << "# HELP cpp_service_clients Clients held in memory and in the spill file\n";
+		ss << "# TYPE cpp_service_clients gauge\n";
+		ss << "cpp_service_clients{tier=\"memory\"} " << clients_resident_ << "\n";
+		ss << "cpp_service_clients{tier=\"spill\"} " << clients_spilled_resident_ << "\n\n";
+
+		ss << "# HELP cpp_service_client_evictions_total Clients evicted from memory\n";
+		ss << "# TYPE cpp_service_client_evictions_total counter\n";
+		ss << "cpp_service_client_evictions_total{reason=\"capacity\"} " << clients_evicted_ << "\n";
+		ss << "cpp_service_client_evictions_total{reason=\"ttl\"} " << clients_expired_ << "\n\n";
+
+		ss << "# HELP cpp_service_client_spills_total Evicted clients written to the spill file\n";
+		ss << "# TYPE cpp_service_client_spills_total counter\n";
+		ss << "cpp_service_client_spills_total " << clients_spilled_ << "\n\n";
+
+		ss << "# HELP cpp_service_client_spill_errors_total Evicted clients lost to spill write errors\n";
+		ss << "# TYPE cpp_service_client_spill_errors_total counter\n";
+		ss << "cpp_service_client_spill_errors_total " << client_spill_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_client_tier_hits_total Client reads and updates served from the spill file\n";
+		ss << "# TYPE cpp_service_client_tier_hits_total counter\n";
+		ss << "cpp_service_client_tier_hits_total " << client_tier_hits_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_datagrams_total Datagrams read by the UDP listener\n";
+		ss << "# TYPE cpp_service_udp_datagrams_total counter\n";
+		ss << "cpp_service_udp_datagrams_total " << udp_datagrams_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_bytes_total Bytes of datagrams read by the UDP listener\n";
+		ss << "# TYPE cpp_service_udp_bytes_total counter\n";
+		ss << "cpp_service_udp_bytes_total " << udp_bytes_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_records_applied_total Datagrams applied to the client aggregates\n";
+		ss << "# TYPE cpp_service_udp_records_applied_total counter\n";
+		ss << "cpp_service_udp_records_applied_total " << udp_applied_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_parse_errors_total Datagrams that did not decode to a valid UserData\n";
+		ss << "# TYPE cpp_service_udp_parse_errors_total counter\n";
+		ss << "cpp_service_udp_parse_errors_total " << udp_parse_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_dropped_total Datagrams lost before decoding\n";
+		ss << "# TYPE cpp_service_udp_dropped_total counter\n";
+		ss << "cpp_service_udp_dropped_total{reason=\"queue_full\"} " << udp_dropped_ << "\n";
+		ss << "cpp_service_udp_dropped_total{reason=\"truncated\"} " << udp_truncated_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_lag_seconds Time from kernel arrival to decoding of a datagram\n";
+		ss << "# TYPE cpp_service_udp_lag_seconds summary\n";
+		ss << "cpp_service_udp_lag_seconds_sum " << udp_lag_seconds_sum_ << "\n";
+		ss << "cpp_service_udp_lag_seconds_count " << udp_lag_samples_ << "\n\n";
+
+		ss << "# HELP cpp_service_udp_lag_max_seconds Largest UDP lag in the last batch read\n";
+		ss << "# TYPE cpp_service_udp_lag_max_seconds gauge\n";
+		ss << "cpp_service_udp_lag_max_seconds " << udp_lag_seconds_max_ << "\n\n";
+
+		// Shared-memory ingestion
+		ss << "# HELP cpp_service_shm_records_total Records applied from shared-memory rings\n";
+		ss << "# TYPE cpp_service_shm_records_total counter\n";
+		ss << "cpp_service_shm_records_total " << shm_records_ << "\n\n";
+
+		ss << "# HELP cpp_service_shm_rejected_total Shared-memory records with an invalid id\n";
+		ss << "# TYPE cpp_service_shm_rejected_total counter\n";
+		ss << "cpp_service_shm_rejected_total " << shm_rejected_ << "\n\n";
+
+		ss << "# HELP cpp_service_shm_sleeps_total Times the ring consumer blocked waiting for producers\n";
+		ss << "# TYPE cpp_service_shm_sleeps_total counter\n";
+		ss << "cpp_service_shm_sleeps_total " << shm_sleeps_ << "\n\n";
+
+		ss << "# HELP cpp_service_shm_producers Connected shared-memory producers\n";
+		ss << "# TYPE cpp_service_shm_producers gauge\n";
+		ss << "cpp_service_shm_producers " << shm_producers_ << "\n\n";
+
+		// Directory tail ingestion
+		ss << "# HELP cpp_service_tail_lines_total Non-blank lines read from tailed files\n";
+		ss << "# TYPE cpp_service_tail_lines_total counter\n";
+		ss << "cpp_service_tail_lines_total " << tail_lines_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_bytes_total Bytes consumed from tailed files\n";
+		ss << "# TYPE cpp_service_tail_bytes_total counter\n";
+		ss << "cpp_service_tail_bytes_total " << tail_bytes_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_records_applied_total Tailed lines applied to the client aggregates\n";
+		ss << "# TYPE cpp_service_tail_records_applied_total counter\n";
+		ss << "cpp_service_tail_records_applied_total " << tail_applied_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_parse_errors_total Tailed lines that did not decode to a valid UserData\n";
+		ss << "# TYPE cpp_service_tail_parse_errors_total counter\n";
+		ss << "cpp_service_tail_parse_errors_total " << tail_parse_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_deferred_total Reads of tailed files put off while workers were busy\n";
+		ss << "# TYPE cpp_service_tail_deferred_total counter\n";
+		ss << "cpp_service_tail_deferred_total " << tail_deferred_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_lag_bytes Bytes written to tailed files and not yet ingested\n";
+		ss << "# TYPE cpp_service_tail_lag_bytes gauge\n";
+		ss << "cpp_service_tail_lag_bytes " << tail_lag_bytes_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_lag_seconds Age of the oldest write not yet ingested\n";
+		ss << "# TYPE cpp_service_tail_lag_seconds gauge\n";
+		ss << "cpp_service_tail_lag_seconds " << tail_lag_seconds_ << "\n\n";
+
+		ss << "# HELP cpp_service_tail_files Files in the tailed directory\n";
+		ss << "# TYPE cpp_service_tail_files gauge\n";
+		ss << "cpp_service_tail_files " << tail_files_ << "\n\n";
+
+		ss << "# HELP cpp_service_push_subscribers Open /numbers/subscribe streams\n";
+		ss << "# TYPE cpp_service_push_subscribers gauge\n";
+		ss << "cpp_service_push_subscribers " << push_subscribers_ << "\n\n";
+
+		ss << "# HELP cpp_service_push_events_total Change events encoded for subscribers\n";
+		ss << "# TYPE cpp_service_push_events_total counter\n";
+		ss << "cpp_service_push_events_total " << push_events_ << "\n\n";
+
+		ss << "# HELP cpp_service_push_deliveries_total Change events queued on subscriber streams\n";
+		ss << "# TYPE cpp_service_push_deliveries_total counter\n";
+		ss << "cpp_service_push_deliveries_total " << push_deliveries_ << "\n\n";
+
+		ss << "# HELP cpp_service_push_dropped_total Subscriber streams closed for falling behind\n";
+		ss << "# TYPE cpp_service_push_dropped_total counter\n";
+		ss << "cpp_service_push_dropped_total " << push_dropped_ << "\n\n";
+
+		ss << "# HELP cpp_service_not_modified_total Conditional reads answered with 304 Not Modified\n";
+		ss << "# TYPE cpp_service_not_modified_total counter\n";
+		ss << "cpp_service_not_modified_total " << not_modified_ << "\n\n";
+
+		ss << "# HELP cpp_service_long_polls_parked Reads waiting for their data to change\n";
+		ss << "# TYPE cpp_service_long_polls_parked gauge\n";
+		ss << "cpp_service_long_polls_parked " << long_polls_parked_ << "\n\n";
+
+		ss << "# HELP cpp_service_mirror_sent_total Requests replayed against the shadow instance\n";
+		ss << "# TYPE cpp_service_mirror_sent_total counter\n";
+		ss << "cpp_service_mirror_sent_total " << mirror_sent_ << "\n\n";
+
+		ss << "# HELP cpp_service_mirror_dropped_total Sampled requests dropped because the mirror queue was full\n";
+		ss << "# TYPE cpp_service_mirror_dropped_total counter\n";
+		ss << "cpp_service_mirror_dropped_total " << mirror_dropped_ << "\n\n";
+
+		ss << "# HELP cpp_service_mirror_errors_total Mirrored requests the shadow did not answer\n";
+		ss << "# TYPE cpp_service_mirror_errors_total counter\n";
+		ss << "cpp_service_mirror_errors_total " << mirror_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_mirror_mismatches_total Shadow replies that differed in status or body\n";
+		ss << "# TYPE cpp_service_mirror_mismatches_total counter\n";
+		ss << "cpp_service_mirror_mismatches_total " << mirror_mismatches_ << "\n\n";
+
+		ss << "# HELP cpp_service_plugin_calls_total Requests handled by plugin routes\n";
+		ss << "# TYPE cpp_service_plugin_calls_total counter\n";
+		ss << "cpp_service_plugin_calls_total " << plugin_calls_ << "\n\n";
+
+		ss << "# HELP cpp_service_plugin_errors_total Plugin calls that failed and were answered with 500\n";
+		ss << "# TYPE cpp_service_plugin_errors_total counter\n";
+		ss << "cpp_service_plugin_errors_total " << plugin_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_plugin_reloads_total Rescans of the plugin directory\n";
+		ss << "# TYPE cpp_service_plugin_reloads_total counter\n";
+		ss << "cpp_service_plugin_reloads_total " << plugin_reloads_ << "\n\n";
+
+		ss << "# HELP cpp_service_plugin_load_errors_total Plugin files that could not be loaded\n";
+		ss << "# TYPE cpp_service_plugin_load_errors_total counter\n";
+		ss << "cpp_service_plugin_load_errors_total " << plugin_load_errors_ << "\n\n";
+
+		ss << "# HELP cpp_service_plugins_loaded Plugins serving routes\n";
+		ss << "# TYPE cpp_service_plugins_loaded gauge\n";
+		ss << "cpp_service_plugins_loaded " << plugins_loaded_ << "\n\n";
+
+		// Allocator heap gauges
+		ss << Allocator::toPrometheus();
+
 		return ss.str();
 	}
 
 private:
+	// Cumulative Prometheus histogram, recorded without a lock
+	struct LatencyHistogram
+	{
+		static constexpr std::array<double, 12> BOUNDS = {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025,
+														   0.005, 0.01, 0.025, 0.1, 0.25, 1.0};
+
+		std::array<std::atomic<long>, BOUNDS.size() + 1> counts{}; // the last is +Inf
+		std::atomic<double> sum{0.0};
+		std::atomic<long> count{0};
+
+		void record(double seconds)
+		{
+			const size_t bucket = std::lower_bound(BOUNDS.begin(), BOUNDS.end(), seconds) - BOUNDS.begin();
+			counts[bucket].fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(seconds, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void reset()
+		{
+			for (auto &bucket : counts)
+				bucket = 0;
+			sum = 0.0;
+			count = 0;
+		}
+
+		void write(std::stringstream &ss, std::string_view name, std::string_view help) const
+		{
+			ss << "# HELP " << name << " " << help << "\n";
+			ss << "# TYPE " << name << " histogram\n";
+			long cumulative = 0;
+			for (size_t i = 0; i < counts.size(); ++i)
+			{
+				cumulative += counts[i].load(std::memory_order_relaxed);
+				ss << name << "_bucket{le=\"";
+				if (i < BOUNDS.size())
+					ss << BOUNDS[i];
+				else
+					ss << "+Inf";
+				ss << "\"} " << cumulative << "\n";
+			}
+			ss << name << "_sum " << sum.load(std::memory_order_relaxed) << "\n";
+			ss << name << "_count " << count.load(std::memory_order_relaxed) << "\n\n";
+		}
+	};
+
 	// Request metrics
 	std::atomic<long> requests_total_{0};
 	std::atomic<long> requests_successful_{0};
@@ -248,7 +598,7 @@ private:
 
 	// Timing metrics
 	std::atomic<double> request_duration_seconds_{0.0};
-	std::mutex duration_mutex_;
+	ProfiledMutex duration_mutex_{"Metrics::duration_mutex_"};
 
 	// Histogram metrics
 	std::atomic<long> request_duration_bucket_1ms_{0};
@@ -258,12 +608,12 @@ private:
 	std::atomic<long> request_duration_bucket_inf_{0};
 	std::atomic<double> request_duration_sum_{0.0};
 	std::atomic<long> request_duration_count_{0};
-	std::mutex histogram_mutex_;
+	ProfiledMutex histogram_mutex_{"Metrics::histogram_mutex_"};
 
 	// New connection timing metrics
 	std::atomic<double> connection_duration_sum_{0.0};
 	std::atomic<long> connection_duration_count_{0};
-	std::mutex connection_mutex_;
+	ProfiledMutex connection_mutex_{"Metrics::connection_mutex_"};
 
 	// New buffer metrics
 	std::atomic<size_t> max_read_buffer_size_{0};
@@ -273,27 +623,80 @@ private:
 	std::atomic<long> bytes_received_{0};
 	std::atomic<long> bytes_sent_{0};
 
+	LatencyHistogram kernel_queue_seconds_;
+	LatencyHistogram end_to_end_seconds_;
+
 	// RPS calculation storage
-	std::vector<std::chrono::steady_clock::time_point> request_timestamps_;
-	std::mutex rps_mutex_;
+	std::vector<Clock::Ticks> request_timestamps_; // in order; read under rps_mutex_
+	ProfiledMutex rps_mutex_{"Metrics::rps_mutex_"};
 
 	std::atomic<long long> total_numbers_sum_{0};
 
+	// Client aggregate table
+	std::atomic<size_t> clients_resident_{0};
+	std::atomic<size_t> clients_spilled_resident_{0};
+	std::atomic<long> clients_evicted_{0};
+	std::atomic<long> clients_expired_{0};
+	std::atomic<long> clients_spilled_{0};
+	std::atomic<long> client_spill_errors_{0};
+	std::atomic<long> client_tier_hits_{0};
+
+	// UDP ingestion
+	std::atomic<uint64_t> udp_datagrams_{0};
+	std::atomic<uint64_t> udp_bytes_{0};
+	std::atomic<uint64_t> udp_applied_{0};
+	std::atomic<uint64_t> udp_parse_errors_{0};
+	std::atomic<uint64_t> udp_dropped_{0};
+	std::atomic<uint64_t> udp_truncated_{0};
+	std::atomic<double> udp_lag_seconds_sum_{0.0};
+	std::atomic<uint64_t> udp_lag_samples_{0};
+	std::atomic<double> udp_lag_seconds_max_{0.0};
+	std::atomic<uint64_t> shm_records_{0};
+	std::atomic<uint64_t> shm_rejected_{0};
+	std::atomic<uint64_t> shm_sleeps_{0};
+	std::atomic<uint64_t> shm_producers_{0};
+	std::atomic<uint64_t> tail_lines_{0};
+	std::atomic<uint64_t> tail_bytes_{0};
+	std::atomic<uint64_t> tail_applied_{0};
+	std::atomic<uint64_t> tail_parse_errors_{0};
+	std::atomic<uint64_t> tail_deferred_{0};
+	std::atomic<uint64_t> tail_lag_bytes_{0};
+	std::atomic<double> tail_lag_seconds_{0.0};
+	std::atomic<uint64_t> tail_files_{0};
+
+	std::atomic<uint64_t> push_events_{0};
+	std::atomic<uint64_t> push_deliveries_{0};
+	std::atomic<uint64_t> push_dropped_{0};
+	std::atomic<uint64_t> push_subscribers_{0};
+
+	std::atomic<uint64_t> not_modified_{0};
+	std::atomic<uint64_t> long_polls_parked_{0};
+
+	std::atomic<uint64_t> mirror_sent_{0};
+	std::atomic<uint64_t> mirror_dropped_{0};
+	std::atomic<uint64_t> mirror_errors_{0};
+	std::atomic<uint64_t> mirror_mismatches_{0};
+	std::atomic<uint64_t> plugin_calls_{0};
+	std::atomic<uint64_t> plugin_errors_{0};
+	std::atomic<uint64_t> plugin_reloads_{0};
+	std::atomic<uint64_t> plugin_load_errors_{0};
+	std::atomic<uint64_t> plugins_loaded_{0};
+
 	Metrics() = default;
 
 	// Record request timestamp for RPS calculation
 	void recordRequestTiming()
 	{
-		std::lock_guard<std::mutex> lock(rps_mutex_);
-		auto now = std::chrono::steady_clock::now();
+		std::lock_guard<ProfiledMutex> lock(rps_mutex_);
+		const Clock::Ticks now = Clock::ticks();
 		request_timestamps_.push_back(now);
 
-		// Clean up old entries (keep last 60 seconds)
-		auto cutoff = now - std::chrono::seconds(60);
-		request_timestamps_.erase(
-			std::remove_if(request_timestamps_.begin(), request_timestamps_.end(),
-						   [cutoff](const auto &timestamp)
-						   { return timestamp < cutoff; }),
-			request_timestamps_.end());
+		// Clean up old entries (keep last 60 seconds); the oldest are in front
+		const Clock::Ticks window = Clock::fromSeconds(60);
+		if (now > window && request_timestamps_.front() < now - window)
+		{
+			request_timestamps_.erase(request_timestamps_.begin(),
+									  std::lower_bound(request_timestamps_.begin(), request_timestamps_.end(), now - window));
+		}
 	}
 };
\ No newline at end of file
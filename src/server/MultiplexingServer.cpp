@@ -4,13 +4,72 @@
 #include <sstream>
 #include <cstring>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <sys/timerfd.h>
 #include <system_error>
 #include <vector>
 
+#include <codec/Codec.h>
+#include <config/Config.h>
 #include <logging/Logger.h>
+#include <server/Allocator.h>
 #include <server/Metrics.h>
 #include <server/MultiplexingServer.h>
 
+namespace
+{
+	// name must be lowercase; the parser stores header names that way
+	std::string_view findHeader(const FlatHashMap<std::string, std::string> &headers, std::string_view name)
+	{
+		auto it = headers.find(name);
+		return it != headers.end() ? std::string_view(it->second) : std::string_view();
+	}
+
+	// Raw value of name in a query string such as "from=1&to=5"; empty when absent
+	std::string_view queryParam(std::string_view query, std::string_view name)
+	{
+		while (!query.empty())
+		{
+			size_t amp = query.find('&');
+			std::string_view pair = query.substr(0, amp);
+			query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+			size_t eq = pair.find('=');
+			if (pair.substr(0, eq) == name)
+				return eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+		}
+		return {};
+	}
+
+	// If-None-Match holds "*" or a comma-separated list of tags; tags compare
+	// weakly, ignoring a W/ prefix
+	bool etagMatches(std::string_view if_none_match, std::string_view etag)
+	{
+		auto opaque = [](std::string_view tag)
+		{
+			while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t'))
+				tag.remove_prefix(1);
+			while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t'))
+				tag.remove_suffix(1);
+			if (tag.starts_with("W/"))
+				tag.remove_prefix(2);
+			return tag;
+		};
+
+		const std::string_view wanted = opaque(etag);
+		while (!if_none_match.empty())
+		{
+			size_t comma = if_none_match.find(',');
+			std::string_view tag = opaque(if_none_match.substr(0, comma));
+			if (tag == "*" || tag == wanted)
+				return true;
+			if_none_match = comma == std::string_view::npos ? std::string_view() : if_none_match.substr(comma + 1);
+		}
+		return false;
+	}
+}
+
 // Initialize static member
 MultiplexingServer *MultiplexingServer::global_instance_ = nullptr;
 
@@ -28,8 +87,8 @@ MultiplexingServer::ClientConnection::ClientConnection(int fd, const std::string
 													   RequestHandler *request_handler,
 													   const ServerConfig &config,
 													   MultiplexingServer *server)
-	: fd_(fd), client_addr_(client_addr), last_activity_(time(nullptr)),
-	  connection_start_time_(time(nullptr)), request_handler_(request_handler),
+	: fd_(fd), client_addr_(client_addr), last_activity_(Clock::coarseSeconds()),
+	  connection_start_time_(Clock::coarseSeconds()), request_handler_(request_handler),
 	  config_(config), server_(server)
 {
 	// Make socket non-blocking
@@ -50,12 +109,15 @@ void MultiplexingServer::ClientConnection::reset(int fd, const std::string &clie
 	fd_ = fd;
 	client_addr_ = client_addr;
 	read_buffer_.clear();
+	read_arrival_ = 0;
 	{
-		std::lock_guard<std::mutex> lock(write_mutex_);
+		std::lock_guard<ProfiledMutex> lock(write_mutex_);
 		write_buffer_.clear();
+		subscription_ = 0;
 	}
-	last_activity_ = time(nullptr);
-	connection_start_time_ = time(nullptr);
+	generation_++;
+	last_activity_ = Clock::coarseSeconds();
+	connection_start_time_ = Clock::coarseSeconds();
 	request_handler_ = request_handler;
 	active_ = true;
 
@@ -73,10 +135,31 @@ bool MultiplexingServer::ClientConnection::readAvailable()
 	ssize_t bytes_read;
 
 	// Single read attempt
-	bytes_read = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+	Clock::Ticks arrival = 0;
+	if (config_.rx_timestamps)
+	{
+		int64_t queued_ns;
+		bytes_read = RxTimestamps::receive(fd_, buffer, sizeof(buffer), queued_ns);
+		if (queued_ns >= 0)
+		{
+			const double queued_seconds = static_cast<double>(queued_ns) / 1e9;
+			Metrics::getInstance().recordKernelQueueDelay(queued_seconds);
+			arrival = Clock::ticks() - Clock::fromSeconds(queued_seconds);
+		}
+	}
+	else
+	{
+		bytes_read = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+	}
 
 	if (bytes_read > 0)
 	{
+		// A subscribed connection only streams events; anything it sends is ignored
+		if (subscription_ != 0)
+		{
+			return true;
+		}
+
 		// Check for buffer overflow protection
 		if (read_buffer_.size() + bytes_read > config_.max_read_buffer_size)
 		{
@@ -85,13 +168,19 @@ bool MultiplexingServer::ClientConnection::readAvailable()
 			return false;
 		}
 
+		if (read_buffer_.empty())
+		{
+			read_arrival_ = arrival;
+		}
 		read_buffer_.append(buffer, bytes_read);
-		last_activity_ = time(nullptr);
+		last_activity_ = Clock::coarseSeconds();
 
 		// Update metrics
 		auto &metrics = Metrics::getInstance();
 		metrics.updateReadBufferSize(read_buffer_.size());
 
+		TRACE_ZONE("frame");
+		PerfCounters::Scope stage(PerfCounters::Stage::Frame);
 		processRequests();
 		return true;
 	}
@@ -130,9 +219,20 @@ bool MultiplexingServer::ClientConnection::readAvailable()
 
 bool MultiplexingServer::ClientConnection::writeAvailable()
 {
+	TRACE_ZONE("flush");
 	try
 	{
-		std::lock_guard<std::mutex> lock(write_mutex_);
+		std::unique_lock<ProfiledMutex> lock(write_mutex_, std::try_to_lock);
+		if (!lock.owns_lock())
+		{
+			return true;
+		}
+		// A worker relaying a proxied body owns the socket until it is done
+		if (relaying_)
+		{
+			disableWriteNotifications();
+			return true;
+		}
 
 		if (write_buffer_.empty())
 		{
@@ -146,7 +246,7 @@ bool MultiplexingServer::ClientConnection::writeAvailable()
 		if (bytes_sent > 0)
 		{
 			write_buffer_.erase(0, bytes_sent);
-			last_activity_ = time(nullptr);
+			last_activity_ = Clock::coarseSeconds();
 
 			// Update metrics
 			auto &metrics = Metrics::getInstance();
@@ -185,9 +285,10 @@ bool MultiplexingServer::ClientConnection::writeAvailable()
 
 void MultiplexingServer::ClientConnection::sendResponse(std::string response)
 {
+	TRACE_ZONE("send");
 	try
 	{
-		std::lock_guard<std::mutex> lock(write_mutex_);
+		std::lock_guard<ProfiledMutex> lock(write_mutex_);
 
 		bool was_empty = write_buffer_.empty();
 
@@ -208,6 +309,12 @@ void MultiplexingServer::ClientConnection::sendResponse(std::string response)
 		auto &metrics = Metrics::getInstance();
 		metrics.updateWriteBufferSize(write_buffer_.size());
 
+		// A relaying worker flushes the buffer when it is done
+		if (relaying_)
+		{
+			return;
+		}
+
 		// If buffer was empty, we need to enable write notifications
 		if (was_empty && config_.enable_epollout_optimization)
 		{
@@ -270,6 +377,10 @@ void MultiplexingServer::ClientConnection::disableWriteNotifications()
 
 void MultiplexingServer::ClientConnection::close()
 {
+	// Waits out a push() writing to fd_ on the reactor
+	std::lock_guard<ProfiledMutex> lock(write_mutex_);
+	subscription_ = 0;
+
 	if (fd_ != -1)
 	{
 		// CRITICAL: Properly shutdown socket before close
@@ -277,11 +388,20 @@ void MultiplexingServer::ClientConnection::close()
 		shutdown(fd_, SHUT_RDWR);
 
 		// Track connection duration
-		auto connection_duration = time(nullptr) - connection_start_time_;
+		auto connection_duration = Clock::coarseSeconds() - connection_start_time_;
 		auto &metrics = Metrics::getInstance();
 		metrics.updateConnectionDuration(static_cast<double>(connection_duration));
 
-		::close(fd_);
+		// A relaying worker fails fast on the shut down socket and closes
+		// the descriptor itself; until then its number cannot be reused
+		if (relaying_)
+		{
+			relaying_ = false;
+		}
+		else
+		{
+			::close(fd_);
+		}
 		fd_ = -1;
 		active_ = false;
 
@@ -339,21 +459,56 @@ void MultiplexingServer::ClientConnection::processRequests()
 		// Extract complete request
 		std::string complete_request = read_buffer_.substr(pos, total_request_length);
 
+		// Short plugin handlers run here rather than waiting in the worker queue
+		if (server_ && server_->plugins_ && server_->plugins_->hasReactorRoutes() &&
+			handleReactorPlugin(complete_request))
+		{
+			pos = total_request_length;
+			continue;
+		}
+
 		// Use thread pool for request processing
 		if (server_ && server_->thread_pool_)
 		{
 			// Offload to thread pool
 			server_->thread_pool_->enqueue([this,
 											complete_request = std::move(complete_request),
-											client_addr = client_addr_]()
+											client_addr = client_addr_,
+											arrival = read_arrival_]()
 										   {
 				try {
 					// Parse and handle HTTP request
 					std::string method, path, body;
-					std::unordered_map<std::string, std::string> headers;
-					if (parseHttpRequestOptimized(complete_request, method, path, body, headers)) {
-						std::string response_content = handleHttpRequest(method, path, body);
-						sendResponse(response_content);
+					HeaderMap headers;
+					bool parsed;
+					{
+						TRACE_ZONE("parse");
+						PerfCounters::Scope stage(PerfCounters::Stage::Parse);
+						parsed = parseHttpRequestOptimized(complete_request, method, path, body, headers);
+					}
+					if (parsed) {
+						const Clock::Ticks start = Clock::ticks();
+						std::string response_content;
+						{
+							TRACE_ZONE("handle");
+							PerfCounters::Scope stage(PerfCounters::Stage::Handle);
+							response_content = dispatchRequest(complete_request, method, path, body, headers);
+						}
+						// Empty once the connection became an event stream, parked or relayed
+						if (!response_content.empty()) {
+							const Clock::Ticks handled = Clock::ticks();
+							{
+								PerfCounters::Scope stage(PerfCounters::Stage::Write);
+								sendResponse(response_content);
+							}
+							if (arrival != 0) {
+								Metrics::getInstance().recordEndToEndLatency(Clock::secondsSince(arrival));
+							}
+							// Copied only once the client's reply is on its way
+							if (server_ && server_->mirror_ && server_->mirror_->sample()) {
+								mirrorRequest(method, path, body, headers, response_content, Clock::toMillis(handled - start));
+							}
+						}
 					} else {
 						Logger::error("Failed to parse HTTP request from {}", client_addr);
 						std::string error_response = createHttpResponse(
@@ -373,11 +528,18 @@ void MultiplexingServer::ClientConnection::processRequests()
 		{
 			// Process inline (fallback)
 			std::string method, path, body;
-			std::unordered_map<std::string, std::string> headers;
+			HeaderMap headers;
 			if (parseHttpRequest(complete_request, method, path, body, headers))
 			{
-				std::string response_content = handleHttpRequest(method, path, body);
-				sendResponse(response_content);
+				std::string response_content = dispatchRequest(complete_request, method, path, body, headers);
+				if (!response_content.empty())
+				{
+					sendResponse(response_content);
+					if (read_arrival_ != 0)
+					{
+						Metrics::getInstance().recordEndToEndLatency(Clock::secondsSince(read_arrival_));
+					}
+				}
 			}
 			else
 			{
@@ -398,6 +560,12 @@ void MultiplexingServer::ClientConnection::processRequests()
 	{
 		read_buffer_.erase(0, pos);
 	}
+	// A partial request left behind keeps the older arrival, which errs
+	// towards a longer latency
+	if (read_buffer_.empty())
+	{
+		read_arrival_ = 0;
+	}
 
 	// Prevent buffer overflow (redundant check for safety)
 	if (read_buffer_.length() > config_.max_read_buffer_size)
@@ -409,7 +577,7 @@ void MultiplexingServer::ClientConnection::processRequests()
 
 bool MultiplexingServer::ClientConnection::parseHttpRequest(const std::string &data, std::string &method,
 															std::string &path, std::string &body,
-															std::unordered_map<std::string, std::string> &headers)
+															HeaderMap &headers)
 {
 	return parseHttpRequestOptimized(std::string_view(data.data(), data.length()),
 									 method, path, body, headers);
@@ -419,7 +587,7 @@ bool MultiplexingServer::ClientConnection::parseHttpRequestOptimized(std::string
 																	 std::string &method,
 																	 std::string &path,
 																	 std::string &body,
-																	 std::unordered_map<std::string, std::string> &headers)
+																	 HeaderMap &headers)
 {
 	// Reset outputs
 	method.clear();
@@ -503,7 +671,10 @@ bool MultiplexingServer::ClientConnection::parseHttpRequestOptimized(std::string
 				value.remove_suffix(1);
 			}
 
-			headers[std::string(key)] = std::string(value);
+			std::string name(key);
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c)
+						   { return static_cast<char>(std::tolower(c)); });
+			headers.insert_or_assign(std::move(name), std::string(value));
 		}
 
 		pos = line_end + 2;
@@ -519,23 +690,37 @@ bool MultiplexingServer::ClientConnection::parseHttpRequestOptimized(std::string
 	return true;
 }
 
-std::string MultiplexingServer::ClientConnection::createHttpResponse(const std::string &content,
-																	 const std::string &content_type,
-																	 int status_code)
+std::string MultiplexingServer::ClientConnection::createHttpResponse(std::string_view content,
+																	 std::string_view content_type,
+																	 int status_code,
+																	 std::string_view extra_headers)
 {
 	std::stringstream response;
 
 	const char *status_text = "OK";
-	if (status_code == 400)
+	if (status_code == 201)
+		status_text = "Created";
+	else if (status_code == 304)
+		status_text = "Not Modified";
+	else if (status_code == 400)
 		status_text = "Bad Request";
+	else if (status_code == 403)
+		status_text = "Forbidden";
 	else if (status_code == 404)
 		status_text = "Not Found";
 	else if (status_code == 500)
 		status_text = "Internal Server Error";
+	else if (status_code == 503)
+		status_text = "Service Unavailable";
 
 	response << "HTTP/1.1 " << status_code << " " << status_text << "\r\n";
-	response << "Content-Type: " << content_type << "\r\n";
-	response << "Content-Length: " << content.length() << "\r\n";
+	// A 304 has no body, and a Content-Length there would describe the
+	// cached representation instead (RFC 9110 §8.6)
+	if (status_code != 304)
+	{
+		response << "Content-Type: " << content_type << "\r\n";
+		response << "Content-Length: " << content.length() << "\r\n";
+	}
 
 	// CRITICAL FIX: Change from 'close' to 'keep-alive'
 	response << "Connection: keep-alive\r\n";
@@ -543,6 +728,7 @@ std::string MultiplexingServer::ClientConnection::createHttpResponse(const std::
 	response << "Access-Control-Allow-Origin: *\r\n";
 	response << "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
 	response << "Access-Control-Allow-Headers: Content-Type\r\n";
+	response << extra_headers;
 	response << "\r\n";
 	response << content;
 
@@ -553,60 +739,225 @@ std::string MultiplexingServer::ClientConnection::createHttpResponse(const std::
 	return response_str;
 }
 
+std::string MultiplexingServer::ClientConnection::dispatchRequest(const std::string &request, const std::string &method,
+																  const std::string &path, const std::string &body,
+																  const HeaderMap &headers)
+{
+	if (server_ && server_->proxy_)
+	{
+		if (const auto *route = server_->proxy_->match(path))
+		{
+			Logger::debug("Forwarding {} {} from {} to {}", method, path, client_addr_, route->prefix);
+			return server_->proxy_->forward(*route, request, client_addr_, *this);
+		}
+	}
+	if (server_ && server_->plugins_)
+	{
+		if (auto handler = server_->plugins_->find(method, std::string_view(path).substr(0, path.find('?'))))
+		{
+			return handlePluginRequest(handler, PluginHost::makeRequest(method, path, body, findHeader(headers, "content-type"),
+																		  findHeader(headers, "accept")));
+		}
+	}
+	return handleHttpRequest(method, path, body, headers);
+}
+
+bool MultiplexingServer::ClientConnection::handleReactorPlugin(const std::string &request)
+{
+	// Route lookup on the request line alone, so requests for the server's
+	// own endpoints go to the workers without being parsed twice
+	const size_t method_end = request.find(' ');
+	const size_t target_end = method_end == std::string::npos ? method_end : request.find(' ', method_end + 1);
+	if (target_end == std::string::npos)
+	{
+		return false;
+	}
+	std::string_view target(request.data() + method_end + 1, target_end - method_end - 1);
+	std::string_view route = target.substr(0, target.find('?'));
+	if (server_->proxy_ && server_->proxy_->match(route))
+	{
+		return false;
+	}
+	auto handler = server_->plugins_->find(std::string_view(request.data(), method_end), route);
+	if (!handler || handler.execClass() != SERVICE_EXEC_REACTOR)
+	{
+		return false;
+	}
+
+	std::string method, path, body;
+	HeaderMap headers;
+	if (!parseHttpRequestOptimized(request, method, path, body, headers))
+	{
+		return false;
+	}
+	sendResponse(handlePluginRequest(handler, PluginHost::makeRequest(method, path, body, findHeader(headers, "content-type"),
+																	  findHeader(headers, "accept"))));
+	return true;
+}
+
+std::string MultiplexingServer::ClientConnection::handlePluginRequest(const PluginHost::Handler &handler,
+																	  const service_request &request)
+{
+	Logger::debug("Plugin {} request from {}", handler.plugin(), client_addr_);
+	auto response = handler.invoke(request);
+	if (!response)
+	{
+		return createHttpResponse(R"({"error": "Plugin failed", "success": false})", "application/json", 500);
+	}
+	return createHttpResponse(response->body, response->content_type, response->status);
+}
+
+bool MultiplexingServer::ClientConnection::relayResponse(std::string_view head, int upstream_fd, size_t body_bytes)
+{
+	// The socket is claimed under the lock but written without it, so the
+	// reactor never waits on a slow client; responses queued meanwhile stay
+	// buffered until the relay is done
+	std::string pending;
+	int fd;
+	{
+		std::lock_guard<ProfiledMutex> lock(write_mutex_);
+		if (!active_ || fd_ == -1 || relaying_)
+		{
+			return false;
+		}
+		disableWriteNotifications();
+		pending.swap(write_buffer_);
+		relaying_ = true;
+		fd = fd_;
+	}
+
+	// Written from this thread in order: earlier responses still queued,
+	// then the head, then the body spliced from the upstream socket
+	const int timeout_ms = config_.request_timeout * 1000;
+	bool relayed = ReverseProxy::writeAll(fd, pending, timeout_ms) &&
+				   ReverseProxy::writeAll(fd, head, timeout_ms) &&
+				   ReverseProxy::spliceAll(upstream_fd, fd, body_bytes, timeout_ms);
+
+	std::lock_guard<ProfiledMutex> lock(write_mutex_);
+	if (fd_ != fd)
+	{
+		// close() ran meanwhile and left the descriptor to this thread
+		::close(fd);
+		return false;
+	}
+	relaying_ = false;
+	last_activity_ = Clock::coarseSeconds();
+
+	if (!relayed)
+	{
+		// Part of a response went out; the stream cannot be resynchronised
+		Logger::warn("Relaying a forwarded response to {} failed, closing", client_addr_);
+		active_ = false;
+		shutdown(fd_, SHUT_RDWR);
+	}
+	else if (!write_buffer_.empty())
+	{
+		enableWriteNotifications();
+	}
+	return relayed;
+}
+
 std::string MultiplexingServer::ClientConnection::handleHttpRequest(const std::string &method,
 																	const std::string &path,
-																	const std::string &body)
+																	const std::string &body,
+																	const HeaderMap &headers)
 {
 	auto &metrics = Metrics::getInstance();
 
 	if (method == "GET")
 	{
-		if (path == "/health")
+		auto format = codec::formatFromAccept(findHeader(headers, "accept"), codec::Format::Json);
+
+		// Routes match on the path without its query string
+		std::string_view route = path;
+		std::string_view query;
+		if (size_t question = route.find('?'); question != std::string_view::npos)
+		{
+			query = route.substr(question + 1);
+			route = route.substr(0, question);
+		}
+
+		if (route == "/health")
 		{
 			Logger::debug("Health check request from {}", client_addr_);
 			std::string json_content = R"({"status": "healthy", "success": true})";
 			return createHttpResponse(json_content, "application/json", 200);
 		}
-		else if (path == "/metrics")
+		else if (route == "/metrics")
 		{
 			Logger::debug("Metrics request from {}", client_addr_);
 			std::string metrics_content = metrics.getPrometheusMetrics();
+			if (server_ && server_->proxy_)
+			{
+				metrics_content += server_->proxy_->prometheusMetrics();
+			}
+			metrics_content += PerfCounters::prometheusMetrics();
 			return createHttpResponse(metrics_content, "text/plain", 200);
 		}
-		else if (path == "/numbers/sum")
+		else if (route == "/debug/allocator")
+		{
+			Logger::debug("Allocator statistics request from {}", client_addr_);
+			return createHttpResponse(Allocator::toJson(), "application/json", 200);
+		}
+		else if (route == "/debug/locks")
+		{
+			Logger::debug("Lock profile request from {}", client_addr_);
+			return createHttpResponse(LockProfiler::toJson(), "application/json", 200);
+		}
+		else if (route == "/debug/trace")
+		{
+			Logger::debug("Trace capture request from {}", client_addr_);
+			int window_ms = 100;
+			std::string_view ms = queryParam(query, "ms");
+			std::from_chars(ms.data(), ms.data() + ms.size(), window_ms);
+			// Holds this worker for the window
+			return createHttpResponse(Tracer::capture(window_ms), "application/json", 200);
+		}
+		else if (route == "/debug/plugins" && server_ && server_->plugins_)
+		{
+			Logger::debug("Plugin list request from {}", client_addr_);
+			return createHttpResponse(server_->plugins_->describeJson(), "application/json", 200);
+		}
+		else if (route == "/debug/mirror" && server_ && server_->mirror_)
+		{
+			Logger::debug("Mirror report request from {}", client_addr_);
+			return createHttpResponse(server_->mirror_->reportJson(), "application/json", 200);
+		}
+		else if (route == "/numbers/sum")
 		{
 			Logger::debug("Total numbers sum request from {}", client_addr_);
-			auto total_sum = request_handler_->getTotalNumbersSum();
-			std::string json_content = R"({"total_numbers_sum": )" + std::to_string(total_sum) + R"(, "success": true})";
-			return createHttpResponse(json_content, "application/json", 200);
+			return handleSumRequest({}, query, headers, format);
 		}
-		else if (path.find("/numbers/sum/") == 0)
+		else if (route.starts_with("/numbers/sum/"))
 		{
-			std::string client_id = path.substr(13);
+			std::string_view client_id = route.substr(13);
 			Logger::debug("Client numbers sum request for: {} from {}", client_id, client_addr_);
-			auto client_sum = request_handler_->getClientNumbersSum(client_id);
-			std::string json_content = R"({"client_id": ")" + client_id + R"(", "numbers_sum": )" + std::to_string(client_sum) + R"(, "success": true})";
-			return createHttpResponse(json_content, "application/json", 200);
+			return handleSumRequest(client_id, query, headers, format);
+		}
+		else if (route.starts_with("/numbers/stats/"))
+		{
+			std::string client_id(route.substr(15));
+			Logger::debug("Client statistics request for: {} from {}", client_id, client_addr_);
+			return createHttpResponse(request_handler_->clientStatsResponse(client_id, format), codec::contentType(format), 200);
 		}
-		else if (path == "/numbers/sum-all")
+		else if (route == "/numbers/sum-all")
 		{
 			Logger::debug("All clients numbers sum request from {}", client_addr_);
-			auto all_sums = request_handler_->getAllClientSums();
-
-			std::stringstream ss;
-			ss << R"({"success": true, "clients": {)";
-			bool first = true;
-			for (const auto &[client_id, sum] : all_sums)
-			{
-				if (!first)
-					ss << ",";
-				ss << R"(")" << client_id << R"(":)" << sum;
-				first = false;
-			}
-			ss << R"(}, "total":)" << request_handler_->getTotalNumbersSum() << "}";
-			return createHttpResponse(ss.str(), "application/json", 200);
+			return createHttpResponse(request_handler_->allClientSumsResponse(format), codec::contentType(format), 200);
+		}
+		else if (route == "/numbers/range")
+		{
+			Logger::debug("Client range request from {}", client_addr_);
+			return createHttpResponse(request_handler_->clientRangeResponse(queryParam(query, "from"), queryParam(query, "to"),
+																			queryParam(query, "limit"), format),
+									  codec::contentType(format), 200);
+		}
+		else if (route == "/numbers/subscribe")
+		{
+			Logger::debug("Subscription request from {}", client_addr_);
+			return handleSubscribeRequest(query);
 		}
-		else if (path == "/")
+		else if (route == "/")
 		{
 			Logger::debug("Root endpoint request from {}", client_addr_);
 			std::string json_content = R"({
@@ -616,62 +967,272 @@ std::string MultiplexingServer::ClientConnection::handleHttpRequest(const std::s
 					"GET /": "API documentation",
 					"GET /health": "Service health check",
 					"GET /metrics": "Prometheus metrics", 
-					"GET /numbers/sum": "Get total sum of all processed numbers",
-					"GET /numbers/sum/{client_id}": "Get sum of numbers for specific client",
+					"GET /numbers/sum?wait=ms": "Get total sum of all processed numbers; with If-None-Match, 304 or wait for a change",
+					"GET /numbers/sum/{client_id}?wait=ms": "Get sum of numbers for specific client; with If-None-Match, 304 or wait for a change",
 					"GET /numbers/sum-all": "Get sums for all clients",
-					"POST /process": "Process JSON request synchronously",
+					"GET /numbers/stats/{client_id}": "Get count, min, max, mean, variance and last seen time for a client",
+					"GET /numbers/range?from=&to=&limit=": "Get sums for a range of user ids in id order",
+					"GET /numbers/subscribe?total=1&clients=": "Stream changes of the total and client sums as Server-Sent Events",
+					"GET /debug/allocator": "Allocator heap statistics",
+					"GET /debug/locks": "Mutex contention, in builds with SERVICE_LOCK_PROFILING",
+					"GET /debug/mirror": "Shadow traffic comparison, when mirroring is on",
+					"GET /debug/trace?ms=": "Chrome trace of all threads over the next ms milliseconds, in builds with SERVICE_TRACING",
+					"GET /debug/plugins": "Loaded handler plugins and their routes, when plugins are on",
+					"POST /debug/plugins/reload": "Rescan the plugin directory",
+					"POST /numbers/sum/multi": "Get sums for an array of client ids in request order",
+					"POST /process": "Process a request synchronously as JSON, MessagePack or CBOR",
+					"POST /process-batch": "Process an array of requests as JSON, MessagePack or CBOR",
 					"POST /process-async": "Process JSON request asynchronously"
 				}
 			})";
 			return createHttpResponse(json_content, "application/json", 200);
 		}
 	}
-	else if (method == "POST" && path == "/process")
+	else if (method == "POST" && (path == "/process" || path == "/process-batch"))
 	{
-		auto start_time = std::chrono::steady_clock::now();
-		metrics.incrementRequests();
-		metrics.incrementBytesReceived(body.size());
+		return handleProcessRequest(path, body, headers);
+	}
+	else if (method == "POST" && path == "/debug/plugins/reload" && server_ && server_->plugins_)
+	{
+		Logger::info("Plugin reload requested by {}", client_addr_);
+		const size_t loaded = server_->plugins_->reload();
+		return createHttpResponse(R"({"plugins": )" + std::to_string(loaded) + R"(, "success": true})", "application/json", 200);
+	}
+	else if (method == "POST" && path == "/numbers/sum/multi")
+	{
+		Logger::debug("Multi client numbers sum request from {}", client_addr_);
+		auto request_format = codec::formatFromContentType(findHeader(headers, "content-type"));
+		auto response_format = codec::formatFromAccept(findHeader(headers, "accept"), request_format);
+		return createHttpResponse(request_handler_->clientSumsResponse(body, request_format, response_format),
+								  codec::contentType(response_format), 200);
+	}
 
-		if (body.empty())
-		{
-			Logger::warn("Empty request body from {}", client_addr_);
-			metrics.incrementFailedRequests();
-			std::string error_json = R"({"error": "Empty request body", "success": false})";
-			return createHttpResponse(error_json, "application/json", 400);
-		}
+	std::string error_json = R"({"error": "Endpoint not found", "success": false})";
+	return createHttpResponse(error_json, "application/json", 404);
+}
+
+std::string MultiplexingServer::ClientConnection::handleSumRequest(std::string_view client_id, std::string_view query,
+																   const HeaderMap &headers, codec::Format format)
+{
+	// Tagged before the body is read, so a racing update can only make the
+	// body newer than its tag and cost the poller one extra full response
+	const uint64_t version = request_handler_->getVersion();
+	std::string etag = sumETag(client_id);
+
+	std::string_view if_none_match = findHeader(headers, "if-none-match");
+	if (if_none_match.empty() || !etagMatches(if_none_match, etag))
+	{
+		return sumResponse(client_id, etag, format);
+	}
 
-		try
+	unsigned wait_ms = 0;
+	std::string_view wait = queryParam(query, "wait");
+	std::from_chars(wait.data(), wait.data() + wait.size(), wait_ms);
+	if (wait_ms == 0 || !server_ || !server_->long_polls_)
+	{
+		return notModifiedResponse(etag);
+	}
+
+	// Parked on the reactor until the tag changes or the wait runs out
+	server_->long_polls_->park(
+		version, std::chrono::milliseconds(wait_ms),
+		[connection = weak_from_this(), generation = generation_.load(), client_id = std::string(client_id),
+		 etag = std::move(etag), format](bool expired)
 		{
-			std::string json_response = request_handler_->processRequest(body);
-			metrics.incrementSuccessfulRequests();
-			metrics.incrementBytesSent(json_response.length());
+			auto self = connection.lock();
+			if (!self || !self->isActive() || self->generation_ != generation)
+			{
+				return true;
+			}
+			if (expired)
+			{
+				self->sendResponse(self->notModifiedResponse(etag));
+				return true;
+			}
+			std::string current = self->sumETag(client_id);
+			if (current == etag)
+			{
+				return false;
+			}
+			self->sendResponse(self->sumResponse(client_id, current, format));
+			return true;
+		});
+	return {};
+}
 
-			auto end_time = std::chrono::steady_clock::now();
-			auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-			double duration_seconds = duration.count() / 1000000.0;
-			metrics.updateRequestDuration(duration_seconds);
-			metrics.updateRequestDurationHistogram(duration_seconds);
+// Weak tags: the same value in JSON, MessagePack or CBOR shares a tag. The
+// total is tagged with the handler's version, a client with its update
+// count plus its sum, since a client dropped from a bounded table without a
+// spill file starts counting again
+std::string MultiplexingServer::ClientConnection::sumETag(std::string_view client_id)
+{
+	if (client_id.empty())
+	{
+		return "W/\"" + std::to_string(request_handler_->getVersion()) + "\"";
+	}
+	auto stats = request_handler_->getClientStats(client_id);
+	return "W/\"" + std::to_string(stats.count) + "-" + std::to_string(stats.sum) + "\"";
+}
+
+std::string MultiplexingServer::ClientConnection::sumResponse(std::string_view client_id, const std::string &etag,
+															  codec::Format format)
+{
+	std::string content = client_id.empty() ? request_handler_->totalSumResponse(format)
+											: request_handler_->clientSumResponse(std::string(client_id), format);
+	return createHttpResponse(content, codec::contentType(format), 200, "ETag: " + etag + "\r\n");
+}
+
+std::string MultiplexingServer::ClientConnection::notModifiedResponse(const std::string &etag)
+{
+	Metrics::getInstance().incrementNotModified();
+	return createHttpResponse({}, {}, 304, "ETag: " + etag + "\r\n");
+}
+
+void MultiplexingServer::ClientConnection::mirrorRequest(const std::string &method, const std::string &path,
+														 const std::string &body, const HeaderMap &headers,
+														 std::string_view response, double latency_ms)
+{
+	// Replies that differ on every instance are not worth comparing
+	if (path.starts_with("/metrics") || path.starts_with("/debug/"))
+	{
+		return;
+	}
+	// Nothing is copied for a request the full queue would drop
+	if (!server_->mirror_->tryReserve())
+	{
+		return;
+	}
+
+	auto [status, response_body] = RequestMirror::splitResponse(response);
+	RequestMirror::Exchange exchange;
+	exchange.method = method;
+	exchange.path = path;
+	exchange.body = body;
+	exchange.content_type = findHeader(headers, "content-type");
+	exchange.accept = findHeader(headers, "accept");
+	exchange.status = status;
+	exchange.response_body = response_body;
+	exchange.latency_ms = latency_ms;
+	server_->mirror_->submit(std::move(exchange));
+}
+
+std::string MultiplexingServer::ClientConnection::handleSubscribeRequest(std::string_view query)
+{
+	if (!server_ || !server_->push_hub_)
+	{
+		return createHttpResponse(R"({"error": "Subscriptions are disabled", "success": false})",
+								  "application/json", 404);
+	}
+
+	auto topics = PushHub::parseTopics(query);
+	if (!topics)
+	{
+		return createHttpResponse(R"({"error": "Expected total=1 and/or clients=<id>,<id>", "success": false})",
+								  "application/json", 400);
+	}
+
+	// The hub writes the stream header along with the first values
+	PushHub &hub = *server_->push_hub_;
+	const uint64_t subscription = hub.nextSubscriptionId();
+	subscription_ = subscription;
+	hub.subscribe(weak_from_this(), subscription, *topics, PushHub::streamHeader());
+	return {};
+}
+
+bool MultiplexingServer::ClientConnection::push(uint64_t subscription, const std::shared_ptr<const std::string> &event)
+{
+	std::lock_guard<ProfiledMutex> lock(write_mutex_);
+	if (!active_ || fd_ == -1 || subscription_ != subscription)
+	{
+		return false;
+	}
+
+	// A reader that cannot keep up is cut off rather than buffered without bound
+	if (write_buffer_.size() + event->size() > config_.max_write_buffer_size)
+	{
+		Logger::warn("Subscriber {} fell {} bytes behind, closing", client_addr_, write_buffer_.size());
+		subscription_ = 0;
+		shutdown(fd_, SHUT_RDWR);
+		return false;
+	}
 
-			return createHttpResponse(json_response, "application/json", 200);
+	// Sent straight from the shared event when nothing is queued; only an
+	// unsent tail is copied
+	std::string_view data = *event;
+	if (write_buffer_.empty() && !relaying_)
+	{
+		ssize_t bytes_sent = send(fd_, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (bytes_sent > 0)
+		{
+			data.remove_prefix(bytes_sent);
 		}
-		catch (const std::exception &e)
+		else if (bytes_sent == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			Logger::debug("Push to {} failed: {}", client_addr_, strerror(errno));
+			active_ = false;
+			return false;
+		}
+	}
+	if (!data.empty())
+	{
+		const bool was_empty = write_buffer_.empty();
+		write_buffer_.append(data);
+		if (was_empty && !relaying_)
 		{
-			metrics.incrementFailedRequests();
-			Logger::error("Request processing error from {}: {}", client_addr_, e.what());
+			enableWriteNotifications();
+		}
+	}
+
+	last_activity_ = Clock::coarseSeconds();
+	return true;
+}
 
-			auto end_time = std::chrono::steady_clock::now();
-			auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-			double duration_seconds = duration.count() / 1000000.0;
-			metrics.updateRequestDuration(duration_seconds);
-			metrics.updateRequestDurationHistogram(duration_seconds);
+std::string MultiplexingServer::ClientConnection::handleProcessRequest(const std::string &path,
+																	   const std::string &body,
+																	   const HeaderMap &headers)
+{
+	auto &metrics = Metrics::getInstance();
+	const Clock::Ticks start = Clock::ticks();
+	metrics.incrementRequests();
+	metrics.incrementBytesReceived(body.size());
 
-			std::string error_json = R"({"error": "Internal server error", "success": false})";
-			return createHttpResponse(error_json, "application/json", 500);
-		}
+	if (body.empty())
+	{
+		Logger::warn("Empty request body from {}", client_addr_);
+		metrics.incrementFailedRequests();
+		std::string error_json = R"({"error": "Empty request body", "success": false})";
+		return createHttpResponse(error_json, "application/json", 400);
 	}
 
-	std::string error_json = R"({"error": "Endpoint not found", "success": false})";
-	return createHttpResponse(error_json, "application/json", 404);
+	auto record_duration = [&]
+	{
+		double duration_seconds = Clock::secondsSince(start);
+		metrics.updateRequestDuration(duration_seconds);
+		metrics.updateRequestDurationHistogram(duration_seconds);
+	};
+
+	try
+	{
+		auto request_format = codec::formatFromContentType(findHeader(headers, "content-type"));
+		auto response_format = codec::formatFromAccept(findHeader(headers, "accept"), request_format);
+		std::string response = path == "/process-batch"
+								   ? request_handler_->processBatch(body, request_format, response_format)
+								   : request_handler_->processRequest(body, request_format, response_format);
+		metrics.incrementSuccessfulRequests();
+		metrics.incrementBytesSent(response.length());
+		record_duration();
+
+		return createHttpResponse(response, codec::contentType(response_format), 200);
+	}
+	catch (const std::exception &e)
+	{
+		metrics.incrementFailedRequests();
+		Logger::error("Request processing error from {}: {}", client_addr_, e.what());
+		record_duration();
+
+		std::string error_json = R"({"error": "Internal server error", "success": false})";
+		return createHttpResponse(error_json, "application/json", 500);
+	}
 }
 
 MultiplexingServer::ThreadPool::ThreadPool(size_t threads)
@@ -680,10 +1241,11 @@ MultiplexingServer::ThreadPool::ThreadPool(size_t threads)
 	{
 		workers_.emplace_back([this]
 							  {
+            TRACE_THREAD_NAME("worker");
             while (true) {
                 std::function<void()> task;
                 {
-                    std::unique_lock<std::mutex> lock(queue_mutex_);
+                    ProfiledLock lock(queue_mutex_);
                     condition_.wait(lock, [this] {
                         return stop_ || !tasks_.empty();
                     });
@@ -693,6 +1255,7 @@ MultiplexingServer::ThreadPool::ThreadPool(size_t threads)
                     task = std::move(tasks_.front());
                     tasks_.pop();
                 }
+                TRACE_ZONE("task");
                 task();
             } });
 	}
@@ -845,6 +1408,12 @@ bool MultiplexingServer::createSocket()
 void MultiplexingServer::initializeServer()
 {
 	Logger::initialize();
+	// Measured now rather than inside the first request
+	Clock::calibrate();
+	if (Clock::usesTsc())
+	{
+		Logger::info("Timing latencies with the TSC at {:.3f} GHz", Clock::ticksPerSecond() / 1e9);
+	}
 	request_handler_ = std::make_unique<RequestHandler>();
 	shutdown_requested_ = false;
 
@@ -870,6 +1439,134 @@ void MultiplexingServer::initializeServer()
 
 	// Add server socket to epoll - use level-triggered for better compatibility
 	addToEpoll(server_fd_, EPOLLIN);
+
+	// Optional fire-and-forget ingestion, read on this reactor
+	const int udp_port = Config::getInt("server.udp_port", 0);
+	if (udp_port > 0)
+	{
+		udp_listener_ = std::make_unique<UdpListener>();
+		if (!udp_listener_->open(host_, udp_port, Config::getInt("server.udp_receive_buffer", 0)))
+		{
+			throw std::runtime_error("Failed to open UDP listener");
+		}
+		addToEpoll(udp_listener_->fd(), EPOLLIN);
+		Logger::info("UDP ingestion listening on {}:{}", host_, udp_port);
+	}
+
+	// Same-host producers writing into shared memory, consumed on their own thread
+	const std::string shm_socket = Config::getString("server.shm_socket", "");
+	if (!shm_socket.empty())
+	{
+		shm_ingest_ = std::make_unique<ShmIngest>(*request_handler_, Config::getInt("server.shm_spin_polls", 2000));
+		if (!shm_ingest_->start(shm_socket))
+		{
+			throw std::runtime_error("Failed to start shared-memory ingestion");
+		}
+	}
+
+	// JSONL files dropped into a directory, read on this reactor
+	const std::string tail_directory = Config::getString("server.tail_directory", "");
+	if (!tail_directory.empty())
+	{
+		file_tailer_ = std::make_unique<FileTailer>();
+		if (!file_tailer_->open(tail_directory, Config::getString("server.tail_checkpoint", "")))
+		{
+			throw std::runtime_error("Failed to watch tail directory");
+		}
+		tail_max_queue_ = static_cast<size_t>(std::max(Config::getInt("server.tail_max_queue", 64), 1));
+		addToEpoll(file_tailer_->fd(), EPOLLIN);
+		Logger::info("Tailing JSONL files in {}", tail_directory);
+	}
+
+	// Shadow traffic to a second instance, sent from the mirror's own threads
+	const int mirror_port = Config::getInt("mirror.port", 0);
+	if (mirror_port > 0)
+	{
+		RequestMirror::Options options;
+		options.host = Config::getString("mirror.host", "127.0.0.1");
+		options.port = mirror_port;
+		const std::string rate = Config::getString("mirror.sample_rate", "0.01");
+		std::from_chars(rate.data(), rate.data() + rate.size(), options.sample_rate);
+		options.connections = static_cast<size_t>(std::max(Config::getInt("mirror.connections", 2), 1));
+		options.max_queue = static_cast<size_t>(std::max(Config::getInt("mirror.max_queue", 1024), 1));
+		options.timeout_ms = std::max(Config::getInt("mirror.timeout_ms", 2000), 1);
+		mirror_ = std::make_unique<RequestMirror>(options);
+		mirror_->start();
+	}
+
+	// Path prefixes relayed to upstream pools instead of handled here
+	const std::string proxy_routes = Config::getString("proxy.routes", "");
+	if (!proxy_routes.empty())
+	{
+		ReverseProxy::Options options;
+		options.strip_prefix = Config::getBool("proxy.strip_prefix", true);
+		options.timeout_ms = std::max(Config::getInt("proxy.timeout_ms", 5000), 1);
+		options.health_interval_ms = std::max(Config::getInt("proxy.health_interval_ms", 2000), 1);
+		options.max_idle = static_cast<size_t>(std::max(Config::getInt("proxy.max_idle", 32), 0));
+		proxy_ = ReverseProxy::create(proxy_routes, options);
+		if (!proxy_)
+		{
+			throw std::runtime_error("Invalid proxy.routes: " + proxy_routes);
+		}
+		proxy_->startHealthChecks();
+		Logger::info("Forwarding {} route(s) to {} upstream(s)", proxy_->routes().size(), proxy_->upstreamCount());
+	}
+
+	// Kernel receive timestamps, for queueing delay and end-to-end latency;
+	// accepted sockets inherit the option from the listener
+	if (Config::getBool("server.rx_timestamps", false))
+	{
+		config_.rx_timestamps = RxTimestamps::enable(server_fd_);
+		if (config_.rx_timestamps)
+			Logger::info("Measuring latency from kernel receive timestamps");
+		else
+			Logger::warn("SO_TIMESTAMPING refused ({}), server.rx_timestamps has no effect", strerror(errno));
+	}
+
+	// Hardware counters per request stage, when the kernel allows them
+	if (Config::getBool("server.perf_counters", false) && PerfCounters::enable())
+	{
+		Logger::info("Counting cycles, instructions, LLC and branch misses per request stage");
+	}
+
+	// Handler plugins; the directory is watched from this reactor for hot reloads
+	const std::string plugin_directory = Config::getString("plugins.directory", "");
+	if (!plugin_directory.empty())
+	{
+		plugins_ = std::make_unique<PluginHost>();
+		if (!plugins_->open(plugin_directory))
+		{
+			throw std::runtime_error("Failed to watch plugin directory");
+		}
+		addToEpoll(plugins_->fd(), EPOLLIN);
+	}
+
+	// Conditional reads waiting for a change, answered from this reactor
+	long_polls_ = std::make_unique<LongPollQueue>();
+	if (!long_polls_->valid())
+	{
+		throw std::runtime_error("Failed to create long-poll eventfd");
+	}
+	addToEpoll(long_polls_->fd(), EPOLLIN);
+
+	// Change notifications for /numbers/subscribe, sampled on a timer
+	const int push_interval_ms = Config::getInt("server.push_interval_ms", 250);
+	if (push_interval_ms > 0)
+	{
+		push_timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (push_timer_fd_ < 0)
+		{
+			throw std::runtime_error("Failed to create push timer");
+		}
+		struct itimerspec interval{};
+		interval.it_interval.tv_sec = push_interval_ms / 1000;
+		interval.it_interval.tv_nsec = static_cast<long>(push_interval_ms % 1000) * 1000000;
+		interval.it_value = interval.it_interval;
+		timerfd_settime(push_timer_fd_, 0, &interval, nullptr);
+		push_hub_ = std::make_unique<PushHub>(*request_handler_);
+		addToEpoll(push_timer_fd_, EPOLLIN);
+		Logger::info("Pushing subscription updates every {} ms", push_interval_ms);
+	}
 }
 
 void MultiplexingServer::runServer()
@@ -877,15 +1574,34 @@ void MultiplexingServer::runServer()
 	try
 	{
 		Logger::info("Multiplexing server thread starting on {}", getAddress());
+		TRACE_THREAD_NAME("reactor");
+		Clock::tick();
 		running_ = true;
 		ready_ = true;
 
 		std::vector<struct epoll_event> events(config_.epoll_max_events);
-		time_t last_health_check = time(nullptr);
+		time_t last_health_check = Clock::coarseSeconds();
 
 		while (!shutdown_requested_)
 		{
-			int num_events = epoll_wait(epoll_fd_, events.data(), config_.epoll_max_events, 1000);
+			// Unread tailed lines keep the loop turning; a busy pool slows it down
+			int timeout_ms = 1000;
+			if (file_tailer_ && file_tailer_->pending())
+			{
+				timeout_ms = thread_pool_->getQueueSize() >= tail_max_queue_ ? 10 : 0;
+			}
+			// Parked reads notice a change within 10 ms
+			if (long_polls_->size() > 0)
+			{
+				timeout_ms = std::min(timeout_ms, 10);
+			}
+			int num_events;
+			{
+				TRACE_ZONE("epoll_wait");
+				num_events = epoll_wait(epoll_fd_, events.data(), config_.epoll_max_events, timeout_ms);
+			}
+			// One clock read per iteration for every timeout check below
+			Clock::tick();
 
 			if (num_events < 0)
 			{
@@ -895,6 +1611,7 @@ void MultiplexingServer::runServer()
 				break;
 			}
 
+			TRACE_ZONE("dispatch_events");
 			for (int i = 0; i < num_events; ++i)
 			{
 				int fd = events[i].data.fd;
@@ -904,11 +1621,31 @@ void MultiplexingServer::runServer()
 				{
 					handleNewConnection();
 				}
+				else if (udp_listener_ && fd == udp_listener_->fd())
+				{
+					udp_listener_->drain(*request_handler_);
+				}
+				else if (file_tailer_ && fd == file_tailer_->fd())
+				{
+					file_tailer_->handleEvents();
+				}
+				else if (plugins_ && fd == plugins_->fd())
+				{
+					plugins_->handleEvents();
+				}
+				else if (fd == push_timer_fd_)
+				{
+					tickPushHub();
+				}
+				else if (fd == long_polls_->fd())
+				{
+					long_polls_->acknowledge();
+				}
 				else
 				{
 					handleClientEvent(fd, event_flags);
 				}
-				time_t now = time(nullptr);
+				time_t now = Clock::coarseSeconds();
 				if (now - last_health_check >= 5)
 				{
 					checkConnectionHealth();
@@ -917,6 +1654,9 @@ void MultiplexingServer::runServer()
 				}
 			}
 
+			drainTailedFiles();
+			resumeLongPolls();
+
 			// Clean up inactive clients
 			cleanupInactiveClients();
 		}
@@ -933,6 +1673,36 @@ void MultiplexingServer::runServer()
 	}
 }
 
+void MultiplexingServer::drainTailedFiles()
+{
+	if (!file_tailer_ || !file_tailer_->pending())
+	{
+		return;
+	}
+	// Backpressure: the files keep the records until the workers catch up
+	if (thread_pool_->getQueueSize() >= tail_max_queue_)
+	{
+		file_tailer_->defer();
+		return;
+	}
+	file_tailer_->drain(*request_handler_);
+}
+
+void MultiplexingServer::tickPushHub()
+{
+	uint64_t expirations;
+	if (read(push_timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations))
+	{
+		return;
+	}
+	push_hub_->tick();
+}
+
+void MultiplexingServer::resumeLongPolls()
+{
+	long_polls_->poll(request_handler_->getVersion());
+}
+
 void MultiplexingServer::handleNewConnection()
 {
 	struct sockaddr_in address;
@@ -959,7 +1729,7 @@ void MultiplexingServer::handleNewConnection()
 		auto client = connection_pool_->acquire(client_fd, client_addr_str, request_handler_.get());
 
 		{
-			std::lock_guard<std::mutex> lock(clients_mutex_);
+			std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 			clients_[client_fd] = client;
 		}
 
@@ -978,7 +1748,7 @@ void MultiplexingServer::handleClientEvent(int client_fd, uint32_t events)
 {
 	std::shared_ptr<ClientConnection> client;
 	{
-		std::lock_guard<std::mutex> lock(clients_mutex_);
+		std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 		auto it = clients_.find(client_fd);
 		if (it == clients_.end())
 		{
@@ -1031,7 +1801,7 @@ void MultiplexingServer::closeClient(int client_fd)
 {
 	std::shared_ptr<ClientConnection> client;
 	{
-		std::lock_guard<std::mutex> lock(clients_mutex_);
+		std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 		auto it = clients_.find(client_fd);
 		if (it == clients_.end())
 		{
@@ -1064,9 +1834,9 @@ void MultiplexingServer::closeClient(int client_fd)
 void MultiplexingServer::cleanupInactiveClients()
 {
 	const time_t TIMEOUT = config_.connection_timeout;
-	time_t now = time(nullptr);
+	time_t now = Clock::coarseSeconds();
 
-	std::lock_guard<std::mutex> lock(clients_mutex_);
+	std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 	for (auto it = clients_.begin(); it != clients_.end();)
 	{
 		if (now - it->second->getLastActivity() > TIMEOUT)
@@ -1125,7 +1895,7 @@ void MultiplexingServer::cleanup()
 
 	// Close all client connections
 	{
-		std::lock_guard<std::mutex> lock(clients_mutex_);
+		std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 		for (auto &[client_fd, client] : clients_)
 		{
 			removeFromEpoll(client_fd);
@@ -1136,6 +1906,34 @@ void MultiplexingServer::cleanup()
 	// Clean up connection pool
 	connection_pool_.reset();
 
+	if (udp_listener_)
+	{
+		removeFromEpoll(udp_listener_->fd());
+		udp_listener_.reset();
+	}
+	shm_ingest_.reset();
+	if (file_tailer_)
+	{
+		removeFromEpoll(file_tailer_->fd());
+		file_tailer_.reset();
+	}
+	if (plugins_)
+	{
+		removeFromEpoll(plugins_->fd());
+	}
+	if (push_timer_fd_ >= 0)
+	{
+		removeFromEpoll(push_timer_fd_);
+		close(push_timer_fd_);
+		push_timer_fd_ = -1;
+	}
+	push_hub_.reset();
+	if (long_polls_)
+	{
+		removeFromEpoll(long_polls_->fd());
+		long_polls_.reset();
+	}
+
 	// Close server socket
 	if (server_fd_ >= 0)
 	{
@@ -1152,6 +1950,10 @@ void MultiplexingServer::cleanup()
 
 	// Clean up thread pool
 	thread_pool_.reset();
+	mirror_.reset();
+	proxy_.reset();
+	// In-flight calls hold their plugin until they return
+	plugins_.reset();
 
 	// Clean up request handler
 	if (request_handler_)
@@ -1170,10 +1972,10 @@ void MultiplexingServer::cleanup()
 void MultiplexingServer::checkConnectionHealth()
 {
 	std::vector<int> dead_connections;
-	time_t now = time(nullptr);
+	time_t now = Clock::coarseSeconds();
 
 	{
-		std::lock_guard<std::mutex> lock(clients_mutex_);
+		std::lock_guard<ProfiledMutex> lock(clients_mutex_);
 		for (const auto &[fd, client] : clients_)
 		{
 			// More aggressive detection of CLOSE_WAIT state
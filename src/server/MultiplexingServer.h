@@ -1,8 +1,22 @@
 #pragma once
 
+#include <common/Clock.h>
+#include <common/FlatHashMap.h>
+#include <common/Tracer.h>
+#include <server/FileTailer.h>
 #include <server/IServer.h>
+#include <server/LockProfiler.h>
+#include <server/LongPoll.h>
 #include <server/RequestHandler.h>
 #include <server/Metrics.h>
+#include <server/PerfCounters.h>
+#include <server/PluginHost.h>
+#include <server/PushHub.h>
+#include <server/RequestMirror.h>
+#include <server/ReverseProxy.h>
+#include <server/RxTimestamps.h>
+#include <server/ShmIngest.h>
+#include <server/UdpListener.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -13,7 +27,6 @@
 #include <thread>
 #include <atomic>
 #include <memory>
-#include <unordered_map>
 #include <mutex>
 #include <queue>
 #include <functional>
@@ -45,6 +58,9 @@ public:
 	void checkConnectionHealth();
 
 private:
+	// Request headers, keyed by lowercased name
+	using HeaderMap = FlatHashMap<std::string, std::string>;
+
 	struct ServerConfig
 	{
 		size_t max_read_buffer_size = 65536;
@@ -56,9 +72,12 @@ private:
 		bool enable_epollout_optimization = true;
 		size_t max_concurrent_connections = 10000;
 		int request_timeout = 10;
+		bool rx_timestamps = false; // kernel receive timestamps on client sockets
 	};
 
-	class ClientConnection
+	class ClientConnection : public PushSubscriber,
+							 public ProxyDownstream,
+							 public std::enable_shared_from_this<ClientConnection>
 	{
 	public:
 		ClientConnection(int fd, const std::string &client_addr, RequestHandler *request_handler,
@@ -76,34 +95,70 @@ private:
 		time_t getLastActivity() const { return last_activity_; }
 		bool hasDataToSend() const
 		{
-			std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(write_mutex_));
+			std::lock_guard<ProfiledMutex> lock(write_mutex_);
 			return !write_buffer_.empty();
 		}
 		void reset(int fd, const std::string &client_addr, RequestHandler *request_handler);
 
+		// PushSubscriber, for a connection streaming /numbers/subscribe
+		bool push(uint64_t subscription, const std::shared_ptr<const std::string> &event) override;
+		bool subscribed(uint64_t subscription) const override
+		{
+			return active_ && subscription_ == subscription;
+		}
+
+		// ProxyDownstream, for forwarded responses with large bodies
+		bool relayResponse(std::string_view head, int upstream_fd, size_t body_bytes) override;
+
 	private:
 		void processRequests();
+		// Forwarding routes first, then plugin routes, then this server's own endpoints
+		std::string dispatchRequest(const std::string &request, const std::string &method,
+									const std::string &path, const std::string &body,
+									const HeaderMap &headers);
 		std::string handleHttpRequest(const std::string &method,
 									  const std::string &path,
-									  const std::string &body);
+									  const std::string &body,
+									  const HeaderMap &headers);
+		std::string handleSubscribeRequest(std::string_view query);
+		// Answers request on the event loop if a plugin route of the reactor class takes it
+		bool handleReactorPlugin(const std::string &request);
+		std::string handlePluginRequest(const PluginHost::Handler &handler, const service_request &request);
+		// GET /numbers/sum[/{client_id}] with ETag, If-None-Match and ?wait=ms
+		std::string handleSumRequest(std::string_view client_id, std::string_view query,
+									 const HeaderMap &headers, codec::Format format);
+		std::string sumETag(std::string_view client_id);
+		std::string sumResponse(std::string_view client_id, const std::string &etag, codec::Format format);
+		std::string notModifiedResponse(const std::string &etag);
+		// Hands a sampled exchange to the shadow mirror
+		void mirrorRequest(const std::string &method, const std::string &path, const std::string &body,
+						   const HeaderMap &headers, std::string_view response, double latency_ms);
+		std::string handleProcessRequest(const std::string &path,
+										 const std::string &body,
+										 const HeaderMap &headers);
 		bool parseHttpRequest(const std::string &data, std::string &method,
 							  std::string &path, std::string &body,
-							  std::unordered_map<std::string, std::string> &headers);
+							  HeaderMap &headers);
 		bool parseHttpRequestOptimized(std::string_view data, std::string &method,
 									   std::string &path, std::string &body,
-									   std::unordered_map<std::string, std::string> &headers);
-		std::string createHttpResponse(const std::string &content,
-									   const std::string &content_type = "application/json",
-									   int status_code = 200);
+									   HeaderMap &headers);
+		std::string createHttpResponse(std::string_view content,
+									   std::string_view content_type = "application/json",
+									   int status_code = 200,
+									   std::string_view extra_headers = {});
 		void enableWriteNotifications();
 		void disableWriteNotifications();
 
 		int fd_;
 		std::string client_addr_;
 		std::string read_buffer_;
-		mutable std::mutex write_mutex_; // Made mutable for const methods
+		Clock::Ticks read_arrival_ = 0; // kernel arrival of the last segment of read_buffer_'s first read, 0 = unknown
+		mutable ProfiledMutex write_mutex_{"ClientConnection::write_mutex_"}; // Made mutable for const methods
 		std::string write_buffer_;
 		std::atomic<bool> active_{true};
+		bool relaying_ = false; // a worker is writing a forwarded response to fd_; guarded by write_mutex_
+		std::atomic<uint64_t> subscription_{0}; // PushHub stream id, 0 for plain HTTP
+		std::atomic<uint64_t> generation_{0};	// bumped on reuse, so parked requests find their connection gone
 		time_t last_activity_;
 		time_t connection_start_time_;
 		RequestHandler *request_handler_;
@@ -116,7 +171,7 @@ private:
 	{
 	private:
 		std::vector<std::shared_ptr<ClientConnection>> pool_; // Changed to shared_ptr
-		std::mutex pool_mutex_;
+		ProfiledMutex pool_mutex_{"ConnectionPool::pool_mutex_"};
 		const ServerConfig &config_;
 		MultiplexingServer *server_;
 
@@ -126,7 +181,7 @@ private:
 
 		std::shared_ptr<ClientConnection> acquire(int fd, const std::string &addr, RequestHandler *handler)
 		{
-			std::lock_guard<std::mutex> lock(pool_mutex_);
+			std::lock_guard<ProfiledMutex> lock(pool_mutex_);
 			if (!pool_.empty())
 			{
 				auto conn = pool_.back();
@@ -139,7 +194,7 @@ private:
 
 		void release(std::shared_ptr<ClientConnection> conn)
 		{
-			std::lock_guard<std::mutex> lock(pool_mutex_);
+			std::lock_guard<ProfiledMutex> lock(pool_mutex_);
 			if (pool_.size() < 100)
 			{ // Limit pool size
 				pool_.push_back(std::move(conn));
@@ -158,6 +213,9 @@ private:
 	void modifyEpoll(int fd, uint32_t events);
 	void removeFromEpoll(int fd);
 	void cleanupInactiveClients();
+	void drainTailedFiles();
+	void tickPushHub();
+	void resumeLongPolls();
 	void enableClientWrite(int client_fd);
 	void disableClientWrite(int client_fd);
 
@@ -175,11 +233,21 @@ private:
 	int server_fd_;
 	int epoll_fd_;
 	std::unique_ptr<RequestHandler> request_handler_;
+	std::unique_ptr<UdpListener> udp_listener_; // when server.udp_port is set
+	std::unique_ptr<ShmIngest> shm_ingest_;		// when server.shm_socket is set
+	std::unique_ptr<FileTailer> file_tailer_;	// when server.tail_directory is set
+	size_t tail_max_queue_ = 0;					// pool backlog at which tailing pauses
+	std::unique_ptr<PushHub> push_hub_;			// unless server.push_interval_ms is 0
+	int push_timer_fd_ = -1;					// fires push_hub_->tick()
+	std::unique_ptr<LongPollQueue> long_polls_;
+	std::unique_ptr<RequestMirror> mirror_; // when mirror.port is set
+	std::unique_ptr<ReverseProxy> proxy_;	// when proxy.routes is set
+	std::unique_ptr<PluginHost> plugins_;	// when plugins.directory is set
 	std::thread server_thread_;
 
 	// Client management
-	std::unordered_map<int, std::shared_ptr<ClientConnection>> clients_;
-	std::mutex clients_mutex_;
+	FlatHashMap<int, std::shared_ptr<ClientConnection>> clients_;
+	ProfiledMutex clients_mutex_{"MultiplexingServer::clients_mutex_"};
 	std::unique_ptr<ConnectionPool> connection_pool_;
 
 	class ThreadPool
@@ -187,8 +255,8 @@ private:
 	private:
 		std::vector<std::thread> workers_;
 		std::queue<std::function<void()>> tasks_;
-		mutable std::mutex queue_mutex_;
-		std::condition_variable condition_;
+		mutable ProfiledMutex queue_mutex_{"ThreadPool::queue_mutex_"};
+		ProfiledConditionVariable condition_;
 		std::atomic<bool> stop_{false};
 
 	public:
@@ -200,7 +268,7 @@ private:
 
 		size_t getQueueSize() const
 		{
-			std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(queue_mutex_));
+			std::lock_guard<ProfiledMutex> lock(queue_mutex_);
 			return tasks_.size();
 		}
 	};
@@ -216,7 +284,7 @@ template <class F>
 void MultiplexingServer::ThreadPool::enqueue(F &&task)
 {
 	{
-		std::lock_guard<std::mutex> lock(queue_mutex_);
+		std::lock_guard<ProfiledMutex> lock(queue_mutex_);
 		tasks_.emplace(std::forward<F>(task));
 	}
 	condition_.notify_one();
@@ -0,0 +1,214 @@
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <logging/Logger.h>
+#include <server/PerfCounters.h>
+
+namespace
+{
+	constexpr std::array<uint64_t, 4> EVENTS = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+												PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+	struct StageTotals
+	{
+		std::atomic<uint64_t> samples{0};
+		std::array<std::atomic<uint64_t>, EVENTS.size()> values{};
+	};
+
+	std::array<StageTotals, PerfCounters::STAGES> stage_totals;
+
+	int openCounter(uint64_t event, int group_fd)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = event;
+		attr.disabled = group_fd == -1; // the group starts once complete
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+	}
+
+	// One group per thread, closed when the thread exits
+	struct ThreadGroup
+	{
+		std::array<int, EVENTS.size()> fds;
+		bool opened = false;
+		bool failed = false;
+
+		ThreadGroup() { fds.fill(-1); }
+
+		~ThreadGroup()
+		{
+			for (int fd : fds)
+			{
+				if (fd >= 0)
+					close(fd);
+			}
+		}
+
+		bool open()
+		{
+			for (size_t i = 0; i < EVENTS.size(); ++i)
+			{
+				fds[i] = openCounter(EVENTS[i], i == 0 ? -1 : fds[0]);
+				if (fds[i] < 0)
+				{
+					failed = true;
+					return false;
+				}
+			}
+			ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			opened = true;
+			return true;
+		}
+	};
+
+	ThreadGroup &threadGroup()
+	{
+		thread_local ThreadGroup group;
+		return group;
+	}
+}
+
+bool PerfCounters::enable()
+{
+	ThreadGroup &group = threadGroup();
+	if (!group.opened && (group.failed || !group.open()))
+	{
+		Logger::warn("Hardware counters unavailable ({}), server.perf_counters has no effect", strerror(errno));
+		return false;
+	}
+	enabled_.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+bool PerfCounters::read(std::array<uint64_t, 4> &values)
+{
+	ThreadGroup &group = threadGroup();
+	if (!group.opened && (group.failed || !group.open()))
+	{
+		return false;
+	}
+
+	struct
+	{
+		uint64_t nr;
+		uint64_t time_enabled;
+		uint64_t time_running;
+		uint64_t values[EVENTS.size()];
+	} data;
+	if (::read(group.fds[0], &data, sizeof(data)) != sizeof(data) || data.time_running == 0)
+	{
+		return false;
+	}
+	// Extrapolated when the PMU was shared with other groups part of the time
+	const double scale = static_cast<double>(data.time_enabled) / static_cast<double>(data.time_running);
+	for (size_t i = 0; i < EVENTS.size(); ++i)
+	{
+		values[i] = data.time_enabled == data.time_running
+						? data.values[i]
+						: static_cast<uint64_t>(static_cast<double>(data.values[i]) * scale);
+	}
+	return true;
+}
+
+void PerfCounters::Scope::finish()
+{
+	std::array<uint64_t, 4> end;
+	if (!read(end))
+	{
+		return;
+	}
+	StageTotals &totals = stage_totals[static_cast<size_t>(stage_)];
+	totals.samples.fetch_add(1, std::memory_order_relaxed);
+	for (size_t i = 0; i < EVENTS.size(); ++i)
+	{
+		// Scaling can make a later reading smaller
+		if (end[i] > start_[i])
+			totals.values[i].fetch_add(end[i] - start_[i], std::memory_order_relaxed);
+	}
+}
+
+PerfCounters::Totals PerfCounters::totals(Stage stage)
+{
+	const StageTotals &stage_total = stage_totals[static_cast<size_t>(stage)];
+	Totals result;
+	result.samples = stage_total.samples.load(std::memory_order_relaxed);
+	result.cycles = stage_total.values[0].load(std::memory_order_relaxed);
+	result.instructions = stage_total.values[1].load(std::memory_order_relaxed);
+	result.llc_misses = stage_total.values[2].load(std::memory_order_relaxed);
+	result.branch_misses = stage_total.values[3].load(std::memory_order_relaxed);
+	return result;
+}
+
+std::string PerfCounters::prometheusMetrics()
+{
+	if (!enabled())
+	{
+		return "";
+	}
+
+	std::array<Totals, STAGES> all;
+	for (size_t i = 0; i < STAGES; ++i)
+	{
+		all[i] = totals(static_cast<Stage>(i));
+	}
+	auto ratio = [](uint64_t numerator, uint64_t denominator, double factor)
+	{ return denominator > 0 ? factor * static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0; };
+
+	std::stringstream ss;
+	auto series = [&](std::string_view name, std::string_view type, std::string_view help, auto value)
+	{
+		ss << "# HELP cpp_service_stage_" << name << " " << help << "\n";
+		ss << "# TYPE cpp_service_stage_" << name << " " << type << "\n";
+		for (size_t i = 0; i < STAGES; ++i)
+		{
+			ss << "cpp_service_stage_" << name << "{stage=\"" << STAGE_NAMES[i] << "\"} " << value(all[i]) << "\n";
+		}
+		ss << "\n";
+	};
+	series("samples_total", "counter", "Stage executions measured with hardware counters",
+		   [](const Totals &t)
+		   { return t.samples; });
+	series("cycles_total", "counter", "User-space CPU cycles spent in the stage",
+		   [](const Totals &t)
+		   { return t.cycles; });
+	series("instructions_total", "counter", "User-space instructions retired in the stage",
+		   [](const Totals &t)
+		   { return t.instructions; });
+	series("llc_misses_total", "counter", "Last-level cache misses in the stage",
+		   [](const Totals &t)
+		   { return t.llc_misses; });
+	series("branch_misses_total", "counter", "Mispredicted branches in the stage",
+		   [](const Totals &t)
+		   { return t.branch_misses; });
+	series("ipc", "gauge", "Instructions per cycle since start",
+		   [&](const Totals &t)
+		   { return ratio(t.instructions, t.cycles, 1.0); });
+	series("llc_mpki", "gauge", "Last-level cache misses per thousand instructions since start",
+		   [&](const Totals &t)
+		   { return ratio(t.llc_misses, t.instructions, 1000.0); });
+	series("branch_mpki", "gauge", "Branch misses per thousand instructions since start",
+		   [&](const Totals &t)
+		   { return ratio(t.branch_misses, t.instructions, 1000.0); });
+	return ss.str();
+}
+
+void PerfCounters::reset()
+{
+	for (auto &stage : stage_totals)
+	{
+		stage.samples.store(0, std::memory_order_relaxed);
+		for (auto &value : stage.values)
+			value.store(0, std::memory_order_relaxed);
+	}
+}
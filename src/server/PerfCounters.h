@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Hardware counters per request stage, to tell whether a stage is bound by
+// branch mispredictions or cache misses rather than only how long it takes.
+// Every thread that enters a Scope opens its own perf_event_open() group
+// counting user-space cycles, instructions, last-level cache misses and
+// branch misses, and reads all four with one read() when a Scope begins and
+// ends; the differences are summed per stage. /metrics then shows per-stage
+// IPC and misses per thousand instructions. Off unless
+// server.perf_counters is set; when the kernel refuses the counters (see
+// /proc/sys/kernel/perf_event_paranoid) or the machine has no PMU, enable()
+// fails and every Scope stays a no-op.
+class PerfCounters
+{
+public:
+	enum class Stage : uint8_t
+	{
+		Frame,	// finding request boundaries on the event loop
+		Parse,	// request line, headers and body
+		Handle, // routing and the handler
+		Write,	// queueing or sending the response
+	};
+
+	static constexpr size_t STAGES = 4;
+	static constexpr std::array<std::string_view, STAGES> STAGE_NAMES = {"frame", "parse", "handle", "write"};
+
+	struct Totals
+	{
+		uint64_t samples = 0;
+		uint64_t cycles = 0;
+		uint64_t instructions = 0;
+		uint64_t llc_misses = 0;
+		uint64_t branch_misses = 0;
+	};
+
+	// Opens counters on the calling thread to see whether the kernel allows
+	// them; false, and nothing is ever counted, if it does not
+	static bool enable();
+	static void disable() { enabled_.store(false, std::memory_order_relaxed); }
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+	// Counts what the current thread does from construction to destruction
+	class Scope
+	{
+	public:
+		explicit Scope(Stage stage) : stage_(stage), active_(enabled() && read(start_)) {}
+		~Scope()
+		{
+			if (active_)
+				finish();
+		}
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+
+	private:
+		void finish();
+
+		Stage stage_;
+		std::array<uint64_t, 4> start_;
+		bool active_;
+	};
+
+	static Totals totals(Stage stage);
+	// Per-stage counters and ratios; empty unless enabled
+	static std::string prometheusMetrics();
+	static void reset();
+
+private:
+	// Scaled values of the calling thread's group; opens it on first use
+	static bool read(std::array<uint64_t, 4> &values);
+
+	inline static std::atomic<bool> enabled_{false};
+};
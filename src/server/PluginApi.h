@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+ * C ABI between the server and handler plugins (see PluginHost.h). A
+ * plugin is a shared object exporting service_plugin_entry(), which returns
+ * a static description of the plugin: its routes, each with the execution
+ * class it needs, and optional create/destroy hooks for plugin state.
+ *
+ * Handlers get a read-only view of the request pointing into the server's
+ * buffers, valid only for the call, and write the response body into a
+ * buffer the server provides. When it is too small a handler sets
+ * response->size to the bytes it needs and returns SERVICE_PLUGIN_NEED_SPACE;
+ * the server grows the buffer and calls it once more. Handlers run
+ * concurrently on several threads and must be thread-safe.
+ *
+ * Only C types cross this boundary, so plugins may be built with another
+ * compiler or standard library than the server. Bump
+ * SERVICE_PLUGIN_ABI_VERSION on any layout change.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SERVICE_PLUGIN_ABI_VERSION 1
+#define SERVICE_PLUGIN_ENTRY "service_plugin_entry"
+
+	typedef struct service_str
+	{
+		const char *data; /* not NUL-terminated */
+		size_t size;
+	} service_str;
+
+	typedef struct service_request
+	{
+		service_str method;
+		service_str path; /* without the query string */
+		service_str query; /* after '?', empty if none */
+		service_str body;
+		service_str content_type;
+		service_str accept;
+	} service_request;
+
+	typedef struct service_response
+	{
+		char *data;	  /* owned by the server */
+		size_t capacity;
+		size_t size;  /* bytes written, or needed with SERVICE_PLUGIN_NEED_SPACE */
+		int status;	  /* HTTP status, 200 unless set */
+		const char *content_type; /* static string, "application/json" unless set */
+	} service_response;
+
+	enum service_plugin_result
+	{
+		SERVICE_PLUGIN_OK = 0,
+		SERVICE_PLUGIN_NEED_SPACE = 1,
+		SERVICE_PLUGIN_ERROR = -1, /* answered with 500 */
+	};
+
+	typedef enum service_exec_class
+	{
+		/* Short and non-blocking: runs on the event loop, skipping the worker queue */
+		SERVICE_EXEC_REACTOR = 0,
+		/* May block or take long: runs on a worker thread */
+		SERVICE_EXEC_WORKER = 1,
+	} service_exec_class;
+
+	typedef int (*service_handler_fn)(void *state, const service_request *request, service_response *response);
+
+	typedef struct service_route
+	{
+		const char *method; /* "GET", "POST", ... */
+		const char *path;	/* exact, or a prefix when it ends in '*' */
+		service_exec_class exec_class;
+		service_handler_fn handle;
+	} service_route;
+
+	typedef struct service_plugin
+	{
+		uint32_t abi_version; /* SERVICE_PLUGIN_ABI_VERSION */
+		const char *name;
+		void *(*create)(void);		  /* optional; its result is passed to every handler */
+		void (*destroy)(void *state); /* optional; called after the last handler returned */
+		const service_route *routes;
+		size_t route_count;
+	} service_plugin;
+
+	typedef const service_plugin *(*service_plugin_entry_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
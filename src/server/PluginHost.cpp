@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <codec/Codec.h>
+#include <common/FlatHashMap.h>
+#include <logging/Logger.h>
+#include <server/Metrics.h>
+#include <server/PluginHost.h>
+
+namespace
+{
+	constexpr uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+	constexpr std::string_view SUFFIX = ".so";
+	// A larger per-thread output buffer is given back after the call that needed it
+	constexpr size_t RETAIN_OUTPUT_BYTES = 1024 * 1024;
+
+	std::atomic<uint64_t> live_modules{0};
+
+	bool pluginFile(std::string_view name)
+	{
+		return name.size() > SUFFIX.size() && name.ends_with(SUFFIX) && name.front() != '.';
+	}
+
+	// Served by the server itself, whatever the plugins register
+	bool reserved(std::string_view path)
+	{
+		return path == "/health" || path.starts_with("/metrics") || path.starts_with("/debug/");
+	}
+
+	int64_t mtimeNs(const struct stat &info)
+	{
+		return static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+	}
+}
+
+struct PluginHost::Module
+{
+	std::string file;
+	// Identity of the file it was loaded from, to tell whether a reload must replace it
+	dev_t device = 0;
+	ino_t inode = 0;
+	off_t size = 0;
+	int64_t mtime_ns = 0;
+
+	// Kept open while loaded: dlopen() matches "/proc/self/fd/N" by name, so
+	// the number must not be reused for another plugin meanwhile
+	int memfd = -1;
+	std::string image;
+	void *handle = nullptr;
+	const service_plugin *plugin = nullptr;
+	void *state = nullptr;
+	bool created = false;
+
+	bool sameFile(const struct stat &info) const
+	{
+		return device == info.st_dev && inode == info.st_ino && size == info.st_size && mtime_ns == mtimeNs(info);
+	}
+
+	~Module()
+	{
+		if (created)
+		{
+			Logger::info("Unloading plugin {} ({})", plugin->name, file);
+			if (plugin->destroy)
+			{
+				plugin->destroy(state);
+			}
+			live_modules.fetch_sub(1, std::memory_order_relaxed);
+		}
+		if (handle)
+		{
+			dlclose(handle);
+			// glibc keeps objects with STB_GNU_UNIQUE symbols mapped; their name
+			// must then stay unique for good
+			if (void *resident = dlopen(image.c_str(), RTLD_NOW | RTLD_NOLOAD))
+			{
+				dlclose(resident);
+				Logger::warn("Plugin {} stays mapped after unloading (build it with -fno-gnu-unique)", file);
+				memfd = -1;
+			}
+		}
+		if (memfd >= 0)
+		{
+			::close(memfd);
+		}
+	}
+};
+
+struct PluginHost::Table
+{
+	struct Route
+	{
+		std::string_view method; // static strings of the plugin
+		std::string_view path;
+		const Module *module;
+		const service_route *route;
+	};
+
+	std::vector<std::shared_ptr<Module>> modules;
+	FlatHashMap<std::string, std::vector<Route>> exact; // by path
+	std::vector<Route> prefixes;						 // longest first
+	size_t routes = 0;
+	bool reactor = false;
+};
+
+std::string_view PluginHost::Handler::plugin() const
+{
+	return module_->plugin->name;
+}
+
+std::optional<PluginHost::Response> PluginHost::Handler::invoke(const service_request &request) const
+{
+	thread_local std::string output;
+	if (output.size() > RETAIN_OUTPUT_BYTES)
+	{
+		output = std::string();
+	}
+	if (output.size() < INITIAL_OUTPUT_BYTES)
+	{
+		output.resize(INITIAL_OUTPUT_BYTES);
+	}
+
+	auto &metrics = Metrics::getInstance();
+	metrics.incrementPluginCalls();
+
+	// Once more after growing the buffer to the size the plugin asked for
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		service_response response{output.data(), output.size(), 0, 200, nullptr};
+		const int result = route_->handle(module_->state, &request, &response);
+		if (result == SERVICE_PLUGIN_OK && response.size <= output.size() &&
+			response.status >= 100 && response.status <= 599)
+		{
+			return Response{response.status,
+							response.content_type ? response.content_type : "application/json",
+							std::string_view(output.data(), response.size)};
+		}
+		if (result != SERVICE_PLUGIN_NEED_SPACE || response.size <= output.size() || response.size > MAX_OUTPUT_BYTES)
+		{
+			break;
+		}
+		output.resize(response.size);
+	}
+
+	metrics.incrementPluginErrors();
+	Logger::warn("Plugin {} failed on {} {}", plugin(), route_->method, route_->path);
+	return std::nullopt;
+}
+
+PluginHost::PluginHost()
+	: events_(16 * (sizeof(inotify_event) + NAME_MAX + 1))
+{
+}
+
+PluginHost::~PluginHost()
+{
+	if (inotify_fd_ >= 0)
+	{
+		::close(inotify_fd_);
+	}
+}
+
+bool PluginHost::open(const std::string &directory)
+{
+	inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd_ < 0)
+	{
+		Logger::error("Failed to create inotify instance: {}", strerror(errno));
+		return false;
+	}
+	if (inotify_add_watch(inotify_fd_, directory.c_str(), WATCH_EVENTS | IN_ONLYDIR) < 0)
+	{
+		Logger::error("Failed to watch {}: {}", directory, strerror(errno));
+		::close(inotify_fd_);
+		inotify_fd_ = -1;
+		return false;
+	}
+
+	directory_ = directory;
+	reload();
+	return true;
+}
+
+void PluginHost::handleEvents()
+{
+	bool changed = false;
+	for (;;)
+	{
+		ssize_t length = read(inotify_fd_, events_.data(), events_.size());
+		if (length <= 0)
+		{
+			break;
+		}
+		for (const char *cursor = events_.data(); cursor < events_.data() + length;)
+		{
+			const auto *event = reinterpret_cast<const inotify_event *>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+			changed = changed || (event->len > 0 && pluginFile(event->name)) || (event->mask & IN_Q_OVERFLOW);
+		}
+	}
+	if (changed)
+	{
+		reload();
+	}
+}
+
+size_t PluginHost::reload()
+{
+	std::lock_guard<ProfiledMutex> reload_lock(reload_mutex_);
+	auto &metrics = Metrics::getInstance();
+	const auto previous = table();
+
+	std::vector<std::string> names;
+	if (DIR *dir = opendir(directory_.c_str()))
+	{
+		while (const dirent *entry = readdir(dir))
+		{
+			if (pluginFile(entry->d_name))
+			{
+				names.emplace_back(entry->d_name);
+			}
+		}
+		closedir(dir);
+	}
+	else
+	{
+		Logger::error("Failed to read plugin directory {}: {}", directory_, strerror(errno));
+	}
+	std::sort(names.begin(), names.end());
+
+	auto next = std::make_shared<Table>();
+	for (const auto &name : names)
+	{
+		struct stat info;
+		if (stat((directory_ + "/" + name).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+		{
+			continue;
+		}
+
+		std::shared_ptr<Module> module;
+		if (previous)
+		{
+			for (const auto &loaded : previous->modules)
+			{
+				if (loaded->file == name && loaded->sameFile(info))
+				{
+					module = loaded;
+					break;
+				}
+			}
+		}
+		if (!module)
+		{
+			module = load(name);
+		}
+		if (!module)
+		{
+			metrics.incrementPluginLoadErrors();
+			continue;
+		}
+
+		for (size_t i = 0; i < module->plugin->route_count; ++i)
+		{
+			const service_route &route = module->plugin->routes[i];
+			std::string_view path = route.path;
+			const bool prefix = path.ends_with('*');
+			if (prefix)
+			{
+				path.remove_suffix(1);
+			}
+			Table::Route entry{route.method, path, module.get(), &route};
+
+			auto &candidates = prefix ? next->prefixes : next->exact[std::string(path)];
+			if (std::any_of(candidates.begin(), candidates.end(), [&](const Table::Route &other)
+							{ return other.method == entry.method && other.path == entry.path; }))
+			{
+				Logger::warn("Plugin {} route {} {} is already taken, ignoring it", module->plugin->name,
+							 route.method, route.path);
+				continue;
+			}
+			candidates.push_back(entry);
+			next->reactor = next->reactor || route.exec_class == SERVICE_EXEC_REACTOR;
+			next->routes++;
+		}
+		next->modules.push_back(std::move(module));
+	}
+	std::stable_sort(next->prefixes.begin(), next->prefixes.end(), [](const Table::Route &a, const Table::Route &b)
+					 { return a.path.size() > b.path.size(); });
+
+	const size_t loaded = next->modules.size();
+	Logger::info("{} plugin(s) with {} route(s) active from {}", loaded, next->routes, directory_);
+	reactor_routes_.store(next->reactor, std::memory_order_relaxed);
+	{
+		std::lock_guard<ProfiledMutex> lock(table_mutex_);
+		table_ = std::move(next);
+	}
+	metrics.incrementPluginReloads();
+	metrics.setPluginsLoaded(loaded);
+	// Replaced modules unload as the last Handler referring to previous goes
+	return loaded;
+}
+
+std::shared_ptr<PluginHost::Module> PluginHost::load(const std::string &name) const
+{
+	const std::string path = directory_ + "/" + name;
+	int source = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (source < 0)
+	{
+		Logger::error("Failed to open plugin {}: {}", path, strerror(errno));
+		return nullptr;
+	}
+
+	auto module = std::make_shared<Module>();
+	module->file = name;
+	struct stat info;
+	bool copied = fstat(source, &info) == 0;
+	if (copied)
+	{
+		module->device = info.st_dev;
+		module->inode = info.st_ino;
+		module->size = info.st_size;
+		module->mtime_ns = mtimeNs(info);
+		module->memfd = memfd_create(name.c_str(), MFD_CLOEXEC);
+		copied = module->memfd >= 0;
+	}
+	for (off_t offset = 0; copied && offset < info.st_size;)
+	{
+		ssize_t sent = sendfile(module->memfd, source, &offset, static_cast<size_t>(info.st_size - offset));
+		copied = sent > 0 || (sent < 0 && errno == EINTR);
+	}
+	::close(source);
+	if (!copied)
+	{
+		Logger::error("Failed to copy plugin {}: {}", path, strerror(errno));
+		return nullptr;
+	}
+
+	module->image = "/proc/self/fd/" + std::to_string(module->memfd);
+	module->handle = dlopen(module->image.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (!module->handle)
+	{
+		Logger::error("Failed to load plugin {}: {}", path, dlerror());
+		return nullptr;
+	}
+	auto entry = reinterpret_cast<service_plugin_entry_fn>(dlsym(module->handle, SERVICE_PLUGIN_ENTRY));
+	const service_plugin *plugin = entry ? entry() : nullptr;
+	if (!plugin || plugin->abi_version != SERVICE_PLUGIN_ABI_VERSION || !plugin->name ||
+		(plugin->route_count > 0 && !plugin->routes))
+	{
+		Logger::error("Plugin {} does not export a version {} {}", path, SERVICE_PLUGIN_ABI_VERSION, SERVICE_PLUGIN_ENTRY);
+		return nullptr;
+	}
+	for (size_t i = 0; i < plugin->route_count; ++i)
+	{
+		const service_route &route = plugin->routes[i];
+		if (!route.method || !route.path || route.path[0] != '/' || !route.handle ||
+			(route.exec_class != SERVICE_EXEC_REACTOR && route.exec_class != SERVICE_EXEC_WORKER))
+		{
+			Logger::error("Plugin {} has an invalid route at index {}", path, i);
+			return nullptr;
+		}
+	}
+
+	module->plugin = plugin;
+	module->state = plugin->create ? plugin->create() : nullptr;
+	module->created = true;
+	live_modules.fetch_add(1, std::memory_order_relaxed);
+	Logger::info("Loaded plugin {} ({}) with {} route(s)", plugin->name, name, plugin->route_count);
+	return module;
+}
+
+std::shared_ptr<const PluginHost::Table> PluginHost::table() const
+{
+	std::lock_guard<ProfiledMutex> lock(table_mutex_);
+	return table_;
+}
+
+PluginHost::Handler PluginHost::find(std::string_view method, std::string_view path) const
+{
+	Handler handler;
+	if (reserved(path))
+	{
+		return handler;
+	}
+	auto table = this->table();
+	if (!table)
+	{
+		return handler;
+	}
+
+	const Table::Route *match = nullptr;
+	if (auto it = table->exact.find(path); it != table->exact.end())
+	{
+		for (const auto &route : it->second)
+		{
+			if (route.method == method)
+			{
+				match = &route;
+				break;
+			}
+		}
+	}
+	for (size_t i = 0; !match && i < table->prefixes.size(); ++i)
+	{
+		const auto &route = table->prefixes[i];
+		if (route.method == method && path.starts_with(route.path))
+		{
+			match = &route;
+		}
+	}
+	if (match)
+	{
+		handler.module_ = match->module;
+		handler.route_ = match->route;
+		handler.table_ = std::move(table);
+	}
+	return handler;
+}
+
+std::string PluginHost::describeJson() const
+{
+	const auto table = this->table();
+	const size_t count = table ? table->modules.size() : 0;
+	return codec::encode(codec::Format::Json, [&](auto &writer)
+						 {
+		writer.startObject(3);
+		writer.key("directory");
+		writer.value(directory_);
+		writer.key("live_modules");
+		writer.value(liveModules());
+		writer.key("plugins");
+		writer.startArray(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Module &module = *table->modules[i];
+			writer.startObject(3);
+			writer.key("name");
+			writer.value(module.plugin->name);
+			writer.key("file");
+			writer.value(module.file);
+			writer.key("routes");
+			writer.startArray(module.plugin->route_count);
+			for (size_t r = 0; r < module.plugin->route_count; ++r)
+			{
+				const service_route &route = module.plugin->routes[r];
+				writer.startObject(3);
+				writer.key("method");
+				writer.value(route.method);
+				writer.key("path");
+				writer.value(route.path);
+				writer.key("exec_class");
+				writer.value(route.exec_class == SERVICE_EXEC_REACTOR ? "reactor" : "worker");
+				writer.endObject();
+			}
+			writer.endArray();
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.endObject(); });
+}
+
+service_request PluginHost::makeRequest(std::string_view method, std::string_view target, std::string_view body,
+										std::string_view content_type, std::string_view accept)
+{
+	std::string_view path = target;
+	std::string_view query;
+	if (size_t question = target.find('?'); question != std::string_view::npos)
+	{
+		path = target.substr(0, question);
+		query = target.substr(question + 1);
+	}
+	auto view = [](std::string_view s)
+	{ return service_str{s.data(), s.size()}; };
+	return service_request{view(method), view(path), view(query), view(body), view(content_type), view(accept)};
+}
+
+uint64_t PluginHost::liveModules()
+{
+	return live_modules.load(std::memory_order_relaxed);
+}
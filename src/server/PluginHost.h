@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <server/LockProfiler.h>
+#include <server/PluginApi.h>
+
+// Handler plugins loaded at runtime from a directory (plugins.directory),
+// so endpoints can ship without rebuilding the server. Every *.so file there
+// is copied into a memfd and dlopen()ed from it: the file on disk can be
+// overwritten in place without corrupting mapped code, and a reload always
+// maps the new contents. The routes of all plugins form one immutable
+// table; find() returns a Handler that keeps the table it came from alive.
+// reload(), run on an inotify event or POST /debug/plugins/reload, swaps in
+// a new table. A plugin whose file changed or disappeared is destroyed and
+// unloaded when the last Handler of the old table is released, i.e. once its
+// in-flight calls drained; unchanged plugins carry over with their state.
+// Routes of plugins loaded earlier (in file name order) win on conflicts.
+// Plugin routes are matched before the built-in endpoints, so they can
+// override them, except /health, /metrics* and /debug/.
+class PluginHost
+{
+	struct Module;
+	struct Table;
+
+public:
+	struct Response
+	{
+		int status = 200;
+		std::string_view content_type;
+		std::string_view body; // per-thread buffer, valid until the next call on this thread
+	};
+
+	static constexpr size_t INITIAL_OUTPUT_BYTES = 16 * 1024;
+	static constexpr size_t MAX_OUTPUT_BYTES = 64 * 1024 * 1024;
+
+	class Handler
+	{
+	public:
+		Handler() = default;
+
+		explicit operator bool() const { return route_ != nullptr; }
+		service_exec_class execClass() const { return route_->exec_class; }
+		std::string_view plugin() const;
+
+		// Runs the route; nullopt if the plugin failed or wanted more than
+		// MAX_OUTPUT_BYTES
+		std::optional<Response> invoke(const service_request &request) const;
+
+	private:
+		friend class PluginHost;
+
+		std::shared_ptr<const Table> table_;
+		const Module *module_ = nullptr;
+		const service_route *route_ = nullptr;
+	};
+
+	PluginHost();
+	~PluginHost();
+
+	PluginHost(const PluginHost &) = delete;
+	PluginHost &operator=(const PluginHost &) = delete;
+
+	// Loads the plugins in directory and watches it for changes
+	bool open(const std::string &directory);
+	int fd() const { return inotify_fd_; }
+	// Reads the inotify events queued so far and reloads if a plugin changed
+	void handleEvents();
+	// Rescans the directory; returns the number of plugins loaded
+	size_t reload();
+
+	Handler find(std::string_view method, std::string_view path) const;
+	// Whether some route runs on the event loop, so the reactor must look
+	// requests up before queueing them
+	bool hasReactorRoutes() const { return reactor_routes_.load(std::memory_order_relaxed); }
+	// Plugins and their routes, for GET /debug/plugins
+	std::string describeJson() const;
+
+	// Request view over target ("/path?query") and the other fields
+	static service_request makeRequest(std::string_view method, std::string_view target, std::string_view body,
+									   std::string_view content_type, std::string_view accept);
+	// Plugins loaded and not yet unloaded, over all hosts
+	static uint64_t liveModules();
+
+private:
+	std::shared_ptr<const Table> table() const;
+	std::shared_ptr<Module> load(const std::string &name) const;
+
+	int inotify_fd_ = -1;
+	std::string directory_;
+	std::vector<char> events_;
+	mutable ProfiledMutex table_mutex_{"PluginHost::table_mutex_"};
+	std::shared_ptr<const Table> table_;
+	ProfiledMutex reload_mutex_{"PluginHost::reload_mutex_"};
+	std::atomic<bool> reactor_routes_{false};
+};
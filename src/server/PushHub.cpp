@@ -0,0 +1,243 @@
+#include <algorithm>
+
+#include <codec/Codec.h>
+#include <server/ClientAggregates.h>
+#include <server/Metrics.h>
+#include <server/PushHub.h>
+#include <server/RequestHandler.h>
+
+PushHub::PushHub(RequestHandler &handler)
+	: handler_(handler), last_heartbeat_ms_(Clock::coarseMillis())
+{
+}
+
+std::optional<PushHub::Topics> PushHub::parseTopics(std::string_view query)
+{
+	Topics topics;
+	while (!query.empty())
+	{
+		size_t amp = query.find('&');
+		std::string_view pair = query.substr(0, amp);
+		query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+		size_t eq = pair.find('=');
+		std::string_view name = pair.substr(0, eq);
+		std::string_view value = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+		if (name == "total")
+		{
+			topics.total = value != "0" && value != "false";
+		}
+		else if (name == "clients")
+		{
+			while (!value.empty())
+			{
+				size_t comma = value.find(',');
+				auto id = ClientAggregates::parseClientId(value.substr(0, comma));
+				if (!id || topics.clients.size() == MAX_CLIENTS)
+				{
+					return std::nullopt;
+				}
+				topics.clients.push_back(*id);
+				value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+			}
+		}
+	}
+
+	std::sort(topics.clients.begin(), topics.clients.end());
+	topics.clients.erase(std::unique(topics.clients.begin(), topics.clients.end()), topics.clients.end());
+	if (!topics.total && topics.clients.empty())
+	{
+		return std::nullopt;
+	}
+	return topics;
+}
+
+const std::string &PushHub::streamHeader()
+{
+	static const std::string header = "HTTP/1.1 200 OK\r\n"
+									  "Content-Type: text/event-stream\r\n"
+									  "Cache-Control: no-cache\r\n"
+									  "Connection: keep-alive\r\n"
+									  "Access-Control-Allow-Origin: *\r\n"
+									  "\r\n";
+	return header;
+}
+
+std::shared_ptr<const std::string> PushHub::totalEvent(long long total)
+{
+	std::string data = codec::encode(codec::Format::Json, [&](auto &writer)
+									 {
+		writer.startObject(1);
+		writer.key("total_numbers_sum");
+		writer.value(total);
+		writer.endObject(); });
+	return std::make_shared<const std::string>("event: total\ndata: " + data + "\n\n");
+}
+
+std::shared_ptr<const std::string> PushHub::clientEvent(int32_t id, long long sum)
+{
+	std::string data = codec::encode(codec::Format::Json, [&](auto &writer)
+									 {
+		writer.startObject(2);
+		writer.key("client_id");
+		writer.value(ClientAggregates::clientKey(id));
+		writer.key("numbers_sum");
+		writer.value(sum);
+		writer.endObject(); });
+	return std::make_shared<const std::string>("event: client\ndata: " + data + "\n\n");
+}
+
+void PushHub::subscribe(std::weak_ptr<PushSubscriber> subscriber, uint64_t subscription, const Topics &topics,
+						const std::string &header)
+{
+	auto target = subscriber.lock();
+	if (!target)
+	{
+		return;
+	}
+
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	// Topics already watched start from the value last sent, so this
+	// subscriber and the others see the same sequence from here on
+	std::string initial = header;
+	if (topics.total)
+	{
+		if (total_.subscribers.empty())
+		{
+			total_.last = handler_.getTotalNumbersSum();
+		}
+		initial += *totalEvent(total_.last);
+		total_.subscribers.push_back({subscriber, subscription});
+	}
+
+	ids_.clear();
+	for (int32_t id : topics.clients)
+	{
+		if (!clients_.contains(id))
+		{
+			ids_.push_back(id);
+		}
+	}
+	handler_.getClientSums(ids_, sums_);
+	for (size_t i = 0; i < ids_.size(); ++i)
+	{
+		clients_.try_emplace(*ids_[i]).first->second.last = sums_[i];
+	}
+	for (int32_t id : topics.clients)
+	{
+		Topic &topic = clients_.find(id)->second;
+		initial += *clientEvent(id, topic.last);
+		topic.subscribers.push_back({subscriber, subscription});
+	}
+
+	all_.push_back({subscriber, subscription});
+	target->push(subscription, std::make_shared<const std::string>(std::move(initial)));
+	Metrics::getInstance().setPushSubscribers(all_.size());
+}
+
+void PushHub::tick()
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	const Counters before = counters_;
+	prune();
+
+	if (!total_.subscribers.empty())
+	{
+		const long long total = handler_.getTotalNumbersSum();
+		if (total != total_.last)
+		{
+			total_.last = total;
+			broadcast(total_.subscribers, totalEvent(total));
+		}
+	}
+
+	if (!clients_.empty())
+	{
+		// One lock on the aggregates for every watched client
+		ids_.clear();
+		for (const auto &[id, topic] : clients_)
+		{
+			ids_.push_back(id);
+		}
+		handler_.getClientSums(ids_, sums_);
+		for (size_t i = 0; i < ids_.size(); ++i)
+		{
+			Topic &topic = clients_.find(*ids_[i])->second;
+			if (sums_[i] != topic.last)
+			{
+				topic.last = sums_[i];
+				broadcast(topic.subscribers, clientEvent(*ids_[i], sums_[i]));
+			}
+		}
+	}
+
+	// Runs on the reactor, whose iteration has just updated the coarse clock
+	const uint64_t now_ms = Clock::coarseMillis();
+	if (now_ms - last_heartbeat_ms_ >= static_cast<uint64_t>(std::chrono::milliseconds(HEARTBEAT).count()))
+	{
+		last_heartbeat_ms_ = now_ms;
+		static const auto heartbeat = std::make_shared<const std::string>(": heartbeat\n\n");
+		for (auto &subscriber : all_)
+		{
+			if (auto target = subscriber.target.lock())
+				target->push(subscriber.subscription, heartbeat);
+		}
+	}
+
+	auto &metrics = Metrics::getInstance();
+	metrics.addPushEvents(counters_.events - before.events, counters_.deliveries - before.deliveries,
+						  counters_.dropped - before.dropped);
+	metrics.setPushSubscribers(all_.size());
+}
+
+void PushHub::broadcast(std::vector<Subscriber> &subscribers, const std::shared_ptr<const std::string> &event)
+{
+	counters_.events++;
+	for (auto &subscriber : subscribers)
+	{
+		auto target = subscriber.target.lock();
+		if (target && target->push(subscriber.subscription, event))
+		{
+			counters_.deliveries++;
+		}
+		else if (target)
+		{
+			counters_.dropped++;
+		}
+	}
+}
+
+void PushHub::prune()
+{
+	auto gone = [](const Subscriber &subscriber)
+	{
+		auto target = subscriber.target.lock();
+		return !target || !target->subscribed(subscriber.subscription);
+	};
+
+	std::erase_if(all_, gone);
+	std::erase_if(total_.subscribers, gone);
+	std::vector<int32_t> unwatched;
+	for (auto &[id, topic] : clients_)
+	{
+		std::erase_if(topic.subscribers, gone);
+		if (topic.subscribers.empty())
+			unwatched.push_back(id);
+	}
+	for (int32_t id : unwatched)
+	{
+		clients_.erase(id);
+	}
+}
+
+size_t PushHub::subscribers() const
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	return all_.size();
+}
+
+PushHub::Counters PushHub::counters() const
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	return counters_;
+}
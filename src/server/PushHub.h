@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <common/Clock.h>
+#include <common/FlatHashMap.h>
+#include <server/LockProfiler.h>
+
+class RequestHandler;
+
+// Receiving end of a push stream, e.g. an HTTP connection in SSE mode. A
+// subscriber may be reused for another stream, so calls carry the id the
+// hub gave the subscription.
+class PushSubscriber
+{
+public:
+	virtual ~PushSubscriber() = default;
+
+	// Queues event without copying it; false if the stream is gone or too
+	// far behind, after which the hub forgets it
+	virtual bool push(uint64_t subscription, const std::shared_ptr<const std::string> &event) = 0;
+	virtual bool subscribed(uint64_t subscription) const = 0;
+};
+
+// Change notifications for /numbers/subscribe as Server-Sent Events. Topics
+// are the global total and individual client ids. Instead of hooking the
+// request path, tick() samples every subscribed topic once per interval
+// (one atomic load and one locked multi-get for the client ids) and
+// compares it with the value last sent, so any number of updates in between
+// collapse into one event carrying the latest value and no topic sends more
+// than one event per tick. Each event is encoded once and the same buffer
+// is queued on every subscriber of its topic. Idle streams get a comment
+// line every HEARTBEAT so proxies and the idle-connection reaper keep them.
+// Thread-safe: subscriptions come from worker threads, ticks from the
+// reactor.
+class PushHub
+{
+public:
+	struct Topics
+	{
+		bool total = false;
+		std::vector<int32_t> clients;
+	};
+
+	struct Counters
+	{
+		uint64_t events = 0;	 // encoded
+		uint64_t deliveries = 0; // events queued on subscribers
+		uint64_t dropped = 0;	 // subscribers that fell too far behind
+	};
+
+	static constexpr size_t MAX_CLIENTS = 1000; // per subscription
+	static constexpr std::chrono::seconds HEARTBEAT{15};
+
+	explicit PushHub(RequestHandler &handler);
+
+	// "total=1" and/or "clients=user_1,user_2"; nullopt if neither, or a
+	// client id does not parse
+	static std::optional<Topics> parseTopics(std::string_view query);
+	// HTTP/1.1 response head that opens an SSE stream
+	static const std::string &streamHeader();
+
+	uint64_t nextSubscriptionId() { return next_id_++; }
+	// Pushes header followed by the current value of every topic, then
+	// registers the subscriber for later changes
+	void subscribe(std::weak_ptr<PushSubscriber> subscriber, uint64_t subscription, const Topics &topics,
+				   const std::string &header);
+	// Sends what changed since the last tick
+	void tick();
+
+	size_t subscribers() const;
+	Counters counters() const;
+
+private:
+	struct Subscriber
+	{
+		std::weak_ptr<PushSubscriber> target;
+		uint64_t subscription;
+	};
+
+	struct Topic
+	{
+		long long last = 0;
+		std::vector<Subscriber> subscribers;
+	};
+
+	static std::shared_ptr<const std::string> totalEvent(long long total);
+	static std::shared_ptr<const std::string> clientEvent(int32_t id, long long sum);
+	void broadcast(std::vector<Subscriber> &subscribers, const std::shared_ptr<const std::string> &event);
+	void prune();
+
+	RequestHandler &handler_;
+	mutable ProfiledMutex mutex_{"PushHub::mutex_"};
+	Topic total_;
+	FlatHashMap<int32_t, Topic> clients_;
+	std::vector<Subscriber> all_; // one entry per subscription, for heartbeats
+	uint64_t last_heartbeat_ms_; // Clock::coarseMillis()
+	std::vector<std::optional<int32_t>> ids_; // scratch space of tick()
+	std::vector<long long> sums_;
+	std::atomic<uint64_t> next_id_{1};
+	Counters counters_;
+};
@@ -1,13 +1,36 @@
 #include <spdlog/spdlog.h>
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <iterator>
 #include <thread>
 
 #include <server/RequestHandler.h>
+#include <common/Clock.h>
+#include <config/Config.h>
 #include <logging/Logger.h>
+#include <logging/LogRateLimiter.h>
+
+namespace
+{
+	ClientAggregates::Limits clientLimits()
+	{
+		ClientAggregates::Limits limits;
+		limits.capacity = static_cast<size_t>(std::max(Config::getInt("application.client_capacity", 0), 0));
+		limits.ttl_ms = static_cast<int64_t>(std::max(Config::getInt("application.client_ttl_s", 0), 0)) * 1000;
+		limits.spill_path = Config::getString("application.client_spill_path", "");
+		return limits;
+	}
+}
 
 RequestHandler::RequestHandler()
+	: clients_(clientLimits()),
+	  processing_delay_(Config::getInt("application.processing_delay_us", 1000)),
+	  json_backend_(JsonBackend::create(Config::getString("application.json_backend", "codec")))
 {
-	Logger::info("RequestHandler initialized");
+
+	Logger::info("RequestHandler initialized with {} JSON backend", json_backend_->name());
 }
 
 RequestHandler::~RequestHandler()
@@ -16,189 +39,273 @@ RequestHandler::~RequestHandler()
 				 requests_processed_.load(), successful_requests_.load(), failed_requests_.load());
 }
 
-UserData RequestHandler::parseJson(const std::string &json_input)
+const char *toString(RequestError error) noexcept
+{
+	switch (error)
+	{
+	case RequestError::InvalidJson:
+		return "Invalid JSON format";
+	case RequestError::NotAnObject:
+		return "Expected JSON object";
+	case RequestError::NotAnArray:
+		return "Expected array of requests";
+	case RequestError::InvalidId:
+		return "Missing or invalid 'id' field";
+	case RequestError::InvalidName:
+		return "Missing or invalid 'name' field";
+	case RequestError::InvalidPhone:
+		return "Missing or invalid 'phone' field";
+	case RequestError::InvalidNumber:
+		return "Missing or invalid 'number' field";
+	case RequestError::InvalidUserData:
+		return "Invalid user data";
+	}
+	return "Unknown error";
+}
+
+std::expected<UserData, RequestError> RequestHandler::parseRequest(std::string_view body, codec::Format format)
 {
-	rapidjson::Document doc;
-	doc.Parse(json_input.c_str());
+	if (format == codec::Format::Json)
+	{
+		return json_backend_->parseUserData(body);
+	}
 
-	if (doc.HasParseError())
+	auto data = codec::decode<UserData>(format, body);
+	if (!data)
 	{
-		Logger::error("JSON parse error: {} at offset {}", doc.GetParseError(), doc.GetErrorOffset());
-		throw std::runtime_error("Invalid JSON format");
+		return std::unexpected(toRequestError(data.error()));
 	}
+	return std::move(*data);
+}
 
-	if (!doc.IsObject())
+std::expected<void, RequestError> RequestHandler::validateUserData(const UserData &data)
+{
+	if (auto valid = codec::validate(data); !valid)
 	{
-		throw std::runtime_error("Expected JSON object");
+		return std::unexpected(toRequestError(valid.error()));
 	}
 
-	UserData data;
+	return {};
+}
 
-	// Parse id
-	if (doc.HasMember("id") && doc["id"].IsInt())
+std::expected<ClientAggregates::Update, RequestError> RequestHandler::decodeUpdate(std::string_view body,
+																				  codec::Format format)
+{
+	auto data = parseRequest(body, format);
+	if (!data)
 	{
-		data.id = doc["id"].GetInt();
+		return std::unexpected(data.error());
 	}
-	else
+	if (auto valid = validateUserData(*data); !valid)
 	{
-		throw std::runtime_error("Missing or invalid 'id' field");
+		return std::unexpected(valid.error());
 	}
+	return ClientAggregates::Update{data->id, data->number};
+}
+
+std::string RequestHandler::generateResponse(const UserData &data, codec::Format format)
+{
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(codec::fieldCount<UserData> + 1);
+		writer.members(data);
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
+}
+
+std::string RequestHandler::generateErrorResponse(std::string_view error_message, codec::Format format)
+{
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(2);
+		writer.key("error");
+		writer.value(error_message);
+		writer.key("success");
+		writer.value(false);
+		writer.endObject(); });
+}
 
-	// Parse name
-	if (doc.HasMember("name") && doc["name"].IsString())
+const std::string &RequestHandler::errorResponse(RequestError error, codec::Format format)
+{
+	// Rendered once per format; the error path only copies a ready-made body
+	constexpr size_t error_count = static_cast<size_t>(RequestError::InvalidUserData) + 1;
+	constexpr size_t format_count = static_cast<size_t>(codec::Format::Cbor) + 1;
+	static const auto responses = []
 	{
-		data.name = doc["name"].GetString();
-	}
-	else
+		std::array<std::array<std::string, error_count>, format_count> result;
+		for (size_t f = 0; f < format_count; ++f)
+		{
+			for (size_t i = 0; i < error_count; ++i)
+			{
+				result[f][i] = generateErrorResponse(toString(static_cast<RequestError>(i)), static_cast<codec::Format>(f));
+			}
+		}
+		return result;
+	}();
+
+	return responses[static_cast<size_t>(format)][static_cast<size_t>(error)];
+}
+
+std::string RequestHandler::rejectRequest(RequestError error, codec::Format format)
+{
+	static LogRateLimiter limiter(Config::getInt("logging.request_error_rate", 10));
+
+	uint64_t suppressed = 0;
+	if (limiter.allow(suppressed))
 	{
-		throw std::runtime_error("Missing or invalid 'name' field");
+		Logger::warn("Rejected request: {} ({} similar messages suppressed)", toString(error), suppressed);
 	}
 
-	// Parse phone
-	if (doc.HasMember("phone") && doc["phone"].IsString())
+	failed_requests_++;
+	return errorResponse(error, format);
+}
+
+int RequestHandler::increase(int number)
+{
+	// Simulate some processing time
+	if (processing_delay_.count() > 0)
 	{
-		data.phone = doc["phone"].GetString();
+		std::this_thread::sleep_for(processing_delay_);
 	}
-	else
+	Logger::debug("Increasing number from {} to {}", number, number + 1);
+	return ++number;
+}
+
+std::expected<void, RequestError> RequestHandler::handleUserData(UserData &user_data,
+																 std::vector<ClientAggregates::Update> *batch)
+{
+	if (auto valid = validateUserData(user_data); !valid)
 	{
-		throw std::runtime_error("Missing or invalid 'phone' field");
+		return std::unexpected(valid.error());
 	}
 
-	// Parse number
-	if (doc.HasMember("number") && doc["number"].IsInt())
+	Logger::debug("Parsed data - id: {}, name: {}, phone: {}, number: {}",
+				  user_data.id, user_data.name, user_data.phone, user_data.number);
+
+	// Track the original number before processing
+	int original_number = user_data.number;
+
+	// Perform calculation
+	user_data.number = increase(user_data.number);
+
+	const ClientAggregates::Update update{user_data.id, original_number};
+	if (batch != nullptr)
 	{
-		data.number = doc["number"].GetInt();
+		batch->push_back(update);
 	}
 	else
 	{
-		throw std::runtime_error("Missing or invalid 'number' field");
+		recordUpdates({&update, 1});
 	}
 
-	return data;
+	return {};
 }
 
-bool RequestHandler::validateUserData(const UserData &data)
+void RequestHandler::recordUpdates(std::span<const ClientAggregates::Update> updates)
 {
-	if (data.name.empty())
+	const int64_t now_ms = Clock::coarseWallMillis();
+
+	long long sum = 0;
+	for (const auto &update : updates)
 	{
-		return false;
+		sum += update.number;
 	}
+	// Fix: Use atomic fetch_add for thread safety
+	total_numbers_sum_.fetch_add(sum, std::memory_order_relaxed);
 
-	if (data.phone.empty())
+	std::lock_guard<ProfiledMutex> lock(client_mutex_);
+	if (updates.size() == 1)
 	{
-		return false;
+		clients_.record(updates[0].id, updates[0].number, now_ms);
 	}
-
-	if (data.id < 0)
+	else
 	{
-		return false;
+		clients_.recordBatch(updates, now_ms);
 	}
-
-	return true;
+	version_.fetch_add(1, std::memory_order_release);
 }
 
-std::string RequestHandler::generateJsonResponse(const UserData &data)
+std::string RequestHandler::processRequestInternal(std::string_view body, codec::Format request_format,
+												   codec::Format response_format,
+												   std::vector<ClientAggregates::Update> *batch)
 {
-	rapidjson::Document doc;
-	doc.SetObject();
-	rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
+	requests_processed_++;
 
-	doc.AddMember("id", data.id, allocator);
-	doc.AddMember("name", rapidjson::Value(data.name.c_str(), allocator), allocator);
-	doc.AddMember("phone", rapidjson::Value(data.phone.c_str(), allocator), allocator);
-	doc.AddMember("number", data.number, allocator);
-	doc.AddMember("success", true, allocator);
+	auto user_data = parseRequest(body, request_format);
+	if (!user_data)
+	{
+		return rejectRequest(user_data.error(), response_format);
+	}
 
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-	doc.Accept(writer);
+	if (auto handled = handleUserData(*user_data, batch); !handled)
+	{
+		return rejectRequest(handled.error(), response_format);
+	}
 
-	return buffer.GetString();
+	successful_requests_++;
+	std::string response = generateResponse(*user_data, response_format);
+	Logger::debug("Generated {} byte {} response", response.size(), codec::contentType(response_format));
+	return response;
 }
 
-std::string RequestHandler::generateErrorResponse(const std::string &error_message)
+std::string RequestHandler::processRequest(const std::string &json_input)
 {
-	rapidjson::Document doc;
-	doc.SetObject();
-	rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
-
-	doc.AddMember("error", rapidjson::Value(error_message.c_str(), allocator), allocator);
-	doc.AddMember("success", false, allocator);
-
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-	doc.Accept(writer);
-
-	return buffer.GetString();
+	return processRequestInternal(json_input, codec::Format::Json, codec::Format::Json);
 }
 
-int RequestHandler::increase(int number)
+std::string RequestHandler::processRequest(std::string_view body, codec::Format request_format,
+										   codec::Format response_format)
 {
-	// Simulate some processing time
-	std::this_thread::sleep_for(std::chrono::milliseconds(1));
-	Logger::debug("Increasing number from {} to {}", number, number + 1);
-	return ++number;
+	return processRequestInternal(body, request_format, response_format);
 }
 
-std::string RequestHandler::processRequestInternal(const std::string &json_input)
+std::string RequestHandler::processBatch(std::string_view body, codec::Format request_format,
+										 codec::Format response_format)
 {
-	requests_processed_++;
-
-	try
+	// Elements stay views into the body; each one goes through the same path
+	// as /process, except that the client aggregates are updated in one pass
+	// at the end
+	auto items = codec::splitArray(request_format, body);
+	if (!items)
 	{
-		// Parse input
-		UserData user_data = parseJson(json_input);
-
-		// Validate data
-		if (!validateUserData(user_data))
-		{
-			throw std::runtime_error("Invalid user data");
-		}
-
-		Logger::debug("Parsed data - id: {}, name: {}, phone: {}, number: {}",
-					  user_data.id, user_data.name, user_data.phone, user_data.number);
-
-		// Track the original number before processing
-		int original_number = user_data.number;
-
-		// Perform calculation
-		user_data.number = increase(user_data.number);
-
-		// Update number tracking - use client IP or user ID as client identifier
-		std::string client_id = "user_" + std::to_string(user_data.id);
-
-		// Fix: Use atomic fetch_add for thread safety
-		total_numbers_sum_.fetch_add(original_number, std::memory_order_relaxed);
-
-		{
-			std::lock_guard<std::mutex> lock(client_mutex_);
-			client_numbers_sum_[client_id] += static_cast<long long>(original_number);
-		}
-
-		// Generate response
-		std::string response = generateJsonResponse(user_data);
-		Logger::debug("Generated response: {}", response);
+		requests_processed_++;
+		bool wrong_root = items.error().kind == codec::DecodeError::NotAnObject;
+		return rejectRequest(wrong_root ? RequestError::NotAnArray : RequestError::InvalidJson, response_format);
+	}
 
-		successful_requests_++;
-		return response;
+	std::vector<std::string> results;
+	results.reserve(items->size());
+	std::vector<ClientAggregates::Update> updates;
+	updates.reserve(items->size());
+	for (std::string_view item : *items)
+	{
+		results.push_back(processRequestInternal(item, request_format, response_format, &updates));
 	}
-	catch (const std::exception &e)
+	if (!updates.empty())
 	{
-		Logger::error("Error processing request: {}", e.what());
-		failed_requests_++;
-		return generateErrorResponse(e.what());
+		recordUpdates(updates);
 	}
-}
 
-std::string RequestHandler::processRequest(const std::string &json_input)
-{
-	return processRequestInternal(json_input);
+	return codec::encode(response_format, [&](auto &writer)
+						 {
+		writer.startObject(2);
+		writer.key("results");
+		writer.startArray(results.size());
+		for (const auto &result : results)
+		{
+			writer.raw(result);
+		}
+		writer.endArray();
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
 }
 
 std::future<std::string> RequestHandler::processRequestAsync(const std::string &json_input)
 {
 	return std::async(std::launch::async, [this, json_input]()
-					  { return processRequestInternal(json_input); });
+					  { return processRequestInternal(json_input, codec::Format::Json, codec::Format::Json); });
 }
 
 std::vector<std::string> RequestHandler::processBatchRequests(const std::vector<std::string> &json_inputs)
@@ -215,6 +322,186 @@ std::vector<std::string> RequestHandler::processBatchRequests(const std::vector<
 	return results;
 }
 
+std::string RequestHandler::totalSumResponse(codec::Format format)
+{
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(2);
+		writer.key("total_numbers_sum");
+		writer.value(getTotalNumbersSum());
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
+}
+
+std::string RequestHandler::clientSumResponse(const std::string &client_id, codec::Format format)
+{
+	long long sum = getClientNumbersSum(client_id);
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(3);
+		writer.key("client_id");
+		writer.value(client_id);
+		writer.key("numbers_sum");
+		writer.value(sum);
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
+}
+
+std::string RequestHandler::allClientSumsResponse(codec::Format format)
+{
+	auto all_sums = getAllClientSums();
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(3);
+		writer.key("success");
+		writer.value(true);
+		writer.key("clients");
+		writer.startObject(all_sums.size());
+		for (const auto &[client_id, sum] : all_sums)
+		{
+			writer.key(client_id);
+			writer.value(sum);
+		}
+		writer.endObject();
+		writer.key("total");
+		writer.value(getTotalNumbersSum());
+		writer.endObject(); });
+}
+
+std::string RequestHandler::clientStatsResponse(const std::string &client_id, codec::Format format)
+{
+	auto stats = getClientStats(client_id);
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(9);
+		writer.key("client_id");
+		writer.value(client_id);
+		writer.key("count");
+		writer.value(stats.count);
+		writer.key("sum");
+		writer.value(stats.sum);
+		writer.key("min");
+		writer.value(stats.min);
+		writer.key("max");
+		writer.value(stats.max);
+		writer.key("mean");
+		writer.value(stats.mean);
+		writer.key("variance");
+		writer.value(stats.variance);
+		writer.key("last_seen_ms");
+		writer.value(stats.last_seen_ms);
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
+}
+
+std::string RequestHandler::clientRangeResponse(std::string_view from, std::string_view to, std::string_view limit,
+												codec::Format format)
+{
+	auto parse = [](std::string_view text, auto &value)
+	{
+		if (text.empty())
+			return true;
+		auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+		return ec == std::errc() && end == text.data() + text.size();
+	};
+
+	int32_t first = 0;
+	int32_t last = INT32_MAX;
+	size_t max_clients = DEFAULT_RANGE_LIMIT;
+	if (!parse(from, first) || !parse(to, last) || !parse(limit, max_clients) || first > last)
+	{
+		return generateErrorResponse("Invalid range parameters", format);
+	}
+	max_clients = std::min(max_clients, MAX_RANGE_LIMIT);
+
+	OrderedIndex::RangeTotal total;
+	std::vector<std::pair<int32_t, int64_t>> clients;
+	{
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		total = clients_.index().total(first, last);
+		clients.reserve(std::min<uint64_t>(max_clients, total.count));
+		clients_.index().scan(first, last, max_clients, [&](int32_t id, int64_t sum)
+						   { clients.emplace_back(id, sum); });
+	}
+
+	return codec::encode(format, [&](auto &writer)
+						 {
+		writer.startObject(7);
+		writer.key("success");
+		writer.value(true);
+		writer.key("from");
+		writer.value(first);
+		writer.key("to");
+		writer.value(last);
+		writer.key("count");
+		writer.value(total.count);
+		writer.key("total");
+		writer.value(total.sum);
+		writer.key("clients");
+		writer.startArray(clients.size());
+		for (const auto &[id, sum] : clients)
+		{
+			writer.startObject(2);
+			writer.key("id");
+			writer.value(id);
+			writer.key("numbers_sum");
+			writer.value(sum);
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.key("truncated");
+		writer.value(clients.size() < total.count);
+		writer.endObject(); });
+}
+
+std::string RequestHandler::clientSumsResponse(std::string_view body, codec::Format request_format,
+											   codec::Format response_format)
+{
+	auto ids = codec::decodeStrings(request_format, body);
+	if (!ids)
+	{
+		if (ids.error().kind == codec::DecodeError::Syntax)
+			return errorResponse(RequestError::InvalidJson, response_format);
+		return generateErrorResponse("Expected array of client ids", response_format);
+	}
+
+	// One lock for the whole batch, so the reply is a consistent snapshot
+	const size_t count = ids->size();
+	std::vector<std::optional<int32_t>> client_ids(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		client_ids[i] = ClientAggregates::parseClientId((*ids)[i]);
+	}
+
+	std::vector<long long> sums;
+	{
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		clients_.sums(client_ids, sums);
+	}
+
+	return codec::encode(response_format, [&](auto &writer)
+						 {
+		writer.startObject(2);
+		writer.key("results");
+		writer.startArray(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			writer.startObject(2);
+			writer.key("client_id");
+			writer.value((*ids)[i]);
+			writer.key("numbers_sum");
+			writer.value(sums[i]);
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.key("success");
+		writer.value(true);
+		writer.endObject(); });
+}
+
 void RequestHandler::resetStatistics()
 {
 	requests_processed_ = 0;
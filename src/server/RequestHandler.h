@@ -1,25 +1,24 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <expected>
 #include <future>
 #include <functional>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <span>
+#include <vector>
 
 #include <common/rapidjson/document.h>
 #include <common/rapidjson/stringbuffer.h>
 #include <common/rapidjson/writer.h>
-
-struct UserData
-{
-	int id;
-	std::string name;
-	std::string phone;
-	int number;
-
-	// Constructor for easy initialization
-	UserData(int id = 0, std::string name = "", std::string phone = "", int number = 0)
-		: id(id), name(std::move(name)), phone(std::move(phone)), number(number) {}
-};
+#include <codec/Codec.h>
+#include <server/ClientAggregates.h>
+#include <server/JsonBackend.h>
+#include <server/LockProfiler.h>
+#include <server/UserData.h>
 
 class RequestHandler
 {
@@ -28,29 +27,98 @@ public:
 	~RequestHandler();
 
 	std::string processRequest(const std::string &json_input);
+	// Decodes body as request_format and encodes the reply as response_format
+	std::string processRequest(std::string_view body, codec::Format request_format, codec::Format response_format);
+	// Body is an array of /process payloads; replies {"results": [...], "success": true}
+	std::string processBatch(std::string_view body, codec::Format request_format, codec::Format response_format);
 	std::future<std::string> processRequestAsync(const std::string &json_input);
 	std::vector<std::string> processBatchRequests(const std::vector<std::string> &json_inputs);
 
+	// Fire-and-forget ingestion (e.g. UDP datagrams): decodes and validates
+	// one UserData without building a reply or counting it as a request
+	std::expected<ClientAggregates::Update, RequestError> decodeUpdate(std::string_view body, codec::Format format);
+	// Adds updates to the totals and, in one pass under the lock, to the
+	// client aggregates
+	void recordUpdates(std::span<const ClientAggregates::Update> updates);
+
 	long long getTotalNumbersSum() const { return total_numbers_sum_; }
+	// Bumped after every applied batch; a reader that saw version v also
+	// sees the sums of every batch up to v
+	uint64_t getVersion() const { return version_.load(std::memory_order_acquire); }
 
-	long long getClientNumbersSum(const std::string &client_id)
+	long long getClientNumbersSum(std::string_view client_id)
 	{
-		std::lock_guard<std::mutex> lock(client_mutex_);
-		auto it = client_numbers_sum_.find(client_id);
-		return it != client_numbers_sum_.end() ? it->second : 0;
+		auto id = ClientAggregates::parseClientId(client_id);
+		if (!id)
+			return 0;
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		return clients_.sum(*id);
 	}
 
-	std::unordered_map<std::string, long long> getAllClientSums()
+	// Sums of ids under one lock, 0 for unknown or unparsed ids
+	void getClientSums(const std::vector<std::optional<int32_t>> &ids, std::vector<long long> &sums)
 	{
-		std::lock_guard<std::mutex> lock(client_mutex_);
-		return client_numbers_sum_;
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		clients_.sums(ids, sums);
 	}
 
+	// Zeroed Stats for an unknown client
+	ClientStatsTable::Stats getClientStats(std::string_view client_id)
+	{
+		auto id = ClientAggregates::parseClientId(client_id);
+		if (!id)
+			return {};
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		return clients_.stats(*id);
+	}
+
+	// Resident clients, copied under the lock so callers can iterate while
+	// updates continue
+	std::vector<std::pair<std::string, long long>> getAllClientSums()
+	{
+		std::vector<std::pair<int32_t, long long>> ids;
+		{
+			std::lock_guard<ProfiledMutex> lock(client_mutex_);
+			ids.reserve(clients_.size());
+			clients_.forEach([&](int32_t id, int64_t sum)
+							 { ids.emplace_back(id, sum); });
+		}
+
+		std::vector<std::pair<std::string, long long>> sums;
+		sums.reserve(ids.size());
+		for (const auto &[id, sum] : ids)
+		{
+			sums.emplace_back(ClientAggregates::clientKey(id), sum);
+		}
+		return sums;
+	}
+
+	// Bodies of the /numbers/* reads
+	std::string totalSumResponse(codec::Format format);
+	std::string clientSumResponse(const std::string &client_id, codec::Format format);
+	std::string allClientSumsResponse(codec::Format format);
+	std::string clientStatsResponse(const std::string &client_id, codec::Format format);
+	// GET /numbers/range: clients with from <= id <= to in id order, at most
+	// limit of them, plus the count and sum over the whole range. Parameters
+	// are the raw query values; empty means unset.
+	std::string clientRangeResponse(std::string_view from, std::string_view to, std::string_view limit,
+									codec::Format format);
+
+	// POST /numbers/sum/multi: body is an array of client ids; replies
+	// {"results": [{"client_id", "numbers_sum"}...], "success": true} in
+	// request order, with 0 for unknown ids
+	std::string clientSumsResponse(std::string_view body, codec::Format request_format,
+								   codec::Format response_format);
+
+	static constexpr size_t DEFAULT_RANGE_LIMIT = 100;
+	static constexpr size_t MAX_RANGE_LIMIT = 1000;
+
 	void resetNumberTracking()
 	{
 		total_numbers_sum_ = 0;
-		std::lock_guard<std::mutex> lock(client_mutex_);
-		client_numbers_sum_.clear();
+		std::lock_guard<ProfiledMutex> lock(client_mutex_);
+		clients_.clear();
+		version_.fetch_add(1, std::memory_order_release);
 	}
 
 	// Statistics
@@ -61,6 +129,9 @@ public:
 	// Reset statistics
 	void resetStatistics();
 
+	// Simulated work per request in increase()
+	void setProcessingDelay(std::chrono::microseconds delay) { processing_delay_ = delay; }
+
 private:
 	friend class RequestHandlerTest;
 
@@ -68,13 +139,22 @@ private:
 	std::atomic<size_t> successful_requests_{0};
 	std::atomic<size_t> failed_requests_{0};
 	std::atomic<long long> total_numbers_sum_{0};
-	std::unordered_map<std::string, long long> client_numbers_sum_;
-	std::mutex client_mutex_;
+	std::atomic<uint64_t> version_{0};
+	ClientAggregates clients_;
+	ProfiledMutex client_mutex_{"RequestHandler::client_mutex_"};
+	std::chrono::microseconds processing_delay_;
+	std::unique_ptr<JsonBackend> json_backend_;
 
-	UserData parseJson(const std::string &json_input);
-	bool validateUserData(const UserData &data);
-	std::string generateJsonResponse(const UserData &data);
-	std::string generateErrorResponse(const std::string &error_message);
+	std::expected<UserData, RequestError> parseRequest(std::string_view body, codec::Format format);
+	std::expected<void, RequestError> validateUserData(const UserData &data);
+	// Records the client's number right away, or appends it to batch when given
+	std::expected<void, RequestError> handleUserData(UserData &data,
+													 std::vector<ClientAggregates::Update> *batch = nullptr);
+	static std::string generateResponse(const UserData &data, codec::Format format);
+	static std::string generateErrorResponse(std::string_view error_message, codec::Format format);
+	static const std::string &errorResponse(RequestError error, codec::Format format);
+	std::string rejectRequest(RequestError error, codec::Format format);
 	int increase(int number);
-	std::string processRequestInternal(const std::string &json_input);
+	std::string processRequestInternal(std::string_view body, codec::Format request_format, codec::Format response_format,
+									   std::vector<ClientAggregates::Update> *batch = nullptr);
 };
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include <charconv>
+#include <chrono>
+#include <random>
+
+#include <codec/Codec.h>
+#include <common/Clock.h>
+#include <common/httplib.h>
+#include <logging/Logger.h>
+#include <server/Metrics.h>
+#include <server/RequestMirror.h>
+
+RequestMirror::RequestMirror(Options options)
+	: options_(std::move(options))
+{
+}
+
+RequestMirror::~RequestMirror()
+{
+	stop();
+}
+
+void RequestMirror::start()
+{
+	for (size_t i = 0; i < std::max<size_t>(options_.connections, 1); ++i)
+	{
+		senders_.emplace_back(&RequestMirror::senderLoop, this);
+	}
+	Logger::info("Mirroring {:.2f}% of requests to {}:{}", options_.sample_rate * 100, options_.host, options_.port);
+}
+
+void RequestMirror::stop()
+{
+	{
+		std::lock_guard<ProfiledMutex> lock(mutex_);
+		stopping_ = true;
+	}
+	ready_.notify_all();
+	for (auto &sender : senders_)
+	{
+		sender.join();
+	}
+	senders_.clear();
+}
+
+bool RequestMirror::sample() const
+{
+	if (options_.sample_rate >= 1)
+		return true;
+	if (options_.sample_rate <= 0)
+		return false;
+	thread_local std::minstd_rand engine(std::random_device{}());
+	return std::uniform_real_distribution<double>(0, 1)(engine) < options_.sample_rate;
+}
+
+bool RequestMirror::tryReserve()
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	counters_.sampled++;
+	if (stopping_ || queue_.size() + reserved_ >= options_.max_queue)
+	{
+		counters_.dropped++;
+		Metrics::getInstance().addMirrorRequests(0, 1, 0);
+		return false;
+	}
+	reserved_++;
+	return true;
+}
+
+void RequestMirror::submit(Exchange exchange)
+{
+	{
+		std::lock_guard<ProfiledMutex> lock(mutex_);
+		reserved_--;
+		if (stopping_)
+		{
+			counters_.dropped++;
+			Metrics::getInstance().addMirrorRequests(0, 1, 0);
+			return;
+		}
+		queue_.push_back(std::move(exchange));
+	}
+	ready_.notify_one();
+}
+
+void RequestMirror::senderLoop()
+{
+	httplib::Client client(options_.host, options_.port);
+	client.set_keep_alive(true);
+	client.set_connection_timeout(std::chrono::milliseconds(options_.timeout_ms));
+	client.set_read_timeout(std::chrono::milliseconds(options_.timeout_ms));
+	client.set_write_timeout(std::chrono::milliseconds(options_.timeout_ms));
+
+	for (;;)
+	{
+		Exchange exchange;
+		{
+			ProfiledLock lock(mutex_);
+			ready_.wait(lock, [this]
+						{ return stopping_ || !queue_.empty(); });
+			if (stopping_)
+				return;
+			exchange = std::move(queue_.front());
+			queue_.pop_front();
+		}
+
+		httplib::Headers headers;
+		if (!exchange.accept.empty())
+		{
+			headers.emplace("Accept", exchange.accept);
+		}
+
+		const Clock::Ticks start = Clock::ticks();
+		httplib::Result result = exchange.method == "POST"
+									 ? client.Post(exchange.path, headers, exchange.body,
+												   exchange.content_type.empty() ? "application/json" : exchange.content_type)
+									 : client.Get(exchange.path, headers);
+		const double latency_ms = Clock::millisSince(start);
+
+		if (!result)
+		{
+			std::lock_guard<ProfiledMutex> lock(mutex_);
+			counters_.sent++;
+			counters_.errors++;
+			Metrics::getInstance().addMirrorRequests(1, 0, 1);
+			continue;
+		}
+		record(exchange, result->status, result->body, latency_ms);
+	}
+}
+
+void RequestMirror::record(const Exchange &exchange, int status, const std::string &body, double latency_ms)
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	counters_.sent++;
+	primary_latency_.add(exchange.latency_ms);
+	shadow_latency_.add(latency_ms);
+	Metrics::getInstance().addMirrorRequests(1, 0, 0);
+
+	if (status == exchange.status && body == exchange.response_body)
+	{
+		counters_.matched++;
+		return;
+	}
+
+	if (status != exchange.status)
+		counters_.status_mismatches++;
+	else
+		counters_.body_mismatches++;
+	Metrics::getInstance().incrementMirrorMismatches();
+
+	if (diffs_.size() == MAX_DIFFS)
+	{
+		diffs_.pop_front();
+	}
+	diffs_.push_back({exchange.method, exchange.path, exchange.status, status,
+					  exchange.response_body.substr(0, DIFF_BODY_BYTES), body.substr(0, DIFF_BODY_BYTES)});
+}
+
+void RequestMirror::Histogram::add(double ms)
+{
+	size_t bucket = 0;
+	while (bucket < LATENCY_BUCKETS_MS.size() && ms > LATENCY_BUCKETS_MS[bucket])
+	{
+		++bucket;
+	}
+	counts[bucket]++;
+	sum_ms += ms;
+	count++;
+}
+
+RequestMirror::Counters RequestMirror::counters() const
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	return counters_;
+}
+
+std::string RequestMirror::reportJson() const
+{
+	std::lock_guard<ProfiledMutex> lock(mutex_);
+	return codec::encode(codec::Format::Json, [&](auto &writer)
+						 {
+		auto histogram = [&](const Histogram &latency)
+		{
+			writer.startObject(3);
+			writer.key("mean_ms");
+			writer.value(latency.count > 0 ? latency.sum_ms / static_cast<double>(latency.count) : 0.0);
+			writer.key("count");
+			writer.value(latency.count);
+			// Cumulative, like a Prometheus histogram; the last bucket is +Inf
+			writer.key("buckets");
+			writer.startArray(latency.counts.size());
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < latency.counts.size(); ++i)
+			{
+				cumulative += latency.counts[i];
+				writer.startObject(2);
+				writer.key("le_ms");
+				if (i < LATENCY_BUCKETS_MS.size())
+					writer.value(LATENCY_BUCKETS_MS[i]);
+				else
+					writer.value("+Inf");
+				writer.key("count");
+				writer.value(cumulative);
+				writer.endObject();
+			}
+			writer.endArray();
+			writer.endObject();
+		};
+
+		writer.startObject(12);
+		writer.key("shadow");
+		writer.value(options_.host + ":" + std::to_string(options_.port));
+		writer.key("sample_rate");
+		writer.value(options_.sample_rate);
+		writer.key("sampled");
+		writer.value(counters_.sampled);
+		writer.key("dropped");
+		writer.value(counters_.dropped);
+		writer.key("sent");
+		writer.value(counters_.sent);
+		writer.key("errors");
+		writer.value(counters_.errors);
+		writer.key("matched");
+		writer.value(counters_.matched);
+		writer.key("status_mismatches");
+		writer.value(counters_.status_mismatches);
+		writer.key("body_mismatches");
+		writer.value(counters_.body_mismatches);
+		writer.key("primary_latency");
+		histogram(primary_latency_);
+		writer.key("shadow_latency");
+		histogram(shadow_latency_);
+		writer.key("recent_mismatches");
+		writer.startArray(diffs_.size());
+		for (const auto &diff : diffs_)
+		{
+			writer.startObject(5);
+			writer.key("request");
+			writer.value(diff.method + " " + diff.path);
+			writer.key("primary_status");
+			writer.value(diff.primary_status);
+			writer.key("shadow_status");
+			writer.value(diff.shadow_status);
+			writer.key("primary_body");
+			writer.value(diff.primary_body);
+			writer.key("shadow_body");
+			writer.value(diff.shadow_body);
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.endObject(); });
+}
+
+std::pair<int, std::string_view> RequestMirror::splitResponse(std::string_view response)
+{
+	// "HTTP/1.1 200 OK\r\n...\r\n\r\n<body>"
+	int status = 0;
+	size_t space = response.find(' ');
+	size_t header_end = response.find("\r\n\r\n");
+	if (space == std::string_view::npos || header_end == std::string_view::npos)
+	{
+		return {0, {}};
+	}
+	std::from_chars(response.data() + space + 1, response.data() + response.size(), status);
+	return {status, response.substr(header_end + 4)};
+}
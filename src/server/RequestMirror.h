@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <server/LockProfiler.h>
+
+// Shadow traffic: copies a sample of the requests this server answers to a
+// second instance and compares the replies. The request path only rolls the
+// sampling dice and, for a sampled request, takes a slot in a bounded queue
+// and moves a copy into it without blocking; when the queue is full no copy
+// is made and the request counts as dropped. Sender
+// threads, each holding one keep-alive connection to the shadow, replay the
+// requests and record both latencies plus whether status and body matched.
+// Shadow replies never reach the primary's clients.
+class RequestMirror
+{
+public:
+	struct Options
+	{
+		std::string host = "127.0.0.1";
+		int port = 0;
+		double sample_rate = 0.01; // fraction of requests copied
+		size_t connections = 2;	   // sender threads, one connection each
+		size_t max_queue = 1024;   // copies waiting; more are dropped
+		int timeout_ms = 2000;	   // shadow connect and read timeout
+	};
+
+	// A primary request and what the primary answered
+	struct Exchange
+	{
+		std::string method;
+		std::string path;
+		std::string body;
+		std::string content_type;
+		std::string accept;
+		int status = 0;
+		std::string response_body;
+		double latency_ms = 0;
+	};
+
+	struct Counters
+	{
+		uint64_t sampled = 0;
+		uint64_t dropped = 0; // queue full
+		uint64_t sent = 0;
+		uint64_t errors = 0; // no reply from the shadow
+		uint64_t matched = 0;
+		uint64_t status_mismatches = 0;
+		uint64_t body_mismatches = 0;
+	};
+
+	static constexpr size_t MAX_DIFFS = 16;			// most recent mismatches kept
+	static constexpr size_t DIFF_BODY_BYTES = 256;	// of each body in a kept mismatch
+	static constexpr std::array<double, 12> LATENCY_BUCKETS_MS = {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 1000};
+
+	explicit RequestMirror(Options options);
+	~RequestMirror();
+
+	RequestMirror(const RequestMirror &) = delete;
+	RequestMirror &operator=(const RequestMirror &) = delete;
+
+	void start();
+	void stop();
+
+	// Per-request dice roll, no locks
+	bool sample() const;
+	// Takes a queue slot for a sampled request before the caller builds its
+	// Exchange; false, counted as dropped, when the queue is full
+	bool tryReserve();
+	// Queues the exchange for replay into a slot from tryReserve()
+	void submit(Exchange exchange);
+
+	Counters counters() const;
+	// GET /debug/mirror: counters, latency histograms of both sides and the
+	// most recent mismatches
+	std::string reportJson() const;
+
+	// Status code and body of a raw HTTP/1.1 response; status 0 if malformed
+	static std::pair<int, std::string_view> splitResponse(std::string_view response);
+
+private:
+	struct Histogram
+	{
+		std::array<uint64_t, LATENCY_BUCKETS_MS.size() + 1> counts{};
+		double sum_ms = 0;
+		uint64_t count = 0;
+
+		void add(double ms);
+	};
+
+	struct Diff
+	{
+		std::string method;
+		std::string path;
+		int primary_status;
+		int shadow_status;
+		std::string primary_body;
+		std::string shadow_body;
+	};
+
+	void senderLoop();
+	void record(const Exchange &exchange, int status, const std::string &body, double latency_ms);
+
+	const Options options_;
+	std::vector<std::thread> senders_;
+	bool stopping_ = false;
+
+	mutable ProfiledMutex mutex_{"RequestMirror::mutex_"}; // guards everything below
+	ProfiledConditionVariable ready_;
+	std::deque<Exchange> queue_;
+	size_t reserved_ = 0; // slots taken by exchanges still being built
+	Counters counters_;
+	Histogram primary_latency_;
+	Histogram shadow_latency_;
+	std::deque<Diff> diffs_;
+};
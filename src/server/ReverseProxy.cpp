@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sstream>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <common/Clock.h>
+#include <common/httplib.h>
+#include <logging/Logger.h>
+#include <server/ReverseProxy.h>
+
+namespace
+{
+	std::string errorResponse(int status, std::string_view reason, std::string_view message)
+	{
+		std::string body = R"({"error": ")" + std::string(message) + R"(", "success": false})";
+		return "HTTP/1.1 " + std::to_string(status) + " " + std::string(reason) +
+			   "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) +
+			   "\r\nConnection: keep-alive\r\n\r\n" + body;
+	}
+
+	// Value of a header in a raw head, matched case-insensitively; empty when absent
+	std::string_view headerValue(std::string_view head, std::string_view name)
+	{
+		size_t pos = head.find("\r\n");
+		while (pos != std::string_view::npos && pos + 2 < head.size())
+		{
+			size_t start = pos + 2;
+			size_t end = head.find("\r\n", start);
+			std::string_view line = head.substr(start, end == std::string_view::npos ? end : end - start);
+			size_t colon = line.find(':');
+			if (colon == name.size() && strncasecmp(line.data(), name.data(), name.size()) == 0)
+			{
+				std::string_view value = line.substr(colon + 1);
+				while (!value.empty() && value.front() == ' ')
+					value.remove_prefix(1);
+				while (!value.empty() && value.back() == ' ')
+					value.remove_suffix(1);
+				return value;
+			}
+			pos = end;
+		}
+		return {};
+	}
+
+	bool waitFor(int fd, short events, int timeout_ms)
+	{
+		struct pollfd descriptor = {fd, events, 0};
+		int ready;
+		do
+		{
+			ready = ::poll(&descriptor, 1, timeout_ms);
+		} while (ready < 0 && errno == EINTR);
+		return ready > 0;
+	}
+
+	// Per-thread pipe for spliceAll(); -1 if it could not be made
+	struct SplicePipe
+	{
+		int read_fd = -1;
+		int write_fd = -1;
+
+		SplicePipe()
+		{
+			int fds[2];
+			if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) == 0)
+			{
+				read_fd = fds[0];
+				write_fd = fds[1];
+				// Larger than the default 64 KiB so fewer round trips; best effort
+				fcntl(write_fd, F_SETPIPE_SZ, 1 << 20);
+			}
+		}
+		// Leaves the pipe empty for the next relay after a failed one
+		void drain()
+		{
+			char discard[4096];
+			while (read(read_fd, discard, sizeof(discard)) > 0)
+			{
+			}
+		}
+
+		~SplicePipe()
+		{
+			if (read_fd >= 0)
+			{
+				::close(read_fd);
+				::close(write_fd);
+			}
+		}
+	};
+}
+
+std::unique_ptr<ReverseProxy> ReverseProxy::create(std::string_view routes, Options options)
+{
+	std::unique_ptr<ReverseProxy> proxy(new ReverseProxy(options));
+	while (!routes.empty())
+	{
+		size_t semicolon = routes.find(';');
+		std::string_view spec = routes.substr(0, semicolon);
+		routes = semicolon == std::string_view::npos ? std::string_view() : routes.substr(semicolon + 1);
+		if (spec.empty())
+			continue;
+
+		size_t eq = spec.find('=');
+		if (eq == std::string_view::npos || eq == 0 || spec.front() != '/')
+			return nullptr;
+		Route route;
+		route.prefix = std::string(spec.substr(0, eq));
+		if (route.prefix.size() > 1 && route.prefix.back() == '/')
+			route.prefix.pop_back();
+
+		std::string_view targets = spec.substr(eq + 1);
+		while (!targets.empty())
+		{
+			size_t comma = targets.find(',');
+			std::string_view target = targets.substr(0, comma);
+			targets = comma == std::string_view::npos ? std::string_view() : targets.substr(comma + 1);
+
+			size_t colon = target.rfind(':');
+			int port = 0;
+			if (colon == std::string_view::npos || colon == 0 ||
+				std::from_chars(target.data() + colon + 1, target.data() + target.size(), port).ec != std::errc() ||
+				port <= 0 || port > 65535)
+			{
+				return nullptr;
+			}
+
+			// Routes may share upstreams, and then share their pools
+			auto existing = std::find_if(proxy->upstreams_.begin(), proxy->upstreams_.end(),
+										 [&](const auto &upstream)
+										 { return upstream->name == target; });
+			if (existing == proxy->upstreams_.end())
+			{
+				auto upstream = std::make_unique<Upstream>();
+				upstream->host = std::string(target.substr(0, colon));
+				upstream->port = port;
+				upstream->name = std::string(target);
+				proxy->upstreams_.push_back(std::move(upstream));
+				existing = proxy->upstreams_.end() - 1;
+			}
+			route.upstreams.push_back(static_cast<size_t>(existing - proxy->upstreams_.begin()));
+		}
+		if (route.upstreams.empty())
+			return nullptr;
+		proxy->routes_.push_back(std::move(route));
+	}
+
+	if (proxy->routes_.empty())
+		return nullptr;
+	// Longest prefix first, so /a/b wins over /a
+	std::stable_sort(proxy->routes_.begin(), proxy->routes_.end(), [](const Route &a, const Route &b)
+					 { return a.prefix.size() > b.prefix.size(); });
+	return proxy;
+}
+
+ReverseProxy::~ReverseProxy()
+{
+	{
+		std::lock_guard<ProfiledMutex> lock(health_mutex_);
+		stopping_ = true;
+	}
+	health_wake_.notify_all();
+	if (health_thread_.joinable())
+	{
+		health_thread_.join();
+	}
+	for (auto &upstream : upstreams_)
+	{
+		for (int fd : upstream->idle)
+		{
+			::close(fd);
+		}
+	}
+}
+
+const ReverseProxy::Route *ReverseProxy::match(std::string_view path) const
+{
+	for (const auto &route : routes_)
+	{
+		if (route.prefix == "/")
+			return &route;
+		if (path.starts_with(route.prefix) &&
+			(path.size() == route.prefix.size() || path[route.prefix.size()] == '/' || path[route.prefix.size()] == '?'))
+		{
+			return &route;
+		}
+	}
+	return nullptr;
+}
+
+size_t ReverseProxy::pick(const Route &route)
+{
+	// Least outstanding requests among the healthy; the rotating start
+	// spreads ties instead of always favouring the first upstream
+	const size_t count = route.upstreams.size();
+	const size_t start = rotation_.fetch_add(1, std::memory_order_relaxed) % count;
+	size_t best = SIZE_MAX;
+	uint64_t best_load = UINT64_MAX;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const size_t index = route.upstreams[(start + i) % count];
+		const Upstream &upstream = *upstreams_[index];
+		if (!upstream.healthy)
+			continue;
+		const uint64_t load = upstream.outstanding.load(std::memory_order_relaxed);
+		if (load < best_load)
+		{
+			best = index;
+			best_load = load;
+		}
+	}
+	return best;
+}
+
+std::string ReverseProxy::forward(const Route &route, std::string_view request, std::string_view client_addr,
+								  ProxyDownstream &downstream)
+{
+	const size_t index = pick(route);
+	if (index == SIZE_MAX)
+	{
+		return errorResponse(503, "Service Unavailable", "No healthy upstream");
+	}
+	Upstream &upstream = *upstreams_[index];
+
+	// Request line with the prefix stripped, then X-Forwarded-For, then the
+	// client's headers and body unchanged
+	size_t line_end = request.find("\r\n");
+	size_t first_space = request.find(' ');
+	size_t second_space = first_space == std::string_view::npos ? first_space : request.find(' ', first_space + 1);
+	if (line_end == std::string_view::npos || second_space == std::string_view::npos || second_space > line_end)
+	{
+		return errorResponse(400, "Bad Request", "Invalid HTTP request");
+	}
+	std::string_view target = request.substr(first_space + 1, second_space - first_space - 1);
+	if (options_.strip_prefix && route.prefix != "/")
+	{
+		target.remove_prefix(std::min(route.prefix.size(), target.size()));
+	}
+	std::string_view client_ip = client_addr.substr(0, client_addr.rfind(':'));
+	const std::string_view method = request.substr(0, first_space);
+	const bool idempotent = method == "GET" || method == "HEAD";
+
+	std::string rewritten;
+	rewritten.reserve(request.size() + 64);
+	rewritten.append(request.substr(0, first_space + 1));
+	if (target.empty() || target.front() != '/')
+		rewritten += '/';
+	rewritten.append(target);
+	rewritten.append(request.substr(second_space, line_end + 2 - second_space));
+	rewritten.append("X-Forwarded-For: ").append(client_ip).append("\r\n");
+	rewritten.append(request.substr(line_end + 2));
+
+	upstream.outstanding++;
+	upstream.requests++;
+	const Clock::Ticks start = Clock::ticks();
+
+	std::optional<std::string> response = exchange(upstream, rewritten, idempotent, downstream);
+	if (!response)
+	{
+		// The pooled connection had been closed by the upstream, likely along
+		// with the rest of the pool (a restart); once more on a new one
+		{
+			std::lock_guard<ProfiledMutex> lock(upstream.mutex);
+			for (int fd : upstream.idle)
+				::close(fd);
+			upstream.idle.clear();
+		}
+		response = exchange(upstream, rewritten, idempotent, downstream);
+	}
+	if (!response)
+	{
+		upstream.errors++;
+		response = errorResponse(502, "Bad Gateway", "Upstream closed the connection");
+	}
+
+	upstream.outstanding--;
+	recordLatency(upstream, Clock::secondsSince(start));
+	return std::move(*response);
+}
+
+std::optional<std::string> ReverseProxy::exchange(Upstream &upstream, std::string_view request, bool idempotent,
+												  ProxyDownstream &downstream)
+{
+	bool reused = false;
+	int fd = acquireConnection(upstream, reused);
+	if (fd < 0)
+	{
+		Logger::warn("Upstream {} unreachable, out of rotation until its next health check", upstream.name);
+		upstream.healthy = false;
+		upstream.errors++;
+		return errorResponse(502, "Bad Gateway", "Upstream unreachable");
+	}
+
+	auto fail = [&](std::string_view message) -> std::optional<std::string>
+	{
+		::close(fd);
+		upstream.errors++;
+		return errorResponse(502, "Bad Gateway", message);
+	};
+
+	if (!writeAll(fd, request, options_.timeout_ms))
+	{
+		if (!reused)
+			return fail("Upstream write failed");
+		::close(fd);
+		return std::nullopt;
+	}
+
+	// Head, and whatever part of the body arrives with it
+	std::string response;
+	size_t head_end;
+	char chunk[16384];
+	for (;;)
+	{
+		ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+		if (received <= 0)
+		{
+			// The upstream may have applied the request before closing, so
+			// only a repeatable one is sent again
+			if (reused && response.empty() && idempotent)
+			{
+				::close(fd);
+				return std::nullopt;
+			}
+			return fail(received == 0 ? "Upstream closed the connection" : "Upstream read failed");
+		}
+		response.append(chunk, static_cast<size_t>(received));
+		head_end = response.find("\r\n\r\n");
+		if (head_end != std::string::npos)
+			break;
+		if (response.size() > MAX_HEAD_BYTES)
+			return fail("Upstream response head too large");
+	}
+
+	const std::string_view head(response.data(), head_end + 2);
+	const size_t body_start = head_end + 4;
+	int status = 0;
+	if (size_t space = head.find(' '); space != std::string_view::npos)
+	{
+		std::from_chars(head.data() + space + 1, head.data() + head.size(), status);
+	}
+	if (!headerValue(head, "transfer-encoding").empty())
+	{
+		return fail("Chunked upstream responses are not supported");
+	}
+	const std::string_view connection = headerValue(head, "connection");
+	const bool keep_alive = connection.size() != 5 || strncasecmp(connection.data(), "close", 5) != 0;
+
+	std::optional<size_t> length;
+	if (status / 100 == 1 || status == 204 || status == 304)
+	{
+		length = 0;
+	}
+	else if (std::string_view value = headerValue(head, "content-length"); !value.empty())
+	{
+		size_t parsed = 0;
+		if (std::from_chars(value.data(), value.data() + value.size(), parsed).ec != std::errc())
+			return fail("Invalid upstream Content-Length");
+		length = parsed;
+	}
+
+	if (!length)
+	{
+		// Delimited by close: read it all and give the client a length
+		ssize_t received;
+		while ((received = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+		{
+			response.append(chunk, static_cast<size_t>(received));
+		}
+		::close(fd);
+		if (received < 0)
+		{
+			upstream.errors++;
+			return errorResponse(502, "Bad Gateway", "Upstream read failed");
+		}
+		std::string body = response.substr(body_start);
+		response.resize(head_end + 2);
+		response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+		return response;
+	}
+
+	const size_t total = body_start + *length;
+	if (response.size() < total && *length >= SPLICE_MIN_BYTES)
+	{
+		const size_t remaining = total - response.size();
+		const bool relayed = downstream.relayResponse(response, fd, remaining);
+		if (relayed && keep_alive)
+			releaseConnection(upstream, fd);
+		else
+			::close(fd);
+		if (!relayed)
+			upstream.errors++;
+		return std::string();
+	}
+
+	while (response.size() < total)
+	{
+		ssize_t received = recv(fd, chunk, std::min(sizeof(chunk), total - response.size()), 0);
+		if (received <= 0)
+			return fail("Upstream response truncated");
+		response.append(chunk, static_cast<size_t>(received));
+	}
+	// Anything past the body would be an unrequested response; don't reuse
+	if (response.size() == total && keep_alive)
+		releaseConnection(upstream, fd);
+	else
+		::close(fd);
+	response.resize(total);
+	return response;
+}
+
+int ReverseProxy::connectTo(Upstream &upstream)
+{
+	struct addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo *addresses = nullptr;
+	if (getaddrinfo(upstream.host.c_str(), std::to_string(upstream.port).c_str(), &hints, &addresses) != 0)
+	{
+		return -1;
+	}
+
+	int fd = -1;
+	for (auto *address = addresses; address != nullptr && fd < 0; address = address->ai_next)
+	{
+		fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+		if (fd < 0)
+			continue;
+		int result = ::connect(fd, address->ai_addr, address->ai_addrlen);
+		int error = 0;
+		socklen_t error_size = sizeof(error);
+		if (result < 0 && (errno != EINPROGRESS || !waitFor(fd, POLLOUT, options_.timeout_ms) ||
+						   getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) < 0 || error != 0))
+		{
+			::close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	if (fd < 0)
+		return -1;
+
+	// Blocking from here on, with the timeout on every read and write
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+	struct timeval timeout = {options_.timeout_ms / 1000, (options_.timeout_ms % 1000) * 1000};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+int ReverseProxy::acquireConnection(Upstream &upstream, bool &reused)
+{
+	{
+		std::lock_guard<ProfiledMutex> lock(upstream.mutex);
+		if (!upstream.idle.empty())
+		{
+			int fd = upstream.idle.back();
+			upstream.idle.pop_back();
+			reused = true;
+			return fd;
+		}
+	}
+	reused = false;
+	return connectTo(upstream);
+}
+
+void ReverseProxy::releaseConnection(Upstream &upstream, int fd)
+{
+	std::lock_guard<ProfiledMutex> lock(upstream.mutex);
+	if (upstream.idle.size() < options_.max_idle)
+	{
+		upstream.idle.push_back(fd);
+		return;
+	}
+	::close(fd);
+}
+
+void ReverseProxy::recordLatency(Upstream &upstream, double seconds)
+{
+	size_t bucket = 0;
+	while (bucket < LATENCY_BUCKETS_S.size() && seconds > LATENCY_BUCKETS_S[bucket])
+	{
+		++bucket;
+	}
+	std::lock_guard<ProfiledMutex> lock(upstream.mutex);
+	upstream.buckets[bucket]++;
+	upstream.latency_sum += seconds;
+	upstream.latency_count++;
+}
+
+bool ReverseProxy::writeAll(int fd, std::string_view data, int timeout_ms)
+{
+	while (!data.empty())
+	{
+		ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent > 0)
+		{
+			data.remove_prefix(static_cast<size_t>(sent));
+		}
+		else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			if (!waitFor(fd, POLLOUT, timeout_ms))
+				return false;
+		}
+		else if (sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ReverseProxy::spliceAll(int from, int to, size_t bytes, int timeout_ms)
+{
+	thread_local SplicePipe pipe;
+	if (pipe.read_fd < 0)
+	{
+		return false;
+	}
+
+	size_t in_pipe = 0;
+	while (bytes > 0 || in_pipe > 0)
+	{
+		if (bytes > 0)
+		{
+			ssize_t moved = splice(from, nullptr, pipe.write_fd, nullptr, bytes,
+								   SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+			if (moved > 0)
+			{
+				bytes -= static_cast<size_t>(moved);
+				in_pipe += static_cast<size_t>(moved);
+			}
+			else if (moved == 0)
+			{
+				pipe.drain(); // source closed early
+				return false;
+			}
+			else if (errno != EAGAIN && errno != EINTR)
+			{
+				pipe.drain();
+				return false;
+			}
+			else if (in_pipe == 0 && !waitFor(from, POLLIN, timeout_ms))
+			{
+				return false;
+			}
+		}
+
+		if (in_pipe > 0)
+		{
+			ssize_t moved = splice(pipe.read_fd, nullptr, to, nullptr, in_pipe,
+								   SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_NONBLOCK);
+			if (moved > 0)
+			{
+				in_pipe -= static_cast<size_t>(moved);
+			}
+			else if ((moved < 0 && errno != EAGAIN && errno != EINTR) ||
+					 (moved < 0 && errno == EAGAIN && !waitFor(to, POLLOUT, timeout_ms)))
+			{
+				pipe.drain();
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void ReverseProxy::startHealthChecks()
+{
+	health_thread_ = std::thread(&ReverseProxy::healthLoop, this);
+}
+
+void ReverseProxy::healthLoop()
+{
+	const auto interval = std::chrono::milliseconds(std::max(options_.health_interval_ms, 1));
+	for (;;)
+	{
+		for (auto &upstream : upstreams_)
+		{
+			httplib::Client client(upstream->host, upstream->port);
+			client.set_connection_timeout(std::chrono::milliseconds(options_.timeout_ms));
+			client.set_read_timeout(std::chrono::milliseconds(options_.timeout_ms));
+			auto result = client.Get("/health");
+			const bool healthy = result && result->status == 200;
+			if (healthy != upstream->healthy.exchange(healthy))
+			{
+				if (healthy)
+					Logger::info("Upstream {} is healthy again", upstream->name);
+				else
+					Logger::warn("Upstream {} failed its health check", upstream->name);
+			}
+		}
+
+		ProfiledLock lock(health_mutex_);
+		if (health_wake_.wait_for(lock, interval, [this]
+								  { return stopping_; }))
+		{
+			return;
+		}
+	}
+}
+
+std::string ReverseProxy::prometheusMetrics() const
+{
+	std::stringstream ss;
+	ss << "# HELP cpp_service_upstream_healthy Whether the upstream passed its last health check\n";
+	ss << "# TYPE cpp_service_upstream_healthy gauge\n";
+	for (const auto &upstream : upstreams_)
+	{
+		ss << "cpp_service_upstream_healthy{upstream=\"" << upstream->name << "\"} " << (upstream->healthy ? 1 : 0) << "\n";
+	}
+	ss << "\n# HELP cpp_service_upstream_outstanding Requests in flight to the upstream\n";
+	ss << "# TYPE cpp_service_upstream_outstanding gauge\n";
+	for (const auto &upstream : upstreams_)
+	{
+		ss << "cpp_service_upstream_outstanding{upstream=\"" << upstream->name << "\"} " << upstream->outstanding << "\n";
+	}
+	ss << "\n# HELP cpp_service_upstream_requests_total Requests forwarded to the upstream\n";
+	ss << "# TYPE cpp_service_upstream_requests_total counter\n";
+	for (const auto &upstream : upstreams_)
+	{
+		ss << "cpp_service_upstream_requests_total{upstream=\"" << upstream->name << "\"} " << upstream->requests << "\n";
+	}
+	ss << "\n# HELP cpp_service_upstream_errors_total Forwarded requests that failed at the upstream\n";
+	ss << "# TYPE cpp_service_upstream_errors_total counter\n";
+	for (const auto &upstream : upstreams_)
+	{
+		ss << "cpp_service_upstream_errors_total{upstream=\"" << upstream->name << "\"} " << upstream->errors << "\n";
+	}
+	ss << "\n# HELP cpp_service_upstream_duration_seconds Time to relay a request and its response\n";
+	ss << "# TYPE cpp_service_upstream_duration_seconds histogram\n";
+	for (const auto &upstream : upstreams_)
+	{
+		std::lock_guard<ProfiledMutex> lock(upstream->mutex);
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < upstream->buckets.size(); ++i)
+		{
+			cumulative += upstream->buckets[i];
+			ss << "cpp_service_upstream_duration_seconds_bucket{upstream=\"" << upstream->name << "\",le=\"";
+			if (i < LATENCY_BUCKETS_S.size())
+				ss << LATENCY_BUCKETS_S[i];
+			else
+				ss << "+Inf";
+			ss << "\"} " << cumulative << "\n";
+		}
+		ss << "cpp_service_upstream_duration_seconds_sum{upstream=\"" << upstream->name << "\"} " << upstream->latency_sum << "\n";
+		ss << "cpp_service_upstream_duration_seconds_count{upstream=\"" << upstream->name << "\"} " << upstream->latency_count << "\n";
+	}
+	ss << "\n";
+	return ss.str();
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <server/LockProfiler.h>
+
+// Where a forwarded response goes once its body is too large to copy:
+// writes head (status line, headers and any body bytes already read), then
+// moves body_bytes from upstream_fd straight to the client socket.
+class ProxyDownstream
+{
+public:
+	virtual ~ProxyDownstream() = default;
+
+	virtual bool relayResponse(std::string_view head, int upstream_fd, size_t body_bytes) = 0;
+};
+
+// Forwarding routes: requests under a path prefix are relayed to a pool of
+// upstream instances instead of being handled here, e.g. to front shards
+// or blue/green deployments. Each request goes to the healthy upstream with
+// the fewest requests in flight, over a pooled keep-alive connection
+// (blocking, with proxy.timeout_ms on every read and write). Requests are
+// already buffered by the server and are written out from userspace;
+// response bodies of SPLICE_MIN_BYTES or more are moved from the upstream
+// socket to the client with splice() through a per-thread pipe and never
+// enter userspace. A health thread polls every upstream's /health and
+// takes failing ones out of rotation; a failed connect does the same until
+// the next check. Upstreams must frame responses with Content-Length or
+// by closing the connection.
+class ReverseProxy
+{
+public:
+	struct Options
+	{
+		bool strip_prefix = true; // /blue/numbers/sum is sent as /numbers/sum
+		int timeout_ms = 5000;
+		int health_interval_ms = 2000;
+		size_t max_idle = 32; // pooled connections per upstream
+	};
+
+	struct Route
+	{
+		std::string prefix;
+		std::vector<size_t> upstreams; // indexes into upstreams_
+	};
+
+	static constexpr size_t SPLICE_MIN_BYTES = 64 * 1024;
+	static constexpr size_t MAX_HEAD_BYTES = 16 * 1024;
+	static constexpr std::array<double, 10> LATENCY_BUCKETS_S = {0.0005, 0.001, 0.0025, 0.005, 0.01,
+																 0.025, 0.05, 0.1, 0.25, 1};
+
+	// routes: "/blue=127.0.0.1:9001,127.0.0.1:9002;/green=10.0.0.2:8080";
+	// nullptr if it does not parse
+	static std::unique_ptr<ReverseProxy> create(std::string_view routes, Options options);
+	~ReverseProxy();
+
+	ReverseProxy(const ReverseProxy &) = delete;
+	ReverseProxy &operator=(const ReverseProxy &) = delete;
+
+	void startHealthChecks();
+
+	// Route whose prefix path falls under, if any
+	const Route *match(std::string_view path) const;
+	// Relays request (as received, head and body) and returns the response
+	// to send, or an empty string if it went through downstream
+	std::string forward(const Route &route, std::string_view request, std::string_view client_addr,
+						ProxyDownstream &downstream);
+
+	// Per-upstream health, load and latency histograms, in the /metrics format
+	std::string prometheusMetrics() const;
+
+	// Moves bytes from one descriptor to another through a pipe, waiting up
+	// to timeout_ms whenever either side stalls; false on error or timeout
+	static bool spliceAll(int from, int to, size_t bytes, int timeout_ms);
+	// Writes all of data to a possibly non-blocking descriptor
+	static bool writeAll(int fd, std::string_view data, int timeout_ms);
+
+	bool healthy(size_t upstream) const { return upstreams_[upstream]->healthy; }
+	size_t upstreamCount() const { return upstreams_.size(); }
+	const std::vector<Route> &routes() const { return routes_; }
+
+private:
+	struct Upstream
+	{
+		std::string host;
+		int port = 0;
+		std::string name; // host:port, for logs and labels
+		std::atomic<bool> healthy{true};
+		std::atomic<uint64_t> outstanding{0};
+		std::atomic<uint64_t> requests{0};
+		std::atomic<uint64_t> errors{0};
+
+		ProfiledMutex mutex{"ReverseProxy::Upstream::mutex"}; // guards idle and the histogram
+		std::vector<int> idle;
+		std::array<uint64_t, LATENCY_BUCKETS_S.size() + 1> buckets{};
+		double latency_sum = 0;
+		uint64_t latency_count = 0;
+	};
+
+	ReverseProxy(Options options) : options_(options) {}
+
+	size_t pick(const Route &route);
+	int connectTo(Upstream &upstream);
+	int acquireConnection(Upstream &upstream, bool &reused);
+	void releaseConnection(Upstream &upstream, int fd);
+	// One attempt; nullopt when a reused connection turned out to be closed
+	// and the request may be retried on a fresh one: it was not delivered,
+	// or it is idempotent and no answer had started
+	std::optional<std::string> exchange(Upstream &upstream, std::string_view request, bool idempotent,
+										ProxyDownstream &downstream);
+	void recordLatency(Upstream &upstream, double seconds);
+	void healthLoop();
+
+	const Options options_;
+	std::vector<std::unique_ptr<Upstream>> upstreams_;
+	std::vector<Route> routes_;
+	std::atomic<uint64_t> rotation_{0}; // breaks ties between equally loaded upstreams
+
+	std::thread health_thread_;
+	ProfiledMutex health_mutex_{"ReverseProxy::health_mutex_"};
+	ProfiledConditionVariable health_wake_;
+	bool stopping_ = false;
+};
@@ -0,0 +1,60 @@
+#include <cstring>
+#include <ctime>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <server/RxTimestamps.h>
+
+bool RxTimestamps::enable(int fd)
+{
+	int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	return setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+}
+
+ssize_t RxTimestamps::receive(int fd, char *buffer, size_t size, int64_t &queued_ns)
+{
+	queued_ns = -1;
+
+	iovec iov{buffer, size};
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+	msghdr message{};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	ssize_t bytes_read = recvmsg(fd, &message, MSG_DONTWAIT);
+	if (bytes_read <= 0)
+	{
+		return bytes_read;
+	}
+
+	for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg))
+	{
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+		{
+			continue;
+		}
+		// ts[0] is the software stamp, on CLOCK_REALTIME; zero when the
+		// segment arrived before stamping was switched on
+		scm_timestamping stamps;
+		std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+		if (stamps.ts[0].tv_sec == 0 && stamps.ts[0].tv_nsec == 0)
+		{
+			break;
+		}
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		const int64_t queued = (static_cast<int64_t>(now.tv_sec) - stamps.ts[0].tv_sec) * 1'000'000'000 +
+							   (now.tv_nsec - stamps.ts[0].tv_nsec);
+		// A wall clock step can put the stamp in the future
+		if (queued >= 0)
+		{
+			queued_ns = queued;
+		}
+		break;
+	}
+	return bytes_read;
+}
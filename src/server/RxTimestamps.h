@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// Software receive timestamps (SO_TIMESTAMPING) on stream sockets. The
+// kernel stamps each segment as it takes it in, so a request's latency can
+// start at its arrival instead of when the event loop gets to it. For TCP,
+// recvmsg() hands back the stamp of the LAST segment a read copied, so when
+// a read spans several segments the delays derived from it are lower
+// bounds: the earlier segments waited longer.
+class RxTimestamps
+{
+public:
+	// Asks the kernel to stamp what arrives on fd, and on the connections a
+	// listening fd accepts; false if it refuses. Stamping starts shortly
+	// after the first socket of the system asks for it.
+	static bool enable(int fd);
+
+	// recv(MSG_DONTWAIT) that also sets queued_ns to how long the last
+	// segment of the returned bytes waited in the receive queue, or -1
+	// without a stamp
+	static ssize_t receive(int fd, char *buffer, size_t size, int64_t &queued_ns);
+};
@@ -1,12 +1,25 @@
 #include <iostream>
+#include <charconv>
 #include <csignal>
 #include <chrono>
 #include <utility>
 
+#include <codec/Codec.h>
+#include <common/Clock.h>
+#include <common/Tracer.h>
+#include <config/Config.h>
 #include <logging/Logger.h>
+#include <server/Allocator.h>
+#include <server/LockProfiler.h>
 #include <server/Metrics.h>
 #include <server/Server.h>
 
+namespace
+{
+	// Matches the resolution of the multiplexing server's reactor ticks or better
+	constexpr auto CLOCK_TICK_INTERVAL = std::chrono::milliseconds(10);
+}
+
 // Initialize static member
 Server *Server::global_instance_ = nullptr;
 
@@ -63,6 +76,14 @@ bool Server::start()
 			return false;
 		}
 
+		clock_thread_ = std::thread([this]
+									{
+			while (!shutdown_requested_)
+			{
+				Clock::tick();
+				std::this_thread::sleep_for(CLOCK_TICK_INTERVAL);
+			} });
+
 		Logger::info("Server started successfully on {}", getAddress());
 		return true;
 	}
@@ -114,6 +135,10 @@ void Server::stop()
 	{
 		server_thread_.join();
 	}
+	if (clock_thread_.joinable())
+	{
+		clock_thread_.join();
+	}
 
 	cleanup();
 }
@@ -153,6 +178,8 @@ void Server::runServer()
 void Server::initializeServer()
 {
 	Logger::initialize();
+	// Measured now rather than inside the first request
+	Clock::calibrate();
 
 	// Initialize components
 	request_handler_ = std::make_unique<RequestHandler>();
@@ -168,8 +195,49 @@ void Server::initializeServer()
 	server_->set_read_timeout(30, 0);  // 30 seconds
 	server_->set_write_timeout(30, 0); // 30 seconds
 
+	// Handler plugins; reloaded only through POST /debug/plugins/reload here,
+	// as no event loop of this server watches the directory
+	const std::string plugin_directory = Config::getString("plugins.directory", "");
+	if (!plugin_directory.empty())
+	{
+		plugins_ = std::make_unique<PluginHost>();
+		if (!plugins_->open(plugin_directory))
+		{
+			throw std::runtime_error("Failed to watch plugin directory");
+		}
+	}
+
 	setupRoutes();
 	shutdown_requested_ = false;
+
+	if (Config::getInt("server.udp_port", 0) > 0)
+	{
+		Logger::warn("server.udp_port is ignored: UDP ingestion runs on the multiplexing server");
+	}
+	if (!Config::getString("server.shm_socket", "").empty())
+	{
+		Logger::warn("server.shm_socket is ignored: shared-memory ingestion runs on the multiplexing server");
+	}
+	if (!Config::getString("server.tail_directory", "").empty())
+	{
+		Logger::warn("server.tail_directory is ignored: file tailing runs on the multiplexing server");
+	}
+	if (Config::getInt("mirror.port", 0) > 0)
+	{
+		Logger::warn("mirror.port is ignored: request mirroring runs on the multiplexing server");
+	}
+	if (!Config::getString("proxy.routes", "").empty())
+	{
+		Logger::warn("proxy.routes is ignored: forwarding runs on the multiplexing server");
+	}
+	if (Config::getBool("server.rx_timestamps", false))
+	{
+		Logger::warn("server.rx_timestamps is ignored: receive timestamps are read by the multiplexing server");
+	}
+	if (Config::getBool("server.perf_counters", false))
+	{
+		Logger::warn("server.perf_counters is ignored: request stages are measured on the multiplexing server");
+	}
 }
 
 void Server::cleanup()
@@ -187,6 +255,7 @@ void Server::cleanup()
 	{
 		server_.reset();
 	}
+	plugins_.reset();
 
 	// Reset state flags
 	running_ = false;
@@ -234,48 +303,85 @@ void Server::setupRoutes()
         auto& metrics = Metrics::getInstance();
         res.set_content(metrics.getPrometheusMetrics(), "text/plain"); });
 
-	server_->Get("/numbers/sum", [this](const httplib::Request &, httplib::Response &res)
+	// Allocator statistics endpoint
+	server_->Get("/debug/allocator", [](const httplib::Request &, httplib::Response &res)
+				 {
+        Logger::debug("Allocator statistics request");
+        res.set_content(Allocator::toJson(), "application/json"); });
+
+	server_->Get("/debug/locks", [](const httplib::Request &, httplib::Response &res)
+				 {
+        Logger::debug("Lock profile request");
+        res.set_content(LockProfiler::toJson(), "application/json"); });
+
+	server_->Get("/debug/trace", [](const httplib::Request &req, httplib::Response &res)
+				 {
+        Logger::debug("Trace capture request");
+        int window_ms = 100;
+        const std::string ms = req.get_param_value("ms");
+        std::from_chars(ms.data(), ms.data() + ms.size(), window_ms);
+        res.set_content(Tracer::capture(window_ms), "application/json"); });
+
+	if (plugins_)
+	{
+		server_->Get("/debug/plugins", [this](const httplib::Request &, httplib::Response &res)
+					 {
+            Logger::debug("Plugin list request");
+            res.set_content(plugins_->describeJson(), "application/json"); });
+
+		server_->Post("/debug/plugins/reload", [this](const httplib::Request &, httplib::Response &res)
+					  {
+            Logger::info("Plugin reload requested");
+            const size_t loaded = plugins_->reload();
+            res.set_content(R"({"plugins": )" + std::to_string(loaded) + R"(, "success": true})", "application/json"); });
+	}
+
+	server_->Get("/numbers/sum", [this](const httplib::Request &req, httplib::Response &res)
 				 {
     Logger::debug("Total numbers sum request");
-    auto total_sum = request_handler_->getTotalNumbersSum();
-    res.set_content(R"({"total_numbers_sum": )" + std::to_string(total_sum) + R"(, "success": true})", "application/json"); });
+    auto format = codec::formatFromAccept(req.get_header_value("Accept"), codec::Format::Json);
+    res.set_content(request_handler_->totalSumResponse(format), codec::contentType(format)); });
 
 	// Client numbers tracking endpoint
 	server_->Get("/numbers/sum/(.*)", [this](const httplib::Request &req, httplib::Response &res)
 				 {
     std::string client_id = req.matches[1];
     Logger::debug("Client numbers sum request for: {}", client_id);
-    auto client_sum = request_handler_->getClientNumbersSum(client_id);
-    res.set_content(R"({"client_id": ")" + client_id + R"(", "numbers_sum": )" + std::to_string(client_sum) + R"(, "success": true})", "application/json"); });
+    auto format = codec::formatFromAccept(req.get_header_value("Accept"), codec::Format::Json);
+    res.set_content(request_handler_->clientSumResponse(client_id, format), codec::contentType(format)); });
+
+	// Per-client statistics endpoint
+	server_->Get("/numbers/stats/(.*)", [this](const httplib::Request &req, httplib::Response &res)
+				 {
+    std::string client_id = req.matches[1];
+    Logger::debug("Client statistics request for: {}", client_id);
+    auto format = codec::formatFromAccept(req.get_header_value("Accept"), codec::Format::Json);
+    res.set_content(request_handler_->clientStatsResponse(client_id, format), codec::contentType(format)); });
 
 	// All clients numbers endpoint
-	server_->Get("/numbers/sum-all", [this](const httplib::Request &, httplib::Response &res)
+	server_->Get("/numbers/sum-all", [this](const httplib::Request &req, httplib::Response &res)
 				 {
     Logger::debug("All clients numbers sum request");
-    auto all_sums = request_handler_->getAllClientSums();
-    
-    rapidjson::Document doc;
-    doc.SetObject();
-    rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
-    
-    doc.AddMember("success", true, allocator);
-    
-    rapidjson::Value clients(rapidjson::kObjectType);
-    for (const auto& [client_id, sum] : all_sums) {
-        clients.AddMember(
-            rapidjson::Value(client_id.c_str(), allocator).Move(),
-            rapidjson::Value(static_cast<int64_t>(sum)), // Fix: cast to int64_t
-            allocator
-        );
-    }
-    doc.AddMember("clients", clients, allocator);
-    doc.AddMember("total", rapidjson::Value(static_cast<int64_t>(request_handler_->getTotalNumbersSum())), allocator); // Fix: cast to int64_t
-    
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
-    
-    res.set_content(buffer.GetString(), "application/json"); });
+    auto format = codec::formatFromAccept(req.get_header_value("Accept"), codec::Format::Json);
+    res.set_content(request_handler_->allClientSumsResponse(format), codec::contentType(format)); });
+
+	// Ordered client range endpoint
+	server_->Get("/numbers/range", [this](const httplib::Request &req, httplib::Response &res)
+				 {
+    Logger::debug("Client range request");
+    auto format = codec::formatFromAccept(req.get_header_value("Accept"), codec::Format::Json);
+    res.set_content(request_handler_->clientRangeResponse(req.get_param_value("from"), req.get_param_value("to"),
+                                                          req.get_param_value("limit"), format),
+                    codec::contentType(format)); });
+
+	// Many client sums in one request, answered in request order
+	server_->Post("/numbers/sum/multi", [this](const httplib::Request &req, httplib::Response &res)
+				  {
+    Logger::debug("Multi client numbers sum request");
+    auto request_format = codec::formatFromContentType(req.get_header_value("Content-Type"));
+    auto response_format = codec::formatFromAccept(req.get_header_value("Accept"), request_format);
+    res.set_content(request_handler_->clientSumsResponse(req.body, request_format, response_format),
+                    codec::contentType(response_format)); });
 
 	// Root endpoint - API documentation
 	server_->Get("/", [](const httplib::Request &, httplib::Response &res)
@@ -291,7 +397,16 @@ void Server::setupRoutes()
 				"GET /numbers/sum": "Get total sum of all processed numbers",
 				"GET /numbers/sum/{client_id}": "Get sum of numbers for specific client",
 				"GET /numbers/sum-all": "Get sums for all clients",
-				"POST /process": "Process JSON request synchronously",
+				"GET /numbers/stats/{client_id}": "Get count, min, max, mean, variance and last seen time for a client",
+				"GET /numbers/range?from=&to=&limit=": "Get sums for a range of user ids in id order",
+				"GET /debug/allocator": "Allocator heap statistics",
+				"GET /debug/locks": "Mutex contention, in builds with SERVICE_LOCK_PROFILING",
+				"GET /debug/trace?ms=": "Chrome trace of all threads over the next ms milliseconds, in builds with SERVICE_TRACING",
+				"GET /debug/plugins": "Loaded handler plugins and their routes, when plugins are on",
+				"POST /debug/plugins/reload": "Rescan the plugin directory",
+				"POST /numbers/sum/multi": "Get sums for an array of client ids in request order",
+				"POST /process": "Process a request synchronously as JSON, MessagePack or CBOR",
+				"POST /process-batch": "Process an array of requests as JSON, MessagePack or CBOR",
 				"POST /process-async": "Process JSON request asynchronously"
 			}
 		})", "application/json"); });
@@ -303,7 +418,7 @@ void Server::setupRoutes()
         metrics.incrementRequests();
         metrics.incrementBytesReceived(req.body.size());
         
-        auto start_time = std::chrono::steady_clock::now();
+        const Clock::Ticks start = Clock::ticks();
         
         if (req.body.empty()) {
             Logger::warn("Empty request body");
@@ -316,10 +431,12 @@ void Server::setupRoutes()
         }
         
         try {
-            auto response = request_handler_->processRequest(req.body);
+            auto request_format = codec::formatFromContentType(req.get_header_value("Content-Type"));
+            auto response_format = codec::formatFromAccept(req.get_header_value("Accept"), request_format);
+            auto response = request_handler_->processRequest(req.body, request_format, response_format);
             metrics.incrementSuccessfulRequests();
             metrics.incrementBytesSent(response.size());
-            res.set_content(std::move(response), "application/json");
+            res.set_content(std::move(response), codec::contentType(response_format));
         } 
         catch (const std::exception& e) {
             metrics.incrementFailedRequests();
@@ -330,9 +447,47 @@ void Server::setupRoutes()
             res.set_content(error_response, "application/json");
         }
         
-        auto end_time = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-        double duration_seconds = duration.count() / 1000000.0;
+        double duration_seconds = Clock::secondsSince(start);
+        metrics.updateRequestDuration(duration_seconds);
+        metrics.updateRequestDurationHistogram(duration_seconds); });
+
+	// Batch processing endpoint: an array of /process payloads in one body
+	server_->Post("/process-batch", [this](const httplib::Request &req, httplib::Response &res)
+				  {
+        auto& metrics = Metrics::getInstance();
+        metrics.incrementRequests();
+        metrics.incrementBytesReceived(req.body.size());
+
+        const Clock::Ticks start = Clock::ticks();
+
+        if (req.body.empty()) {
+            Logger::warn("Empty request body");
+            metrics.incrementFailedRequests();
+            res.status = 400;
+            std::string error_response = R"({"error": "Empty request body", "success": false})";
+            metrics.incrementBytesSent(error_response.size());
+            res.set_content(error_response, "application/json");
+            return;
+        }
+
+        try {
+            auto request_format = codec::formatFromContentType(req.get_header_value("Content-Type"));
+            auto response_format = codec::formatFromAccept(req.get_header_value("Accept"), request_format);
+            auto response = request_handler_->processBatch(req.body, request_format, response_format);
+            metrics.incrementSuccessfulRequests();
+            metrics.incrementBytesSent(response.size());
+            res.set_content(std::move(response), codec::contentType(response_format));
+        }
+        catch (const std::exception& e) {
+            metrics.incrementFailedRequests();
+            Logger::error("Batch processing error: {}", e.what());
+            res.status = 500;
+            std::string error_response = R"({"error": "Internal server error", "success": false})";
+            metrics.incrementBytesSent(error_response.size());
+            res.set_content(error_response, "application/json");
+        }
+
+        double duration_seconds = Clock::secondsSince(start);
         metrics.updateRequestDuration(duration_seconds);
         metrics.updateRequestDurationHistogram(duration_seconds); });
 
@@ -343,7 +498,7 @@ void Server::setupRoutes()
         metrics.incrementRequests();
         metrics.incrementBytesReceived(req.body.size());
         
-        auto start_time = std::chrono::steady_clock::now();
+        const Clock::Ticks start = Clock::ticks();
         
         if (req.body.empty()) {
             Logger::warn("Empty request body");
@@ -372,18 +527,35 @@ void Server::setupRoutes()
             res.set_content(error_response, "application/json");
         }
         
-        auto end_time = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-        double duration_seconds = duration.count() / 1000000.0;
+        double duration_seconds = Clock::secondsSince(start);
         metrics.updateRequestDuration(duration_seconds);
         metrics.updateRequestDurationHistogram(duration_seconds); });
 
 	// Connection tracking - Add connection callbacks
-	server_->set_pre_routing_handler([&](const httplib::Request & /*req*/, httplib::Response & /*res*/)
+	// Plugin routes are matched ahead of the built-in ones; every execution
+	// class runs on this server's thread pool
+	server_->set_pre_routing_handler([&](const httplib::Request &req, httplib::Response &res)
 									 {
         auto& metrics = Metrics::getInstance();
         metrics.incrementConnections();
-        return httplib::Server::HandlerResponse::Unhandled; });
+        if (!plugins_) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+        auto handler = plugins_->find(req.method, req.path);
+        if (!handler) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+        const std::string content_type = req.get_header_value("Content-Type");
+        const std::string accept = req.get_header_value("Accept");
+        auto response = handler.invoke(PluginHost::makeRequest(req.method, req.target, req.body, content_type, accept));
+        if (response) {
+            res.status = response->status;
+            res.set_content(response->body.data(), response->body.size(), std::string(response->content_type));
+        } else {
+            res.status = 500;
+            res.set_content(R"({"error": "Plugin failed", "success": false})", "application/json");
+        }
+        return httplib::Server::HandlerResponse::Handled; });
 
 	server_->set_post_routing_handler([&](const httplib::Request & /*req*/, httplib::Response & /*res*/)
 									  {
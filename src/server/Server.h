@@ -6,6 +6,7 @@
 #include <string>
 
 #include <common/httplib.h>
+#include <server/PluginHost.h>
 #include <server/RequestHandler.h>
 #include <server/IServer.h>
 
@@ -60,7 +61,9 @@ private:
 	// Server components
 	std::unique_ptr<httplib::Server> server_;
 	std::unique_ptr<RequestHandler> request_handler_;
+	std::unique_ptr<PluginHost> plugins_; // when plugins.directory is set
 	std::thread server_thread_;
+	std::thread clock_thread_; // ticks the coarse Clock, which has no reactor here
 
 	// Signal handling - make it non-static instance pointer
 	static Server *global_instance_;
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/Clock.h>
+#include <logging/Logger.h>
+#include <server/Metrics.h>
+#include <server/RequestHandler.h>
+#include <server/ShmIngest.h>
+
+namespace
+{
+	void cpuRelax()
+	{
+#if defined(__SSE2__)
+		_mm_pause();
+#endif
+	}
+}
+
+ShmIngest::ShmIngest(RequestHandler &handler, size_t spin_polls)
+	: handler_(handler), spin_polls_(spin_polls), records_(BATCH)
+{
+	updates_.reserve(BATCH);
+}
+
+ShmIngest::~ShmIngest()
+{
+	stop();
+}
+
+bool ShmIngest::start(const std::string &socket_path)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path))
+	{
+		Logger::error("Invalid shared-memory ingestion socket path '{}'", socket_path);
+		return false;
+	}
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+	wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (listen_fd_ < 0 || epoll_fd_ < 0 || wake_fd_ < 0)
+	{
+		Logger::error("Failed to set up shared-memory ingestion: {}", strerror(errno));
+		stop();
+		return false;
+	}
+
+	::unlink(socket_path.c_str());
+	if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listen_fd_, 16) < 0)
+	{
+		Logger::error("Failed to listen on {}: {}", socket_path, strerror(errno));
+		stop();
+		return false;
+	}
+	socket_path_ = socket_path;
+
+	for (int fd : {listen_fd_, wake_fd_})
+	{
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+	}
+
+	running_ = true;
+	thread_ = std::thread(&ShmIngest::run, this);
+	Logger::info("Shared-memory ingestion listening on {}", socket_path);
+	return true;
+}
+
+void ShmIngest::stop()
+{
+	if (running_.exchange(false))
+	{
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+	}
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+
+	while (!producers_.empty())
+	{
+		closeProducer(producers_.back()->socket);
+	}
+	for (const auto &handshake : handshakes_)
+	{
+		::close(handshake.socket);
+	}
+	handshakes_.clear();
+	for (int *fd : {&listen_fd_, &epoll_fd_, &wake_fd_})
+	{
+		if (*fd >= 0)
+		{
+			::close(*fd);
+			*fd = -1;
+		}
+	}
+	if (!socket_path_.empty())
+	{
+		::unlink(socket_path_.c_str());
+		socket_path_.clear();
+	}
+}
+
+void ShmIngest::run()
+{
+	size_t idle_passes = 0;
+	// This thread spins past the reactor's ticks, so it reads the fine clock
+	const Clock::Ticks events_interval = Clock::fromSeconds(0.01);
+	Clock::Ticks last_events = Clock::ticks();
+	while (running_.load(std::memory_order_relaxed))
+	{
+		if (drain() > 0)
+		{
+			idle_passes = 0;
+			const Clock::Ticks now = Clock::ticks();
+			if (now - last_events >= events_interval)
+			{
+				handleEvents(0);
+				last_events = now;
+			}
+			continue;
+		}
+
+		if (++idle_passes < spin_polls_)
+		{
+			cpuRelax();
+			continue;
+		}
+
+		// Block only if no record slipped in after the last pass
+		bool asleep = true;
+		for (auto &producer : producers_)
+		{
+			if (!producer->ring.consumerSleep())
+			{
+				asleep = false;
+				break;
+			}
+		}
+		if (asleep)
+		{
+			counters_.sleeps++;
+			Metrics::getInstance().incrementShmSleeps();
+			handleEvents(1000);
+		}
+		for (auto &producer : producers_)
+		{
+			producer->ring.consumerWake();
+		}
+		idle_passes = 0;
+		last_events = Clock::ticks();
+	}
+}
+
+size_t ShmIngest::drain()
+{
+	size_t total = 0;
+	for (auto &producer : producers_)
+	{
+		const size_t count = producer->ring.pop(records_);
+		apply(count);
+		total += count;
+	}
+	if (!updates_.empty())
+	{
+		handler_.recordUpdates(updates_);
+		updates_.clear();
+	}
+	return total;
+}
+
+void ShmIngest::apply(size_t count)
+{
+	size_t rejected = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Same rule as UserData.id over HTTP
+		if (records_[i].id < 0)
+		{
+			rejected++;
+			continue;
+		}
+		updates_.push_back({records_[i].id, records_[i].number});
+	}
+	if (count > 0)
+	{
+		counters_.records += count - rejected;
+		counters_.rejected += rejected;
+		Metrics::getInstance().addShmRecords(count - rejected, rejected);
+	}
+}
+
+void ShmIngest::handleEvents(int timeout_ms)
+{
+	epoll_event events[16];
+	int count = epoll_wait(epoll_fd_, events, 16, timeout_ms);
+	for (int i = 0; i < count; ++i)
+	{
+		const int fd = events[i].data.fd;
+		if (fd == listen_fd_)
+		{
+			acceptProducer();
+		}
+		else if (fd == wake_fd_)
+		{
+			uint64_t value;
+			[[maybe_unused]] ssize_t got = read(wake_fd_, &value, sizeof(value));
+		}
+		else if (!continueHandshake(fd))
+		{
+			// Producers send nothing after the handshake: data or EOF ends the session
+			char byte;
+			ssize_t got = recv(fd, &byte, 1, MSG_DONTWAIT);
+			if (got >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+			{
+				closeProducer(fd);
+			}
+		}
+	}
+	expireHandshakes();
+}
+
+void ShmIngest::acceptProducer()
+{
+	int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	// The hello usually follows connect() at once, but is read only when
+	// epoll reports it; the registration carries over to the producer
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLRDHUP;
+	event.data.fd = fd;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+	handshakes_.push_back({.socket = fd, .deadline = Clock::ticks() + Clock::fromSeconds(HANDSHAKE_SECONDS)});
+	continueHandshake(fd);
+}
+
+bool ShmIngest::continueHandshake(int socket)
+{
+	auto it = std::find_if(handshakes_.begin(), handshakes_.end(), [&](const Handshake &handshake)
+						   { return handshake.socket == socket; });
+	if (it == handshakes_.end())
+	{
+		return false;
+	}
+
+	const ssize_t got = recv(socket, reinterpret_cast<char *>(&it->hello) + it->received,
+							 sizeof(it->hello) - it->received, MSG_DONTWAIT);
+	if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		return true;
+	}
+	if (got > 0)
+	{
+		it->received += static_cast<size_t>(got);
+		if (it->received < sizeof(it->hello))
+		{
+			return true;
+		}
+	}
+
+	const ShmRing::Hello hello = it->hello;
+	const bool complete = it->received == sizeof(hello);
+	handshakes_.erase(it);
+	if (!complete || hello.magic != ShmRing::MAGIC || hello.version != ShmRing::VERSION ||
+		(hello.mode != ShmRing::Mode::SingleProducer && hello.mode != ShmRing::Mode::MultiProducer))
+	{
+		Logger::warn("Rejected shared-memory producer with a bad handshake");
+		::close(socket);
+		return true;
+	}
+	addProducer(socket, hello);
+	return true;
+}
+
+void ShmIngest::expireHandshakes()
+{
+	if (handshakes_.empty())
+	{
+		return;
+	}
+	const Clock::Ticks now = Clock::ticks();
+	std::erase_if(handshakes_, [&](const Handshake &handshake)
+				  {
+		if (now < handshake.deadline)
+			return false;
+		Logger::warn("Rejected shared-memory producer that sent no handshake");
+		::close(handshake.socket);
+		return true; });
+}
+
+void ShmIngest::addProducer(int fd, ShmRing::Hello hello)
+{
+	auto producer = std::make_unique<Producer>();
+	producer->socket = fd;
+	hello.capacity = ShmRing::roundCapacity(hello.capacity);
+	producer->size = ShmRing::bytesFor(hello.capacity);
+
+	int memfd = memfd_create("service-shm-ring", MFD_CLOEXEC);
+	if (memfd < 0 || ftruncate(memfd, static_cast<off_t>(producer->size)) < 0 ||
+		(producer->memory = mmap(nullptr, producer->size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) == MAP_FAILED)
+	{
+		Logger::error("Failed to create a shared-memory ring: {}", strerror(errno));
+		if (memfd >= 0)
+			::close(memfd);
+		::close(fd);
+		return;
+	}
+	producer->ring = ShmRing::create(producer->memory, hello.capacity, hello.mode);
+
+	iovec iov{&hello, sizeof(hello)};
+	alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+	msghdr message{};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	cmsghdr *rights = CMSG_FIRSTHDR(&message);
+	rights->cmsg_level = SOL_SOCKET;
+	rights->cmsg_type = SCM_RIGHTS;
+	rights->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	const int fds[2] = {memfd, wake_fd_};
+	std::memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+
+	const bool sent = sendmsg(fd, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(hello));
+	::close(memfd);
+	if (!sent)
+	{
+		munmap(producer->memory, producer->size);
+		::close(fd);
+		return;
+	}
+
+	producers_.push_back(std::move(producer));
+	counters_.producers = producers_.size();
+	Metrics::getInstance().setShmProducers(producers_.size());
+	Logger::info("Shared-memory producer connected with a {}-record ring", hello.capacity);
+}
+
+void ShmIngest::closeProducer(int socket)
+{
+	auto it = std::find_if(producers_.begin(), producers_.end(), [&](const auto &producer)
+						   { return producer->socket == socket; });
+	if (it == producers_.end())
+	{
+		return;
+	}
+
+	Producer &producer = **it;
+	// Records pushed before the producer left still count
+	while (size_t count = producer.ring.pop(records_))
+	{
+		apply(count);
+		handler_.recordUpdates(updates_);
+		updates_.clear();
+	}
+
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+	::close(socket);
+	munmap(producer.memory, producer.size);
+	producers_.erase(it);
+	counters_.producers = producers_.size();
+	Metrics::getInstance().setShmProducers(producers_.size());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/Clock.h>
+#include <common/ShmRing.h>
+#include <server/ClientAggregates.h>
+
+class RequestHandler;
+
+// Consumer end of shared-memory ingestion (see ShmRing and ShmProducer).
+// Listens on a Unix socket; each producer that connects gets its own ring
+// in a fresh memfd, sent back together with the eventfd all producers use
+// to wake this side. One thread takes up to BATCH records from every ring
+// per pass, rejects negative ids and applies the rest in one
+// RequestHandler::recordUpdates() call. Polling is adaptive: after
+// spin_polls passes without records the thread raises each ring's sleeping
+// flag and blocks in epoll until a producer signals, connects or leaves.
+// While records keep coming neither side makes a syscall; the sockets are
+// polled about every 10 ms then, for new and departing producers. A
+// connecting producer's hello is read as it arrives on the same epoll set,
+// so a silent peer never holds up the rings; it is dropped after
+// HANDSHAKE_SECONDS.
+class ShmIngest
+{
+public:
+	struct Counters
+	{
+		std::atomic<uint64_t> records{0};
+		std::atomic<uint64_t> rejected{0};
+		std::atomic<uint64_t> sleeps{0}; // times the thread blocked on an idle ring
+		std::atomic<uint64_t> producers{0};
+	};
+
+	static constexpr size_t BATCH = 1024;
+	static constexpr double HANDSHAKE_SECONDS = 1.0;
+
+	explicit ShmIngest(RequestHandler &handler, size_t spin_polls = 2000);
+	~ShmIngest();
+
+	ShmIngest(const ShmIngest &) = delete;
+	ShmIngest &operator=(const ShmIngest &) = delete;
+
+	// Binds socket_path, replacing a stale socket file, and starts the thread
+	bool start(const std::string &socket_path);
+	// Applies what the rings still hold, then disconnects every producer
+	void stop();
+
+	const Counters &counters() const { return counters_; }
+
+private:
+	struct Producer
+	{
+		int socket = -1;
+		void *memory = nullptr;
+		size_t size = 0;
+		ShmRing ring;
+	};
+
+	// An accepted socket whose hello has not fully arrived
+	struct Handshake
+	{
+		int socket = -1;
+		ShmRing::Hello hello{};
+		size_t received = 0;
+		Clock::Ticks deadline = 0;
+	};
+
+	void run();
+	size_t drain();
+	void apply(size_t count);
+	void handleEvents(int timeout_ms);
+	void acceptProducer();
+	// Reads what arrived of the hello on a handshaking socket; false if the
+	// socket is not handshaking
+	bool continueHandshake(int socket);
+	void expireHandshakes();
+	void addProducer(int socket, ShmRing::Hello hello);
+	void closeProducer(int socket);
+
+	RequestHandler &handler_;
+	const size_t spin_polls_;
+	std::string socket_path_;
+	int listen_fd_ = -1;
+	int epoll_fd_ = -1;
+	int wake_fd_ = -1;
+	std::vector<std::unique_ptr<Producer>> producers_;
+	std::vector<Handshake> handshakes_;
+	std::vector<ShmRing::Record> records_;
+	std::vector<ClientAggregates::Update> updates_;
+	std::atomic<bool> running_{false};
+	std::thread thread_;
+	Counters counters_;
+};
@@ -0,0 +1,668 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/rapidjson/document.h>
+#include <server/JsonBackend.h>
+
+// Stage 1 classifies 64-byte blocks into bitmasks (quotes, backslashes,
+// structural operators, control bytes), resolves escapes and string spans with
+// bit arithmetic, and emits the offsets of structural characters. Stage 2
+// walks only those offsets. Every byte outside strings is still checked, so
+// the backend accepts and rejects exactly what rapidjson::Document does.
+
+namespace
+{
+	constexpr size_t BLOCK_SIZE = 64;
+
+	struct BlockMasks
+	{
+		uint64_t quote;
+		uint64_t backslash;
+		uint64_t op;	  // { } [ ] : ,
+		uint64_t control; // bytes below 0x20
+	};
+
+	inline BlockMasks classifyBlock(const char *block)
+	{
+		BlockMasks masks{0, 0, 0, 0};
+#if defined(__SSE2__)
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i case_bit = _mm_set1_epi8(0x20);
+		const __m128i open = _mm_set1_epi8('{');  // '[' | 0x20 == '{'
+		const __m128i close = _mm_set1_epi8('}'); // ']' | 0x20 == '}'
+		const __m128i colon = _mm_set1_epi8(':');
+		const __m128i comma = _mm_set1_epi8(',');
+		const __m128i control_max = _mm_set1_epi8(0x1F);
+
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+			__m128i folded = _mm_or_si128(v, case_bit);
+			__m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+									  _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+			__m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max);
+
+			const int shift = 16 * i;
+			masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+			masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+			masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(op))) << shift;
+			masks.control |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(control))) << shift;
+		}
+#else
+		for (size_t i = 0; i < BLOCK_SIZE; ++i)
+		{
+			const unsigned char c = static_cast<unsigned char>(block[i]);
+			const uint64_t bit = uint64_t{1} << i;
+			if (c == '"')
+				masks.quote |= bit;
+			else if (c == '\\')
+				masks.backslash |= bit;
+			else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')
+				masks.op |= bit;
+			else if (c < 0x20)
+				masks.control |= bit;
+		}
+#endif
+		return masks;
+	}
+
+	// Bit i of the result is the XOR of bits 0..i: set for every byte from an
+	// opening quote up to (not including) its closing quote
+	inline uint64_t prefixXor(uint64_t x)
+	{
+		x ^= x << 1;
+		x ^= x << 2;
+		x ^= x << 4;
+		x ^= x << 8;
+		x ^= x << 16;
+		x ^= x << 32;
+		return x;
+	}
+
+	// Marks bytes preceded by an unescaped backslash. Backslashes are rare in our
+	// payloads, so this walks them one by one instead of using carry tricks.
+	inline uint64_t findEscaped(uint64_t backslash, uint64_t &carry)
+	{
+		uint64_t escaped = carry;
+		backslash &= ~carry;
+		carry = 0;
+
+		while (backslash)
+		{
+			const int bit = __builtin_ctzll(backslash);
+			if (bit == 63)
+			{
+				carry = 1;
+				break;
+			}
+			escaped |= uint64_t{1} << (bit + 1);
+			backslash &= ~(uint64_t{3} << bit);
+		}
+		return escaped;
+	}
+
+	// Stage 1: fills positions with the offsets of structural operators outside
+	// strings and of all unescaped quotes. Returns false for unterminated strings
+	// and raw control characters inside strings.
+	bool buildStructuralIndex(std::string_view json, std::vector<uint32_t> &positions, size_t &count)
+	{
+		if (positions.size() < json.size() + BLOCK_SIZE)
+		{
+			positions.resize(json.size() + BLOCK_SIZE);
+		}
+
+		uint32_t *out = positions.data();
+		count = 0;
+
+		uint64_t escape_carry = 0;
+		uint64_t in_string_carry = 0;
+		uint64_t control_in_string = 0;
+		char tail[BLOCK_SIZE];
+
+		for (size_t base = 0; base < json.size(); base += BLOCK_SIZE)
+		{
+			const char *block = json.data() + base;
+			if (json.size() - base < BLOCK_SIZE)
+			{
+				std::memset(tail, ' ', BLOCK_SIZE);
+				std::memcpy(tail, block, json.size() - base);
+				block = tail;
+			}
+
+			BlockMasks masks = classifyBlock(block);
+
+			uint64_t escaped = 0;
+			if (masks.backslash | escape_carry)
+			{
+				escaped = findEscaped(masks.backslash, escape_carry);
+			}
+
+			const uint64_t quotes = masks.quote & ~escaped;
+			const uint64_t in_string = prefixXor(quotes) ^ in_string_carry;
+			in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+			control_in_string |= masks.control & in_string;
+
+			uint64_t structurals = (masks.op & ~in_string) | quotes;
+			while (structurals)
+			{
+				out[count++] = static_cast<uint32_t>(base + __builtin_ctzll(structurals));
+				structurals &= structurals - 1;
+			}
+		}
+
+		return in_string_carry == 0 && control_in_string == 0;
+	}
+
+	inline bool isWhitespace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	inline int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	inline bool parseHex4(const char *p, const char *end, unsigned &codepoint)
+	{
+		if (end - p < 4)
+			return false;
+
+		codepoint = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			int digit = hexValue(p[i]);
+			if (digit < 0)
+				return false;
+			codepoint = (codepoint << 4) | static_cast<unsigned>(digit);
+		}
+		return true;
+	}
+
+	void appendUtf8(std::string &out, unsigned codepoint)
+	{
+		if (codepoint <= 0x7F)
+		{
+			out.push_back(static_cast<char>(codepoint));
+		}
+		else if (codepoint <= 0x7FF)
+		{
+			out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+			out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+		else if (codepoint <= 0xFFFF)
+		{
+			out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+		else
+		{
+			out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+			out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+		}
+	}
+
+	// Decodes the escapes of a string body, with rapidjson's surrogate rules
+	bool unescape(std::string_view raw, std::string &out)
+	{
+		out.clear();
+		const char *p = raw.data();
+		const char *end = raw.data() + raw.size();
+
+		while (p < end)
+		{
+			const char *backslash = static_cast<const char *>(std::memchr(p, '\\', end - p));
+			if (!backslash)
+			{
+				out.append(p, end);
+				break;
+			}
+			out.append(p, backslash);
+			p = backslash + 1;
+			if (p == end)
+				return false;
+
+			switch (*p++)
+			{
+			case '"':
+				out.push_back('"');
+				break;
+			case '\\':
+				out.push_back('\\');
+				break;
+			case '/':
+				out.push_back('/');
+				break;
+			case 'b':
+				out.push_back('\b');
+				break;
+			case 'f':
+				out.push_back('\f');
+				break;
+			case 'n':
+				out.push_back('\n');
+				break;
+			case 'r':
+				out.push_back('\r');
+				break;
+			case 't':
+				out.push_back('\t');
+				break;
+			case 'u':
+			{
+				unsigned codepoint;
+				if (!parseHex4(p, end, codepoint))
+					return false;
+				p += 4;
+
+				if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+				{
+					// Only a high surrogate directly followed by an escaped low surrogate is valid
+					unsigned low;
+					if (codepoint > 0xDBFF || end - p < 2 || p[0] != '\\' || p[1] != 'u' ||
+						!parseHex4(p + 2, end, low) || low < 0xDC00 || low > 0xDFFF)
+						return false;
+					p += 6;
+					codepoint = (((codepoint - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+				}
+				appendUtf8(out, codepoint);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+
+	enum class ValueKind
+	{
+		Int,
+		String,
+		Other,
+	};
+
+	// Field slots filled from the root object; the first occurrence of a key wins
+	enum FieldSlot
+	{
+		FIELD_ID,
+		FIELD_NAME,
+		FIELD_PHONE,
+		FIELD_NUMBER,
+		FIELD_COUNT,
+		FIELD_NONE = -1,
+	};
+
+	struct CapturedField
+	{
+		bool seen = false;
+		ValueKind kind = ValueKind::Other;
+		int int_value = 0;
+		std::string string_value;
+	};
+
+	int matchField(std::string_view key)
+	{
+		switch (key.size())
+		{
+		case 2:
+			return key == "id" ? FIELD_ID : FIELD_NONE;
+		case 4:
+			return key == "name" ? FIELD_NAME : FIELD_NONE;
+		case 5:
+			return key == "phone" ? FIELD_PHONE : FIELD_NONE;
+		case 6:
+			return key == "number" ? FIELD_NUMBER : FIELD_NONE;
+		default:
+			return FIELD_NONE;
+		}
+	}
+
+	// Stage 2: validates the document by walking the structural index
+	class StructuralWalker
+	{
+	public:
+		StructuralWalker(std::string_view json, const uint32_t *positions, size_t count,
+						 std::vector<char> &stack, std::string &scratch)
+			: data_(json.data()), size_(json.size()), positions_(positions), count_(count),
+			  stack_(stack), scratch_(scratch)
+		{
+		}
+
+		bool run();
+		bool rootIsObject() const { return root_ == '{'; }
+		CapturedField &field(int slot) { return fields_[slot]; }
+
+	private:
+		size_t skipWhitespace(size_t pos) const
+		{
+			while (pos < size_ && isWhitespace(data_[pos]))
+				++pos;
+			return pos;
+		}
+
+		// Next structural character, provided only whitespace separates it from the cursor
+		char peekStructural() const
+		{
+			if (next_ >= count_)
+				return 0;
+			size_t pos = positions_[next_];
+			return skipWhitespace(cursor_) == pos ? data_[pos] : 0;
+		}
+
+		void consumeStructural()
+		{
+			cursor_ = positions_[next_++] + 1;
+		}
+
+		bool stringAt(size_t start, std::string_view &raw);
+		bool key();
+		bool primitive(size_t start);
+		bool scalar(std::string_view token, CapturedField *capture);
+
+		const char *data_;
+		size_t size_;
+		const uint32_t *positions_;
+		size_t count_;
+		size_t next_ = 0;
+		size_t cursor_ = 0;
+		char root_ = 0;
+		int current_field_ = FIELD_NONE;
+		std::vector<char> &stack_;
+		std::string &scratch_;
+		CapturedField fields_[FIELD_COUNT];
+	};
+
+	// Consumes the string whose opening quote is at start; raw is its undecoded body
+	bool StructuralWalker::stringAt(size_t start, std::string_view &raw)
+	{
+		if (next_ + 1 >= count_ || positions_[next_] != start)
+			return false;
+
+		size_t close = positions_[next_ + 1];
+		raw = std::string_view(data_ + start + 1, close - start - 1);
+		next_ += 2;
+		cursor_ = close + 1;
+		return true;
+	}
+
+	bool StructuralWalker::key()
+	{
+		size_t start = skipWhitespace(cursor_);
+		std::string_view raw;
+		if (start >= size_ || data_[start] != '"' || !stringAt(start, raw))
+			return false;
+
+		std::string_view key = raw;
+		if (std::memchr(raw.data(), '\\', raw.size()))
+		{
+			if (!unescape(raw, scratch_))
+				return false;
+			key = scratch_;
+		}
+
+		current_field_ = stack_.size() == 1 ? matchField(key) : FIELD_NONE;
+		if (current_field_ != FIELD_NONE && fields_[current_field_].seen)
+		{
+			current_field_ = FIELD_NONE;
+		}
+
+		if (peekStructural() != ':')
+			return false;
+		consumeStructural();
+		return true;
+	}
+
+	bool StructuralWalker::primitive(size_t start)
+	{
+		CapturedField *capture = current_field_ != FIELD_NONE ? &fields_[current_field_] : nullptr;
+		current_field_ = FIELD_NONE;
+		if (capture)
+		{
+			capture->seen = true;
+		}
+
+		if (data_[start] == '"')
+		{
+			std::string_view raw;
+			if (!stringAt(start, raw))
+				return false;
+
+			bool escaped = std::memchr(raw.data(), '\\', raw.size()) != nullptr;
+			if (capture)
+			{
+				capture->kind = ValueKind::String;
+				if (escaped)
+					return unescape(raw, capture->string_value);
+				capture->string_value.assign(raw.data(), raw.size());
+				return true;
+			}
+			return !escaped || unescape(raw, scratch_);
+		}
+
+		// A scalar runs up to the next structural character (or the end of input)
+		size_t end = next_ < count_ ? positions_[next_] : size_;
+		size_t token_end = end;
+		while (token_end > start && isWhitespace(data_[token_end - 1]))
+			--token_end;
+		cursor_ = end;
+		return scalar(std::string_view(data_ + start, token_end - start), capture);
+	}
+
+	bool StructuralWalker::scalar(std::string_view token, CapturedField *capture)
+	{
+		ValueKind kind = ValueKind::Other;
+		int int_value = 0;
+
+		if (token == "true" || token == "false" || token == "null")
+		{
+			kind = ValueKind::Other;
+		}
+		else
+		{
+			// Fast path: plain integers short enough not to overflow int64
+			size_t i = token.size() > 0 && token[0] == '-' ? 1 : 0;
+			size_t digits = token.size() - i;
+			bool plain = digits > 0 && digits <= 18 && (token[i] != '0' || digits == 1);
+			int64_t value = 0;
+			for (size_t j = i; plain && j < token.size(); ++j)
+			{
+				char c = token[j];
+				plain = c >= '0' && c <= '9';
+				value = value * 10 + (c - '0');
+			}
+
+			if (plain)
+			{
+				value = i ? -value : value;
+				if (value >= INT32_MIN && value <= INT32_MAX)
+				{
+					kind = ValueKind::Int;
+					int_value = static_cast<int>(value);
+				}
+			}
+			else
+			{
+				// Fractions, exponents and huge integers: defer to rapidjson so that
+				// overflow and precision rules match the DOM backend exactly
+				if (token.empty() || !(token[0] == '-' || (token[0] >= '0' && token[0] <= '9')))
+					return false;
+
+				rapidjson::Document number;
+				number.Parse(token.data(), token.size());
+				if (number.HasParseError())
+					return false;
+				if (number.IsInt())
+				{
+					kind = ValueKind::Int;
+					int_value = number.GetInt();
+				}
+			}
+		}
+
+		if (capture)
+		{
+			capture->kind = kind;
+			capture->int_value = int_value;
+		}
+		return true;
+	}
+
+	bool StructuralWalker::run()
+	{
+		stack_.clear();
+		bool expect_value = true;
+
+		while (true)
+		{
+			if (expect_value)
+			{
+				size_t start = skipWhitespace(cursor_);
+				if (start >= size_)
+					return false;
+
+				char c = data_[start];
+				if (stack_.empty())
+					root_ = c;
+
+				if (c == '{' || c == '[')
+				{
+					if (next_ >= count_ || positions_[next_] != start)
+						return false;
+					if (current_field_ != FIELD_NONE)
+					{
+						fields_[current_field_].seen = true;
+						fields_[current_field_].kind = ValueKind::Other;
+						current_field_ = FIELD_NONE;
+					}
+					consumeStructural();
+					stack_.push_back(c);
+
+					if (peekStructural() == (c == '{' ? '}' : ']'))
+					{
+						consumeStructural();
+						stack_.pop_back();
+					}
+					else
+					{
+						if (c == '{' && !key())
+							return false;
+						continue;
+					}
+				}
+				else if (!primitive(start))
+				{
+					return false;
+				}
+			}
+
+			// After a complete value
+			if (stack_.empty())
+				break;
+
+			char c = peekStructural();
+			if (c == ',')
+			{
+				consumeStructural();
+				if (stack_.back() == '{' && !key())
+					return false;
+				expect_value = true;
+			}
+			else if (c == (stack_.back() == '{' ? '}' : ']'))
+			{
+				consumeStructural();
+				stack_.pop_back();
+				expect_value = false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return next_ == count_ && skipWhitespace(cursor_) == size_;
+	}
+}
+
+std::expected<UserData, RequestError> StructuralJsonBackend::parseUserData(std::string_view json_input) const
+{
+	thread_local std::vector<uint32_t> positions;
+	thread_local std::vector<char> stack;
+	thread_local std::string scratch;
+
+	// Match rapidjson's input handling: a leading BOM is skipped and an embedded
+	// NUL terminates the document
+	for (unsigned char bom : {0xEFu, 0xBBu, 0xBFu})
+	{
+		if (!json_input.empty() && static_cast<unsigned char>(json_input.front()) == bom)
+			json_input.remove_prefix(1);
+	}
+	if (const void *nul = std::memchr(json_input.data(), '\0', json_input.size()))
+	{
+		json_input = json_input.substr(0, static_cast<const char *>(nul) - json_input.data());
+	}
+
+	size_t count = 0;
+	if (!buildStructuralIndex(json_input, positions, count))
+	{
+		return std::unexpected(RequestError::InvalidJson);
+	}
+
+	StructuralWalker walker(json_input, positions.data(), count, stack, scratch);
+	if (!walker.run())
+	{
+		return std::unexpected(RequestError::InvalidJson);
+	}
+
+	if (!walker.rootIsObject())
+	{
+		return std::unexpected(RequestError::NotAnObject);
+	}
+
+	UserData data;
+
+	CapturedField &id = walker.field(FIELD_ID);
+	if (!id.seen || id.kind != ValueKind::Int)
+	{
+		return std::unexpected(RequestError::InvalidId);
+	}
+	data.id = id.int_value;
+
+	CapturedField &name = walker.field(FIELD_NAME);
+	if (!name.seen || name.kind != ValueKind::String)
+	{
+		return std::unexpected(RequestError::InvalidName);
+	}
+	data.name = std::move(name.string_value);
+
+	CapturedField &phone = walker.field(FIELD_PHONE);
+	if (!phone.seen || phone.kind != ValueKind::String)
+	{
+		return std::unexpected(RequestError::InvalidPhone);
+	}
+	data.phone = std::move(phone.string_value);
+
+	CapturedField &number = walker.field(FIELD_NUMBER);
+	if (!number.seen || number.kind != ValueKind::Int)
+	{
+		return std::unexpected(RequestError::InvalidNumber);
+	}
+	data.number = number.int_value;
+
+	return data;
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <logging/Logger.h>
+#include <server/Metrics.h>
+#include <server/RequestHandler.h>
+#include <server/UdpListener.h>
+
+namespace
+{
+	// Room for the SO_TIMESTAMPNS and SO_RXQ_OVFL messages of one datagram
+	constexpr size_t CONTROL_BYTES = CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+	double secondsBetween(const timespec &from, const timespec &to)
+	{
+		return static_cast<double>(to.tv_sec - from.tv_sec) + static_cast<double>(to.tv_nsec - from.tv_nsec) * 1e-9;
+	}
+}
+
+UdpListener::UdpListener()
+	: buffers_(BATCH * MAX_DATAGRAM), controls_(BATCH * CONTROL_BYTES), iovecs_(BATCH), messages_(BATCH)
+{
+	for (size_t i = 0; i < BATCH; ++i)
+	{
+		iovecs_[i] = {buffers_.data() + i * MAX_DATAGRAM, MAX_DATAGRAM};
+		messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+		messages_[i].msg_hdr.msg_iovlen = 1;
+		messages_[i].msg_hdr.msg_control = controls_.data() + i * CONTROL_BYTES;
+	}
+	updates_.reserve(BATCH);
+}
+
+UdpListener::~UdpListener()
+{
+	close();
+}
+
+bool UdpListener::open(const std::string &host, int port, int receive_buffer)
+{
+	close();
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(port));
+	address.sin_addr.s_addr = INADDR_ANY;
+	if (!host.empty() && inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+	{
+		Logger::error("Invalid UDP listen address {}", host);
+		return false;
+	}
+
+	fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+	{
+		Logger::error("Failed to create UDP socket: {}", strerror(errno));
+		return false;
+	}
+
+	// Both only feed metrics, so the listener works without them
+	int on = 1;
+	if (setsockopt(fd_, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+	{
+		Logger::warn("Failed to set SO_RXQ_OVFL: {}", strerror(errno));
+	}
+	if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0)
+	{
+		Logger::warn("Failed to set SO_TIMESTAMPNS: {}", strerror(errno));
+	}
+	if (receive_buffer > 0 && setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer)) < 0)
+	{
+		Logger::warn("Failed to set SO_RCVBUF to {}: {}", receive_buffer, strerror(errno));
+	}
+
+	if (bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+	{
+		Logger::error("Failed to bind UDP socket to port {}: {}", port, strerror(errno));
+		close();
+		return false;
+	}
+
+	socklen_t length = sizeof(address);
+	getsockname(fd_, reinterpret_cast<sockaddr *>(&address), &length);
+	port_ = ntohs(address.sin_port);
+	return true;
+}
+
+void UdpListener::close()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+		fd_ = -1;
+		port_ = 0;
+	}
+}
+
+codec::Format UdpListener::detectFormat(std::string_view datagram)
+{
+	// A UserData root is a map: MessagePack fixmap/map16/map32, CBOR major type 5
+	const auto first = datagram.empty() ? 0u : static_cast<unsigned char>(datagram.front());
+	if ((first >= 0x80 && first <= 0x8f) || first == 0xde || first == 0xdf)
+	{
+		return codec::Format::MsgPack;
+	}
+	if (first >= 0xa0 && first <= 0xbf)
+	{
+		return codec::Format::Cbor;
+	}
+	return codec::Format::Json;
+}
+
+size_t UdpListener::drain(RequestHandler &handler, size_t max_batches)
+{
+	const Counters before = counters_;
+	uint64_t lag_samples = 0;
+	double lag_max = 0;
+	size_t received = 0;
+	updates_.clear();
+
+	for (size_t batch = 0; batch < max_batches && fd_ >= 0; ++batch)
+	{
+		for (auto &message : messages_)
+		{
+			message.msg_hdr.msg_controllen = CONTROL_BYTES;
+		}
+
+		int count = recvmmsg(fd_, messages_.data(), BATCH, MSG_DONTWAIT, nullptr);
+		if (count <= 0)
+		{
+			if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				Logger::warn("UDP recvmmsg failed: {}", strerror(errno));
+			}
+			break;
+		}
+
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		for (int i = 0; i < count; ++i)
+		{
+			msghdr &header = messages_[i].msg_hdr;
+			counters_.datagrams++;
+			counters_.bytes += messages_[i].msg_len;
+
+			for (cmsghdr *control = CMSG_FIRSTHDR(&header); control != nullptr; control = CMSG_NXTHDR(&header, control))
+			{
+				if (control->cmsg_level != SOL_SOCKET)
+					continue;
+				if (control->cmsg_type == SCM_TIMESTAMPNS)
+				{
+					timespec arrived;
+					std::memcpy(&arrived, CMSG_DATA(control), sizeof(arrived));
+					const double lag = secondsBetween(arrived, now);
+					counters_.lag_seconds_sum += lag;
+					lag_max = std::max(lag_max, lag);
+					lag_samples++;
+				}
+				else if (control->cmsg_type == SO_RXQ_OVFL)
+				{
+					uint32_t drops;
+					std::memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+					counters_.dropped += drops - kernel_drops_;
+					kernel_drops_ = drops;
+				}
+			}
+
+			if (header.msg_flags & MSG_TRUNC)
+			{
+				counters_.truncated++;
+				continue;
+			}
+
+			std::string_view datagram(buffers_.data() + i * MAX_DATAGRAM, messages_[i].msg_len);
+			auto update = handler.decodeUpdate(datagram, detectFormat(datagram));
+			if (update)
+			{
+				updates_.push_back(*update);
+			}
+			else
+			{
+				counters_.parse_errors++;
+			}
+		}
+
+		received += static_cast<size_t>(count);
+		if (static_cast<size_t>(count) < BATCH)
+			break;
+	}
+
+	if (received == 0)
+	{
+		return 0;
+	}
+
+	if (!updates_.empty())
+	{
+		handler.recordUpdates(updates_);
+		counters_.applied += updates_.size();
+	}
+	counters_.lag_seconds_max = lag_max;
+
+	auto &metrics = Metrics::getInstance();
+	metrics.addUdpDatagrams(counters_.datagrams - before.datagrams, counters_.bytes - before.bytes,
+							counters_.applied - before.applied, counters_.parse_errors - before.parse_errors);
+	metrics.addUdpDrops(counters_.dropped - before.dropped, counters_.truncated - before.truncated);
+	metrics.addUdpLag(counters_.lag_seconds_sum - before.lag_seconds_sum, lag_samples, lag_max);
+	return received;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <codec/Codec.h>
+#include <server/ClientAggregates.h>
+
+class RequestHandler;
+
+// Fire-and-forget ingestion over UDP. Each datagram carries one UserData as
+// JSON, MessagePack or CBOR, told apart by its first byte, and nothing is
+// sent back. drain() reads datagrams BATCH at a time with recvmmsg(),
+// decodes and validates them on the calling (reactor) thread and applies
+// the accepted ones in one RequestHandler::recordUpdates() call, the bulk
+// aggregate path. The kernel reports datagrams it dropped on a full receive
+// queue (SO_RXQ_OVFL) and the time each one arrived (SO_TIMESTAMPNS); the
+// latter gives the lag between arrival and decoding. Not thread-safe.
+class UdpListener
+{
+public:
+	struct Counters
+	{
+		uint64_t datagrams = 0;
+		uint64_t bytes = 0;
+		uint64_t applied = 0;
+		uint64_t parse_errors = 0;
+		uint64_t dropped = 0;	// by the kernel, receive queue full
+		uint64_t truncated = 0; // longer than MAX_DATAGRAM
+		double lag_seconds_sum = 0;
+		double lag_seconds_max = 0; // over the last drain()
+	};
+
+	static constexpr size_t BATCH = 64;
+	static constexpr size_t MAX_DATAGRAM = 2048;
+
+	UdpListener();
+	~UdpListener();
+
+	UdpListener(const UdpListener &) = delete;
+	UdpListener &operator=(const UdpListener &) = delete;
+
+	// Binds a non-blocking socket; port 0 picks a free one (see port()).
+	// receive_buffer sets SO_RCVBUF when positive.
+	bool open(const std::string &host, int port, int receive_buffer = 0);
+	void close();
+	int fd() const { return fd_; }
+	int port() const { return port_; }
+
+	// Reads until the socket is empty or after max_batches recvmmsg() calls,
+	// so one busy source cannot starve the rest of the reactor; returns the
+	// number of datagrams read
+	size_t drain(RequestHandler &handler, size_t max_batches = 16);
+
+	const Counters &counters() const { return counters_; }
+
+	static codec::Format detectFormat(std::string_view datagram);
+
+private:
+	int fd_ = -1;
+	int port_ = 0;
+	std::vector<char> buffers_;	 // BATCH datagrams of MAX_DATAGRAM bytes
+	std::vector<char> controls_; // BATCH ancillary data buffers
+	std::vector<iovec> iovecs_;
+	std::vector<mmsghdr> messages_;
+	std::vector<ClientAggregates::Update> updates_;
+	uint32_t kernel_drops_ = 0; // last SO_RXQ_OVFL value, a running total
+	Counters counters_;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include <codec/Describe.h>
+
+struct UserData
+{
+	int id;
+	std::string name;
+	std::string phone;
+	int number;
+
+	// Constructor for easy initialization
+	UserData(int id = 0, std::string name = "", std::string phone = "", int number = 0)
+		: id(id), name(std::move(name)), phone(std::move(phone)), number(number) {}
+};
+
+template <>
+struct codec::Describe<UserData>
+{
+	static constexpr auto fields = std::make_tuple(
+		CODEC_FIELD(UserData, id, codec::NonNegative),
+		CODEC_FIELD(UserData, name, codec::NotEmpty),
+		CODEC_FIELD(UserData, phone, codec::NotEmpty),
+		CODEC_FIELD(UserData, number));
+};
+
+// Reasons a /process payload is rejected; each maps to a precomputed error response
+enum class RequestError
+{
+	InvalidJson,
+	NotAnObject,
+	NotAnArray,
+	InvalidId,
+	InvalidName,
+	InvalidPhone,
+	InvalidNumber,
+	InvalidUserData,
+};
+
+const char *toString(RequestError error) noexcept;
+
+// Maps a codec failure on UserData to the error reported to the client
+RequestError toRequestError(const codec::DecodeError &error) noexcept;
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include <server/BatchProcessor.h>
+#include <server/RequestHandler.h>
+
+namespace
+{
+	std::string line(int id, int number)
+	{
+		return R"({"id":)" + std::to_string(id) + R"(,"name":"Batch","phone":"+1234567890","number":)" +
+			   std::to_string(number) + "}";
+	}
+}
+
+class BatchProcessorTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		handler = std::make_unique<RequestHandler>();
+
+		// Valid lines, CRLF endings, blank lines and rejects, without a final newline
+		std::mt19937 rng(7);
+		for (int i = 0; i < 3000; ++i)
+		{
+			const int id = static_cast<int>(rng() % 40);
+			const int number = static_cast<int>(rng() % 1000) - 100;
+			input += line(id, number) + (i % 7 == 0 ? "\r\n" : "\n");
+			expected[id].first += number;
+			expected[id].second++;
+			if (i % 100 == 0)
+			{
+				input += "{\"id\":1\n\n   \n";
+			}
+		}
+		input += line(99, 5);
+		expected[99] = {5, 1};
+	}
+
+	void expectMatches(const BatchProcessor &processor)
+	{
+		const auto &summary = processor.summary();
+		EXPECT_EQ(summary.lines, 3031u);
+		EXPECT_EQ(summary.applied, 3001u);
+		EXPECT_EQ(summary.rejected, 30u);
+		EXPECT_EQ(summary.clients, expected.size());
+
+		long long total = 0;
+		for (const auto &[id, sum_count] : expected)
+		{
+			const auto stats = processor.stats(id);
+			EXPECT_EQ(stats.sum, sum_count.first) << id;
+			EXPECT_EQ(stats.count, static_cast<uint64_t>(sum_count.second)) << id;
+			total += sum_count.first;
+		}
+		EXPECT_EQ(summary.total_sum, total);
+		EXPECT_EQ(processor.stats(1000).count, 0u);
+	}
+
+	std::unique_ptr<RequestHandler> handler;
+	std::string input;
+	std::map<int, std::pair<long long, int>> expected;
+};
+
+TEST_F(BatchProcessorTest, EveryChunkSizeSeesEachLineOnce)
+{
+	for (size_t chunk_bytes : {1ul, 7ul, 64ul, 97ul, 4096ul, 1ul << 20})
+	{
+		SCOPED_TRACE(chunk_bytes);
+		BatchProcessor processor(*handler, {4, chunk_bytes});
+		processor.process(input);
+		expectMatches(processor);
+	}
+}
+
+TEST_F(BatchProcessorTest, MergedStatsMatchOneThread)
+{
+	BatchProcessor single(*handler, {1, 1u << 20});
+	single.process(input);
+	BatchProcessor parallel(*handler, {3, 512});
+	parallel.process(input);
+
+	for (const auto &[id, sum_count] : expected)
+	{
+		const auto a = single.stats(id);
+		const auto b = parallel.stats(id);
+		EXPECT_EQ(a.min, b.min);
+		EXPECT_EQ(a.max, b.max);
+		EXPECT_NEAR(a.mean, b.mean, 1e-9);
+		EXPECT_NEAR(a.variance, b.variance, a.variance * 1e-9);
+	}
+	// Replay never touches the handler's own aggregates
+	EXPECT_EQ(handler->getTotalNumbersSum(), 0);
+}
+
+TEST_F(BatchProcessorTest, ProcessesFileAndWritesResults)
+{
+	const std::string base = "/tmp/batch_processor_test_" + std::to_string(getpid());
+	{
+		std::ofstream file(base + ".jsonl", std::ios::binary);
+		file << input;
+	}
+
+	std::vector<std::pair<uint64_t, uint64_t>> progress;
+	BatchProcessor processor(*handler, {2, 1024});
+	processor.onProgress([&](uint64_t done, uint64_t total, uint64_t)
+						 { progress.emplace_back(done, total); });
+	ASSERT_TRUE(processor.processFile(base + ".jsonl"));
+	expectMatches(processor);
+	ASSERT_FALSE(progress.empty());
+	EXPECT_EQ(progress.back().first, input.size());
+	EXPECT_EQ(processor.summary().bytes, input.size());
+
+	ASSERT_TRUE(processor.writeResults(base + ".out"));
+	std::ifstream results(base + ".out");
+	std::vector<std::string> lines;
+	for (std::string text; std::getline(results, text);)
+	{
+		lines.push_back(text);
+	}
+	ASSERT_EQ(lines.size(), expected.size());
+	EXPECT_EQ(lines.front().rfind(R"({"client_id":"user_0","count":)", 0), 0u) << lines.front();
+	EXPECT_EQ(lines.back(), R"({"client_id":"user_99","count":1,"sum":5,"min":5,"max":5,"mean":5,"variance":0})");
+
+	EXPECT_FALSE(processor.processFile(base + ".missing"));
+	std::remove((base + ".jsonl").c_str());
+	std::remove((base + ".out").c_str());
+}
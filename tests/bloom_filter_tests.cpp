@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+
+#include <common/BloomFilter.h>
+#include <common/FlatHashMap.h>
+
+namespace
+{
+	uint64_t keyHash(uint64_t key)
+	{
+		return FlatHash<uint64_t>::mix(key);
+	}
+}
+
+TEST(BloomFilterTest, NoFalseNegatives)
+{
+	BloomFilter filter(10000);
+	for (uint64_t key = 0; key < 10000; ++key)
+	{
+		filter.insert(keyHash(key));
+	}
+
+	EXPECT_EQ(filter.size(), 10000u);
+	EXPECT_FALSE(filter.saturated());
+	for (uint64_t key = 0; key < 10000; ++key)
+	{
+		ASSERT_TRUE(filter.mightContain(keyHash(key))) << key;
+	}
+}
+
+TEST(BloomFilterTest, FalsePositiveRateAtCapacity)
+{
+	constexpr uint64_t capacity = 50000;
+	BloomFilter filter(capacity);
+	for (uint64_t key = 0; key < capacity; ++key)
+	{
+		filter.insert(keyHash(key));
+	}
+
+	constexpr uint64_t probes = 200000;
+	uint64_t false_positives = 0;
+	for (uint64_t key = capacity; key < capacity + probes; ++key)
+	{
+		false_positives += filter.mightContain(keyHash(key)) ? 1 : 0;
+	}
+	// About 1% by design; allow headroom for the block layout
+	EXPECT_LT(static_cast<double>(false_positives) / probes, 0.03);
+}
+
+TEST(BloomFilterTest, ResetDropsKeysAndResizes)
+{
+	BloomFilter filter(64);
+	for (uint64_t key = 0; key < 65; ++key)
+	{
+		filter.insert(keyHash(key));
+	}
+	EXPECT_TRUE(filter.saturated());
+
+	filter.reset(1000);
+	EXPECT_EQ(filter.size(), 0u);
+	EXPECT_EQ(filter.capacity(), 1000u);
+	EXPECT_FALSE(filter.saturated());
+
+	uint64_t hits = 0;
+	for (uint64_t key = 0; key < 65; ++key)
+	{
+		hits += filter.mightContain(keyHash(key)) ? 1 : 0;
+	}
+	EXPECT_EQ(hits, 0u);
+}
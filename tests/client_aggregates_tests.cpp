@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+
+#include <server/ClientAggregates.h>
+
+TEST(ClientAggregatesTest, ParsesClientIds)
+{
+	EXPECT_EQ(ClientAggregates::parseClientId("user_42"), 42);
+	EXPECT_EQ(ClientAggregates::parseClientId("user_-7"), -7);
+	EXPECT_FALSE(ClientAggregates::parseClientId("user_").has_value());
+	EXPECT_FALSE(ClientAggregates::parseClientId("user_4x").has_value());
+	EXPECT_FALSE(ClientAggregates::parseClientId("client_4").has_value());
+	EXPECT_FALSE(ClientAggregates::parseClientId("user_99999999999").has_value());
+	EXPECT_EQ(ClientAggregates::clientKey(-7), "user_-7");
+}
+
+TEST(ClientAggregatesTest, ClockEvictsUnreferencedClients)
+{
+	ClientAggregates::Limits limits;
+	limits.capacity = 4;
+	ClientAggregates clients(limits);
+	for (int32_t id = 1; id <= 4; ++id)
+	{
+		clients.record(id, id * 10, 0);
+	}
+
+	// Every client is referenced, so the hand clears all bits and comes back to the first
+	clients.record(5, 50, 0);
+	EXPECT_EQ(clients.size(), 4u);
+	EXPECT_EQ(clients.sum(1), 0);
+	EXPECT_EQ(clients.counters().evicted, 1u);
+
+	// Client 2 is referenced again and survives the next pass; 3 goes
+	clients.record(2, 1, 0);
+	clients.record(6, 60, 0);
+	EXPECT_EQ(clients.sum(2), 21);
+	EXPECT_EQ(clients.sum(3), 0);
+	EXPECT_EQ(clients.counters().evicted, 2u);
+
+	auto total = clients.index().total(INT32_MIN, INT32_MAX);
+	EXPECT_EQ(total.count, 4u);
+	EXPECT_EQ(total.sum, 21 + 40 + 50 + 60);
+}
+
+TEST(ClientAggregatesTest, TtlExpiresIdleClients)
+{
+	ClientAggregates::Limits limits;
+	limits.ttl_ms = 1000;
+	ClientAggregates clients(limits);
+	for (int32_t id = 1; id <= 4; ++id)
+	{
+		clients.record(id, 1, 0);
+	}
+
+	// Each record checks the next two slots
+	clients.record(1, 1, 5000);
+	EXPECT_EQ(clients.counters().expired, 1u);
+	clients.record(1, 1, 5001);
+	EXPECT_EQ(clients.counters().expired, 3u);
+	EXPECT_EQ(clients.size(), 1u);
+	EXPECT_EQ(clients.sum(1), 3);
+	EXPECT_EQ(clients.sum(4), 0);
+
+	// Freed slots are reused before the table grows
+	clients.record(7, 2, 5002);
+	EXPECT_EQ(clients.size(), 2u);
+	EXPECT_EQ(clients.stats(7).count, 1u);
+}
+
+TEST(ClientAggregatesTest, SpilledClientsAreReadAndRestored)
+{
+	ClientAggregates::Limits limits;
+	limits.capacity = 2;
+	limits.spill_path = testing::TempDir() + "client_aggregates_spill";
+	ClientAggregates clients(limits);
+	ASSERT_TRUE(clients.spillEnabled());
+
+	clients.record(1, 4, 10);
+	clients.record(1, 8, 20);
+	clients.record(2, 5, 30);
+	clients.record(3, 6, 40);
+	EXPECT_EQ(clients.spilledSize(), 1u);
+	EXPECT_EQ(clients.counters().spilled, 1u);
+
+	EXPECT_EQ(clients.sum(1), 12);
+	auto stats = clients.stats(1);
+	EXPECT_EQ(stats.count, 2u);
+	EXPECT_EQ(stats.max, 8);
+	EXPECT_EQ(stats.last_seen_ms, 20);
+	std::vector<long long> sums;
+	clients.sums({1, std::nullopt, 2, 99}, sums);
+	EXPECT_EQ(sums, (std::vector<long long>{12, 0, 5, 0}));
+
+	// Recording for the spilled client brings its row back
+	clients.record(1, 3, 50);
+	EXPECT_EQ(clients.stats(1).count, 3u);
+	EXPECT_EQ(clients.sum(1), 15);
+	EXPECT_GE(clients.counters().tier_hits, 4u);
+	EXPECT_EQ(clients.index().find(1), 15);
+
+	clients.clear();
+	EXPECT_EQ(clients.size(), 0u);
+	EXPECT_EQ(clients.spilledSize(), 0u);
+	EXPECT_EQ(clients.sum(1), 0);
+}
+
+TEST(ClientAggregatesTest, BoundedTableWithSpillKeepsEverySum)
+{
+	ClientAggregates::Limits limits;
+	limits.capacity = 100;
+	limits.spill_path = testing::TempDir() + "client_aggregates_churn";
+	ClientAggregates clients(limits);
+
+	std::mt19937 rng(5);
+	std::map<int32_t, long long> reference;
+	for (int i = 0; i < 20000; ++i)
+	{
+		int32_t id = static_cast<int32_t>(rng() % 1500);
+		int32_t number = static_cast<int32_t>(rng() % 100);
+		clients.record(id, number, i);
+		reference[id] += number;
+	}
+
+	EXPECT_EQ(clients.size(), 100u);
+	EXPECT_EQ(clients.size() + clients.spilledSize(), reference.size());
+	for (const auto &[id, sum] : reference)
+	{
+		ASSERT_EQ(clients.sum(id), sum) << id;
+	}
+}
+
+TEST(ClientAggregatesTest, RecordBatchMatchesRecord)
+{
+	ClientAggregates batched, single;
+	std::mt19937 rng(9);
+	std::vector<ClientAggregates::Update> updates;
+	for (int64_t batch = 0; batch < 50; ++batch)
+	{
+		// Few enough ids that batches repeat them
+		updates.clear();
+		const size_t count = rng() % 100;
+		for (size_t i = 0; i < count; ++i)
+		{
+			updates.push_back({static_cast<int32_t>(rng() % 300), static_cast<int32_t>(rng() % 1000) - 500});
+			single.record(updates.back().id, updates.back().number, batch);
+		}
+		batched.recordBatch(updates, batch);
+	}
+
+	ASSERT_EQ(batched.size(), single.size());
+	for (int32_t id = 0; id < 300; ++id)
+	{
+		auto a = batched.stats(id);
+		auto b = single.stats(id);
+		ASSERT_EQ(a.count, b.count) << id;
+		EXPECT_EQ(a.sum, b.sum);
+		EXPECT_EQ(a.min, b.min);
+		EXPECT_EQ(a.max, b.max);
+		EXPECT_NEAR(a.mean, b.mean, 1e-9);
+		EXPECT_NEAR(a.variance, b.variance, 1e-6);
+		EXPECT_EQ(a.last_seen_ms, b.last_seen_ms);
+		EXPECT_EQ(batched.index().find(id), single.index().find(id));
+	}
+}
+
+TEST(ClientAggregatesTest, RecordBatchEvictingWithinTheBatch)
+{
+	// Batches larger than the table: admitting the new ids evicts clients
+	// the batch has already looked up
+	ClientAggregates::Limits limits;
+	limits.capacity = 16;
+	limits.spill_path = testing::TempDir() + "client_aggregates_batch";
+	ClientAggregates clients(limits);
+
+	std::mt19937 rng(3);
+	std::map<int32_t, long long> reference;
+	std::vector<ClientAggregates::Update> updates;
+	for (int64_t batch = 0; batch < 200; ++batch)
+	{
+		updates.clear();
+		for (int i = 0; i < 64; ++i)
+		{
+			updates.push_back({static_cast<int32_t>(rng() % 100), static_cast<int32_t>(rng() % 100)});
+			reference[updates.back().id] += updates.back().number;
+		}
+		clients.recordBatch(updates, batch);
+	}
+
+	EXPECT_EQ(clients.size(), 16u);
+	EXPECT_GT(clients.counters().evicted, 0u);
+	EXPECT_EQ(clients.size() + clients.spilledSize(), reference.size());
+	for (const auto &[id, sum] : reference)
+	{
+		ASSERT_EQ(clients.sum(id), sum) << id;
+	}
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <common/ClientStatsTable.h>
+
+TEST(ClientStatsTableTest, RecordMatchesTwoPassStatistics)
+{
+	ClientStatsTable table;
+	uint32_t slot = table.add();
+	EXPECT_EQ(table.add(), slot + 1);
+
+	std::mt19937 rng(7);
+	std::vector<int32_t> values;
+	for (int i = 0; i < 1000; ++i)
+	{
+		values.push_back(static_cast<int32_t>(rng() % 2001) - 1000);
+		table.record(slot, values.back(), i);
+	}
+
+	double mean = 0;
+	long long sum = 0;
+	for (int32_t v : values)
+	{
+		sum += v;
+	}
+	mean = static_cast<double>(sum) / values.size();
+	double variance = 0;
+	for (int32_t v : values)
+	{
+		variance += (v - mean) * (v - mean);
+	}
+	variance /= values.size();
+
+	auto stats = table.get(slot);
+	EXPECT_EQ(stats.count, values.size());
+	EXPECT_EQ(stats.sum, sum);
+	EXPECT_EQ(stats.min, *std::min_element(values.begin(), values.end()));
+	EXPECT_EQ(stats.max, *std::max_element(values.begin(), values.end()));
+	EXPECT_NEAR(stats.mean, mean, 1e-9);
+	EXPECT_NEAR(stats.variance, variance, 1e-6);
+	EXPECT_EQ(stats.last_seen_ms, 999);
+
+	// The untouched row reports zeros, not the empty-row sentinels
+	auto empty = table.get(slot + 1);
+	EXPECT_EQ(empty.count, 0u);
+	EXPECT_EQ(empty.min, 0);
+	EXPECT_EQ(empty.max, 0);
+}
+
+TEST(ClientStatsTableTest, MergeMatchesRecordingEverything)
+{
+	// Odd sizes so the SIMD loops leave scalar tails; the second table is larger
+	constexpr uint32_t rows = 37;
+	ClientStatsTable left, right, all;
+	for (uint32_t i = 0; i < rows; ++i)
+	{
+		if (i < rows - 6)
+			left.add();
+		right.add();
+		all.add();
+	}
+
+	std::mt19937 rng(11);
+	for (int i = 0; i < 5000; ++i)
+	{
+		uint32_t slot = rng() % rows;
+		int32_t value = static_cast<int32_t>(rng()) / 4;
+		int64_t now = rng() % 100000;
+		// Row 0 only on the left, row 1 only on the right, rows past left's size only on the right
+		bool to_left = slot < left.size() && slot != 1 && (slot == 0 || rng() % 2 == 0);
+		(to_left ? left : right).record(slot, value, now);
+		all.record(slot, value, now);
+	}
+
+	left.merge(right);
+	ASSERT_EQ(left.size(), rows);
+	for (uint32_t slot = 0; slot < rows; ++slot)
+	{
+		auto merged = left.get(slot);
+		auto expected = all.get(slot);
+		EXPECT_EQ(merged.count, expected.count) << slot;
+		EXPECT_EQ(merged.sum, expected.sum) << slot;
+		EXPECT_EQ(merged.min, expected.min) << slot;
+		EXPECT_EQ(merged.max, expected.max) << slot;
+		EXPECT_EQ(merged.last_seen_ms, expected.last_seen_ms) << slot;
+		EXPECT_NEAR(merged.mean, expected.mean, 1e-6 * std::abs(expected.mean) + 1e-6) << slot;
+		EXPECT_NEAR(merged.variance, expected.variance, 1e-9 * expected.variance + 1e-6) << slot;
+	}
+}
+
+TEST(ClientStatsTableTest, MergeRowMatchesRecord)
+{
+	ClientStatsTable table;
+	uint32_t merged = table.add();
+	uint32_t recorded = table.add();
+
+	std::mt19937 rng(11);
+	for (int batch = 0; batch < 20; ++batch)
+	{
+		ClientStatsTable::Row row;
+		for (int i = 0; i < batch % 5; ++i)
+		{
+			int32_t value = static_cast<int32_t>(rng() % 2001) - 1000;
+			ClientStatsTable::record(row, value, batch);
+			table.record(recorded, value, batch);
+		}
+		table.mergeRow(merged, row);
+	}
+
+	auto a = table.get(merged);
+	auto b = table.get(recorded);
+	EXPECT_EQ(a.count, b.count);
+	EXPECT_EQ(a.sum, b.sum);
+	EXPECT_EQ(a.min, b.min);
+	EXPECT_EQ(a.max, b.max);
+	EXPECT_NEAR(a.mean, b.mean, 1e-9);
+	EXPECT_NEAR(a.variance, b.variance, 1e-6);
+	EXPECT_EQ(a.last_seen_ms, b.last_seen_ms);
+}
+
+TEST(ClientStatsTableTest, MergeWithEmptyRowsIsIdentity)
+{
+	ClientStatsTable table, empty;
+	uint32_t slot = table.add();
+	empty.add();
+	empty.add();
+	table.record(slot, INT_MIN, 5);
+	table.record(slot, INT_MAX, 3);
+	auto before = table.get(slot);
+
+	table.merge(empty);
+	auto after = table.get(slot);
+	EXPECT_EQ(after.count, before.count);
+	EXPECT_EQ(after.min, INT_MIN);
+	EXPECT_EQ(after.max, INT_MAX);
+	EXPECT_EQ(after.mean, before.mean);
+	EXPECT_EQ(after.variance, before.variance);
+	EXPECT_EQ(after.last_seen_ms, 5);
+	EXPECT_EQ(table.get(1).count, 0u);
+
+	table.clear();
+	EXPECT_EQ(table.size(), 0u);
+}
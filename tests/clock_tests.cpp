@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include <common/Clock.h>
+
+// The test environment's blocking server ticks the clock too, so only
+// catching up on tick() is checked
+TEST(ClockTest, CoarseTimeCatchesUpOnTick)
+{
+	Clock::tick();
+	const time_t seconds = Clock::coarseSeconds();
+	const uint64_t millis = Clock::coarseMillis();
+	const int64_t wall_millis = Clock::coarseWallMillis();
+	EXPECT_LE(std::abs(seconds - time(nullptr)), 1);
+	EXPECT_LE(std::abs(wall_millis / 1000 - static_cast<int64_t>(seconds)), 1);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	Clock::tick();
+	EXPECT_GE(Clock::coarseMillis(), millis + 20);
+	EXPECT_GE(Clock::coarseWallMillis(), wall_millis + 20);
+	EXPECT_GE(Clock::coarseSeconds(), seconds);
+}
+
+TEST(ClockTest, FineTimeAgreesWithSteadyClock)
+{
+	Clock::calibrate();
+	EXPECT_GT(Clock::ticksPerSecond(), 0.0);
+
+	const auto steady_start = std::chrono::steady_clock::now();
+	const Clock::Ticks start = Clock::ticks();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	const double elapsed_ms = Clock::millisSince(start);
+	const double steady_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - steady_start).count();
+
+	EXPECT_GE(elapsed_ms, 49.0);
+	EXPECT_NEAR(elapsed_ms, steady_ms, steady_ms * 0.02 + 0.5);
+	EXPECT_NEAR(Clock::toSeconds(Clock::fromSeconds(2.5)), 2.5, 1e-6);
+
+	// nanos() lands on steady_clock's timeline
+	const auto steady_now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+													  std::chrono::steady_clock::now().time_since_epoch())
+													  .count());
+	EXPECT_NEAR(static_cast<double>(Clock::nanos()), static_cast<double>(steady_now), 1e6);
+}
@@ -0,0 +1,431 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+
+#include <codec/Codec.h>
+#include <codec/Json.h>
+#include <common/rapidjson/stringbuffer.h>
+#include <common/rapidjson/writer.h>
+#include <server/UserData.h>
+
+namespace
+{
+	struct Sample
+	{
+		int64_t big = 0;
+		unsigned small = 0;
+		bool flag = false;
+		double ratio = 0;
+		std::string label;
+	};
+}
+
+template <>
+struct codec::Describe<Sample>
+{
+	static constexpr auto fields = std::make_tuple(
+		CODEC_FIELD(Sample, big),
+		CODEC_FIELD(Sample, small, codec::InRange<1u, 100u>),
+		CODEC_FIELD(Sample, flag),
+		CODEC_FIELD(Sample, ratio),
+		CODEC_FIELD(Sample, label, codec::NotEmpty, codec::MaxLength<8>));
+};
+
+TEST(CodecTest, PerfectHashFindsEveryField)
+{
+	for (size_t i = 0; i < codec::fieldCount<Sample>; ++i)
+	{
+		EXPECT_EQ(codec::fieldIndex<Sample>.find(codec::fieldNames<Sample>[i]), static_cast<int>(i));
+	}
+	for (size_t i = 0; i < codec::fieldCount<UserData>; ++i)
+	{
+		EXPECT_EQ(codec::fieldIndex<UserData>.find(codec::fieldNames<UserData>[i]), static_cast<int>(i));
+	}
+}
+
+TEST(CodecTest, DecodesAllFieldTypes)
+{
+	auto sample = codec::decodeJson<Sample>(
+		R"({"label": "abc", "ratio": 2, "flag": true, "small": 7, "big": -9000000000, "other": {"big": 1}})");
+	ASSERT_TRUE(sample.has_value());
+	EXPECT_EQ(sample->big, -9000000000);
+	EXPECT_EQ(sample->small, 7u);
+	EXPECT_TRUE(sample->flag);
+	EXPECT_DOUBLE_EQ(sample->ratio, 2.0);
+	EXPECT_EQ(sample->label, "abc");
+}
+
+TEST(CodecTest, ReportsFirstFailingField)
+{
+	auto missing = codec::decodeJson<Sample>(R"({"big": 1, "flag": true, "ratio": 1, "label": "x"})");
+	ASSERT_FALSE(missing.has_value());
+	EXPECT_EQ(missing.error().kind, codec::DecodeError::MissingField);
+	EXPECT_EQ(missing.error().field, 1u);
+
+	auto negative = codec::decodeJson<Sample>(R"({"big": 1, "small": -1, "flag": 1, "ratio": 1, "label": "x"})");
+	ASSERT_FALSE(negative.has_value());
+	EXPECT_EQ(negative.error().kind, codec::DecodeError::WrongType);
+	EXPECT_EQ(negative.error().field, 1u);
+
+	auto nested = codec::decodeJson<Sample>(R"({"big": [1], "small": 1, "flag": true, "ratio": 1, "label": "x"})");
+	ASSERT_FALSE(nested.has_value());
+	EXPECT_EQ(nested.error().kind, codec::DecodeError::WrongType);
+	EXPECT_EQ(nested.error().field, 0u);
+}
+
+TEST(CodecTest, SyntaxErrorsWinOverFieldErrors)
+{
+	auto truncated = codec::decodeJson<Sample>(R"({"big": "x", "small": )");
+	ASSERT_FALSE(truncated.has_value());
+	EXPECT_EQ(truncated.error().kind, codec::DecodeError::Syntax);
+
+	auto array = codec::decodeJson<Sample>(R"([1, 2])");
+	ASSERT_FALSE(array.has_value());
+	EXPECT_EQ(array.error().kind, codec::DecodeError::NotAnObject);
+}
+
+TEST(CodecTest, FirstDuplicateKeyWins)
+{
+	auto sample = codec::decodeJson<Sample>(
+		R"({"big": 1, "big": 2, "small": 1, "flag": false, "ratio": 1.5, "label": "a", "label": 3})");
+	ASSERT_TRUE(sample.has_value());
+	EXPECT_EQ(sample->big, 1);
+	EXPECT_EQ(sample->label, "a");
+}
+
+TEST(CodecTest, ValidatorsReportFieldIndex)
+{
+	Sample sample;
+	sample.small = 5;
+	sample.label = "ok";
+	EXPECT_TRUE(codec::validate(sample).has_value());
+
+	sample.label = "too long label";
+	auto long_label = codec::validate(sample);
+	ASSERT_FALSE(long_label.has_value());
+	EXPECT_EQ(long_label.error().kind, codec::DecodeError::Invalid);
+	EXPECT_EQ(long_label.error().field, 4u);
+
+	sample.small = 0;
+	EXPECT_EQ(codec::validate(sample).error().field, 1u);
+}
+
+TEST(CodecTest, EncoderMatchesRapidJsonWriter)
+{
+	const std::string names[] = {
+		"plain",
+		"quote \" backslash \\ slash /",
+		"controls \b\f\n\r\t\x01\x1f end",
+		"caf\xC3\xA9 \xF0\x9F\x98\x80",
+		"",
+	};
+
+	for (const auto &name : names)
+	{
+		UserData data(-12, name, "+1-555-0100", 2147483647);
+
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		writer.StartObject();
+		writer.Key("id");
+		writer.Int(data.id);
+		writer.Key("name");
+		writer.String(data.name.c_str(), static_cast<rapidjson::SizeType>(data.name.size()));
+		writer.Key("phone");
+		writer.String(data.phone.c_str(), static_cast<rapidjson::SizeType>(data.phone.size()));
+		writer.Key("number");
+		writer.Int(data.number);
+		writer.EndObject();
+
+		EXPECT_EQ(codec::encodeJson(data), buffer.GetString());
+	}
+}
+
+namespace
+{
+	std::string bytes(std::initializer_list<unsigned char> values)
+	{
+		return std::string(values.begin(), values.end());
+	}
+
+	Sample makeSample()
+	{
+		Sample sample;
+		sample.big = -1234567890123;
+		sample.small = 42;
+		sample.flag = true;
+		sample.ratio = -0.375;
+		sample.label = "binary";
+		return sample;
+	}
+
+	template <typename Encode, typename Decode>
+	void expectRoundTrip(Encode encode, Decode decode)
+	{
+		Sample sample = makeSample();
+		auto decoded = decode(encode(sample));
+		ASSERT_TRUE(decoded.has_value());
+		EXPECT_EQ(decoded->big, sample.big);
+		EXPECT_EQ(decoded->small, sample.small);
+		EXPECT_EQ(decoded->flag, sample.flag);
+		EXPECT_EQ(decoded->ratio, sample.ratio);
+		EXPECT_EQ(decoded->label, sample.label);
+	}
+}
+
+TEST(CodecTest, BinaryFormatsRoundTrip)
+{
+	expectRoundTrip([](const Sample &s)
+					{ return codec::encodeMsgPack(s); },
+					[](const std::string &data)
+					{ return codec::decodeMsgPack<Sample>(data); });
+	expectRoundTrip([](const Sample &s)
+					{ return codec::encodeCbor(s); },
+					[](const std::string &data)
+					{ return codec::decodeCbor<Sample>(data); });
+
+	UserData data(7, "Name", "+1-555-0100", -1000);
+	for (auto format : {codec::Format::Json, codec::Format::MsgPack, codec::Format::Cbor})
+	{
+		std::string encoded = codec::encode(format, [&](auto &writer)
+											{
+			writer.startObject(codec::fieldCount<UserData>);
+			writer.members(data);
+			writer.endObject(); });
+		auto decoded = codec::decode<UserData>(format, encoded);
+		ASSERT_TRUE(decoded.has_value());
+		EXPECT_EQ(decoded->id, data.id);
+		EXPECT_EQ(decoded->name, data.name);
+		EXPECT_EQ(decoded->phone, data.phone);
+		EXPECT_EQ(decoded->number, data.number);
+	}
+}
+
+TEST(CodecTest, MsgPackUsesMinimalEncodings)
+{
+	auto encoded = [](auto value)
+	{
+		std::string out;
+		codec::MsgPackWriter writer(out);
+		writer.value(value);
+		return out;
+	};
+
+	EXPECT_EQ(encoded(5), bytes({0x05}));
+	EXPECT_EQ(encoded(-1), bytes({0xFF}));
+	EXPECT_EQ(encoded(-33), bytes({0xD0, 0xDF}));
+	EXPECT_EQ(encoded(200), bytes({0xCC, 0xC8}));
+	EXPECT_EQ(encoded(70000), bytes({0xCE, 0x00, 0x01, 0x11, 0x70}));
+	EXPECT_EQ(encoded(true), bytes({0xC3}));
+	EXPECT_EQ(encoded("ab"), bytes({0xA2, 'a', 'b'}));
+	EXPECT_EQ(encoded(std::string(40, 'x')).substr(0, 2), bytes({0xD9, 40}));
+
+	// {"id": 1, "name": "A", "phone": "B", "number": 2} from another encoder, with str8 and int16 forms
+	auto user = codec::decodeMsgPack<UserData>(bytes({0x84,
+													  0xA2, 'i', 'd', 0xD1, 0x00, 0x01,
+													  0xA4, 'n', 'a', 'm', 'e', 0xD9, 0x01, 'A',
+													  0xA5, 'p', 'h', 'o', 'n', 'e', 0xA1, 'B',
+													  0xA6, 'n', 'u', 'm', 'b', 'e', 'r', 0x02}));
+	ASSERT_TRUE(user.has_value());
+	EXPECT_EQ(user->id, 1);
+	EXPECT_EQ(user->name, "A");
+	EXPECT_EQ(user->number, 2);
+}
+
+TEST(CodecTest, CborDecodesKnownItems)
+{
+	auto integer = [](const std::string &data)
+	{
+		codec::CborReader reader(data);
+		int64_t value = 0;
+		EXPECT_EQ(codec::readField(reader, value), codec::ReadResult::Stored);
+		EXPECT_TRUE(reader.atEnd());
+		return value;
+	};
+	EXPECT_EQ(integer(bytes({0x19, 0x03, 0xE8})), 1000);
+	EXPECT_EQ(integer(bytes({0x39, 0x03, 0xE7})), -1000);
+	EXPECT_EQ(integer(bytes({0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF})), INT64_MIN);
+
+	auto real = [](const std::string &data)
+	{
+		codec::CborReader reader(data);
+		double value = 0;
+		EXPECT_EQ(codec::readField(reader, value), codec::ReadResult::Stored);
+		return value;
+	};
+	EXPECT_EQ(real(bytes({0xF9, 0x3C, 0x00})), 1.0);
+	EXPECT_EQ(real(bytes({0xF9, 0xC4, 0x00})), -4.0);
+	EXPECT_EQ(real(bytes({0xFA, 0x47, 0xC3, 0x50, 0x00})), 100000.0);
+
+	std::string out;
+	codec::CborWriter writer(out);
+	writer.value(-1000);
+	writer.value(1000u);
+	EXPECT_EQ(out, bytes({0x39, 0x03, 0xE7, 0x19, 0x03, 0xE8}));
+
+	// Indefinite-length strings are refused rather than misread
+	EXPECT_EQ(codec::decodeCbor<Sample>(bytes({0xA1, 0x7F, 0x61, 'a', 0xFF, 0x01})).error().kind,
+			  codec::DecodeError::Syntax);
+}
+
+TEST(CodecTest, BinaryTruncationIsSyntaxError)
+{
+	for (const auto &[encoded, format] : {
+			 std::pair{codec::encodeMsgPack(makeSample()), codec::Format::MsgPack},
+			 std::pair{codec::encodeCbor(makeSample()), codec::Format::Cbor},
+		 })
+	{
+		for (size_t length = 0; length < encoded.size(); ++length)
+		{
+			auto result = codec::decode<Sample>(format, std::string_view(encoded).substr(0, length));
+			ASSERT_FALSE(result.has_value()) << length;
+			EXPECT_EQ(result.error().kind, codec::DecodeError::Syntax) << length;
+		}
+
+		auto trailing = codec::decode<Sample>(format, encoded + '\x00');
+		ASSERT_FALSE(trailing.has_value());
+		EXPECT_EQ(trailing.error().kind, codec::DecodeError::Syntax);
+	}
+}
+
+TEST(CodecTest, BinaryFieldErrorsMatchJson)
+{
+	EXPECT_EQ(codec::decodeMsgPack<Sample>(bytes({0x93, 0x01, 0x02, 0x03})).error().kind, codec::DecodeError::NotAnObject);
+	EXPECT_EQ(codec::decodeCbor<Sample>(bytes({0x83, 0x01, 0x02, 0x03})).error().kind, codec::DecodeError::NotAnObject);
+
+	// "small" sent as a string: the first failing field is reported
+	std::string out;
+	codec::MsgPackWriter writer(out);
+	writer.startObject(5);
+	writer.key("big");
+	writer.value(1);
+	writer.key("small");
+	writer.value("5");
+	writer.key("flag");
+	writer.value(false);
+	writer.key("ratio");
+	writer.value(1);
+	writer.key("label");
+	writer.value("ok");
+	auto wrong = codec::decodeMsgPack<Sample>(out);
+	ASSERT_FALSE(wrong.has_value());
+	EXPECT_EQ(wrong.error().kind, codec::DecodeError::WrongType);
+	EXPECT_EQ(wrong.error().field, 1u);
+
+	// Duplicates keep the first value; unknown keys of any type are skipped
+	out.clear();
+	writer.startObject(7);
+	writer.key("big");
+	writer.value(1);
+	writer.key("big");
+	writer.value(2);
+	writer.key("extra");
+	writer.startArray(2);
+	writer.value(1);
+	writer.value("x");
+	writer.key("small");
+	writer.value(5);
+	writer.key("flag");
+	writer.value(false);
+	writer.key("ratio");
+	writer.value(1);
+	writer.key("label");
+	writer.value("ok");
+	auto duplicate = codec::decodeMsgPack<Sample>(out);
+	ASSERT_TRUE(duplicate.has_value());
+	EXPECT_EQ(duplicate->big, 1);
+	EXPECT_EQ(duplicate->ratio, 1.0);
+}
+
+TEST(CodecTest, SplitArrayReturnsElementBytes)
+{
+	for (auto format : {codec::Format::Json, codec::Format::MsgPack, codec::Format::Cbor})
+	{
+		std::string encoded = codec::encode(format, [](auto &writer)
+											{
+			writer.startArray(3);
+			writer.startObject(1);
+			writer.key("big");
+			writer.value(1);
+			writer.endObject();
+			writer.value(7);
+			writer.startObject(1);
+			writer.key("label");
+			writer.value("two");
+			writer.endObject();
+			writer.endArray(); });
+
+		auto items = codec::splitArray(format, encoded);
+		ASSERT_TRUE(items.has_value());
+		ASSERT_EQ(items->size(), 3u);
+		EXPECT_EQ(codec::decode<Sample>(format, (*items)[0]).error().kind, codec::DecodeError::MissingField);
+		EXPECT_EQ(codec::decode<Sample>(format, (*items)[1]).error().kind, codec::DecodeError::NotAnObject);
+
+		std::string object = codec::encode(format, [](auto &writer)
+										   {
+			writer.startObject(0);
+			writer.endObject(); });
+		EXPECT_EQ(codec::splitArray(format, object).error().kind, codec::DecodeError::NotAnObject);
+		EXPECT_EQ(codec::splitArray(format, encoded.substr(0, encoded.size() - 1)).error().kind,
+				  codec::DecodeError::Syntax);
+	}
+}
+
+TEST(CodecTest, DecodeStringsInAllFormats)
+{
+	for (auto format : {codec::Format::Json, codec::Format::MsgPack, codec::Format::Cbor})
+	{
+		std::string encoded = codec::encode(format, [](auto &writer)
+											{
+			writer.startArray(3);
+			writer.value("user_1");
+			writer.value("");
+			writer.value("user_\u00e9");
+			writer.endArray(); });
+		auto strings = codec::decodeStrings(format, encoded);
+		ASSERT_TRUE(strings.has_value());
+		EXPECT_EQ(*strings, (std::vector<std::string>{"user_1", "", "user_\u00e9"}));
+
+		std::string mixed = codec::encode(format, [](auto &writer)
+										  {
+			writer.startArray(3);
+			writer.value("user_1");
+			writer.startObject(1);
+			writer.key("a");
+			writer.startArray(0);
+			writer.endArray();
+			writer.endObject();
+			writer.value(3);
+			writer.endArray(); });
+		auto wrong = codec::decodeStrings(format, mixed);
+		ASSERT_FALSE(wrong.has_value());
+		EXPECT_EQ(wrong.error().kind, codec::DecodeError::WrongType);
+		EXPECT_EQ(wrong.error().field, 1u);
+
+		std::string object = codec::encode(format, [](auto &writer)
+										   {
+			writer.startObject(0);
+			writer.endObject(); });
+		EXPECT_EQ(codec::decodeStrings(format, object).error().kind, codec::DecodeError::NotAnObject);
+		EXPECT_EQ(codec::decodeStrings(format, encoded.substr(0, encoded.size() - 1)).error().kind,
+				  codec::DecodeError::Syntax);
+	}
+}
+
+TEST(CodecTest, ContentNegotiation)
+{
+	using codec::Format;
+	EXPECT_EQ(codec::formatFromContentType(""), Format::Json);
+	EXPECT_EQ(codec::formatFromContentType("text/plain"), Format::Json);
+	EXPECT_EQ(codec::formatFromContentType("application/msgpack"), Format::MsgPack);
+	EXPECT_EQ(codec::formatFromContentType("Application/X-MsgPack; charset=binary"), Format::MsgPack);
+	EXPECT_EQ(codec::formatFromContentType("application/cbor"), Format::Cbor);
+
+	EXPECT_EQ(codec::formatFromAccept("", Format::Cbor), Format::Cbor);
+	EXPECT_EQ(codec::formatFromAccept("*/*", Format::MsgPack), Format::MsgPack);
+	EXPECT_EQ(codec::formatFromAccept("text/html", Format::MsgPack), Format::MsgPack);
+	EXPECT_EQ(codec::formatFromAccept("application/cbor", Format::Json), Format::Cbor);
+	EXPECT_EQ(codec::formatFromAccept("application/json, application/cbor", Format::MsgPack), Format::Json);
+	EXPECT_EQ(codec::formatFromAccept("application/json;q=0.5, application/msgpack", Format::Json), Format::MsgPack);
+	EXPECT_EQ(codec::formatFromAccept("application/msgpack;q=0, */*;q=0.1", Format::Cbor), Format::Cbor);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <server/FileTailer.h>
+#include <server/RequestHandler.h>
+
+class FileTailerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		handler = std::make_unique<RequestHandler>();
+		directory = std::filesystem::temp_directory_path() / ("file_tailer_test_" + std::to_string(getpid()));
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directory(directory);
+	}
+
+	void TearDown() override { std::filesystem::remove_all(directory); }
+
+	void append(const std::string &name, const std::string &text)
+	{
+		std::ofstream file(directory / name, std::ios::app | std::ios::binary);
+		file << text;
+	}
+
+	static std::string line(int id, int number)
+	{
+		return R"({"id":)" + std::to_string(id) + R"(,"name":"Tail","phone":"+1234567890","number":)" +
+			   std::to_string(number) + "}\n";
+	}
+
+	// Events are queued by the time the write returns
+	size_t poll(FileTailer &tailer)
+	{
+		tailer.handleEvents();
+		size_t total = 0;
+		while (tailer.pending())
+		{
+			total += tailer.drain(*handler);
+		}
+		return total;
+	}
+
+	std::unique_ptr<RequestHandler> handler;
+	std::filesystem::path directory;
+};
+
+TEST_F(FileTailerTest, ReadsExistingFilesAndWhatIsAppended)
+{
+	append("a.jsonl", line(1, 10) + line(2, 20) + "{\n\n" + R"({"id":1,)");
+	append("ignored.txt", line(9, 99));
+
+	FileTailer tailer;
+	ASSERT_TRUE(tailer.open(directory));
+	poll(tailer);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), 10);
+	EXPECT_EQ(handler->getTotalNumbersSum(), 30);
+	EXPECT_EQ(tailer.counters().parse_errors, 1u);
+	// The unfinished line waits for its newline
+	EXPECT_GT(tailer.counters().lag_bytes, 0u);
+
+	append("a.jsonl", R"("name":"Tail","phone":"+1234567890","number":5})"
+					  "\n");
+	append("b.jsonl", line(3, 30));
+	poll(tailer);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), 15);
+	EXPECT_EQ(handler->getClientNumbersSum("user_3"), 30);
+	EXPECT_EQ(handler->getClientNumbersSum("user_9"), 0);
+	EXPECT_EQ(tailer.counters().applied, 4u);
+	EXPECT_EQ(tailer.counters().lag_bytes, 0u);
+	EXPECT_EQ(tailer.offset("a.jsonl"), std::filesystem::file_size(directory / "a.jsonl"));
+}
+
+TEST_F(FileTailerTest, ResumesFromCheckpointAfterRestart)
+{
+	append("a.jsonl", line(1, 10) + line(1, 20));
+	{
+		FileTailer tailer;
+		ASSERT_TRUE(tailer.open(directory));
+		poll(tailer);
+		EXPECT_EQ(tailer.counters().applied, 2u);
+	}
+
+	// Written while the server was down
+	append("a.jsonl", line(1, 5));
+	FileTailer tailer;
+	ASSERT_TRUE(tailer.open(directory));
+	poll(tailer);
+	EXPECT_EQ(tailer.counters().applied, 1u);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), 35);
+}
+
+TEST_F(FileTailerTest, RereadsReplacedFiles)
+{
+	append("a.jsonl", line(1, 10));
+	FileTailer tailer;
+	ASSERT_TRUE(tailer.open(directory, (directory / "offsets").string()));
+	poll(tailer);
+
+	// Same name, new inode: rename over it as log shippers do
+	append("new.tmp", line(2, 7));
+	std::filesystem::rename(directory / "new.tmp", directory / "a.jsonl");
+	poll(tailer);
+	EXPECT_EQ(handler->getClientNumbersSum("user_2"), 7);
+
+	std::filesystem::remove(directory / "a.jsonl");
+	poll(tailer);
+	EXPECT_EQ(tailer.offset("a.jsonl"), 0u);
+	EXPECT_TRUE(std::filesystem::exists(directory / "offsets"));
+	EXPECT_FALSE(std::filesystem::exists(directory / ".tail-offsets"));
+}
+
+TEST_F(FileTailerTest, DrainStopsAtItsBudget)
+{
+	std::string lines;
+	for (int i = 0; i < 200; ++i)
+	{
+		lines += line(i % 5, 1);
+	}
+	append("a.jsonl", lines);
+
+	FileTailer tailer;
+	ASSERT_TRUE(tailer.open(directory));
+	tailer.handleEvents();
+	ASSERT_TRUE(tailer.pending());
+	size_t drains = 0;
+	while (tailer.pending())
+	{
+		const size_t consumed = tailer.drain(*handler, lines.size() / 4);
+		EXPECT_LE(consumed, lines.size() / 4 + FileTailer::READ_BYTES);
+		drains++;
+	}
+	EXPECT_GT(drains, 1u);
+	EXPECT_EQ(tailer.counters().applied, 200u);
+	EXPECT_EQ(handler->getTotalNumbersSum(), 200);
+
+	tailer.defer();
+	EXPECT_EQ(tailer.counters().deferred, 1u);
+}
+
+TEST_F(FileTailerTest, DropsLinesLongerThanOneRead)
+{
+	// The dropped line ends in something that would parse as a record
+	append("a.jsonl", std::string(FileTailer::READ_BYTES, 'x') + line(7, 70) + line(1, 10));
+
+	FileTailer tailer;
+	ASSERT_TRUE(tailer.open(directory));
+	tailer.handleEvents();
+	tailer.drain(*handler, FileTailer::READ_BYTES);
+	// Its newline lands inside a read the budget cut short of the next one
+	tailer.drain(*handler, line(7, 70).size() + 5);
+	while (tailer.pending())
+	{
+		tailer.drain(*handler);
+	}
+	EXPECT_EQ(handler->getClientNumbersSum("user_7"), 0);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), 10);
+	EXPECT_EQ(tailer.counters().parse_errors, 1u);
+}
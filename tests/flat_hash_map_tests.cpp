@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <common/FlatHashMap.h>
+
+namespace
+{
+	// Every key lands in the same group and shares a tag, so lookups have
+	// to probe past full groups and compare keys
+	struct CollidingHash
+	{
+		size_t operator()(int) const { return 0x1234; }
+	};
+}
+
+TEST(FlatHashMapTest, InsertFindErase)
+{
+	FlatHashMap<int, int> map;
+	EXPECT_TRUE(map.empty());
+	EXPECT_EQ(map.find(1), map.end());
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto [it, inserted] = map.try_emplace(i, i * 2);
+		EXPECT_TRUE(inserted);
+		EXPECT_EQ(it->second, i * 2);
+	}
+	EXPECT_EQ(map.size(), 1000u);
+	EXPECT_FALSE(map.try_emplace(7, 0).second);
+	EXPECT_EQ(map[7], 14);
+
+	for (int i = 0; i < 1000; i += 2)
+	{
+		EXPECT_EQ(map.erase(i), 1u);
+	}
+	EXPECT_EQ(map.erase(0), 0u);
+	EXPECT_EQ(map.size(), 500u);
+	for (int i = 0; i < 1000; ++i)
+	{
+		EXPECT_EQ(map.contains(i), i % 2 == 1) << i;
+	}
+
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_EQ(map.begin(), map.end());
+	map[3] += 5;
+	EXPECT_EQ(map.at(3), 5);
+}
+
+TEST(FlatHashMapTest, HeterogeneousStringLookup)
+{
+	FlatHashMap<std::string, long long> map;
+	map["user_1"] += 10;
+	map[std::string_view("user_1")] += 5;
+	map.try_emplace(std::string_view("user_2"), 7);
+
+	EXPECT_EQ(map.size(), 2u);
+	EXPECT_EQ(map.find(std::string_view("user_1"))->second, 15);
+	EXPECT_EQ(map.find("user_2")->second, 7);
+	EXPECT_FALSE(map.contains(std::string_view("user_3")));
+}
+
+TEST(FlatHashMapTest, MatchesUnorderedMapUnderRandomOperations)
+{
+	FlatHashMap<int, int> map;
+	FlatHashMap<int, int, CollidingHash> colliding;
+	std::unordered_map<int, int> reference;
+	std::mt19937 rng(12345);
+
+	// Small key range and frequent erases keep tombstones cycling through rehashes
+	for (int round = 0; round < 200000; ++round)
+	{
+		int key = static_cast<int>(rng() % 512);
+		switch (rng() % 3)
+		{
+		case 0:
+			map[key] = round;
+			if (round % 16 == 0)
+				colliding[key] = round;
+			reference[key] = round;
+			break;
+		case 1:
+			ASSERT_EQ(map.erase(key), reference.erase(key)) << round;
+			colliding.erase(key);
+			break;
+		default:
+		{
+			auto it = map.find(key);
+			auto expected = reference.find(key);
+			ASSERT_EQ(it == map.end(), expected == reference.end()) << round;
+			if (it != map.end())
+			{
+				ASSERT_EQ(it->second, expected->second) << round;
+			}
+		}
+		}
+	}
+
+	ASSERT_EQ(map.size(), reference.size());
+	size_t visited = 0;
+	for (const auto &[key, value] : map)
+	{
+		EXPECT_EQ(reference.at(key), value);
+		++visited;
+	}
+	EXPECT_EQ(visited, reference.size());
+	EXPECT_LE(colliding.size(), reference.size());
+	for (const auto &[key, value] : colliding)
+	{
+		EXPECT_TRUE(colliding.contains(key));
+	}
+}
+
+TEST(FlatHashMapTest, EraseWhileIterating)
+{
+	FlatHashMap<int, std::unique_ptr<int>> map;
+	for (int i = 0; i < 100; ++i)
+	{
+		map.try_emplace(i, std::make_unique<int>(i));
+	}
+
+	for (auto it = map.begin(); it != map.end();)
+	{
+		it = *it->second % 3 == 0 ? map.erase(it) : std::next(it);
+	}
+
+	EXPECT_EQ(map.size(), 66u);
+	for (const auto &[key, value] : map)
+	{
+		EXPECT_NE(key % 3, 0);
+		EXPECT_EQ(*value, key);
+	}
+}
+
+TEST(FlatHashMapTest, CopyMoveAndSnapshot)
+{
+	FlatHashMap<std::string, std::string> map{{"a", "1"}, {"b", "2"}};
+	map.reserve(1000);
+	EXPECT_GE(map.capacity(), 1000u);
+
+	FlatHashMap<std::string, std::string> copy = map;
+	copy["c"] = "3";
+	EXPECT_EQ(map.size(), 2u);
+	EXPECT_EQ(copy.size(), 3u);
+
+	FlatHashMap<std::string, std::string> moved = std::move(copy);
+	EXPECT_EQ(moved.size(), 3u);
+	EXPECT_EQ(moved.at("c"), "3");
+
+	auto snapshot = moved.snapshot();
+	moved.clear();
+	ASSERT_EQ(snapshot.size(), 3u);
+	std::sort(snapshot.begin(), snapshot.end());
+	EXPECT_EQ(snapshot.front(), std::make_pair(std::string("a"), std::string("1")));
+	EXPECT_EQ(snapshot.back(), std::make_pair(std::string("c"), std::string("3")));
+}
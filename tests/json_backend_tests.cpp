@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <server/JsonBackend.h>
+
+class JsonBackendTest : public ::testing::Test
+{
+protected:
+	// Every backend must produce the same UserData or the same error as the DOM parse
+	void expectSameResult(const std::string &json)
+	{
+		expectSameResult(codec, json);
+		expectSameResult(structural, json);
+	}
+
+	void expectSameResult(const JsonBackend &backend, const std::string &json)
+	{
+		auto expected = reference.parseUserData(json);
+		auto actual = backend.parseUserData(json);
+
+		ASSERT_EQ(expected.has_value(), actual.has_value()) << backend.name() << " input: " << json;
+		if (expected)
+		{
+			EXPECT_EQ(expected->id, actual->id) << backend.name() << " input: " << json;
+			EXPECT_EQ(expected->name, actual->name) << backend.name() << " input: " << json;
+			EXPECT_EQ(expected->phone, actual->phone) << backend.name() << " input: " << json;
+			EXPECT_EQ(expected->number, actual->number) << backend.name() << " input: " << json;
+		}
+		else
+		{
+			EXPECT_EQ(toString(expected.error()), toString(actual.error())) << backend.name() << " input: " << json;
+		}
+	}
+
+	static std::vector<std::string> corpus()
+	{
+		return {
+			R"({"id": 1, "name": "Test User", "phone": "+1234567890", "number": 42})",
+			R"({"number":42,"phone":"+1","name":"n","id":7})",
+			"  \t\r\n{ \"id\" : 1 , \"name\" : \"a\" , \"phone\" : \"b\" , \"number\" : 2 }\n ",
+			R"({"id": 1, "name": "a\"b\\c\/d\b\f\n\r\t", "phone": "é中😀", "number": 2})",
+			R"({"id": 1, "name": "\ud83d", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "\ude00", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "\u0000x", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "\x", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "ends with backslash\\", "phone": "p", "number": 2})",
+			R"({"id": 1, "id": 2, "name": "first", "name": "second", "phone": "p", "number": 2})",
+			R"({"id": "1", "id": 2, "name": "n", "phone": "p", "number": 2})",
+			R"({"extra": {"id": 9, "list": [1, 2.5, "x", null, true, false, {}, []]}, "id": 1, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1.0, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1e2, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1e400, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": -0, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 2147483647, "name": "n", "phone": "p", "number": -2147483648})",
+			R"({"id": 2147483648, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": -2147483649, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 123456789012345678901234567890, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 01, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": -, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1 2, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": tru, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": null, "name": "n", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": ["n"], "phone": "p", "number": 2})",
+			R"({"id": 1, "name": "n", "phone": "p"})",
+			R"({"id": 1, "name": "n", "phone": "p", "number": 2,})",
+			R"({"id": 1, "name": "n", "phone": "p", "number": 2}})",
+			R"({"id": 1, "name": "n", "phone": "p", "number": 2} x)",
+			R"({"id": 1 "name": "n"})",
+			R"({"id"  1})",
+			R"({,})",
+			R"({})",
+			R"([])",
+			R"([1, 2, 3])",
+			R"("string")",
+			"42",
+			"true",
+			"",
+			"   ",
+			"\xEF\xBB\xBF{\"id\": 1, \"name\": \"n\", \"phone\": \"p\", \"number\": 2}",
+			"\xBB{\"id\": 1, \"name\": \"n\", \"phone\": \"p\", \"number\": 2}",
+			std::string("{\"id\": 1, \"name\": \"n\", \"phone\": \"p\", \"number\": 2}") + '\0' + "garbage",
+			"{\"id\": 1, \"name\": \"tab\there\", \"phone\": \"p\", \"number\": 2}",
+			"{\"id\": 1, \"name\": \"caf\xC3\xA9\", \"phone\": \"p\", \"number\": 2}",
+			R"({"id": 1, "name": "n", "phone": "p", "number": 2, "padding": ")" + std::string(200, 'x') + R"("})",
+			R"({"id": 1, "name": ")" + std::string(63, '\\') + R"(", "phone": "p", "number": 2})",
+			R"({"id": 1, "name": ")" + std::string(64, '\\') + R"(", "phone": "p", "number": 2})",
+		};
+	}
+
+	RapidJsonBackend reference;
+	CodecJsonBackend codec;
+	StructuralJsonBackend structural;
+};
+
+TEST_F(JsonBackendTest, CreateSelectsBackendByName)
+{
+	EXPECT_STREQ(JsonBackend::create("codec")->name(), "codec");
+	EXPECT_STREQ(JsonBackend::create("rapidjson")->name(), "rapidjson");
+	EXPECT_STREQ(JsonBackend::create("structural")->name(), "structural");
+	EXPECT_STREQ(JsonBackend::create("unknown")->name(), "codec");
+}
+
+TEST_F(JsonBackendTest, StructuralParsesValidPayload)
+{
+	auto result = structural.parseUserData(
+		R"({"id": 7, "name": "Test \"User\"", "phone": "+1234567890", "number": -3})");
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result->id, 7);
+	EXPECT_EQ(result->name, "Test \"User\"");
+	EXPECT_EQ(result->phone, "+1234567890");
+	EXPECT_EQ(result->number, -3);
+}
+
+TEST_F(JsonBackendTest, MatchesReferenceOnCorpus)
+{
+	for (const auto &json : corpus())
+	{
+		expectSameResult(json);
+	}
+}
+
+TEST_F(JsonBackendTest, MatchesReferenceOnEveryTruncation)
+{
+	for (const auto &json : corpus())
+	{
+		for (size_t length = 0; length < json.size(); ++length)
+		{
+			expectSameResult(json.substr(0, length));
+		}
+	}
+}
+
+TEST_F(JsonBackendTest, MatchesReferenceOnRandomMutations)
+{
+	static const char alphabet[] = "{}[]:,\"\\ \t\n0123456789-+.eEtrufalsn\x01\x7f\xc3";
+	std::mt19937 rng(12345);
+
+	for (const auto &json : corpus())
+	{
+		if (json.empty())
+			continue;
+
+		for (int round = 0; round < 200; ++round)
+		{
+			std::string mutated = json;
+			int edits = 1 + static_cast<int>(rng() % 3);
+			for (int i = 0; i < edits; ++i)
+			{
+				size_t pos = rng() % mutated.size();
+				char c = alphabet[rng() % (sizeof(alphabet) - 1)];
+				switch (rng() % 3)
+				{
+				case 0:
+					mutated[pos] = c;
+					break;
+				case 1:
+					mutated.insert(mutated.begin() + pos, c);
+					break;
+				default:
+					if (mutated.size() > 1)
+						mutated.erase(mutated.begin() + pos);
+					break;
+				}
+			}
+			expectSameResult(mutated);
+		}
+	}
+}
@@ -14,6 +14,10 @@
 #include <unordered_map>
 #include <iostream>
 #include <memory>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <client/Client.h>
 
 class LoadBenchmark : public benchmark::Fixture
@@ -406,6 +410,117 @@ protected:
 
         state.counters["success_rate"] = result.getSuccessRate();
     }
+
+    long long clientSum(Client &client, int id)
+    {
+        std::string response = client.sendRequest("/numbers/sum/user_" + std::to_string(id), "GET");
+        size_t pos = response.find("\"numbers_sum\":");
+        return pos == std::string::npos ? -1 : std::atoll(response.c_str() + pos + 14);
+    }
+
+    // Sends records with number 1 for one fresh client, either as /process
+    // requests over 8 connections or as datagrams to the UDP listener on the
+    // same port number (server.udp_port), and times them until the server's
+    // sum for the client stops growing. UDP may lose datagrams, so the
+    // delivered share is reported next to the rate.
+    void runIngestTest(benchmark::State &state, bool udp)
+    {
+        if (!isServerReady())
+        {
+            state.SkipWithError("Test server not available");
+            return;
+        }
+
+        const int records = udp ? 50000 : 2000;
+        auto reader = createClient();
+        double delivered_percent = 0;
+        double records_per_second = 0;
+
+        for (auto _ : state)
+        {
+            const int id = 1000000 + std::rand() % 1000000;
+            auto start = std::chrono::steady_clock::now();
+
+            if (udp)
+            {
+                int fd = socket(AF_INET, SOCK_DGRAM, 0);
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_port = htons(TEST_PORT);
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+                const std::string payload = R"({"id":)" + std::to_string(id) +
+                                            R"(,"name":"Udp","phone":"+1-555-0100","number":1})";
+                constexpr int batch = 64;
+                std::vector<iovec> iovecs(batch, iovec{const_cast<char *>(payload.data()), payload.size()});
+                std::vector<mmsghdr> messages(batch);
+                for (int i = 0; i < batch; ++i)
+                {
+                    messages[i].msg_hdr.msg_name = &address;
+                    messages[i].msg_hdr.msg_namelen = sizeof(address);
+                    messages[i].msg_hdr.msg_iov = &iovecs[i];
+                    messages[i].msg_hdr.msg_iovlen = 1;
+                }
+                for (int sent = 0; sent < records;)
+                {
+                    int n = sendmmsg(fd, messages.data(), std::min(batch, records - sent), 0);
+                    if (n <= 0)
+                        break;
+                    sent += n;
+                }
+                close(fd);
+            }
+            else
+            {
+                std::vector<std::thread> threads;
+                for (int t = 0; t < 8; ++t)
+                {
+                    threads.emplace_back([&]
+                                         {
+                        auto client = createClient();
+                        const std::string payload = R"({"id":)" + std::to_string(id) +
+                                                    R"(,"name":"Http","phone":"+1-555-0100","number":1})";
+                        for (int i = 0; i < records / 8; ++i)
+                        {
+                            client->sendRequest("/process", "POST", payload);
+                        } });
+                }
+                for (auto &thread : threads)
+                {
+                    thread.join();
+                }
+            }
+
+            // Wait until every record is in, or the sum has not moved for 200 ms
+            long long sum = 0;
+            auto last_change = std::chrono::steady_clock::now();
+            while (sum < records && std::chrono::steady_clock::now() - last_change < std::chrono::milliseconds(200))
+            {
+                long long current = clientSum(*reader, id);
+                if (current > sum)
+                {
+                    sum = current;
+                    last_change = std::chrono::steady_clock::now();
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+
+            if (sum <= 0)
+            {
+                state.SkipWithError(udp ? "UDP ingestion not enabled on the server (server.udp_port)"
+                                        : "No records applied");
+                return;
+            }
+
+            double elapsed = std::chrono::duration<double>(last_change - start).count();
+            state.SetIterationTime(elapsed);
+            delivered_percent = 100.0 * static_cast<double>(sum) / records;
+            records_per_second = static_cast<double>(sum) / elapsed;
+        }
+
+        state.counters["delivered_percent"] = delivered_percent;
+        state.counters["records_per_second"] = records_per_second;
+    }
 };
 
 // Light load benchmark - INCREASED from 3x10 to 5x20
@@ -519,4 +634,17 @@ BENCHMARK_DEFINE_F(LoadBenchmark, NumberAccuracy)(benchmark::State &state)
 }
 BENCHMARK_REGISTER_F(LoadBenchmark, NumberAccuracy)->Unit(benchmark::kMillisecond);
 
+// Fire-and-forget ingestion: the same records over HTTP /process and UDP
+BENCHMARK_DEFINE_F(LoadBenchmark, HttpIngest)(benchmark::State &state)
+{
+    runIngestTest(state, false);
+}
+BENCHMARK_REGISTER_F(LoadBenchmark, HttpIngest)->Unit(benchmark::kMillisecond)->UseManualTime()->Iterations(3);
+
+BENCHMARK_DEFINE_F(LoadBenchmark, UdpIngest)(benchmark::State &state)
+{
+    runIngestTest(state, true);
+}
+BENCHMARK_REGISTER_F(LoadBenchmark, UdpIngest)->Unit(benchmark::kMillisecond)->UseManualTime()->Iterations(3);
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <vector>
 #include <algorithm>
 #include <client/Client.h>
+#include <codec/Codec.h>
+#include <server/UserData.h>
 
 class IntegrationTest : public ::testing::Test
 {
@@ -141,4 +143,30 @@ TEST_F(IntegrationTest, MultipleEndpoints)
 	auto async_response = client.sendRequest("/process-async", "POST",
 											 R"({"id": 999, "name": "Test", "phone": "+9999999999", "number": 100})");
 	EXPECT_TRUE(async_response.find("success") != std::string::npos);
-}
\ No newline at end of file
+}
+
+TEST_F(IntegrationTest, BinaryContentNegotiation)
+{
+	Client client("127.0.0.1", TEST_PORT);
+	UserData request(321, "Binary", "+1-555-0321", 9);
+
+	auto msgpack = client.sendRequest("/process", "POST", codec::encodeMsgPack(request), "application/msgpack");
+	auto reply = codec::decodeMsgPack<UserData>(msgpack);
+	ASSERT_TRUE(reply.has_value());
+	EXPECT_EQ(reply->number, 10);
+
+	auto json = client.sendRequest("/process", "POST", codec::encodeCbor(request), "application/cbor", "application/json");
+	EXPECT_TRUE(json.find("\"success\":true") != std::string::npos);
+
+	std::string batch;
+	codec::MsgPackWriter writer(batch);
+	writer.startArray(2);
+	writer.raw(codec::encodeMsgPack(request));
+	writer.raw(codec::encodeMsgPack(request));
+	auto results = client.sendRequest("/process-batch", "POST", batch, "application/msgpack", "application/json");
+	EXPECT_TRUE(results.find(R"("results":[{"id":321)") != std::string::npos);
+
+	auto total = client.sendRequest("/numbers/sum", "GET", "", "application/json", "application/cbor");
+	EXPECT_FALSE(total.empty());
+	EXPECT_EQ(static_cast<unsigned char>(total[0]), 0xA2);
+}
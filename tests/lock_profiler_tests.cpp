@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include <server/LockProfiler.h>
+
+TEST(LockProfilerTest, CountsUncontendedAcquisitions)
+{
+	InstrumentedMutex mutex("LockProfilerTest.uncontended");
+	InstrumentedMutex same_name("LockProfilerTest.uncontended");
+	for (int i = 0; i < 10; ++i)
+	{
+		std::lock_guard<InstrumentedMutex> lock(i % 2 ? mutex : same_name);
+	}
+	ASSERT_TRUE(mutex.try_lock());
+	mutex.unlock();
+
+	const auto &site = LockProfiler::site("LockProfilerTest.uncontended");
+	EXPECT_EQ(site.acquisitions, 11u);
+	EXPECT_EQ(site.contended, 0u);
+	uint64_t holds = 0;
+	for (const auto &count : site.hold.counts)
+		holds += count;
+	EXPECT_EQ(holds, 11u);
+}
+
+TEST(LockProfilerTest, RecordsWaitAndHoldTimes)
+{
+	InstrumentedMutex mutex("LockProfilerTest.contended");
+	std::atomic<bool> held{false};
+	std::thread holder([&]
+					   {
+		std::lock_guard<InstrumentedMutex> lock(mutex);
+		held = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+	while (!held)
+		std::this_thread::yield();
+	{
+		std::lock_guard<InstrumentedMutex> lock(mutex);
+	}
+	holder.join();
+
+	const auto &site = LockProfiler::site("LockProfilerTest.contended");
+	EXPECT_EQ(site.acquisitions, 2u);
+	EXPECT_EQ(site.contended, 1u);
+	EXPECT_GT(site.wait.max_ns, 5'000'000u);
+	EXPECT_GE(site.hold.max_ns, 20'000'000u);
+	// Beyond the last bound, so counted in +Inf
+	EXPECT_EQ(site.wait.counts.back(), 1u);
+
+	const std::string json = LockProfiler::toJson();
+	EXPECT_NE(json.find(R"("name":"LockProfilerTest.contended","acquisitions":2,"contended":1)"), std::string::npos);
+
+	LockProfiler::reset();
+	EXPECT_EQ(site.acquisitions, 0u);
+	EXPECT_EQ(site.wait.max_ns, 0u);
+}
+
+TEST(LockProfilerTest, ProfiledMutexWorksWithConditionVariables)
+{
+	ProfiledMutex mutex("LockProfilerTest.condition");
+	ProfiledConditionVariable condition;
+	bool ready = false;
+	std::thread notifier([&]
+						 {
+		std::lock_guard<ProfiledMutex> lock(mutex);
+		ready = true;
+		condition.notify_one(); });
+	{
+		ProfiledLock lock(mutex);
+		condition.wait(lock, [&]
+					   { return ready; });
+	}
+	notifier.join();
+	EXPECT_TRUE(ready);
+	EXPECT_EQ(LockProfiler::site("LockProfilerTest.condition").acquisitions > 0, LockProfiler::ENABLED);
+}
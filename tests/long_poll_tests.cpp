@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+
+#include <server/LongPoll.h>
+#include <server/RequestHandler.h>
+
+using namespace std::chrono_literals;
+
+class LongPollTest : public ::testing::Test
+{
+protected:
+	// A waiter that answers on expiry, or on a version change once ready
+	LongPollQueue::Resume waiter(int index)
+	{
+		return [this, index](bool expired)
+		{
+			calls.push_back(index);
+			if (!expired && !ready)
+				return false;
+			answered.push_back({index, expired});
+			return true;
+		};
+	}
+
+	LongPollQueue queue;
+	bool ready = true;
+	std::vector<int> calls;
+	std::vector<std::pair<int, bool>> answered;
+};
+
+TEST_F(LongPollTest, ResumesWhenTheVersionMoves)
+{
+	ASSERT_TRUE(queue.valid());
+	Clock::tick();
+	const uint64_t now = Clock::coarseMillis();
+	queue.park(5, 1000ms, waiter(1));
+	queue.park(6, 1000ms, waiter(2));
+
+	// Waiter 1 saw an older version than the current one
+	EXPECT_EQ(queue.poll(6, now), 1u);
+	EXPECT_EQ(answered, (std::vector<std::pair<int, bool>>{{1, false}}));
+
+	// Nothing changed, so nothing is looked at
+	calls.clear();
+	EXPECT_EQ(queue.poll(6, now), 0u);
+	EXPECT_TRUE(calls.empty());
+
+	EXPECT_EQ(queue.poll(7, now), 1u);
+	EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST_F(LongPollTest, KeepsWaitersWhoseDataDidNotChange)
+{
+	Clock::tick();
+	const uint64_t now = Clock::coarseMillis();
+	ready = false;
+	queue.park(1, 1000ms, waiter(1));
+
+	EXPECT_EQ(queue.poll(2, now), 0u);
+	EXPECT_EQ(calls.size(), 1u);
+	// Checked again only after the next change
+	EXPECT_EQ(queue.poll(2, now), 0u);
+	EXPECT_EQ(calls.size(), 1u);
+	EXPECT_EQ(queue.size(), 1u);
+}
+
+TEST_F(LongPollTest, ExpiresAtTheDeadline)
+{
+	Clock::tick();
+	const uint64_t now = Clock::coarseMillis();
+	queue.park(1, 50ms, waiter(1));
+	queue.park(1, 1h, waiter(2)); // capped at MAX_WAIT
+
+	EXPECT_EQ(queue.poll(1, now + 10), 0u);
+	EXPECT_EQ(queue.poll(1, now + 100), 1u);
+	EXPECT_EQ(queue.poll(1, now + LongPollQueue::MAX_WAIT.count() + 1000), 1u);
+	EXPECT_EQ(answered, (std::vector<std::pair<int, bool>>{{1, true}, {2, true}}));
+}
+
+TEST_F(LongPollTest, HandlerVersionFollowsUpdates)
+{
+	RequestHandler handler;
+	const uint64_t before = handler.getVersion();
+	ClientAggregates::Update updates[] = {{1, 2}, {2, 3}};
+	handler.recordUpdates(updates);
+	EXPECT_EQ(handler.getVersion(), before + 1);
+	handler.recordUpdates({updates, 1});
+	EXPECT_EQ(handler.getVersion(), before + 2);
+}
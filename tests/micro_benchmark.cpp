@@ -0,0 +1,638 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <client/ShmProducer.h>
+#include <common/ClientStatsTable.h>
+#include <common/FlatHashMap.h>
+#include <common/OrderedIndex.h>
+#include <common/rapidjson/document.h>
+#include <common/rapidjson/stringbuffer.h>
+#include <common/rapidjson/writer.h>
+#include <codec/Codec.h>
+#include <codec/Json.h>
+#include <server/Allocator.h>
+#include <server/ClientAggregates.h>
+#include <server/JsonBackend.h>
+#include <server/RequestHandler.h>
+#include <server/ShmIngest.h>
+#include <server/UdpListener.h>
+
+namespace
+{
+	std::string makePayload(int id)
+	{
+		return R"({"id": )" + std::to_string(id) +
+			   R"(, "name": "User_)" + std::to_string(id % 1000) +
+			   R"(", "phone": "+1-555-)" + std::to_string(1000 + id % 9000) +
+			   R"(", "number": )" + std::to_string(id % 100) + "}";
+	}
+}
+
+// Mirrors the allocation pattern of one /process request: DOM parse, field
+// copies, client key and a serialized response. Run with several threads to
+// expose arena contention; rebuild with -DSERVICE_ALLOCATOR=... to compare.
+static void BM_AllocatorRequestChurn(benchmark::State &state)
+{
+	std::vector<std::string> payloads;
+	for (int i = 0; i < 64; ++i)
+	{
+		payloads.push_back(makePayload(state.thread_index() * 64 + i));
+	}
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		const std::string &payload = payloads[i++ % payloads.size()];
+
+		rapidjson::Document doc;
+		doc.Parse(payload.c_str(), payload.size());
+		std::string name = doc["name"].GetString();
+		std::string phone = doc["phone"].GetString();
+		std::string client_id = "user_" + std::to_string(doc["id"].GetInt());
+
+		rapidjson::Document out;
+		out.SetObject();
+		auto &allocator = out.GetAllocator();
+		out.AddMember("id", doc["id"].GetInt(), allocator);
+		out.AddMember("name", rapidjson::Value(name.c_str(), allocator), allocator);
+		out.AddMember("phone", rapidjson::Value(phone.c_str(), allocator), allocator);
+		out.AddMember("number", doc["number"].GetInt() + 1, allocator);
+		out.AddMember("success", true, allocator);
+
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		out.Accept(writer);
+		std::string response = buffer.GetString();
+
+		benchmark::DoNotOptimize(client_id);
+		benchmark::DoNotOptimize(response);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(Allocator::backend());
+}
+BENCHMARK(BM_AllocatorRequestChurn)->ThreadRange(1, 8)->UseRealTime();
+
+// Mixed-size allocations freed on a different schedule than allocated
+static void BM_AllocatorMixedSizes(benchmark::State &state)
+{
+	std::vector<std::string> live(256);
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		size_t slot = (i * 7919) % live.size();
+		live[slot] = std::string(16 + (i % 61) * 17, 'x');
+		benchmark::DoNotOptimize(live[slot].data());
+		++i;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(Allocator::backend());
+}
+BENCHMARK(BM_AllocatorMixedSizes)->ThreadRange(1, 8)->UseRealTime();
+
+// Full /process handling without the simulated delay; compare valid traffic
+// with each class of rejected payload.
+static void BM_ProcessRequest(benchmark::State &state)
+{
+	static const std::vector<std::string> payloads = {
+		makePayload(42),
+		R"({"id": 42, "name": "User_42", "phone": "+1-555-1042", "number": )",
+		R"(["id", 42, "name", "User_42"])",
+		R"({"id": 42, "name": "User_42", "phone": "+1-555-1042"})",
+		R"({"id": -42, "name": "User_42", "phone": "+1-555-1042", "number": 42})",
+	};
+
+	RequestHandler handler;
+	handler.setProcessingDelay(std::chrono::microseconds(0));
+	const std::string &payload = payloads[state.range(0)];
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(handler.processRequest(payload));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_ProcessRequest)
+	->ArgName("payload") // 0 valid, 1 truncated, 2 not an object, 3 missing field, 4 invalid data
+	->DenseRange(0, 4);
+
+// Parse throughput per JSON backend. The padded payloads carry an unknown
+// string field so the structural scan, not per-field work, dominates.
+static void BM_JsonBackendParse(benchmark::State &state)
+{
+	static const char *const backends[] = {"rapidjson", "structural", "codec"};
+	auto backend = JsonBackend::create(backends[state.range(0)]);
+
+	std::string payload = makePayload(42);
+	if (state.range(1) > 0)
+	{
+		payload.pop_back();
+		payload += R"(, "padding": ")" + std::string(state.range(1), 'x') + R"("})";
+	}
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(backend->parseUserData(payload));
+	}
+
+	state.SetBytesProcessed(state.iterations() * payload.size());
+	state.SetLabel(backend->name());
+}
+BENCHMARK(BM_JsonBackendParse)
+	->ArgNames({"backend", "padding"}) // backend 0 rapidjson, 1 structural, 2 codec
+	->ArgsProduct({{0, 1, 2}, {0, 1024, 65536}});
+
+// /process response body: the former DOM build (0) against the codec writer (1)
+static void BM_UserDataEncode(benchmark::State &state)
+{
+	const UserData data(42, "User_42", "+1-555-1042", 43);
+
+	for (auto _ : state)
+	{
+		std::string response;
+		if (state.range(0) == 0)
+		{
+			rapidjson::Document doc;
+			doc.SetObject();
+			auto &allocator = doc.GetAllocator();
+			doc.AddMember("id", data.id, allocator);
+			doc.AddMember("name", rapidjson::Value(data.name.c_str(), allocator), allocator);
+			doc.AddMember("phone", rapidjson::Value(data.phone.c_str(), allocator), allocator);
+			doc.AddMember("number", data.number, allocator);
+			doc.AddMember("success", true, allocator);
+
+			rapidjson::StringBuffer buffer;
+			rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+			doc.Accept(writer);
+			response = buffer.GetString();
+		}
+		else
+		{
+			codec::JsonWriter writer(response);
+			writer.startObject();
+			writer.members(data);
+			writer.key("success");
+			writer.value(true);
+			writer.endObject();
+		}
+		benchmark::DoNotOptimize(response);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserDataEncode)->ArgName("codec")->DenseRange(0, 1);
+
+// Full /process handling per wire format (request and reply in the same one),
+// with the payload and reply sizes reported next to the CPU time.
+static void BM_ProcessFormat(benchmark::State &state)
+{
+	const auto format = static_cast<codec::Format>(state.range(0));
+	const UserData data(42, "User_42", "+1-555-1042", 42);
+	const std::string payload = codec::encode(format, [&](auto &writer)
+											  {
+		writer.startObject(codec::fieldCount<UserData>);
+		writer.members(data);
+		writer.endObject(); });
+
+	RequestHandler handler;
+	handler.setProcessingDelay(std::chrono::microseconds(0));
+	size_t response_size = 0;
+
+	for (auto _ : state)
+	{
+		auto response = handler.processRequest(payload, format, format);
+		response_size = response.size();
+		benchmark::DoNotOptimize(response);
+	}
+
+	state.counters["bytes_in"] = static_cast<double>(payload.size());
+	state.counters["bytes_out"] = static_cast<double>(response_size);
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_ProcessFormat)->ArgName("format")->DenseRange(0, 2); // 0 json, 1 msgpack, 2 cbor
+
+// FlatHashMap against std::unordered_map on the server's key distributions:
+// small dense fds, "user_<id>" client keys and a request's header names.
+template <typename Map>
+static void BM_MapFindFd(benchmark::State &state)
+{
+	const int count = static_cast<int>(state.range(0));
+	Map map;
+	for (int fd = 0; fd < count; ++fd)
+	{
+		map[fd + 3] = fd;
+	}
+
+	std::mt19937 rng(42);
+	std::vector<int> probes(4096);
+	for (auto &probe : probes)
+	{
+		probe = 3 + static_cast<int>(rng() % count);
+	}
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(map.find(probes[i++ & 4095]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MapFindFd, std::unordered_map<int, int>)->RangeMultiplier(16)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_MapFindFd, FlatHashMap<int, int>)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+// The handler's update: key formatted on the stack, then sum += number.
+// std::unordered_map needs a std::string to look up; FlatHashMap takes the view.
+template <typename Map>
+static void BM_MapClientSumUpdate(benchmark::State &state)
+{
+	const int count = static_cast<int>(state.range(0));
+	std::mt19937 rng(42);
+	std::vector<int> ids(4096);
+	for (auto &id : ids)
+	{
+		id = static_cast<int>(rng() % count);
+	}
+
+	Map map;
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		char key[32] = "user_";
+		char *end = std::to_chars(key + 5, std::end(key), ids[i++ & 4095]).ptr;
+		std::string_view client_id(key, end - key);
+		if constexpr (std::is_same_v<Map, std::unordered_map<std::string, long long>>)
+			map[std::string(client_id)] += 1;
+		else
+			map[client_id] += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MapClientSumUpdate, std::unordered_map<std::string, long long>)->RangeMultiplier(16)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_MapClientSumUpdate, FlatHashMap<std::string, long long>)->RangeMultiplier(16)->Range(16, 1 << 16);
+
+// Per-request header map: build from a typical request, then two lookups
+template <typename Map>
+static void BM_MapRequestHeaders(benchmark::State &state)
+{
+	static const std::pair<const char *, const char *> headers[] = {
+		{"host", "127.0.0.1:8080"},
+		{"user-agent", "cpp-httplib/0.14"},
+		{"accept", "application/json"},
+		{"content-type", "application/json"},
+		{"content-length", "62"},
+		{"connection", "keep-alive"},
+		{"accept-encoding", "gzip, deflate"},
+	};
+
+	for (auto _ : state)
+	{
+		Map map;
+		for (const auto &[name, value] : headers)
+		{
+			map.insert_or_assign(std::string(name), std::string(value));
+		}
+		benchmark::DoNotOptimize(map.find(std::string("accept")));
+		benchmark::DoNotOptimize(map.find(std::string("content-type")));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MapRequestHeaders, std::unordered_map<std::string, std::string>);
+BENCHMARK_TEMPLATE(BM_MapRequestHeaders, FlatHashMap<std::string, std::string>);
+
+// Sum over a 1% id range: OrderedIndex prefix totals against filtering every
+// entry of the hash aggregate, which is what /numbers/sum-all clients had to do
+static void BM_ClientRangeTotal(benchmark::State &state)
+{
+	const bool use_index = state.range(0) == 1;
+	const int32_t clients = static_cast<int32_t>(state.range(1));
+
+	OrderedIndex index;
+	FlatHashMap<int32_t, int64_t> sums;
+	std::mt19937 rng(42);
+	for (int32_t id = 0; id < clients; ++id)
+	{
+		int64_t sum = rng() % 1000;
+		index.add(id, sum);
+		sums[id] = sum;
+	}
+
+	const int32_t width = std::max(clients / 100, 1);
+	for (auto _ : state)
+	{
+		int32_t from = static_cast<int32_t>(rng() % clients);
+		int32_t to = from + width;
+		int64_t total = 0;
+		if (use_index)
+		{
+			total = index.total(from, to).sum;
+		}
+		else
+		{
+			for (const auto &[id, sum] : sums)
+			{
+				if (id >= from && id <= to)
+					total += sum;
+			}
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClientRangeTotal)
+	->ArgNames({"index", "clients"})
+	->ArgsProduct({{0, 1}, {1 << 10, 1 << 14, 1 << 18}});
+
+// POST /numbers/sum/multi with 256 ids: one getClientNumbersSum() (and lock)
+// per id against the batched lookup with Bloom filter and prefetching.
+// hit_pct of the requested ids exist; the rest must come back as 0.
+static void BM_ClientSumsMulti(benchmark::State &state)
+{
+	const bool batched = state.range(0) == 1;
+	const int clients = static_cast<int>(state.range(1));
+	const int hit_pct = static_cast<int>(state.range(2));
+	constexpr int BATCH = 256;
+
+	RequestHandler handler;
+	handler.setProcessingDelay(std::chrono::microseconds(0));
+	for (int id = 0; id < clients; ++id)
+	{
+		handler.processRequest(R"({"id":)" + std::to_string(id) + R"(,"name":"n","phone":"p","number":1})");
+	}
+
+	std::mt19937 rng(42);
+	std::string body = "[";
+	for (int i = 0; i < BATCH; ++i)
+	{
+		int id = static_cast<int>(rng() % clients) + (static_cast<int>(rng() % 100) < hit_pct ? 0 : clients);
+		body += (i ? ",\"user_" : "\"user_") + std::to_string(id) + "\"";
+	}
+	body += "]";
+
+	for (auto _ : state)
+	{
+		std::string response;
+		if (batched)
+		{
+			response = handler.clientSumsResponse(body, codec::Format::Json, codec::Format::Json);
+		}
+		else
+		{
+			auto ids = codec::decodeStrings(codec::Format::Json, body);
+			response = codec::encode(codec::Format::Json, [&](auto &writer)
+									 {
+				writer.startObject(2);
+				writer.key("results");
+				writer.startArray(ids->size());
+				for (const auto &id : *ids)
+				{
+					writer.startObject(2);
+					writer.key("client_id");
+					writer.value(id);
+					writer.key("numbers_sum");
+					writer.value(handler.getClientNumbersSum(id));
+					writer.endObject();
+				}
+				writer.endArray();
+				writer.key("success");
+				writer.value(true);
+				writer.endObject(); });
+		}
+		benchmark::DoNotOptimize(response);
+	}
+	state.SetItemsProcessed(state.iterations() * BATCH);
+}
+BENCHMARK(BM_ClientSumsMulti)
+	->ArgNames({"batched", "clients", "hit_pct"})
+	->ArgsProduct({{0, 1}, {1 << 10, 1 << 20}, {100, 10}});
+
+// Per-request statistics update on a random row
+static void BM_ClientStatsRecord(benchmark::State &state)
+{
+	const uint32_t rows = static_cast<uint32_t>(state.range(0));
+	ClientStatsTable table;
+	for (uint32_t i = 0; i < rows; ++i)
+	{
+		table.add();
+	}
+
+	std::mt19937 rng(42);
+	int64_t now = 0;
+	for (auto _ : state)
+	{
+		table.record(rng() % rows, static_cast<int32_t>(rng() % 1000), ++now);
+	}
+	benchmark::DoNotOptimize(table.get(0));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClientStatsRecord)->Arg(1 << 10)->Arg(1 << 20);
+
+// Folding one shard's table into another, rows per second
+static void BM_ClientStatsMerge(benchmark::State &state)
+{
+	const uint32_t rows = static_cast<uint32_t>(state.range(0));
+	ClientStatsTable a, b;
+	std::mt19937 rng(42);
+	for (uint32_t i = 0; i < rows; ++i)
+	{
+		a.add();
+		b.add();
+		a.record(i, static_cast<int32_t>(rng() % 1000), 1);
+		b.record(i, static_cast<int32_t>(rng() % 1000), 2);
+	}
+
+	for (auto _ : state)
+	{
+		a.merge(b);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * rows);
+	state.SetBytesProcessed(state.iterations() * rows * ClientStatsTable::BYTES_PER_CLIENT * 2);
+}
+BENCHMARK(BM_ClientStatsMerge)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// record() over 1M distinct ids, unbounded against a 64k-client CLOCK table
+// that evicts on most new arrivals (no spill file)
+static void BM_ClientAggregatesRecord(benchmark::State &state)
+{
+	ClientAggregates::Limits limits;
+	limits.capacity = static_cast<size_t>(state.range(0));
+	ClientAggregates clients(limits);
+
+	std::mt19937 rng(42);
+	int64_t now = 0;
+	for (auto _ : state)
+	{
+		clients.record(static_cast<int32_t>(rng() % (1 << 20)), 1, ++now);
+	}
+	state.counters["resident"] = static_cast<double>(clients.size());
+	state.counters["evicted"] = static_cast<double>(clients.counters().evicted);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClientAggregatesRecord)->ArgName("capacity")->Arg(0)->Arg(1 << 16);
+
+// Batches of 1024 uniformly random updates against a table of N clients,
+// applied one record() at a time or through recordBatch(); 4M clients take
+// a few hundred MB, well beyond the last level cache
+static ClientAggregates &populatedClients(size_t clients)
+{
+	static std::unique_ptr<ClientAggregates> table;
+	static size_t populated = 0;
+	if (!table || populated != clients)
+	{
+		table = std::make_unique<ClientAggregates>();
+		for (size_t id = 0; id < clients; ++id)
+		{
+			table->record(static_cast<int32_t>(id), 1, 0);
+		}
+		populated = clients;
+	}
+	return *table;
+}
+
+static void BM_ClientAggregatesApply(benchmark::State &state)
+{
+	const auto clients = static_cast<size_t>(state.range(0));
+	const bool batched = state.range(1) != 0;
+	ClientAggregates &table = populatedClients(clients);
+
+	std::mt19937 rng(42);
+	std::vector<ClientAggregates::Update> updates(1024);
+	int64_t now = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (auto &update : updates)
+		{
+			update = {static_cast<int32_t>(rng() % clients), static_cast<int32_t>(rng() % 100)};
+		}
+		++now;
+		state.ResumeTiming();
+
+		if (batched)
+		{
+			table.recordBatch(updates, now);
+		}
+		else
+		{
+			for (const auto &update : updates)
+			{
+				table.record(update.id, update.number, now);
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * updates.size());
+}
+BENCHMARK(BM_ClientAggregatesApply)
+	->ArgNames({"clients", "batched"})
+	->ArgsProduct({{1 << 16, 1 << 22}, {0, 1}});
+
+// UDP ingestion in-process over loopback: 64 JSON datagrams per sendmmsg(),
+// read back with recvmmsg() and applied through the bulk aggregate path.
+// Compare with BM_ProcessFormat/format:0, the same record through /process
+// handling without the socket.
+static void BM_UdpIngest(benchmark::State &state)
+{
+	RequestHandler handler;
+	UdpListener listener;
+	if (!listener.open("127.0.0.1", 0, 1 << 20))
+	{
+		state.SkipWithError("Cannot open UDP listener");
+		return;
+	}
+
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(listener.port()));
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	std::vector<std::string> payloads;
+	for (size_t i = 0; i < UdpListener::BATCH; ++i)
+	{
+		payloads.push_back(R"({"id":)" + std::to_string(i % 16) + R"(,"name":"User","phone":"+1-555-1042","number":42})");
+	}
+	std::vector<iovec> iovecs(UdpListener::BATCH);
+	std::vector<mmsghdr> messages(UdpListener::BATCH);
+	for (size_t i = 0; i < UdpListener::BATCH; ++i)
+	{
+		iovecs[i] = {payloads[i].data(), payloads[i].size()};
+		messages[i].msg_hdr.msg_name = &address;
+		messages[i].msg_hdr.msg_namelen = sizeof(address);
+		messages[i].msg_hdr.msg_iov = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for (auto _ : state)
+	{
+		sendmmsg(fd, messages.data(), static_cast<unsigned>(messages.size()), 0);
+		listener.drain(handler);
+	}
+	close(fd);
+
+	state.counters["dropped"] = static_cast<double>(listener.counters().dropped);
+	state.SetItemsProcessed(static_cast<int64_t>(listener.counters().applied));
+}
+BENCHMARK(BM_UdpIngest);
+
+// Records a same-host producer pushes through a shared-memory ring to the
+// aggregates. wakeups_per_record is the producer's syscall rate: near zero
+// while the consumer keeps up, since it only blocks once the ring is idle
+static void BM_ShmIngest(benchmark::State &state)
+{
+	RequestHandler handler;
+	ShmIngest ingest(handler);
+	const std::string socket_path = "/tmp/bm_shm_ingest_" + std::to_string(getpid()) + ".sock";
+	ShmProducer producer;
+	if (!ingest.start(socket_path) || !producer.connect(socket_path))
+	{
+		state.SkipWithError("Cannot set up shared-memory ingestion");
+		return;
+	}
+
+	std::vector<ShmRing::Record> records(64);
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		records[i] = {static_cast<int32_t>(i % 16), 42};
+	}
+
+	int64_t pushed = 0;
+	for (auto _ : state)
+	{
+		std::span<const ShmRing::Record> rest(records);
+		while (!rest.empty())
+		{
+			const size_t count = producer.push(rest);
+			rest = rest.subspan(count);
+			if (count == 0)
+				std::this_thread::yield();
+		}
+		pushed += static_cast<int64_t>(records.size());
+	}
+	while (producer.pending() > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	state.counters["wakeups_per_record"] =
+		pushed > 0 ? static_cast<double>(producer.wakeups()) / static_cast<double>(pushed) : 0.0;
+	state.SetItemsProcessed(pushed);
+}
+BENCHMARK(BM_ShmIngest)->UseRealTime();
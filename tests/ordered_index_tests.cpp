@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <common/OrderedIndex.h>
+
+namespace
+{
+	OrderedIndex::RangeTotal referenceTotal(const std::map<int32_t, int64_t> &reference, int32_t from, int32_t to)
+	{
+		OrderedIndex::RangeTotal total;
+		if (from > to)
+			return total;
+		for (auto it = reference.lower_bound(from); it != reference.end() && it->first <= to; ++it)
+		{
+			++total.count;
+			total.sum += it->second;
+		}
+		return total;
+	}
+}
+
+TEST(OrderedIndexTest, AddFindAndScanInOrder)
+{
+	OrderedIndex index;
+	EXPECT_TRUE(index.empty());
+	EXPECT_FALSE(index.find(1).has_value());
+
+	for (int32_t key : {5, 1, 9, 3, 7})
+	{
+		index.add(key, key * 10);
+	}
+	index.add(3, 1);
+
+	EXPECT_EQ(index.size(), 5u);
+	EXPECT_EQ(index.find(3), 31);
+	EXPECT_FALSE(index.find(4).has_value());
+
+	std::vector<int32_t> keys;
+	EXPECT_EQ(index.scan(2, 8, 10, [&](int32_t key, int64_t)
+						 { keys.push_back(key); }),
+			  3u);
+	EXPECT_EQ(keys, (std::vector<int32_t>{3, 5, 7}));
+
+	keys.clear();
+	index.scan(INT32_MIN, INT32_MAX, 2, [&](int32_t key, int64_t)
+			   { keys.push_back(key); });
+	EXPECT_EQ(keys, (std::vector<int32_t>{1, 3}));
+
+	auto total = index.total(3, 9);
+	EXPECT_EQ(total.count, 4u);
+	EXPECT_EQ(total.sum, 31 + 50 + 70 + 90);
+	EXPECT_EQ(index.total(9, 3).count, 0u);
+
+	index.clear();
+	EXPECT_TRUE(index.empty());
+	EXPECT_EQ(index.total(INT32_MIN, INT32_MAX).count, 0u);
+}
+
+TEST(OrderedIndexTest, MatchesStdMapAcrossSplits)
+{
+	OrderedIndex index;
+	std::map<int32_t, int64_t> reference;
+	std::mt19937 rng(7);
+
+	// Enough keys for a three-level tree; ascending runs exercise the
+	// rightmost-split path, random keys the middle ones
+	for (int i = 0; i < 300000; ++i)
+	{
+		int32_t key = i < 100000 ? i * 3 : static_cast<int32_t>(rng() % 2000000) - 1000000;
+		int64_t delta = static_cast<int64_t>(rng() % 1000) - 500;
+		index.add(key, delta);
+		reference[key] += delta;
+	}
+	index.add(INT32_MIN, 1);
+	index.add(INT32_MAX, 2);
+	reference[INT32_MIN] += 1;
+	reference[INT32_MAX] += 2;
+
+	ASSERT_EQ(index.size(), reference.size());
+	EXPECT_GE(index.height(), 3);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		int32_t a = static_cast<int32_t>(rng() % 2400000) - 1100000;
+		int32_t b = a + static_cast<int32_t>(rng() % 50000);
+		auto total = index.total(a, b);
+		auto expected = referenceTotal(reference, a, b);
+		ASSERT_EQ(total.count, expected.count) << a << ".." << b;
+		ASSERT_EQ(total.sum, expected.sum) << a << ".." << b;
+		ASSERT_EQ(index.find(a), reference.contains(a) ? std::optional<int64_t>(reference[a]) : std::nullopt);
+	}
+
+	auto all = index.total(INT32_MIN, INT32_MAX);
+	EXPECT_EQ(all.count, reference.size());
+	EXPECT_EQ(all.sum, referenceTotal(reference, INT32_MIN, INT32_MAX).sum);
+
+	auto expected = reference.begin();
+	size_t visited = index.scan(INT32_MIN, INT32_MAX, SIZE_MAX, [&](int32_t key, int64_t value)
+								{
+		ASSERT_EQ(key, expected->first);
+		ASSERT_EQ(value, expected->second);
+		++expected; });
+	EXPECT_EQ(visited, reference.size());
+}
+
+TEST(OrderedIndexTest, EraseKeepsTotalsAndScans)
+{
+	OrderedIndex index;
+	std::map<int32_t, int64_t> reference;
+	std::mt19937 rng(13);
+	for (int32_t key = 0; key < 20000; ++key)
+	{
+		index.add(key, key % 17);
+		reference[key] = key % 17;
+	}
+
+	// Empty whole leaves in the middle, then scattered keys, then re-add some
+	for (int32_t key = 5000; key < 9000; ++key)
+	{
+		ASSERT_EQ(index.erase(key), reference[key]);
+		reference.erase(key);
+	}
+	for (int i = 0; i < 3000; ++i)
+	{
+		int32_t key = static_cast<int32_t>(rng() % 20000);
+		auto erased = index.erase(key);
+		auto it = reference.find(key);
+		ASSERT_EQ(erased.has_value(), it != reference.end()) << key;
+		if (it != reference.end())
+		{
+			EXPECT_EQ(*erased, it->second);
+			reference.erase(it);
+		}
+	}
+	for (int32_t key = 6000; key < 6100; ++key)
+	{
+		index.add(key, 1);
+		reference[key] += 1;
+	}
+
+	ASSERT_EQ(index.size(), reference.size());
+	EXPECT_FALSE(index.erase(-1).has_value());
+	for (int i = 0; i < 500; ++i)
+	{
+		int32_t a = static_cast<int32_t>(rng() % 21000) - 500;
+		int32_t b = a + static_cast<int32_t>(rng() % 6000);
+		auto total = index.total(a, b);
+		auto expected = referenceTotal(reference, a, b);
+		ASSERT_EQ(total.count, expected.count) << a << ".." << b;
+		ASSERT_EQ(total.sum, expected.sum) << a << ".." << b;
+	}
+
+	auto expected = reference.lower_bound(4000);
+	index.scan(4000, 10000, SIZE_MAX, [&](int32_t key, int64_t value)
+			   {
+		ASSERT_EQ(key, expected->first);
+		ASSERT_EQ(value, expected->second);
+		++expected; });
+	EXPECT_EQ(expected, reference.upper_bound(10000));
+}
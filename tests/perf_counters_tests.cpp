@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include <server/PerfCounters.h>
+
+namespace
+{
+	uint64_t work(uint64_t rounds)
+	{
+		volatile uint64_t sum = 0;
+		for (uint64_t i = 0; i < rounds; ++i)
+			sum = sum + i * i;
+		return sum;
+	}
+}
+
+class PerfCountersTest : public ::testing::Test
+{
+protected:
+	void SetUp() override { PerfCounters::reset(); }
+	void TearDown() override
+	{
+		PerfCounters::disable();
+		PerfCounters::reset();
+	}
+};
+
+TEST_F(PerfCountersTest, ScopesAreNoOpsUntilEnabled)
+{
+	{
+		PerfCounters::Scope scope(PerfCounters::Stage::Parse);
+		work(10000);
+	}
+	EXPECT_EQ(PerfCounters::totals(PerfCounters::Stage::Parse).samples, 0u);
+	EXPECT_EQ(PerfCounters::prometheusMetrics(), "");
+}
+
+TEST_F(PerfCountersTest, CountsPerStageWhereTheKernelAllows)
+{
+	if (!PerfCounters::enable())
+	{
+		// No PMU, or perf_event_paranoid forbids it: everything stays a no-op
+		EXPECT_FALSE(PerfCounters::enabled());
+		{
+			PerfCounters::Scope scope(PerfCounters::Stage::Handle);
+		}
+		EXPECT_EQ(PerfCounters::totals(PerfCounters::Stage::Handle).samples, 0u);
+		GTEST_SKIP() << "hardware counters unavailable";
+	}
+
+	{
+		PerfCounters::Scope scope(PerfCounters::Stage::Handle);
+		work(1'000'000);
+	}
+	// Other threads open their own group
+	std::thread([]
+				{
+		PerfCounters::Scope scope(PerfCounters::Stage::Write);
+		work(100'000); })
+		.join();
+
+	const auto handle = PerfCounters::totals(PerfCounters::Stage::Handle);
+	EXPECT_EQ(handle.samples, 1u);
+	EXPECT_GT(handle.instructions, 1'000'000u);
+	EXPECT_GT(handle.cycles, 0u);
+	EXPECT_EQ(PerfCounters::totals(PerfCounters::Stage::Write).samples, 1u);
+	EXPECT_EQ(PerfCounters::totals(PerfCounters::Stage::Parse).samples, 0u);
+
+	const std::string metrics = PerfCounters::prometheusMetrics();
+	EXPECT_NE(metrics.find("cpp_service_stage_ipc{stage=\"handle\"}"), std::string::npos);
+	EXPECT_NE(metrics.find("cpp_service_stage_samples_total{stage=\"write\"} 1"), std::string::npos);
+}
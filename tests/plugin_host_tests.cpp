@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <server/PluginHost.h>
+
+class PluginHostTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		directory = std::filesystem::temp_directory_path() / ("plugin_host_test_" + std::to_string(getpid()));
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directory(directory);
+		install();
+	}
+
+	void TearDown() override { std::filesystem::remove_all(directory); }
+
+	// Copies the example plugin over example.so in place, as a deploy would
+	void install()
+	{
+		const auto target = directory / "example.so";
+		const bool existed = std::filesystem::exists(target);
+		std::filesystem::copy_file(EXAMPLE_PLUGIN_PATH, target, std::filesystem::copy_options::overwrite_existing);
+		if (existed)
+		{
+			// Same size and inode, so only the time tells the files apart
+			std::filesystem::last_write_time(target, std::filesystem::last_write_time(target) + std::chrono::hours(1));
+		}
+	}
+
+	static std::string call(const PluginHost::Handler &handler, std::string_view method, std::string_view target,
+							std::string_view body = {})
+	{
+		auto response = handler.invoke(PluginHost::makeRequest(method, target, body, "application/json", ""));
+		return response ? std::to_string(response->status) + " " + std::string(response->body) : "failed";
+	}
+
+	std::filesystem::path directory;
+};
+
+TEST_F(PluginHostTest, RoutesRequestsToPluginHandlers)
+{
+	PluginHost host;
+	ASSERT_TRUE(host.open(directory));
+	EXPECT_TRUE(host.hasReactorRoutes());
+
+	auto echo = host.find("GET", "/plugin/echo");
+	ASSERT_TRUE(echo);
+	EXPECT_EQ(echo.plugin(), "example");
+	EXPECT_EQ(echo.execClass(), SERVICE_EXEC_REACTOR);
+	EXPECT_EQ(call(echo, "GET", "/plugin/echo?a=1"),
+			  R"(200 {"method": "GET", "path": "/plugin/echo", "query": "a=1", "success": true})");
+
+	// '*' routes match by prefix and only for their method
+	auto count = host.find("POST", "/plugin/count/anything");
+	ASSERT_TRUE(count);
+	EXPECT_EQ(count.execClass(), SERVICE_EXEC_WORKER);
+	EXPECT_EQ(call(count, "POST", "/plugin/count/anything", "12345"), R"(200 {"bytes": 5, "calls": 1, "success": true})");
+	EXPECT_FALSE(host.find("GET", "/plugin/count/anything"));
+	EXPECT_FALSE(host.find("GET", "/plugin/echo/more"));
+	EXPECT_FALSE(host.find("GET", "/numbers/sum"));
+
+	const std::string described = host.describeJson();
+	EXPECT_NE(described.find(R"("name":"example")"), std::string::npos);
+	EXPECT_NE(described.find(R"("exec_class":"reactor")"), std::string::npos);
+}
+
+TEST_F(PluginHostTest, GrowsTheOutputBufferOnRequest)
+{
+	PluginHost host;
+	ASSERT_TRUE(host.open(directory));
+	auto repeat = host.find("GET", "/plugin/repeat");
+	ASSERT_TRUE(repeat);
+
+	auto response = repeat.invoke(PluginHost::makeRequest("GET", "/plugin/repeat?n=300000", "", "", ""));
+	ASSERT_TRUE(response);
+	EXPECT_EQ(response->content_type, "text/plain");
+	EXPECT_EQ(response->body, std::string(300000, 'x'));
+
+	EXPECT_EQ(call(repeat, "GET", "/plugin/repeat?n=" + std::to_string(PluginHost::MAX_OUTPUT_BYTES + 1)), "failed");
+	EXPECT_EQ(call(repeat, "GET", "/plugin/repeat?n=abc").substr(0, 4), "400 ");
+}
+
+TEST_F(PluginHostTest, ReloadKeepsReplacedPluginsUntilTheirCallsDrain)
+{
+	const uint64_t before = PluginHost::liveModules();
+	PluginHost host;
+	ASSERT_TRUE(host.open(directory));
+	EXPECT_EQ(PluginHost::liveModules(), before + 1);
+
+	auto old_count = host.find("POST", "/plugin/count/x");
+	ASSERT_TRUE(old_count);
+	EXPECT_NE(call(old_count, "POST", "/plugin/count/x").find(R"("calls": 1)"), std::string::npos);
+
+	// An unchanged file keeps its module and state
+	EXPECT_EQ(host.reload(), 1u);
+	EXPECT_EQ(PluginHost::liveModules(), before + 1);
+	EXPECT_NE(call(host.find("POST", "/plugin/count/x"), "POST", "/plugin/count/x").find(R"("calls": 2)"), std::string::npos);
+
+	// Overwritten in place: the watch reloads it, and the old copy stays
+	// loaded for the handler still held
+	install();
+	host.handleEvents();
+	EXPECT_EQ(PluginHost::liveModules(), before + 2);
+	EXPECT_NE(call(old_count, "POST", "/plugin/count/x").find(R"("calls": 3)"), std::string::npos);
+	EXPECT_NE(call(host.find("POST", "/plugin/count/x"), "POST", "/plugin/count/x").find(R"("calls": 1)"), std::string::npos);
+
+	old_count = PluginHost::Handler();
+	EXPECT_EQ(PluginHost::liveModules(), before + 1);
+
+	std::filesystem::remove(directory / "example.so");
+	host.handleEvents();
+	EXPECT_FALSE(host.find("GET", "/plugin/echo"));
+	EXPECT_FALSE(host.hasReactorRoutes());
+	EXPECT_EQ(PluginHost::liveModules(), before);
+}
+
+TEST_F(PluginHostTest, SkipsFilesThatAreNotPlugins)
+{
+	std::ofstream(directory / "broken.so") << "not an ELF file";
+	std::filesystem::copy_file(EXAMPLE_PLUGIN_PATH, directory / ".hidden.so");
+
+	PluginHost host;
+	ASSERT_TRUE(host.open(directory));
+	EXPECT_TRUE(host.find("GET", "/plugin/echo"));
+	EXPECT_EQ(host.reload(), 1u);
+
+	PluginHost missing;
+	EXPECT_FALSE(missing.open((directory / "missing").string()));
+}
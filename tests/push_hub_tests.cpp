@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <server/PushHub.h>
+#include <server/RequestHandler.h>
+
+namespace
+{
+	class RecordingSubscriber : public PushSubscriber
+	{
+	public:
+		bool push(uint64_t subscription, const std::shared_ptr<const std::string> &event) override
+		{
+			if (!open || full || subscription != id)
+				return false;
+			events.push_back(event);
+			return true;
+		}
+		bool subscribed(uint64_t subscription) const override { return open && subscription == id; }
+
+		uint64_t id = 0;
+		bool open = true;
+		bool full = false; // refuses events while still subscribed, like a lagging reader
+		std::vector<std::shared_ptr<const std::string>> events;
+	};
+}
+
+class PushHubTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		handler = std::make_unique<RequestHandler>();
+		hub = std::make_unique<PushHub>(*handler);
+	}
+
+	std::shared_ptr<RecordingSubscriber> subscribe(std::string_view query)
+	{
+		auto subscriber = std::make_shared<RecordingSubscriber>();
+		subscriber->id = hub->nextSubscriptionId();
+		hub->subscribe(subscriber, subscriber->id, *PushHub::parseTopics(query), "HEAD\n");
+		return subscriber;
+	}
+
+	void record(int32_t id, int32_t number)
+	{
+		ClientAggregates::Update update{id, number};
+		handler->recordUpdates({&update, 1});
+	}
+
+	std::unique_ptr<RequestHandler> handler;
+	std::unique_ptr<PushHub> hub;
+};
+
+TEST_F(PushHubTest, ParsesTopics)
+{
+	auto topics = PushHub::parseTopics("total=1&clients=user_3,user_1,user_3");
+	ASSERT_TRUE(topics);
+	EXPECT_TRUE(topics->total);
+	EXPECT_EQ(topics->clients, (std::vector<int32_t>{1, 3}));
+
+	EXPECT_FALSE(PushHub::parseTopics(""));
+	EXPECT_FALSE(PushHub::parseTopics("total=0"));
+	EXPECT_FALSE(PushHub::parseTopics("clients=user_1,bob"));
+}
+
+TEST_F(PushHubTest, SubscribingSendsHeaderAndCurrentValues)
+{
+	record(7, 5);
+	auto subscriber = subscribe("total=1&clients=user_7");
+
+	ASSERT_EQ(subscriber->events.size(), 1u);
+	EXPECT_EQ(*subscriber->events[0], "HEAD\n"
+									  "event: total\ndata: {\"total_numbers_sum\":5}\n\n"
+									  "event: client\ndata: {\"client_id\":\"user_7\",\"numbers_sum\":5}\n\n");
+	EXPECT_EQ(hub->subscribers(), 1u);
+}
+
+TEST_F(PushHubTest, UpdatesBetweenTicksCoalesce)
+{
+	auto subscriber = subscribe("total=1&clients=user_1");
+	subscriber->events.clear();
+
+	record(1, 2);
+	record(1, 3);
+	record(2, 10);
+	hub->tick();
+
+	ASSERT_EQ(subscriber->events.size(), 2u);
+	EXPECT_EQ(*subscriber->events[0], "event: total\ndata: {\"total_numbers_sum\":15}\n\n");
+	EXPECT_EQ(*subscriber->events[1], "event: client\ndata: {\"client_id\":\"user_1\",\"numbers_sum\":5}\n\n");
+
+	// Only user_2 changed, which nobody watches
+	record(2, 1);
+	record(2, -1);
+	hub->tick();
+	EXPECT_EQ(subscriber->events.size(), 2u);
+}
+
+TEST_F(PushHubTest, SubscribersShareOneEncodedEvent)
+{
+	auto first = subscribe("clients=user_4");
+	auto second = subscribe("total=1&clients=user_4");
+	first->events.clear();
+	second->events.clear();
+
+	record(4, 1);
+	hub->tick();
+
+	ASSERT_EQ(first->events.size(), 1u);
+	ASSERT_EQ(second->events.size(), 2u);
+	EXPECT_EQ(first->events[0], second->events[1]);
+
+	auto counters = hub->counters();
+	EXPECT_EQ(counters.events, 2u);
+	EXPECT_EQ(counters.deliveries, 3u);
+}
+
+TEST_F(PushHubTest, ClosedAndLaggingSubscribersAreDropped)
+{
+	auto closed = subscribe("clients=user_1");
+	auto lagging = subscribe("total=1");
+	auto destroyed = subscribe("total=1");
+	destroyed.reset();
+
+	closed->open = false;
+	lagging->full = true;
+	record(1, 1);
+	hub->tick();
+
+	EXPECT_EQ(hub->counters().dropped, 1u);
+	EXPECT_EQ(hub->subscribers(), 1u);
+
+	// A connection refusing an event stops being subscribed
+	lagging->open = false;
+	hub->tick();
+	EXPECT_EQ(hub->subscribers(), 0u);
+}
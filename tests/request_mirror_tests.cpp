@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include <common/httplib.h>
+#include <server/RequestMirror.h>
+
+using namespace std::chrono_literals;
+
+class RequestMirrorTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		shadow.Get("/numbers/sum", [](const httplib::Request &, httplib::Response &res)
+				   { res.set_content(R"({"total_numbers_sum":5})", "application/json"); });
+		shadow.Post("/process", [](const httplib::Request &req, httplib::Response &res)
+					{ res.set_content(req.body, "application/json"); });
+		port = shadow.bind_to_any_port("127.0.0.1");
+		ASSERT_GT(port, 0);
+		listener = std::thread([this]
+							   { shadow.listen_after_bind(); });
+		shadow.wait_until_ready();
+	}
+
+	void TearDown() override
+	{
+		shadow.stop();
+		listener.join();
+	}
+
+	static RequestMirror::Exchange exchange(std::string method, std::string path, int status, std::string response,
+											std::string body = "")
+	{
+		RequestMirror::Exchange exchange;
+		exchange.method = std::move(method);
+		exchange.path = std::move(path);
+		exchange.body = std::move(body);
+		exchange.status = status;
+		exchange.response_body = std::move(response);
+		exchange.latency_ms = 0.3;
+		return exchange;
+	}
+
+	// What the server does for a sampled request
+	static bool offer(RequestMirror &mirror, RequestMirror::Exchange exchange)
+	{
+		if (!mirror.tryReserve())
+		{
+			return false;
+		}
+		mirror.submit(std::move(exchange));
+		return true;
+	}
+
+	static void waitForSent(const RequestMirror &mirror, uint64_t sent)
+	{
+		for (int i = 0; i < 500 && mirror.counters().sent < sent; ++i)
+		{
+			std::this_thread::sleep_for(10ms);
+		}
+	}
+
+	httplib::Server shadow;
+	std::thread listener;
+	int port = 0;
+};
+
+TEST_F(RequestMirrorTest, ComparesShadowReplies)
+{
+	RequestMirror mirror({.port = port, .sample_rate = 1, .connections = 1});
+	mirror.start();
+	offer(mirror, exchange("GET", "/numbers/sum", 200, R"({"total_numbers_sum":5})"));
+	offer(mirror, exchange("GET", "/numbers/sum", 200, R"({"total_numbers_sum":6})"));
+	offer(mirror, exchange("POST", "/process", 200, R"({"id":1})", R"({"id":1})"));
+	offer(mirror, exchange("GET", "/missing", 200, "{}"));
+	waitForSent(mirror, 4);
+	mirror.stop();
+
+	auto counters = mirror.counters();
+	EXPECT_EQ(counters.sampled, 4u);
+	EXPECT_EQ(counters.sent, 4u);
+	EXPECT_EQ(counters.errors, 0u);
+	EXPECT_EQ(counters.matched, 2u);
+	EXPECT_EQ(counters.body_mismatches, 1u);
+	EXPECT_EQ(counters.status_mismatches, 1u);
+
+	std::string report = mirror.reportJson();
+	EXPECT_NE(report.find(R"("request":"GET /missing","primary_status":200,"shadow_status":404)"), std::string::npos);
+	EXPECT_NE(report.find(R"("primary_body":"{\"total_numbers_sum\":6}")"), std::string::npos);
+}
+
+TEST_F(RequestMirrorTest, DropsWhenTheQueueIsFull)
+{
+	// Not started, so nothing drains the queue
+	RequestMirror mirror({.port = port, .sample_rate = 1, .max_queue = 2});
+	size_t queued = 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		queued += offer(mirror, exchange("GET", "/numbers/sum", 200, "{}"));
+	}
+	EXPECT_EQ(queued, 2u);
+	EXPECT_EQ(mirror.counters().sampled, 5u);
+	EXPECT_EQ(mirror.counters().dropped, 3u);
+}
+
+TEST_F(RequestMirrorTest, UnreachableShadowCountsErrors)
+{
+	RequestMirror mirror({.port = 1, .sample_rate = 1, .connections = 1, .timeout_ms = 200});
+	mirror.start();
+	offer(mirror, exchange("GET", "/numbers/sum", 200, "{}"));
+	waitForSent(mirror, 1);
+	mirror.stop();
+	EXPECT_EQ(mirror.counters().errors, 1u);
+}
+
+TEST_F(RequestMirrorTest, SamplesTheConfiguredFraction)
+{
+	RequestMirror never({.sample_rate = 0});
+	RequestMirror always({.sample_rate = 1});
+	RequestMirror tenth({.sample_rate = 0.1});
+	int sampled = 0;
+	for (int i = 0; i < 10000; ++i)
+	{
+		EXPECT_FALSE(never.sample());
+		EXPECT_TRUE(always.sample());
+		sampled += tenth.sample();
+	}
+	EXPECT_GT(sampled, 800);
+	EXPECT_LT(sampled, 1200);
+}
+
+TEST_F(RequestMirrorTest, SplitsRawResponses)
+{
+	auto [status, body] = RequestMirror::splitResponse("HTTP/1.1 404 Not Found\r\nContent-Length: 2\r\n\r\n{}");
+	EXPECT_EQ(status, 404);
+	EXPECT_EQ(body, "{}");
+	EXPECT_EQ(RequestMirror::splitResponse("garbage").first, 0);
+}
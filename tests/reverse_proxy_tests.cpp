@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include <common/httplib.h>
+#include <server/ReverseProxy.h>
+
+namespace
+{
+	class Upstream
+	{
+	public:
+		explicit Upstream(std::string name)
+		{
+			server.Get("/whoami", [name](const httplib::Request &req, httplib::Response &res)
+					   { res.set_content(name + " " + req.get_header_value("X-Forwarded-For") + " " +
+											 std::to_string(req.remote_port),
+										 "text/plain"); });
+			server.Get("/health", [](const httplib::Request &, httplib::Response &res)
+					   { res.set_content("{}", "application/json"); });
+			server.Get("/large", [](const httplib::Request &, httplib::Response &res)
+					   {
+				std::string body(1 << 20, 'x');
+				for (size_t i = 0; i < body.size(); i += 4096)
+					body[i] = static_cast<char>('a' + (i / 4096) % 26);
+				res.set_content(body, "application/octet-stream"); });
+			server.Post("/process", [](const httplib::Request &req, httplib::Response &res)
+						{ res.set_content(req.body, "application/json"); });
+			port = server.bind_to_any_port("127.0.0.1");
+			thread = std::thread([this]
+								 { server.listen_after_bind(); });
+			server.wait_until_ready();
+		}
+
+		~Upstream()
+		{
+			server.stop();
+			thread.join();
+		}
+
+		std::string address() const { return "127.0.0.1:" + std::to_string(port); }
+
+		httplib::Server server;
+		std::thread thread;
+		int port = 0;
+	};
+
+	// Collects relayed responses through a socketpair, as a client would
+	class CapturingDownstream : public ProxyDownstream
+	{
+	public:
+		bool relayResponse(std::string_view head, int upstream_fd, size_t body_bytes) override
+		{
+			int fds[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+				return false;
+			std::thread reader([&]
+							   {
+				char buffer[65536];
+				ssize_t n;
+				while ((n = read(fds[1], buffer, sizeof(buffer))) > 0)
+					received.append(buffer, static_cast<size_t>(n)); });
+			bool ok = ReverseProxy::writeAll(fds[0], head, 1000) && ReverseProxy::spliceAll(upstream_fd, fds[0], body_bytes, 1000);
+			::close(fds[0]);
+			reader.join();
+			::close(fds[1]);
+			relays++;
+			return ok;
+		}
+
+		std::string received;
+		int relays = 0;
+	};
+
+	// Answers GETs on a kept-alive connection, but reads a POST and closes
+	// without replying, as an upstream crashing mid-request would
+	class ClosingUpstream
+	{
+	public:
+		ClosingUpstream()
+		{
+			listener = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+			socklen_t length = sizeof(address);
+			getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length);
+			port = ntohs(address.sin_port);
+			listen(listener, 8);
+			thread = std::thread([this]
+								 { serve(); });
+		}
+
+		~ClosingUpstream()
+		{
+			stopping = true;
+			thread.join();
+			::close(listener);
+		}
+
+		std::string address() const { return "127.0.0.1:" + std::to_string(port); }
+
+		std::atomic<int> posts{0};
+
+	private:
+		void serve()
+		{
+			while (!stopping)
+			{
+				pollfd ready{listener, POLLIN, 0};
+				if (poll(&ready, 1, 50) != 1)
+					continue;
+				int fd = accept(listener, nullptr, nullptr);
+				char buffer[4096];
+				ssize_t n;
+				while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+				{
+					if (std::string_view(buffer, static_cast<size_t>(n)).starts_with("POST"))
+					{
+						posts++;
+						break;
+					}
+					const std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+					send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+				}
+				::close(fd);
+			}
+		}
+
+		int listener = -1;
+		int port = 0;
+		std::atomic<bool> stopping{false};
+		std::thread thread;
+	};
+
+	std::string body(const std::string &response)
+	{
+		size_t end = response.find("\r\n\r\n");
+		return end == std::string::npos ? std::string() : response.substr(end + 4);
+	}
+}
+
+TEST(ReverseProxyTest, ParsesAndMatchesRoutes)
+{
+	auto proxy = ReverseProxy::create("/blue=127.0.0.1:9001,127.0.0.1:9002;/blue/canary=127.0.0.1:9002", {});
+	ASSERT_TRUE(proxy);
+	EXPECT_EQ(proxy->routes().size(), 2u);
+	EXPECT_EQ(proxy->upstreamCount(), 2u);
+
+	ASSERT_TRUE(proxy->match("/blue/numbers/sum"));
+	EXPECT_EQ(proxy->match("/blue/numbers/sum")->prefix, "/blue");
+	EXPECT_EQ(proxy->match("/blue/canary/x")->prefix, "/blue/canary");
+	EXPECT_EQ(proxy->match("/blue?x=1")->prefix, "/blue");
+	EXPECT_EQ(proxy->match("/bluegreen"), nullptr);
+	EXPECT_EQ(proxy->match("/numbers/sum"), nullptr);
+
+	EXPECT_FALSE(ReverseProxy::create("", {}));
+	EXPECT_FALSE(ReverseProxy::create("blue=127.0.0.1:9001", {}));
+	EXPECT_FALSE(ReverseProxy::create("/blue=127.0.0.1", {}));
+	EXPECT_FALSE(ReverseProxy::create("/blue=127.0.0.1:0", {}));
+}
+
+TEST(ReverseProxyTest, ForwardsWithPrefixStrippedOverKeepAlive)
+{
+	Upstream upstream("a");
+	auto proxy = ReverseProxy::create("/blue=" + upstream.address(), {});
+	ASSERT_TRUE(proxy);
+	CapturingDownstream downstream;
+
+	const std::string request = "GET /blue/whoami HTTP/1.1\r\nHost: test\r\n\r\n";
+	std::string first = proxy->forward(*proxy->match("/blue/whoami"), request, "10.1.2.3:5555", downstream);
+	std::string second = proxy->forward(*proxy->match("/blue/whoami"), request, "10.1.2.3:5555", downstream);
+	ASSERT_TRUE(first.starts_with("HTTP/1.1 200"));
+	EXPECT_TRUE(body(first).starts_with("a 10.1.2.3 "));
+	// Same source port: the second request reused the pooled connection
+	EXPECT_EQ(body(first), body(second));
+
+	std::string post = proxy->forward(*proxy->match("/blue/process"),
+									  "POST /blue/process HTTP/1.1\r\nContent-Length: 8\r\n\r\n{\"id\":1}",
+									  "10.1.2.3:5555", downstream);
+	EXPECT_EQ(body(post), "{\"id\":1}");
+	EXPECT_EQ(downstream.relays, 0);
+}
+
+TEST(ReverseProxyTest, SpreadsRequestsAndSkipsDeadUpstreams)
+{
+	Upstream a("a");
+	Upstream b("b");
+	// Port 1 refuses connections
+	auto proxy = ReverseProxy::create("/=" + a.address() + "," + b.address() + ",127.0.0.1:1", {});
+	ASSERT_TRUE(proxy);
+	CapturingDownstream downstream;
+
+	int from_a = 0;
+	int from_b = 0;
+	int failed = 0;
+	for (int i = 0; i < 12; ++i)
+	{
+		std::string response = proxy->forward(*proxy->match("/whoami"), "GET /whoami HTTP/1.1\r\n\r\n", "127.0.0.1:1", downstream);
+		if (!response.starts_with("HTTP/1.1 200"))
+			failed++;
+		else if (body(response).starts_with("a"))
+			from_a++;
+		else
+			from_b++;
+	}
+	EXPECT_LE(failed, 1);
+	EXPECT_GT(from_a, 3);
+	EXPECT_GT(from_b, 3);
+	EXPECT_FALSE(proxy->healthy(2));
+	EXPECT_NE(proxy->prometheusMetrics().find("cpp_service_upstream_healthy{upstream=\"127.0.0.1:1\"} 0"), std::string::npos);
+}
+
+TEST(ReverseProxyTest, SplicesLargeBodies)
+{
+	Upstream upstream("a");
+	auto proxy = ReverseProxy::create("/=" + upstream.address(), {});
+	ASSERT_TRUE(proxy);
+	CapturingDownstream downstream;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		downstream.received.clear();
+		std::string response = proxy->forward(*proxy->match("/large"), "GET /large HTTP/1.1\r\n\r\n", "127.0.0.1:1", downstream);
+		EXPECT_TRUE(response.empty());
+		ASSERT_TRUE(downstream.received.starts_with("HTTP/1.1 200"));
+		std::string relayed = body(downstream.received);
+		ASSERT_EQ(relayed.size(), 1u << 20);
+		EXPECT_EQ(relayed[4096 * 27], 'b');
+		EXPECT_EQ(relayed.back(), 'x');
+	}
+	EXPECT_EQ(downstream.relays, 2);
+}
+
+TEST(ReverseProxyTest, DoesNotRepeatARequestTheUpstreamMayHaveApplied)
+{
+	ClosingUpstream upstream;
+	auto proxy = ReverseProxy::create("/=" + upstream.address(), {});
+	ASSERT_TRUE(proxy);
+	CapturingDownstream downstream;
+
+	// Leaves a pooled connection for the POST
+	std::string get = proxy->forward(*proxy->match("/whoami"), "GET /whoami HTTP/1.1\r\n\r\n", "127.0.0.1:1", downstream);
+	ASSERT_EQ(body(get), "ok");
+
+	std::string post = proxy->forward(*proxy->match("/process"),
+									  "POST /process HTTP/1.1\r\nContent-Length: 8\r\n\r\n{\"id\":1}",
+									  "127.0.0.1:1", downstream);
+	EXPECT_TRUE(post.starts_with("HTTP/1.1 502"));
+	EXPECT_EQ(upstream.posts, 1);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include <server/Metrics.h>
+#include <server/RxTimestamps.h>
+
+class RxTimestampsTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		ASSERT_GE(listener, 0);
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t length = sizeof(address);
+		ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+		ASSERT_EQ(listen(listener, 1), 0);
+		ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length), 0);
+		port = address.sin_port;
+	}
+
+	void connectPair()
+	{
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = port;
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		ASSERT_EQ(connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+		server = accept(listener, nullptr, nullptr);
+		ASSERT_GE(server, 0);
+	}
+
+	void TearDown() override
+	{
+		for (int fd : {client, server, listener})
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+	}
+
+	in_port_t port = 0;
+	int listener = -1;
+	int client = -1;
+	int server = -1;
+};
+
+TEST_F(RxTimestampsTest, ReportsHowLongBytesWaited)
+{
+	connectPair();
+	if (!RxTimestamps::enable(server))
+	{
+		GTEST_SKIP() << "SO_TIMESTAMPING refused";
+	}
+	// The first socket to ask switches stamping on from a kernel work item
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	ASSERT_EQ(send(client, "hello", 5, 0), 5);
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+	char buffer[16];
+	int64_t queued_ns = 0;
+	ASSERT_EQ(RxTimestamps::receive(server, buffer, sizeof(buffer), queued_ns), 5);
+	EXPECT_EQ(std::string(buffer, 5), "hello");
+	EXPECT_GE(queued_ns, 25'000'000);
+	EXPECT_LT(queued_ns, 5'000'000'000);
+
+	// Nothing left to read
+	EXPECT_EQ(RxTimestamps::receive(server, buffer, sizeof(buffer), queued_ns), -1);
+	EXPECT_EQ(queued_ns, -1);
+}
+
+TEST_F(RxTimestampsTest, AcceptedSocketsInheritTheListenersOption)
+{
+	if (!RxTimestamps::enable(listener))
+	{
+		GTEST_SKIP() << "SO_TIMESTAMPING refused";
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	connectPair();
+	ASSERT_EQ(send(client, "x", 1, 0), 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	char buffer[16];
+	int64_t queued_ns = -1;
+	ASSERT_EQ(RxTimestamps::receive(server, buffer, sizeof(buffer), queued_ns), 1);
+	EXPECT_GE(queued_ns, 5'000'000);
+}
+
+TEST_F(RxTimestampsTest, ReadsWithoutAStampWhenNotEnabled)
+{
+	connectPair();
+	ASSERT_EQ(send(client, "abc", 3, 0), 3);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	char buffer[16];
+	int64_t queued_ns = 0;
+	ASSERT_EQ(RxTimestamps::receive(server, buffer, sizeof(buffer), queued_ns), 3);
+	EXPECT_EQ(queued_ns, -1);
+}
+
+TEST_F(RxTimestampsTest, LatencyHistogramsAreCumulative)
+{
+	auto &metrics = Metrics::getInstance();
+	metrics.reset();
+	metrics.recordKernelQueueDelay(0.00003);
+	metrics.recordKernelQueueDelay(0.003);
+	metrics.recordEndToEndLatency(2.0);
+
+	const std::string text = metrics.getPrometheusMetrics();
+	EXPECT_NE(text.find("cpp_service_kernel_queue_seconds_bucket{le=\"5e-05\"} 1\n"), std::string::npos);
+	EXPECT_NE(text.find("cpp_service_kernel_queue_seconds_bucket{le=\"0.005\"} 2\n"), std::string::npos);
+	EXPECT_NE(text.find("cpp_service_kernel_queue_seconds_count 2\n"), std::string::npos);
+	EXPECT_NE(text.find("cpp_service_end_to_end_seconds_bucket{le=\"1\"} 0\n"), std::string::npos);
+	EXPECT_NE(text.find("cpp_service_end_to_end_seconds_bucket{le=\"+Inf\"} 1\n"), std::string::npos);
+	metrics.reset();
+}
@@ -2,8 +2,11 @@
 #include <future>
 #include <vector>
 #include <string>
+#include <thread>
+#include <chrono>
 
 #include <server/RequestHandler.h>
+#include <logging/LogRateLimiter.h>
 
 class RequestHandlerTest : public ::testing::Test
 {
@@ -80,4 +83,199 @@ TEST_F(RequestHandlerTest, ConcurrentRequests)
 	}
 
 	EXPECT_EQ(success_count, num_requests);
-}
\ No newline at end of file
+}
+
+TEST_F(RequestHandlerTest, ErrorResponseNamesInvalidField)
+{
+	auto response = handler->processRequest(R"({"id": 1, "name": "Test", "phone": "+1234567890"})");
+	EXPECT_EQ(response, R"({"error":"Missing or invalid 'number' field","success":false})");
+
+	response = handler->processRequest(R"({"id": "1", "name": "Test", "phone": "+1", "number": 1})");
+	EXPECT_EQ(response, R"({"error":"Missing or invalid 'id' field","success":false})");
+}
+
+TEST_F(RequestHandlerTest, ErrorResponsesForMalformedPayloads)
+{
+	EXPECT_EQ(handler->processRequest("[1, 2, 3]"), R"({"error":"Expected JSON object","success":false})");
+	EXPECT_EQ(handler->processRequest(R"({"id": 1,)"), R"({"error":"Invalid JSON format","success":false})");
+	EXPECT_EQ(handler->processRequest(R"({"id": -1, "name": "Test", "phone": "+1", "number": 1})"),
+			  R"({"error":"Invalid user data","success":false})");
+	EXPECT_EQ(handler->getFailedRequests(), 3);
+}
+
+TEST_F(RequestHandlerTest, ProcessBinaryFormats)
+{
+	UserData request(5, "Test User", "+1234567890", 41);
+	for (auto format : {codec::Format::MsgPack, codec::Format::Cbor})
+	{
+		std::string body = format == codec::Format::MsgPack ? codec::encodeMsgPack(request) : codec::encodeCbor(request);
+
+		auto reply = codec::decode<UserData>(format, handler->processRequest(body, format, format));
+		ASSERT_TRUE(reply.has_value());
+		EXPECT_EQ(reply->id, 5);
+		EXPECT_EQ(reply->number, 42);
+
+		// Binary request, JSON reply
+		auto json = handler->processRequest(body, format, codec::Format::Json);
+		EXPECT_NE(json.find("\"number\":42"), std::string::npos);
+		EXPECT_NE(json.find("\"success\":true"), std::string::npos);
+	}
+
+	EXPECT_EQ(handler->processRequest(generateValidUserJson(), codec::Format::Json, codec::Format::Cbor),
+			  handler->processRequest(codec::encodeMsgPack(UserData(1, "Test User", "+1234567890", 42)),
+									  codec::Format::MsgPack, codec::Format::Cbor));
+	EXPECT_EQ(handler->processRequest("\x91\x01", codec::Format::MsgPack, codec::Format::Json),
+			  R"({"error":"Expected JSON object","success":false})");
+	EXPECT_EQ(handler->getRequestsProcessed(), 7);
+	EXPECT_EQ(handler->getFailedRequests(), 1);
+}
+
+TEST_F(RequestHandlerTest, ProcessBatchKeepsOrder)
+{
+	std::string body = "[" + generateValidUserJson(1, 10) + R"(, {"id": 2}, )" + generateValidUserJson(3, 30) + "]";
+	auto response = handler->processBatch(body, codec::Format::Json, codec::Format::Json);
+	EXPECT_EQ(response,
+			  R"({"results":[{"id":1,"name":"Test User","phone":"+1234567890","number":11,"success":true},)"
+			  R"({"error":"Missing or invalid 'name' field","success":false},)"
+			  R"({"id":3,"name":"Test User","phone":"+1234567890","number":31,"success":true}],"success":true})");
+	EXPECT_EQ(handler->getRequestsProcessed(), 3);
+	EXPECT_EQ(handler->getFailedRequests(), 1);
+	EXPECT_EQ(handler->getTotalNumbersSum(), 40);
+
+	// Client aggregates are applied once per batch, duplicates included
+	body = "[" + generateValidUserJson(3, 5) + "," + generateValidUserJson(1, 2) + "," + generateValidUserJson(3, 7) + "]";
+	handler->processBatch(body, codec::Format::Json, codec::Format::Json);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), 12);
+	EXPECT_EQ(handler->getClientNumbersSum("user_3"), 42);
+	EXPECT_EQ(handler->getTotalNumbersSum(), 54);
+
+	EXPECT_EQ(handler->processBatch(generateValidUserJson(), codec::Format::Json, codec::Format::Json),
+			  R"({"error":"Expected array of requests","success":false})");
+	EXPECT_EQ(handler->processBatch("[{", codec::Format::Json, codec::Format::Json),
+			  R"({"error":"Invalid JSON format","success":false})");
+}
+
+TEST_F(RequestHandlerTest, ClientRangeQuery)
+{
+	for (int id : {30, 10, 20, 40})
+	{
+		handler->processRequest(generateValidUserJson(id, id));
+	}
+	handler->processRequest(generateValidUserJson(20, 5));
+
+	EXPECT_EQ(handler->clientRangeResponse("15", "40", "2", codec::Format::Json),
+			  R"({"success":true,"from":15,"to":40,"count":3,"total":95,)"
+			  R"("clients":[{"id":20,"numbers_sum":25},{"id":30,"numbers_sum":30}],"truncated":true})");
+	EXPECT_EQ(handler->clientRangeResponse("", "", "", codec::Format::Json),
+			  R"({"success":true,"from":0,"to":2147483647,"count":4,"total":105,)"
+			  R"("clients":[{"id":10,"numbers_sum":10},{"id":20,"numbers_sum":25},)"
+			  R"({"id":30,"numbers_sum":30},{"id":40,"numbers_sum":40}],"truncated":false})");
+
+	const std::string invalid = R"({"error":"Invalid range parameters","success":false})";
+	EXPECT_EQ(handler->clientRangeResponse("5", "1", "", codec::Format::Json), invalid);
+	EXPECT_EQ(handler->clientRangeResponse("x", "", "", codec::Format::Json), invalid);
+	EXPECT_EQ(handler->clientRangeResponse("", "", "-1", codec::Format::Json), invalid);
+
+	handler->resetNumberTracking();
+	EXPECT_NE(handler->clientRangeResponse("", "", "", codec::Format::Json).find(R"("count":0)"), std::string::npos);
+}
+
+TEST_F(RequestHandlerTest, ClientSumsMulti)
+{
+	// Enough clients to rebuild the Bloom filter at least once
+	handler->setProcessingDelay(std::chrono::microseconds(0));
+	for (int id = 1; id <= 3000; ++id)
+	{
+		handler->processRequest(generateValidUserJson(id, id % 7));
+	}
+	handler->processRequest(generateValidUserJson(2, 10));
+
+	EXPECT_EQ(handler->clientSumsResponse(R"(["user_2","user_9999","user_2","user_3000","user_1"])",
+										  codec::Format::Json, codec::Format::Json),
+			  R"({"results":[{"client_id":"user_2","numbers_sum":12},{"client_id":"user_9999","numbers_sum":0},)"
+			  R"({"client_id":"user_2","numbers_sum":12},{"client_id":"user_3000","numbers_sum":4},)"
+			  R"({"client_id":"user_1","numbers_sum":1}],"success":true})");
+	EXPECT_EQ(handler->clientSumsResponse("[]", codec::Format::Json, codec::Format::Json),
+			  R"({"results":[],"success":true})");
+
+	for (int id = 1; id <= 3000; ++id)
+	{
+		std::string client_id = "user_" + std::to_string(id);
+		std::string expected = R"("numbers_sum":)" + std::to_string(id == 2 ? 12 : id % 7);
+		EXPECT_NE(handler->clientSumsResponse("[\"" + client_id + "\"]", codec::Format::Json, codec::Format::Json)
+					  .find(expected),
+				  std::string::npos)
+			<< client_id;
+	}
+
+	EXPECT_EQ(handler->clientSumsResponse("[\"user_1\"", codec::Format::Json, codec::Format::Json),
+			  R"({"error":"Invalid JSON format","success":false})");
+	EXPECT_EQ(handler->clientSumsResponse(R"({"ids":[]})", codec::Format::Json, codec::Format::Json),
+			  R"({"error":"Expected array of client ids","success":false})");
+	EXPECT_EQ(handler->clientSumsResponse("[1]", codec::Format::Json, codec::Format::Json),
+			  R"({"error":"Expected array of client ids","success":false})");
+
+	std::string request = codec::encode(codec::Format::MsgPack, [](auto &writer)
+										 {
+		writer.startArray(1);
+		writer.value("user_1");
+		writer.endArray(); });
+	std::string response = handler->clientSumsResponse(request, codec::Format::MsgPack, codec::Format::Json);
+	EXPECT_EQ(response, R"({"results":[{"client_id":"user_1","numbers_sum":1}],"success":true})");
+
+	handler->resetNumberTracking();
+	EXPECT_EQ(handler->clientSumsResponse(R"(["user_1"])", codec::Format::Json, codec::Format::Json),
+			  R"({"results":[{"client_id":"user_1","numbers_sum":0}],"success":true})");
+}
+
+TEST_F(RequestHandlerTest, ClientStats)
+{
+	handler->setProcessingDelay(std::chrono::microseconds(0));
+	for (int number : {4, 8, 6})
+	{
+		handler->processRequest(generateValidUserJson(7, number));
+	}
+
+	auto stats = handler->getClientStats("user_7");
+	EXPECT_EQ(stats.count, 3u);
+	EXPECT_EQ(stats.sum, 18);
+	EXPECT_EQ(stats.min, 4);
+	EXPECT_EQ(stats.max, 8);
+	EXPECT_DOUBLE_EQ(stats.mean, 6.0);
+	EXPECT_NEAR(stats.variance, 8.0 / 3.0, 1e-12);
+	EXPECT_GT(stats.last_seen_ms, 0);
+	EXPECT_EQ(handler->getClientNumbersSum("user_7"), 18);
+
+	std::string response = handler->clientStatsResponse("user_7", codec::Format::Json);
+	EXPECT_NE(response.find(R"({"client_id":"user_7","count":3,"sum":18,"min":4,"max":8,"mean":6,"variance":2.6666666666666665,"last_seen_ms":)"),
+			  std::string::npos)
+		<< response;
+	EXPECT_EQ(handler->clientStatsResponse("user_8", codec::Format::Json),
+			  R"({"client_id":"user_8","count":0,"sum":0,"min":0,"max":0,"mean":0,"variance":0,"last_seen_ms":0,"success":true})");
+
+	handler->resetNumberTracking();
+	EXPECT_EQ(handler->getClientStats("user_7").count, 0u);
+}
+
+TEST(LogRateLimiterTest, SuppressesBurstAndReportsCount)
+{
+	LogRateLimiter limiter(2);
+	uint64_t suppressed = 0;
+
+	// Align with the start of a one-second window so the burst is not split
+	auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_until(start + std::chrono::milliseconds(1000) -
+								  (start.time_since_epoch() % std::chrono::seconds(1)));
+	// Windows follow the coarse clock, ticked here as the reactor would
+	Clock::tick();
+
+	EXPECT_TRUE(limiter.allow(suppressed));
+	EXPECT_TRUE(limiter.allow(suppressed));
+	EXPECT_FALSE(limiter.allow(suppressed));
+	EXPECT_FALSE(limiter.allow(suppressed));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	Clock::tick();
+	EXPECT_TRUE(limiter.allow(suppressed));
+	EXPECT_EQ(suppressed, 2u);
+}
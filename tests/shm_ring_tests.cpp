@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <client/ShmProducer.h>
+#include <common/ShmRing.h>
+#include <server/RequestHandler.h>
+#include <server/ShmIngest.h>
+
+namespace
+{
+	// Zeroed, page-aligned memory as a memfd mapping would give
+	class Mapping
+	{
+	public:
+		explicit Mapping(size_t size) : size_(size)
+		{
+			memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+		~Mapping() { munmap(memory_, size_); }
+		void *get() const { return memory_; }
+		size_t size() const { return size_; }
+
+	private:
+		void *memory_;
+		size_t size_;
+	};
+
+	bool waitFor(const std::function<bool()> &condition)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!condition())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+}
+
+TEST(ShmRingTest, RoundsCapacityToPowerOfTwo)
+{
+	EXPECT_EQ(ShmRing::roundCapacity(0), ShmRing::MIN_CAPACITY);
+	EXPECT_EQ(ShmRing::roundCapacity(3000), 4096u);
+	EXPECT_EQ(ShmRing::roundCapacity(8192), 8192u);
+	EXPECT_EQ(ShmRing::roundCapacity(~0u), ShmRing::MAX_CAPACITY);
+}
+
+TEST(ShmRingTest, PushPopWrapsAround)
+{
+	const uint32_t capacity = ShmRing::MIN_CAPACITY;
+	Mapping memory(ShmRing::bytesFor(capacity));
+	ShmRing producer = ShmRing::create(memory.get(), capacity, ShmRing::Mode::SingleProducer);
+	ShmRing consumer = ShmRing::attach(memory.get(), memory.size());
+	ASSERT_TRUE(consumer.valid());
+	EXPECT_EQ(consumer.capacity(), capacity);
+
+	std::vector<ShmRing::Record> out(capacity);
+	int32_t pushed = 0;
+	int32_t popped = 0;
+	for (int lap = 0; lap < 5; ++lap)
+	{
+		while (producer.push({pushed, pushed * 2}))
+		{
+			++pushed;
+		}
+		EXPECT_EQ(pushed - popped, static_cast<int32_t>(capacity));
+		EXPECT_EQ(consumer.size(), capacity);
+
+		// Free part of the ring so the next lap starts mid-way
+		const size_t count = consumer.pop(std::span(out).first(capacity / 3 + lap));
+		ASSERT_EQ(count, capacity / 3 + lap);
+		for (size_t i = 0; i < count; ++i, ++popped)
+		{
+			ASSERT_EQ(out[i].id, popped);
+			ASSERT_EQ(out[i].number, popped * 2);
+		}
+	}
+
+	while (size_t count = consumer.pop(out))
+	{
+		for (size_t i = 0; i < count; ++i, ++popped)
+			ASSERT_EQ(out[i].id, popped);
+	}
+	EXPECT_EQ(popped, pushed);
+	EXPECT_FALSE(consumer.readable());
+	EXPECT_EQ(consumer.size(), 0u);
+}
+
+TEST(ShmRingTest, MultiProducerKeepsEveryRecord)
+{
+	const uint32_t capacity = ShmRing::MIN_CAPACITY;
+	const int threads = 4;
+	const int per_thread = 20000;
+	Mapping memory(ShmRing::bytesFor(capacity));
+	ShmRing consumer = ShmRing::create(memory.get(), capacity, ShmRing::Mode::MultiProducer);
+
+	std::vector<std::thread> producers;
+	for (int t = 0; t < threads; ++t)
+	{
+		producers.emplace_back([&, t]
+							   {
+			ShmRing ring = ShmRing::attach(memory.get(), memory.size());
+			for (int i = 0; i < per_thread; ++i)
+			{
+				while (!ring.push({t, i}))
+					std::this_thread::yield();
+			} });
+	}
+
+	// Each producer's records arrive in the order it pushed them
+	std::vector<int32_t> next(threads, 0);
+	std::vector<ShmRing::Record> out(256);
+	int received = 0;
+	while (received < threads * per_thread)
+	{
+		const size_t count = consumer.pop(out);
+		for (size_t i = 0; i < count; ++i)
+		{
+			ASSERT_EQ(out[i].number, next[out[i].id]++);
+		}
+		received += static_cast<int>(count);
+		if (count == 0)
+			std::this_thread::yield();
+	}
+	for (auto &producer : producers)
+		producer.join();
+
+	for (int t = 0; t < threads; ++t)
+		EXPECT_EQ(next[t], per_thread);
+	EXPECT_FALSE(consumer.readable());
+}
+
+TEST(ShmRingTest, AttachRejectsForeignMemory)
+{
+	const uint32_t capacity = ShmRing::MIN_CAPACITY;
+	Mapping memory(ShmRing::bytesFor(capacity));
+	EXPECT_FALSE(ShmRing::attach(memory.get(), memory.size()).valid());
+	EXPECT_FALSE(ShmRing::attach(nullptr, memory.size()).valid());
+
+	ShmRing::create(memory.get(), capacity, ShmRing::Mode::SingleProducer);
+	EXPECT_TRUE(ShmRing::attach(memory.get(), memory.size()).valid());
+	EXPECT_FALSE(ShmRing::attach(memory.get(), memory.size() - 1).valid());
+}
+
+TEST(ShmRingTest, SleepingConsumerIsWokenOnce)
+{
+	const uint32_t capacity = ShmRing::MIN_CAPACITY;
+	Mapping memory(ShmRing::bytesFor(capacity));
+	ShmRing ring = ShmRing::create(memory.get(), capacity, ShmRing::Mode::SingleProducer);
+
+	// Awake consumer: pushing needs no signal
+	ASSERT_TRUE(ring.push({1, 1}));
+	EXPECT_FALSE(ring.producerShouldWake());
+	// A record is waiting, so the consumer must not block
+	EXPECT_FALSE(ring.consumerSleep());
+
+	std::vector<ShmRing::Record> out(4);
+	ASSERT_EQ(ring.pop(out), 1u);
+	EXPECT_TRUE(ring.consumerSleep());
+
+	ASSERT_TRUE(ring.push({2, 2}));
+	EXPECT_TRUE(ring.producerShouldWake());
+	ASSERT_TRUE(ring.push({3, 3}));
+	EXPECT_FALSE(ring.producerShouldWake());
+}
+
+class ShmIngestTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		handler = std::make_unique<RequestHandler>();
+		socket_path = "/tmp/shm_ingest_test_" + std::to_string(getpid()) + ".sock";
+	}
+
+	void TearDown() override
+	{
+		ingest.reset();
+		EXPECT_NE(access(socket_path.c_str(), F_OK), 0);
+	}
+
+	void start(size_t spin_polls)
+	{
+		ingest = std::make_unique<ShmIngest>(*handler, spin_polls);
+		ASSERT_TRUE(ingest->start(socket_path));
+	}
+
+	uint64_t seen() const { return ingest->counters().records + ingest->counters().rejected; }
+
+	std::unique_ptr<RequestHandler> handler;
+	std::unique_ptr<ShmIngest> ingest;
+	std::string socket_path;
+};
+
+TEST_F(ShmIngestTest, ProducerRecordsReachTheAggregates)
+{
+	start(2000);
+	ShmProducer producer;
+	ASSERT_TRUE(producer.connect(socket_path, 3000));
+	EXPECT_EQ(producer.capacity(), 4096u);
+	ASSERT_TRUE(waitFor([&]
+						{ return ingest->counters().producers == 1; }));
+
+	const int count = 10000;
+	for (int i = 0; i < count; ++i)
+	{
+		while (!producer.push(i % 10, 1))
+			std::this_thread::yield();
+	}
+	ASSERT_TRUE(producer.push(-1, 5));
+
+	ASSERT_TRUE(waitFor([&]
+						{ return seen() == count + 1; }));
+	EXPECT_EQ(ingest->counters().rejected, 1u);
+	EXPECT_EQ(handler->getTotalNumbersSum(), count);
+	EXPECT_EQ(handler->getClientNumbersSum("user_3"), count / 10);
+	EXPECT_EQ(producer.pending(), 0u);
+
+	producer.close();
+	EXPECT_TRUE(waitFor([&]
+						{ return ingest->counters().producers == 0; }));
+}
+
+TEST_F(ShmIngestTest, IdleConsumerSleepsUntilWoken)
+{
+	start(10);
+	ShmProducer producer;
+	ASSERT_TRUE(producer.connect(socket_path, ShmRing::MIN_CAPACITY, ShmRing::Mode::MultiProducer));
+	ASSERT_TRUE(waitFor([&]
+						{ return ingest->counters().producers == 1 && ingest->counters().sleeps > 0; }));
+	// Give the consumer time to block rather than merely raise the flag
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	const uint64_t sleeps = ingest->counters().sleeps;
+	ASSERT_TRUE(producer.push(7, 42));
+	EXPECT_EQ(producer.wakeups(), 1u);
+	ASSERT_TRUE(waitFor([&]
+						{ return seen() == 1; }));
+	EXPECT_EQ(handler->getClientNumbersSum("user_7"), 42);
+	EXPECT_TRUE(waitFor([&]
+						{ return ingest->counters().sleeps > sleeps; }));
+}
+
+TEST_F(ShmIngestTest, DisconnectingProducerIsDrained)
+{
+	start(2000);
+	const int producers = 3;
+	for (int p = 0; p < producers; ++p)
+	{
+		ShmProducer producer;
+		ASSERT_TRUE(producer.connect(socket_path));
+		std::vector<ShmRing::Record> records(500, ShmRing::Record{p, 2});
+		ASSERT_EQ(producer.push(records), records.size());
+		// Closes at once; the server still applies what the ring holds
+	}
+
+	ASSERT_TRUE(waitFor([&]
+						{ return seen() == producers * 500u && ingest->counters().producers == 0; }));
+	EXPECT_EQ(handler->getTotalNumbersSum(), producers * 1000);
+	for (int p = 0; p < producers; ++p)
+		EXPECT_EQ(handler->getClientNumbersSum("user_" + std::to_string(p)), 1000);
+}
+
+TEST_F(ShmIngestTest, SilentPeerDoesNotStallTheRings)
+{
+	start(10);
+	ShmProducer producer;
+	ASSERT_TRUE(producer.connect(socket_path));
+	ASSERT_TRUE(waitFor([&]
+						{ return ingest->counters().producers == 1; }));
+
+	// Connects but never sends its hello
+	int silent = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+	ASSERT_EQ(connect(silent, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	const auto pushed = std::chrono::steady_clock::now();
+	ASSERT_TRUE(producer.push(7, 42));
+	ASSERT_TRUE(waitFor([&]
+						{ return seen() == 1; }));
+	EXPECT_LT(std::chrono::steady_clock::now() - pushed, std::chrono::milliseconds(500));
+
+	// Dropped once the handshake times out
+	pollfd closed{silent, POLLIN, 0};
+	ASSERT_EQ(poll(&closed, 1, 5000), 1);
+	char byte;
+	EXPECT_EQ(recv(silent, &byte, 1, 0), 0);
+	::close(silent);
+	EXPECT_EQ(ingest->counters().producers, 1u);
+}
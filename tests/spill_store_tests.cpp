@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+#include <common/SpillStore.h>
+
+namespace
+{
+	std::string recordFor(int32_t key, int version)
+	{
+		return "record-" + std::to_string(key) + "-" + std::to_string(version) + std::string(key % 40, 'x');
+	}
+}
+
+TEST(SpillStoreTest, RecordsSurviveBlockFlushesAndReplacement)
+{
+	const std::string path = testing::TempDir() + "spill_store_round_trip";
+	SpillStore store;
+	ASSERT_TRUE(store.open(path));
+
+	std::map<int32_t, std::string> reference;
+	for (int32_t key = 0; key < 20000; ++key)
+	{
+		ASSERT_TRUE(store.put(key, recordFor(key, 0)));
+		reference[key] = recordFor(key, 0);
+	}
+	// Replace some records and erase others, in blocks on disk and in the pending one
+	for (int32_t key = 0; key < 20000; key += 7)
+	{
+		ASSERT_TRUE(store.put(key, recordFor(key, 1)));
+		reference[key] = recordFor(key, 1);
+	}
+	for (int32_t key = 3; key < 20000; key += 11)
+	{
+		EXPECT_TRUE(store.erase(key));
+		reference.erase(key);
+	}
+	EXPECT_FALSE(store.erase(-5));
+	EXPECT_FALSE(store.get(-5).has_value());
+
+	ASSERT_EQ(store.size(), reference.size());
+	EXPECT_GT(store.fileBytes(), 0u);
+	for (const auto &[key, record] : reference)
+	{
+		auto stored = store.get(key);
+		ASSERT_TRUE(stored.has_value()) << key;
+		ASSERT_EQ(*stored, record) << key;
+	}
+
+	size_t keys = 0;
+	store.forEachKey([&](int32_t key)
+					 {
+		EXPECT_TRUE(reference.contains(key));
+		++keys; });
+	EXPECT_EQ(keys, reference.size());
+
+	store.close();
+	EXPECT_NE(::access(path.c_str(), F_OK), 0);
+}
+
+TEST(SpillStoreTest, CompactionDropsDeadRecords)
+{
+	const std::string path = testing::TempDir() + "spill_store_compaction";
+	SpillStore store;
+	ASSERT_TRUE(store.open(path));
+
+	std::mt19937 rng(3);
+	std::map<int32_t, std::string> reference;
+	for (int round = 0; round < 20; ++round)
+	{
+		for (int32_t key = 0; key < 5000; ++key)
+		{
+			std::string record = recordFor(key, round) + std::to_string(rng());
+			ASSERT_TRUE(store.put(key, record));
+			reference[key] = record;
+		}
+	}
+
+	// Twenty versions were written, but compaction keeps the file near one
+	uint64_t live_bytes = 0;
+	for (const auto &[key, record] : reference)
+	{
+		live_bytes += record.size();
+	}
+	EXPECT_LT(store.fileBytes(), 3 * live_bytes);
+
+	for (int32_t key = 0; key < 5000; key += 2)
+	{
+		store.erase(key);
+		reference.erase(key);
+	}
+	for (const auto &[key, record] : reference)
+	{
+		ASSERT_EQ(store.get(key), record) << key;
+	}
+
+	store.clear();
+	EXPECT_EQ(store.size(), 0u);
+	EXPECT_EQ(store.fileBytes(), 0u);
+	EXPECT_FALSE(store.get(1).has_value());
+	ASSERT_TRUE(store.put(1, "again"));
+	EXPECT_EQ(store.get(1), "again");
+}
+
+TEST(SpillStoreTest, OpenFailsForMissingDirectory)
+{
+	SpillStore store;
+	EXPECT_FALSE(store.open(testing::TempDir() + "missing-dir/spill"));
+	EXPECT_FALSE(store.isOpen());
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include <common/Tracer.h>
+
+TEST(TracerTest, ZonesOutsideACaptureAreNotRecorded)
+{
+	{
+		Tracer::Zone zone("TracerTest.idle");
+	}
+	const std::string trace = Tracer::capture(0);
+	EXPECT_EQ(trace.find("TracerTest.idle"), std::string::npos);
+	EXPECT_NE(trace.find(R"("traceEvents":[)"), std::string::npos);
+	EXPECT_NE(trace.find(std::string(R"("tracing_compiled_in":)") + (Tracer::ENABLED ? "true" : "false")),
+			  std::string::npos);
+}
+
+TEST(TracerTest, CapturesZonesOfEveryThread)
+{
+	std::atomic<bool> stop{false};
+	std::thread worker([&]
+					   {
+		Tracer::setThreadName("TracerTest.worker");
+		while (!stop)
+		{
+			Tracer::Zone zone("TracerTest.step");
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		} });
+
+	const std::string trace = Tracer::capture(30);
+	stop = true;
+	worker.join();
+
+	EXPECT_NE(trace.find(R"("name":"TracerTest.step","ph":"X","ts":)"), std::string::npos);
+	EXPECT_NE(trace.find(R"("name":"thread_name","ph":"M")"), std::string::npos);
+	EXPECT_NE(trace.find(R"("args":{"name":"TracerTest.worker"})"), std::string::npos);
+	EXPECT_FALSE(Tracer::recording());
+}
+
+TEST(TracerTest, KeepsOnlyTheNewestEventsOfAFullBuffer)
+{
+	std::thread writer([]
+					   {
+		const Clock::Ticks soon = Clock::ticks() + Clock::fromSeconds(0.005);
+		// Timestamps in the future so they fall inside the next capture
+		for (size_t i = 0; i < Tracer::BUFFER_EVENTS; ++i)
+			Tracer::record("TracerTest.old", soon, soon + 1);
+		for (size_t i = 0; i < 10; ++i)
+			Tracer::record("TracerTest.new", soon, soon + 1); });
+	writer.join();
+
+	// The window covers the timestamps above
+	const std::string trace = Tracer::capture(50);
+	size_t count = 0;
+	for (size_t pos = trace.find("TracerTest.new"); pos != std::string::npos; pos = trace.find("TracerTest.new", pos + 1))
+		++count;
+	EXPECT_EQ(count, 10u);
+	EXPECT_NE(trace.find("TracerTest.old"), std::string::npos);
+}
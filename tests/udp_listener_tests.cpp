@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <codec/Codec.h>
+#include <server/RequestHandler.h>
+#include <server/UdpListener.h>
+
+class UdpListenerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		handler = std::make_unique<RequestHandler>();
+		ASSERT_TRUE(listener.open("127.0.0.1", 0));
+		ASSERT_GT(listener.port(), 0);
+
+		sender = socket(AF_INET, SOCK_DGRAM, 0);
+		ASSERT_GE(sender, 0);
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<uint16_t>(listener.port()));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	}
+
+	void TearDown() override { close(sender); }
+
+	void send(const std::string &datagram)
+	{
+		ASSERT_EQ(sendto(sender, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr *>(&address),
+						 sizeof(address)),
+				  static_cast<ssize_t>(datagram.size()));
+	}
+
+	// Loopback datagrams are queued by the time sendto() returns
+	size_t drainAll()
+	{
+		size_t total = 0;
+		while (size_t read = listener.drain(*handler))
+		{
+			total += read;
+		}
+		return total;
+	}
+
+	std::unique_ptr<RequestHandler> handler;
+	UdpListener listener;
+	int sender = -1;
+	sockaddr_in address{};
+};
+
+TEST_F(UdpListenerTest, AppliesDatagramsInEveryFormat)
+{
+	send(R"({"id":5,"name":"Udp","phone":"+1234567890","number":10})");
+	send(codec::encodeMsgPack(UserData(5, "Udp", "+1234567890", 20)));
+	send(codec::encodeCbor(UserData(6, "Udp", "+1234567890", 30)));
+	send("{");
+	send(R"({"id":7,"number":1})");
+
+	EXPECT_EQ(drainAll(), 5u);
+	EXPECT_EQ(handler->getClientNumbersSum("user_5"), 30);
+	EXPECT_EQ(handler->getClientNumbersSum("user_6"), 30);
+	EXPECT_EQ(handler->getClientNumbersSum("user_7"), 0);
+	EXPECT_EQ(handler->getTotalNumbersSum(), 60);
+	// No replies, and none of it counts as an HTTP request
+	EXPECT_EQ(handler->getRequestsProcessed(), 0u);
+
+	const auto &counters = listener.counters();
+	EXPECT_EQ(counters.datagrams, 5u);
+	EXPECT_EQ(counters.applied, 3u);
+	EXPECT_EQ(counters.parse_errors, 2u);
+	EXPECT_EQ(counters.truncated, 0u);
+	EXPECT_GE(counters.lag_seconds_sum, 0.0);
+}
+
+TEST_F(UdpListenerTest, ReadsMoreThanOneBatch)
+{
+	const size_t count = UdpListener::BATCH * 3 + 5;
+	for (size_t i = 0; i < count; ++i)
+	{
+		send(R"({"id":1,"name":"Udp","phone":"+1234567890","number":1})");
+	}
+
+	EXPECT_EQ(drainAll(), count);
+	EXPECT_EQ(handler->getClientNumbersSum("user_1"), static_cast<long long>(count));
+	EXPECT_EQ(listener.drain(*handler), 0u);
+}
+
+TEST_F(UdpListenerTest, CountsTruncatedDatagrams)
+{
+	send(std::string(UdpListener::MAX_DATAGRAM + 100, ' '));
+	EXPECT_EQ(drainAll(), 1u);
+	EXPECT_EQ(listener.counters().truncated, 1u);
+	EXPECT_EQ(listener.counters().parse_errors, 0u);
+}
+
+TEST(UdpListenerFormatTest, DetectsFormatFromFirstByte)
+{
+	EXPECT_EQ(UdpListener::detectFormat(R"({"id":1})"), codec::Format::Json);
+	EXPECT_EQ(UdpListener::detectFormat(" {}"), codec::Format::Json);
+	EXPECT_EQ(UdpListener::detectFormat(""), codec::Format::Json);
+	EXPECT_EQ(UdpListener::detectFormat(codec::encodeMsgPack(UserData(1, "a", "b", 2))), codec::Format::MsgPack);
+	EXPECT_EQ(UdpListener::detectFormat(codec::encodeCbor(UserData(1, "a", "b", 2))), codec::Format::Cbor);
+	EXPECT_EQ(UdpListener::detectFormat("\xde\x00\x01"), codec::Format::MsgPack);
+}